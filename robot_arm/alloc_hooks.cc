@@ -0,0 +1,74 @@
+// Global operator new/delete replacements for alloc_stats.hpp.
+// Only compiled with -DROBOT_ARM_ALLOC_STATS=ON (see CMakeLists.txt).
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include "alloc_stats.hpp"
+
+static void *countedAlloc(std::size_t n)
+{
+    void *p = std::malloc(n ? n : 1);
+    if (p) alloc_stats::on_alloc(n);
+    return p;
+}
+
+static void *countedAlignedAlloc(std::size_t n, std::align_val_t al)
+{
+    const std::size_t a = std::max<std::size_t>((std::size_t)al, sizeof(void *));
+    void *p = nullptr;
+    if (posix_memalign(&p, a, n ? n : 1) != 0) return nullptr;
+    alloc_stats::on_alloc(n);
+    return p;
+}
+
+static void countedFree(void *p) noexcept
+{
+    if (!p) return;
+    alloc_stats::on_free();
+    std::free(p);
+}
+
+void *operator new(std::size_t n)
+{
+    if (void *p = countedAlloc(n)) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](std::size_t n)
+{
+    if (void *p = countedAlloc(n)) return p;
+    throw std::bad_alloc();
+}
+void *operator new(std::size_t n, const std::nothrow_t &) noexcept { return countedAlloc(n); }
+void *operator new[](std::size_t n, const std::nothrow_t &) noexcept { return countedAlloc(n); }
+
+void *operator new(std::size_t n, std::align_val_t al)
+{
+    if (void *p = countedAlignedAlloc(n, al)) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](std::size_t n, std::align_val_t al)
+{
+    if (void *p = countedAlignedAlloc(n, al)) return p;
+    throw std::bad_alloc();
+}
+void *operator new(std::size_t n, std::align_val_t al, const std::nothrow_t &) noexcept
+{
+    return countedAlignedAlloc(n, al);
+}
+void *operator new[](std::size_t n, std::align_val_t al, const std::nothrow_t &) noexcept
+{
+    return countedAlignedAlloc(n, al);
+}
+
+void operator delete(void *p) noexcept { countedFree(p); }
+void operator delete[](void *p) noexcept { countedFree(p); }
+void operator delete(void *p, std::size_t) noexcept { countedFree(p); }
+void operator delete[](void *p, std::size_t) noexcept { countedFree(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { countedFree(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { countedFree(p); }
+void operator delete(void *p, std::align_val_t) noexcept { countedFree(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { countedFree(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { countedFree(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { countedFree(p); }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept { countedFree(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept { countedFree(p); }
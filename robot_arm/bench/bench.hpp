@@ -0,0 +1,289 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <json/json.h>
+
+#include "perf_counters.hpp"
+
+/*
+    Minimal benchmark harness for robot_arm_bench.
+
+    A case is a name, a list of parameters and a function that runs its body
+    State::iterations times (setup before State::reset_timer() is not timed).
+    The runner calibrates the iteration count so one repetition lasts at
+    least min_time, runs `reps` repetitions (case by case, or interleaved
+    across cases for the regression gate) and reports
+    the median ns/op together with the per-repetition samples (consumed by
+    the regression gate), ns/sample, heap allocations per op (operator new
+    is counted by bench_main.cc) and response bytes. With Options::perf the
+    timed loops are also measured with hardware counters (perf_counters.hpp):
+    IPC and cache / branch misses per sample.
+*/
+
+namespace bench {
+
+// Heap allocations seen by the replaced global operator new (bench_main.cc)
+inline std::atomic<uint64_t> g_allocs{0};
+inline std::atomic<uint64_t> g_alloc_bytes{0};
+
+// Keeps the optimizer from discarding a computed value
+template <class T>
+inline void do_not_optimize(const T &v)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(v) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &v;
+#endif
+}
+
+struct State {
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t iterations = 1;
+    size_t samples_per_op = 1;     // trajectory samples produced per op (ns/sample)
+    size_t bytes_per_op = 0;       // response bytes per op (serializers)
+    bool perf = false;             // read hardware counters around the timed loop
+
+    // Excludes the setup done so far (inputs built before the timed loop)
+    void reset_timer()
+    {
+        allocs0 = g_allocs.load(std::memory_order_relaxed);
+        bytes0 = g_alloc_bytes.load(std::memory_order_relaxed);
+        if (perf) perf::Counters::thread().read(perf0);
+        t0 = Clock::now();
+    }
+
+    Clock::time_point t0;
+    uint64_t allocs0 = 0, bytes0 = 0;
+    perf::Reading perf0;
+};
+
+using Param = std::pair<std::string, std::string>;
+
+struct Case {
+    std::string name;              // e.g. plan_pmp_minimum_jerk/dof:6/n:1000
+    std::vector<Param> params;
+    std::function<void(State &)> fn;
+};
+
+struct Result {
+    std::string name;
+    std::vector<Param> params;
+    uint64_t iterations = 0;       // per repetition
+    std::vector<double> ns_per_op; // one sample per repetition
+    double median_ns = 0.0;
+    double ns_per_sample = 0.0;
+    double allocs_per_op = 0.0;
+    double alloc_bytes_per_op = 0.0;
+    size_t samples_per_op = 0;
+    size_t bytes_per_op = 0;
+    perf::Reading perf;            // summed over the repetitions (Options::perf)
+    uint64_t perf_ops = 0;         // ops covered by perf
+};
+
+struct Options {
+    std::string filter;            // substring of the case name
+    double min_time = 0.05;        // seconds per repetition
+    int reps = 5;
+    bool perf = false;             // hardware counters (needs perf::Counters::available())
+};
+
+inline std::string case_name(const std::string &base, const std::vector<Param> &params)
+{
+    std::string name = base;
+    for (const auto &p : params) name += "/" + p.first + ":" + p.second;
+    return name;
+}
+
+inline double median(std::vector<double> v)
+{
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    const size_t m = v.size() / 2;
+    return v.size() % 2 ? v[m] : 0.5 * (v[m - 1] + v[m]);
+}
+
+// Seconds of one repetition of c at st.iterations
+inline double time_case(const Case &c, State &st)
+{
+    st.reset_timer();
+    c.fn(st);
+    return std::chrono::duration<double>(State::Clock::now() - st.t0).count();
+}
+
+// Grows the iteration count until one repetition lasts min_time
+inline void calibrate(const Case &c, State &st, const Options &opt)
+{
+    st.iterations = 1;
+    for (;;) {
+        const double s = time_case(c, st);
+        if (s >= opt.min_time || st.iterations >= (1ull << 40)) break;
+        const double grow = s > 0.0 ? std::min(10.0, 1.5 * opt.min_time / s) : 10.0;
+        st.iterations = std::max<uint64_t>(st.iterations + 1, (uint64_t)((double)st.iterations * grow));
+    }
+}
+
+// Adds one timed repetition to r
+inline void run_repetition(const Case &c, State &st, Result &r)
+{
+    const double s = time_case(c, st);
+    perf::Reading end;
+    if (st.perf && perf::Counters::thread().read(end)) {
+        const perf::Reading d = perf::delta(st.perf0, end);
+        r.perf.valid = r.perf_ops ? (r.perf.valid & d.valid) : d.valid;
+        for (size_t e = 0; e < perf::kEvents; ++e) r.perf.value[e] += d.value[e];
+        r.perf_ops += st.iterations;
+    }
+    r.ns_per_op.push_back(s * 1e9 / (double)st.iterations);
+    r.allocs_per_op = (double)(g_allocs.load(std::memory_order_relaxed) - st.allocs0) / (double)st.iterations;
+    r.alloc_bytes_per_op = (double)(g_alloc_bytes.load(std::memory_order_relaxed) - st.bytes0) / (double)st.iterations;
+}
+
+inline Result make_result(const Case &c, const State &st, Result r)
+{
+    r.name = c.name;
+    r.params = c.params;
+    r.iterations = st.iterations;
+    r.median_ns = median(r.ns_per_op);
+    r.samples_per_op = st.samples_per_op;
+    r.bytes_per_op = st.bytes_per_op;
+    r.ns_per_sample = r.median_ns / (double)std::max<size_t>(1, st.samples_per_op);
+    return r;
+}
+
+inline Result run_case(const Case &c, const Options &opt)
+{
+    State st;
+    st.perf = opt.perf;
+    calibrate(c, st, opt);
+    Result r;
+    for (int rep = 0; rep < std::max(1, opt.reps); ++rep) run_repetition(c, st, r);
+    return make_result(c, st, std::move(r));
+}
+
+// Repetition k of every case before repetition k + 1 of any: slow drift of the
+// machine (frequency, neighbours) spreads over all samples instead of shifting
+// whole cases, which keeps the regression gate's intervals honest
+inline std::vector<Result> run_interleaved(const std::vector<Case> &cases, const Options &opt)
+{
+    std::vector<State> states(cases.size());
+    std::vector<Result> partial(cases.size());
+    for (size_t i = 0; i < cases.size(); ++i) {
+        states[i].perf = opt.perf;
+        calibrate(cases[i], states[i], opt);
+    }
+    for (int rep = 0; rep < std::max(1, opt.reps); ++rep) {
+        for (size_t i = 0; i < cases.size(); ++i) run_repetition(cases[i], states[i], partial[i]);
+    }
+    std::vector<Result> out;
+    for (size_t i = 0; i < cases.size(); ++i) out.push_back(make_result(cases[i], states[i], std::move(partial[i])));
+    return out;
+}
+
+inline void print_header(const Options &opt)
+{
+    std::printf("%-58s %12s %12s %12s %12s %12s",
+                "benchmark", "ns/op", "ns/sample", "allocs/op", "KB alloc/op", "resp bytes");
+    if (opt.perf) std::printf(" %6s %12s %12s %12s", "IPC", "L1D miss/s", "LLC miss/s", "br miss/s");
+    std::printf("\n");
+}
+
+// Hardware counter e per trajectory sample (per op for cases without samples); -1 if not counted
+inline double perf_per_sample(const Result &r, size_t e)
+{
+    if (!r.perf_ops || !(r.perf.valid & (1u << e))) return -1.0;
+    return (double)r.perf.value[e] / ((double)r.perf_ops * (double)std::max<size_t>(1, r.samples_per_op));
+}
+
+// Instructions per cycle; -1 if not counted
+inline double perf_ipc(const Result &r)
+{
+    const uint32_t both = (1u << perf::kCycles) | (1u << perf::kInstructions);
+    const uint64_t cycles = r.perf.value[perf::kCycles];
+    if (!r.perf_ops || (r.perf.valid & both) != both || !cycles) return -1.0;
+    return (double)r.perf.value[perf::kInstructions] / (double)cycles;
+}
+
+inline void print_result(const Result &r, const Options &opt)
+{
+    std::printf("%-58s %12.1f %12.2f %12.1f %12.1f %12zu",
+                r.name.c_str(), r.median_ns, r.ns_per_sample, r.allocs_per_op,
+                r.alloc_bytes_per_op / 1024.0, r.bytes_per_op);
+    if (opt.perf) {
+        if (perf_ipc(r) < 0.0) std::printf(" %6s", "-");
+        else std::printf(" %6.2f", perf_ipc(r));
+        for (size_t e : {perf::kL1dMisses, perf::kLlcMisses, perf::kBranchMisses}) {
+            const double v = perf_per_sample(r, e);
+            if (v < 0.0) std::printf(" %12s", "-");
+            else std::printf(" %12.3f", v);
+        }
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+}
+
+// { context: {...}, benchmarks: [ {name, params, iterations, median_ns, ns_per_op: [...], ...} ] }
+inline Json::Value to_json(const std::vector<Result> &results, const Options &opt)
+{
+    Json::Value root(Json::objectValue);
+    Json::Value ctx(Json::objectValue);
+    ctx["date"] = (Json::Int64)std::time(nullptr);
+#if defined(__VERSION__)
+    ctx["compiler"] = __VERSION__;
+#endif
+#ifdef NDEBUG
+    ctx["build"] = "release";
+#else
+    ctx["build"] = "debug";
+#endif
+    ctx["hardware_threads"] = std::thread::hardware_concurrency();
+    ctx["repetitions"] = opt.reps;
+    ctx["min_time_s"] = opt.min_time;
+    root["context"] = ctx;
+
+    Json::Value arr(Json::arrayValue);
+    for (const auto &r : results) {
+        Json::Value b(Json::objectValue);
+        b["name"] = r.name;
+        Json::Value params(Json::objectValue);
+        for (const auto &p : r.params) params[p.first] = p.second;
+        b["params"] = params;
+        b["iterations"] = (Json::UInt64)r.iterations;
+        b["median_ns"] = r.median_ns;
+        Json::Value reps(Json::arrayValue);
+        for (double v : r.ns_per_op) reps.append(v);
+        b["ns_per_op"] = reps;
+        b["ns_per_sample"] = r.ns_per_sample;
+        b["samples_per_op"] = (Json::UInt64)r.samples_per_op;
+        b["allocs_per_op"] = r.allocs_per_op;
+        b["alloc_bytes_per_op"] = r.alloc_bytes_per_op;
+        b["bytes_per_op"] = (Json::UInt64)r.bytes_per_op;
+        if (r.perf_ops) {
+            // { ipc, per_sample: {cycles, instructions, l1d_misses, ...} } (uncounted events left out)
+            Json::Value pc(Json::objectValue), per_sample(Json::objectValue);
+            if (perf_ipc(r) >= 0.0) pc["ipc"] = perf_ipc(r);
+            for (size_t e = 0; e < perf::kEvents; ++e) {
+                const double v = perf_per_sample(r, e);
+                if (v >= 0.0) per_sample[perf::eventName(e)] = v;
+            }
+            pc["per_sample"] = per_sample;
+            b["perf"] = pc;
+        }
+        arr.append(b);
+    }
+    root["benchmarks"] = arr;
+    return root;
+}
+
+} // namespace bench
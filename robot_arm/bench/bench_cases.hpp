@@ -0,0 +1,152 @@
+#pragma once
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "trajectory.hpp"   // solve6, quintic_coeffs, plan_minjerk, plan_pmp_minimum_jerk
+#include "plan_codec.hpp"   // serialize_plan
+#include "metrics.hpp"      // metrics::Histogram, metrics::StageTimer (tsc::now)
+
+/*
+    Benchmark cases of the planning core:
+      solve6, quintic_coeffs                 one call
+      plan_minjerk, plan_pmp_minimum_jerk    dof x N (N = T/dt, 10 .. max_n)
+      serialize_plan                         format x channels x N
+      plan_pmp_q                             plan + serialize, the /arm/plan_pmp_q body path
+      metrics                                cost of one always-on /metrics event
+    Moves are T = 1 s from 0 to a spread target; dt = T/N.
+*/
+
+namespace bench {
+
+inline std::vector<double> bench_q(size_t dof, double scale)
+{
+    std::vector<double> q(dof);
+    for (size_t i = 0; i < dof; ++i) q[i] = scale * (0.3 + 0.1 * (double)i);
+    return q;
+}
+
+inline const char *channels_name(uint32_t ch)
+{
+    return ch == kChanQ ? "q" : "all";
+}
+
+inline std::vector<Case> make_cases(size_t max_n)
+{
+    std::vector<Case> cases;
+    auto add = [&cases](const std::string &base, std::vector<Param> params, std::function<void(State &)> fn) {
+        cases.push_back(Case{case_name(base, params), std::move(params), std::move(fn)});
+    };
+
+    std::vector<size_t> ns;
+    for (size_t n = 10; n <= max_n; n *= 10) ns.push_back(n);
+    const std::vector<size_t> dofs = {1, 6};
+    const uint32_t kChanAll = kChanQ | kChanDq | kChanDdq | kChanU | kChanJacc;
+
+    add("solve6", {}, [](State &st) {
+        const double T = 1.0;
+        std::vector<std::vector<double>> A = {
+            {1, 0, 0, 0, 0, 0},       {0, 1, 0, 0, 0, 0},        {0, 0, 2, 0, 0, 0},
+            {1, T, T * T, T * T * T, T * T * T * T, T * T * T * T * T},
+            {0, 1, 2 * T, 3 * T * T, 4 * T * T * T, 5 * T * T * T * T},
+            {0, 0, 2, 6 * T, 12 * T * T, 20 * T * T * T}};
+        std::vector<double> b = {0.1, 0, 0, 1.2, 0, 0};
+        st.reset_timer();
+        for (uint64_t i = 0; i < st.iterations; ++i) do_not_optimize(solve6(A, b));
+    });
+
+    add("quintic_coeffs", {}, [](State &st) {
+        for (uint64_t i = 0; i < st.iterations; ++i) do_not_optimize(quintic_coeffs(0.1, 0, 0, 1.2, 0, 0, 1.0));
+    });
+
+    for (size_t dof : dofs) {
+        for (size_t n : ns) {
+            const std::vector<Param> params = {{"dof", std::to_string(dof)}, {"n", std::to_string(n)}};
+            add("plan_minjerk", params, [dof, n](State &st) {
+                const auto q0 = bench_q(dof, 0.0), q1 = bench_q(dof, 1.0);
+                st.samples_per_op = n + 1;
+                st.reset_timer();
+                for (uint64_t i = 0; i < st.iterations; ++i) do_not_optimize(plan_minjerk(q0, q1, 1.0, 1.0 / (double)n));
+            });
+        }
+    }
+    for (size_t dof : dofs) {
+        for (size_t n : ns) {
+            const std::vector<Param> params = {{"dof", std::to_string(dof)}, {"n", std::to_string(n)}};
+            add("plan_pmp_minimum_jerk", params, [dof, n](State &st) {
+                const auto q0 = bench_q(dof, 0.0), q1 = bench_q(dof, 1.0);
+                st.samples_per_op = n + 1;
+                st.reset_timer();
+                for (uint64_t i = 0; i < st.iterations; ++i) {
+                    do_not_optimize(plan_pmp_minimum_jerk(q0, q1, 1.0, 1.0 / (double)n));
+                }
+            });
+        }
+    }
+
+    // JSON output of 1e6 samples builds a multi-GB Json::Value tree: capped at 1e5
+    for (PlanFormat format : {PlanFormat::Json, PlanFormat::Binary}) {
+        for (uint32_t ch : {(uint32_t)kChanQ, kChanAll}) {
+            for (size_t n : ns) {
+                if (format == PlanFormat::Json && n > 100000) continue;
+                const std::vector<Param> params = {{"format", format == PlanFormat::Json ? "json" : "bin"},
+                                                   {"channels", channels_name(ch)},
+                                                   {"n", std::to_string(n)}};
+                add("serialize_plan", params, [format, ch, n](State &st) {
+                    const auto traj = plan_pmp_minimum_jerk(bench_q(6, 0.0), bench_q(6, 1.0), 1.0, 1.0 / (double)n);
+                    PlanOptions opt;
+                    opt.format = format;
+                    opt.channels = ch;
+                    st.samples_per_op = traj.size();
+                    st.reset_timer();
+                    for (uint64_t i = 0; i < st.iterations; ++i) {
+                        const std::string body = serialize_plan(traj, 1.0 / (double)n, opt);
+                        st.bytes_per_op = body.size();
+                        do_not_optimize(body);
+                    }
+                });
+            }
+        }
+    }
+
+    // The body of /arm/plan_pmp_q (ArmController::computePlan without the cache)
+    for (PlanFormat format : {PlanFormat::Json, PlanFormat::Binary}) {
+        for (size_t n : {size_t(50), size_t(1000), size_t(100000)}) {
+            if (n > max_n) continue;
+            const std::vector<Param> params = {{"format", format == PlanFormat::Json ? "json" : "bin"},
+                                               {"n", std::to_string(n)}};
+            add("plan_pmp_q", params, [format, n](State &st) {
+                const auto q0 = bench_q(6, 0.0), q1 = bench_q(6, 1.0);
+                const double dt = 1.0 / (double)n;
+                PlanOptions opt;
+                opt.format = format;
+                st.samples_per_op = n + 1;
+                st.reset_timer();
+                for (uint64_t i = 0; i < st.iterations; ++i) {
+                    const std::string body = serialize_plan(plan_pmp_minimum_jerk(q0, q1, 1.0, dt), dt, opt);
+                    st.bytes_per_op = body.size();
+                    do_not_optimize(body);
+                }
+            });
+        }
+    }
+
+    // Recording budget of the always-on metrics: well under 50 ns per event
+    add("metrics/histogram_record", {}, [](State &st) {
+        static metrics::Histogram h;
+        for (uint64_t i = 0; i < st.iterations; ++i) h.record(i * 7919);
+    });
+    // One stage of a chain: it starts at the previous stage's end reading, as in the handlers
+    add("metrics/stage_timer", {}, [](State &st) {
+        uint64_t t = tsc::now();
+        for (uint64_t i = 0; i < st.iterations; ++i) {
+            metrics::StageTimer timer(metrics::Stage::Send, t);
+            timer.stop();
+            t = timer.end();
+        }
+    });
+    return cases;
+}
+
+} // namespace bench
@@ -0,0 +1,150 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <json/json.h>
+
+#include "bench.hpp"
+
+/*
+    Regression gate: compares a run against a stored baseline (the JSON
+    written by robot_arm_bench --json).
+
+    Time: the change of a case is the Hodges-Lehmann estimate of the
+    current/baseline ratio (median of all pairwise ratios of the
+    per-repetition ns/op samples) with a distribution-free 95 % confidence
+    interval from the Mann-Whitney order statistics. A case regresses only
+    when the whole interval lies above 1 + threshold, so one noisy
+    repetition does not fail the gate; an estimate above the threshold
+    with an interval that still includes it is reported as "noisy".
+    Allocations per op are deterministic and are compared directly.
+
+    Every case of the baseline is tracked; a tracked case missing from the
+    run fails the gate too (renamed or removed case: update the baseline).
+*/
+
+namespace bench {
+
+struct Comparison {
+    std::string name;
+    double base_ns = 0.0, cur_ns = 0.0;       // medians
+    double ratio = 1.0;                       // Hodges-Lehmann current / baseline
+    double ci_low = 1.0, ci_high = 1.0;       // 95 % interval of the ratio
+    double base_allocs = 0.0, cur_allocs = 0.0;
+    std::string verdict;                      // ok | faster | noisy | SLOWER | ALLOCS | MISSING
+    bool failed = false;
+};
+
+// Hodges-Lehmann ratio estimate and its ~95 % interval (normal approximation of U)
+inline void ratio_interval(const std::vector<double> &cur, const std::vector<double> &base,
+                           double &ratio, double &lo, double &hi)
+{
+    std::vector<double> d;
+    d.reserve(cur.size() * base.size());
+    for (double c : cur) {
+        for (double b : base) {
+            if (c > 0.0 && b > 0.0) d.push_back(std::log(c / b));
+        }
+    }
+    if (d.empty()) {
+        ratio = lo = hi = 1.0;
+        return;
+    }
+    std::sort(d.begin(), d.end());
+    const double n = (double)cur.size(), m = (double)base.size();
+    const double z = 1.96;
+    const double k_real = n * m / 2.0 - z * std::sqrt(n * m * (n + m + 1.0) / 12.0);
+    const size_t k = (size_t)std::max(0.0, std::floor(k_real));
+    const size_t N = d.size();
+    ratio = std::exp(median(d));
+    lo = std::exp(d[std::min(k, N - 1)]);
+    hi = std::exp(d[N - 1 - std::min(k, N - 1)]);
+}
+
+inline std::vector<Comparison> compare(const Json::Value &baseline, const std::vector<Result> &results,
+                                       double threshold)
+{
+    std::vector<Comparison> out;
+    for (const auto &b : baseline["benchmarks"]) {
+        Comparison c;
+        c.name = b["name"].asString();
+        c.base_ns = b["median_ns"].asDouble();
+        c.base_allocs = b["allocs_per_op"].asDouble();
+
+        auto it = std::find_if(results.begin(), results.end(),
+                               [&c](const Result &r) { return r.name == c.name; });
+        if (it == results.end()) {
+            c.verdict = "MISSING";
+            c.failed = true;
+            out.push_back(c);
+            continue;
+        }
+        std::vector<double> base_samples;
+        for (const auto &v : b["ns_per_op"]) base_samples.push_back(v.asDouble());
+        if (base_samples.empty()) base_samples.push_back(c.base_ns);
+
+        c.cur_ns = it->median_ns;
+        c.cur_allocs = it->allocs_per_op;
+        ratio_interval(it->ns_per_op, base_samples, c.ratio, c.ci_low, c.ci_high);
+
+        const double limit = 1.0 + threshold;
+        if (c.ci_low > limit) {
+            c.verdict = "SLOWER";
+            c.failed = true;
+        } else if (c.cur_allocs > c.base_allocs * limit && c.cur_allocs - c.base_allocs >= 1.0) {
+            c.verdict = "ALLOCS";
+            c.failed = true;
+        } else if (c.ratio > limit) {
+            c.verdict = "noisy";
+        } else if (c.ci_high < 1.0 / limit) {
+            c.verdict = "faster";
+        } else {
+            c.verdict = "ok";
+        }
+        out.push_back(c);
+    }
+    return out;
+}
+
+inline void print_comparison(const std::vector<Comparison> &cmp, double threshold)
+{
+    std::printf("\n%-50s %12s %12s %9s %20s %13s %s\n", "benchmark", "base ns/op", "cur ns/op",
+                "change", "95% CI", "allocs/op", "verdict");
+    size_t failed = 0;
+    for (const auto &c : cmp) {
+        if (c.verdict == "MISSING") {
+            std::printf("%-50s %12.1f %12s %9s %20s %13s %s\n", c.name.c_str(), c.base_ns, "-", "-", "-", "-",
+                        c.verdict.c_str());
+        } else {
+            char ci[64], allocs[64];
+            std::snprintf(ci, sizeof(ci), "[%+.1f%%, %+.1f%%]", (c.ci_low - 1.0) * 100.0, (c.ci_high - 1.0) * 100.0);
+            std::snprintf(allocs, sizeof(allocs), "%.0f -> %.0f", c.base_allocs, c.cur_allocs);
+            std::printf("%-50s %12.1f %12.1f %+8.1f%% %20s %13s %s\n", c.name.c_str(), c.base_ns, c.cur_ns,
+                        (c.ratio - 1.0) * 100.0, ci, allocs, c.verdict.c_str());
+        }
+        failed += c.failed;
+    }
+    if (failed) {
+        std::printf("\nregression gate FAILED: %zu of %zu tracked benchmarks regressed by more than %.0f%%\n",
+                    failed, cmp.size(), threshold * 100.0);
+        for (const auto &c : cmp) {
+            if (!c.failed) continue;
+            if (c.verdict == "MISSING") {
+                std::printf("  %s: not run (renamed or removed? update the baseline)\n", c.name.c_str());
+            } else if (c.verdict == "ALLOCS") {
+                std::printf("  %s: %.0f -> %.0f allocations per op\n", c.name.c_str(), c.base_allocs, c.cur_allocs);
+            } else {
+                std::printf("  %s: %.0f -> %.0f ns/op (x%.2f, at least x%.2f)\n", c.name.c_str(), c.base_ns,
+                            c.cur_ns, c.ratio, c.ci_low);
+            }
+        }
+    } else {
+        std::printf("\nregression gate passed: %zu tracked benchmarks within %.0f%%\n", cmp.size(),
+                    threshold * 100.0);
+    }
+    std::fflush(stdout);
+}
+
+} // namespace bench
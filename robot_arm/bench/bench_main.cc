@@ -0,0 +1,196 @@
+// robot_arm_bench: microbenchmarks of the planning core (see bench_cases.hpp)
+//
+//   robot_arm_bench [--filter=plan_pmp,solve6] [--max-n=1000000] [--reps=5]
+//                   [--min-time=0.05] [--json=bench.json] [--list] [--perf]
+//
+// --perf adds hardware counters per case (IPC, L1D / LLC / branch misses per
+// sample); ignored with a note when the counters are unavailable.
+//
+// Regression gate (bench_compare.hpp): runs the cases of the baseline and
+// exits with 1 when one of them regressed by more than the threshold:
+//
+//   robot_arm_bench --baseline=baseline.json [--threshold=0.2]
+//   robot_arm_bench --baseline=baseline.json --update-baseline
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include "bench.hpp"
+#include "bench_cases.hpp"
+#include "bench_compare.hpp"
+
+// ------------------------------------------------------------
+// Allocation counting: every global operator new is counted
+// (sized/aligned delete variants fall back to these)
+// ------------------------------------------------------------
+#if defined(__GNUC__) && !defined(__clang__)
+// GCC pairs inlined std::allocator calls with our malloc/free and warns spuriously
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void *operator new(std::size_t n)
+{
+    bench::g_allocs.fetch_add(1, std::memory_order_relaxed);
+    bench::g_alloc_bytes.fetch_add(n, std::memory_order_relaxed);
+    if (void *p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t n)
+{
+    return operator new(n);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+static bool argValue(const char *arg, const char *name, std::string &out)
+{
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') return false;
+    out = arg + len + 1;
+    return true;
+}
+
+// --filter=a,b: any of the comma separated substrings
+static bool matches(const std::string &name, const std::string &filter)
+{
+    if (filter.empty()) return true;
+    size_t pos = 0;
+    for (;;) {
+        const size_t comma = filter.find(',', pos);
+        const std::string part = filter.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        if (!part.empty() && name.find(part) != std::string::npos) return true;
+        if (comma == std::string::npos) return false;
+        pos = comma + 1;
+    }
+}
+
+static bool readJson(const std::string &path, Json::Value &out)
+{
+    std::ifstream in(path);
+    Json::CharReaderBuilder builder;
+    std::string errs;
+    return in && Json::parseFromStream(builder, in, &out, &errs);
+}
+
+static bool writeJson(const std::string &path, const Json::Value &v)
+{
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "cannot write " << path << "\n";
+        return false;
+    }
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "  ";
+    out << Json::writeString(builder, v) << "\n";
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    bench::Options opt;
+    std::string json_path, baseline_path, v;
+    size_t max_n = 1000000;
+    double threshold = 0.2;
+    bool list = false, update_baseline = false, reps_set = false, min_time_set = false;
+    for (int i = 1; i < argc; ++i) {
+        if (argValue(argv[i], "--filter", v)) opt.filter = v;
+        else if (argValue(argv[i], "--json", v)) json_path = v;
+        else if (argValue(argv[i], "--reps", v)) opt.reps = std::max(1, std::atoi(v.c_str())), reps_set = true;
+        else if (argValue(argv[i], "--min-time", v)) opt.min_time = std::atof(v.c_str()), min_time_set = true;
+        else if (argValue(argv[i], "--max-n", v)) max_n = std::strtoull(v.c_str(), nullptr, 10);
+        else if (argValue(argv[i], "--baseline", v)) baseline_path = v;
+        else if (argValue(argv[i], "--threshold", v)) threshold = std::atof(v.c_str());
+        else if (std::strcmp(argv[i], "--update-baseline") == 0) update_baseline = true;
+        else if (std::strcmp(argv[i], "--list") == 0) list = true;
+        else if (std::strcmp(argv[i], "--perf") == 0) opt.perf = true;
+        else {
+            std::cerr << "unknown argument: " << argv[i] << "\n"
+                      << "usage: robot_arm_bench [--filter=S[,S...]] [--max-n=N] [--reps=R] "
+                         "[--min-time=SEC] [--json=FILE] [--list] [--perf]\n"
+                         "       [--baseline=FILE [--threshold=0.2] [--update-baseline]]\n";
+            return 2;
+        }
+    }
+
+    // With a baseline, its cases (and its repetition settings) define the run
+    Json::Value baseline;
+    std::vector<std::string> tracked;
+    if (!baseline_path.empty()) {
+        if (!readJson(baseline_path, baseline)) {
+            std::cerr << "cannot read baseline " << baseline_path << "\n";
+            return 2;
+        }
+        for (const auto &b : baseline["benchmarks"]) tracked.push_back(b["name"].asString());
+
+        // Debug and release timings are not comparable: skipped (exit 77, SKIP_RETURN_CODE in ctest)
+        const std::string build = bench::to_json({}, opt)["context"]["build"].asString();
+        const std::string base_build = baseline["context"]["build"].asString();
+        if (!update_baseline && build != base_build) {
+            std::cout << "regression gate skipped: " << build << " build, baseline is " << base_build << "\n";
+            return 77;
+        }
+        if (!reps_set) opt.reps = baseline["context"].get("repetitions", opt.reps).asInt();
+        if (!min_time_set) opt.min_time = baseline["context"].get("min_time_s", opt.min_time).asDouble();
+    }
+
+    std::vector<bench::Case> cases;
+    for (auto &c : bench::make_cases(max_n)) {
+        if (!matches(c.name, opt.filter)) continue;
+        if (!tracked.empty() && std::find(tracked.begin(), tracked.end(), c.name) == tracked.end()) continue;
+        if (list) std::cout << c.name << "\n";
+        else cases.push_back(std::move(c));
+    }
+
+    if (opt.perf && !perf::Counters::thread().available()) {
+        std::cerr << "--perf ignored: " << perf::Counters::thread().reason() << "\n";
+        opt.perf = false;
+    }
+
+    std::vector<bench::Result> results;
+    if (!list) bench::print_header(opt);
+    if (!baseline_path.empty()) {
+        results = bench::run_interleaved(cases, opt);
+        for (const auto &r : results) bench::print_result(r, opt);
+    } else {
+        for (const auto &c : cases) {
+            results.push_back(bench::run_case(c, opt));
+            bench::print_result(results.back(), opt);
+        }
+    }
+
+    if (!json_path.empty() && !writeJson(json_path, bench::to_json(results, opt))) return 1;
+    if (baseline_path.empty() || list) return 0;
+
+    if (update_baseline) {
+        if (!writeJson(baseline_path, bench::to_json(results, opt))) return 1;
+        std::cout << "baseline " << baseline_path << " updated (" << results.size() << " benchmarks)\n";
+        return 0;
+    }
+    const auto cmp = bench::compare(baseline, results, threshold);
+    bench::print_comparison(cmp, threshold);
+    for (const auto &c : cmp) {
+        if (c.failed) return 1;
+    }
+    return 0;
+}
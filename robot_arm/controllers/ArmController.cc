@@ -5,123 +5,2062 @@
 #include <vector>
 #include <json/json.h>
 #include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <condition_variable>
 
 #include "trajectory.hpp"         // plan_pmp_minimum_jerk(...)
+#include "plan_codec.hpp"         // serialize_plan(...)
+#include "trajectory_store.hpp"   // TrajectoryStore
+#include "admission.hpp"          // estimate_plan_bytes(...)
+#include "execution_engine.hpp"   // ExecutionEngine
+#include "alloc_stats.hpp"        // alloc_stats::Scope
+#include "perf_counters.hpp"      // perf::Scope
+#include "metrics.hpp"            // metrics::StageTimer
+#include "trace.hpp"              // trace::Span
+#include "tsc_clock.hpp"          // tsc::now
+#include "request_log.hpp"        // reqlog::Recorder
+#include "memory_accounting.hpp"  // memacct::usage
+#include "warmup.hpp"             // Readiness
+#include <stdexcept>
+#include <trantor/net/EventLoop.h>
+#include <trantor/net/TcpConnection.h>
+#include <trantor/utils/Logger.h>
+#include <atomic>
+#include <thread>
+#include <chrono>
 
 using namespace drogon;
 
-// Helper: takes q of size 3/4/6 and returns JSON array always of size 6 (pads missing with zeros)
-static Json::Value to_q6_json(const std::vector<double> &q_in)
+// Helper: custom_config.<name> section from the loaded config file (null if absent)
+static const Json::Value &customSection(const char *name)
 {
-    Json::Value q(Json::arrayValue);
-    for (int i = 0; i < 6; ++i) {
-        double v = (i < (int)q_in.size()) ? q_in[i] : 0.0;
-        q.append(v);
-    }
-    return q;
+    return app().getCustomConfig()[name];
 }
 
-// Constructor: initializes internal dynamics model for 6 DOF and sets state to zeros
-ArmController::ArmController()
-    : dyn_(6)
+// Helper: Retry-After seconds for overload responses (custom_config.admission.retry_after_s)
+static int retryAfterSeconds()
 {
-    dyn_.setState({0,0,0,0,0,0}, {0,0,0,0,0,0});
+    static const int secs = customSection("admission").get("retry_after_s", 1).asInt();
+    return secs;
 }
 
-// HTTP handler: POST /arm/plan_pmp_q
-void ArmController::handlePlanPMP_Q(const HttpRequestPtr &req,
-                                   std::function<void (const HttpResponsePtr &)> &&callback)
+// Helper: error response in the same form as the original handler (JSON string + status)
+static HttpResponsePtr makeError(const std::string &msg, HttpStatusCode code = k400BadRequest)
+{
+    auto resp = HttpResponse::newHttpJsonResponse(Json::Value(msg));
+    resp->setStatusCode(code);
+    return resp;
+}
+
+// Helper: overload response (429/503) with a Retry-After hint
+static HttpResponsePtr makeOverloaded(const std::string &msg, HttpStatusCode code)
+{
+    auto resp = makeError(msg, code);
+    resp->addHeader("Retry-After", std::to_string(retryAfterSeconds()));
+    return resp;
+}
+
+// Helper: JSON body of a request; falls back to manual parsing when Content-Type is not JSON.
+// Returns nullptr on a malformed body.
+static std::shared_ptr<Json::Value> requestJson(const HttpRequestPtr &req)
 {
     // Try to get JSON directly from request (if Content-Type is application/json)
     auto json = req->getJsonObject();
+    if (json) return json;
 
     // Fallback: manually parse body if getJsonObject() returned null
+    auto root = std::make_shared<Json::Value>();
+    const auto& raw = req->getBody();
+    Json::CharReaderBuilder b;
+    std::string errs;
+    std::unique_ptr<Json::CharReader> reader(b.newCharReader());
+    if (!reader->parse(raw.data(), raw.data() + raw.size(), root.get(), &errs)) return nullptr;
+    return root;
+}
+
+// Helper: reads the first 6 values of a JSON array (rad); false if not an array of >= 6
+// or if any of them is not finite
+static bool readQ6(const Json::Value &arr, std::vector<double> &out)
+{
+    if (!arr.isArray() || arr.size() < 6) return false;
+    out.resize(6);
+    for (Json::ArrayIndex i = 0; i < 6; ++i) {
+        if (!arr[i].isNumeric()) return false;
+        out[i] = arr[i].asDouble();
+        if (!std::isfinite(out[i])) return false;
+    }
+    return true;
+}
+
+// Longest accepted move duration T (s) of /arm/plan_pmp_q and /arm/execute: beyond it the
+// engine's std::chrono time points would overflow
+static constexpr double kMaxT = 3600.0;
+
+// Helper: optional "T" of a request body (default 1 s): a number in (0, kMaxT]
+static bool readT(const Json::Value &body, double &out)
+{
+    out = 1.0;
+    if (!body.isMember("T")) return true;
+    if (!body["T"].isNumeric()) return false;
+    out = body["T"].asDouble();
+    return std::isfinite(out) && out > 0.0 && out <= kMaxT;
+}
+
+// Helper: robot index from the JSON body ("robot") or the query (?robot=), default 0
+static bool readRobotId(const HttpRequestPtr &req, const Json::Value &body, size_t &out)
+{
+    if (body.isObject() && body.isMember("robot")) {
+        if (!body["robot"].isUInt()) return false;
+        out = body["robot"].asUInt();
+        return true;
+    }
+    const auto &v = req->getParameter("robot");
+    if (v.empty()) {
+        out = 0;
+        return true;
+    }
+    char *end = nullptr;
+    const unsigned long id = std::strtoul(v.c_str(), &end, 10);
+    if (*end != '\0' || v[0] == '-') return false;
+    out = id;
+    return true;
+}
+
+// Helper: { robot, status, seq, t, T, speed, rate, q, dq, ddq } of an engine snapshot
+static Json::Value stateJson(size_t robot, const ExecutionEngine::Snapshot &st)
+{
+    Json::Value out(Json::objectValue);
+    out["robot"] = (Json::UInt64)robot;
+    out["status"] = ExecutionEngine::statusName(st.status);
+    out["seq"] = (Json::UInt64)st.seq;
+    out["t"] = st.t;
+    out["T"] = st.T;
+    out["speed"] = st.speed;
+    out["rate"] = st.rate;
+    out["q"] = plan_vec6_json(st.q);
+    out["dq"] = plan_vec6_json(st.dq);
+    out["ddq"] = plan_vec6_json(st.ddq);
+    out["unit"] = "rad";
+    return out;
+}
+
+// Helper: response carrying an already serialized plan body
+static HttpResponsePtr makePlanResponse(const char *body, size_t size, PlanFormat format)
+{
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setContentTypeCode(format == PlanFormat::Binary ? CT_APPLICATION_OCTET_STREAM
+                                                          : CT_APPLICATION_JSON);
+    resp->setBody(body, size);
+    metrics::recordResponseBytes(size);
+    return resp;
+}
+
+static HttpResponsePtr makePlanResponse(const std::string &body, PlanFormat format)
+{
+    return makePlanResponse(body.data(), body.size(), format);
+}
+
+// Helper: one move of custom_config.warmup.moves or of the cache snapshot, in the request layout:
+// {"q0": [6] (default: zero pose, the state at startup), "q_target": [6], "T", "dt", "format", "channels"}
+static bool readMove(const Json::Value &v, PlanMove &m)
+{
+    if (!v.isObject() || !readQ6(v["q_target"], m.q1)) return false;
+    if (!v.isMember("q0")) m.q0.assign(6, 0.0);
+    else if (!readQ6(v["q0"], m.q0)) return false;
+    m.T = v.get("T", 1.0).asDouble();
+    m.dt = v.get("dt", 0.02).asDouble();
+    if (!std::isfinite(m.T) || !std::isfinite(m.dt)) return false;
+    if (!parse_plan_format(v.get("format", "json").asString(), m.opt.format)) return false;
+    return !v.isMember("channels") || parse_plan_channels(v["channels"], m.opt.channels);
+}
+
+static Json::Value moveJson(const PlanMove &m)
+{
+    Json::Value v(Json::objectValue);
+    v["q0"] = plan_vec6_json(m.q0);
+    v["q_target"] = plan_vec6_json(m.q1);
+    v["T"] = m.T;
+    v["dt"] = m.dt;
+    v["format"] = m.opt.format == PlanFormat::Binary ? "bin" : "json";
+    v["channels"] = plan_channels_json(m.opt.channels);
+    return v;
+}
+
+// Helper: first use on this thread of the JSON reader and writer, both plan codecs
+// and the trace ring (lazy initialization otherwise paid by the first requests)
+static void warmThread()
+{
+    static const char kRequest[] = R"({"q_target":[0.1,0.2,0.3,0.4,0.5,0.6],"T":0.2,"dt":0.01})";
     Json::Value root;
-    if (!json) {
-        const auto& body = req->getBody();
-        Json::CharReaderBuilder b;
+    std::string errs;
+    Json::CharReaderBuilder b;
+    std::unique_ptr<Json::CharReader> reader(b.newCharReader());
+    reader->parse(kRequest, kRequest + sizeof(kRequest) - 1, &root, &errs);
+
+    std::vector<double> q1;
+    if (!readQ6(root["q_target"], q1)) return;
+    const auto traj = plan_pmp_minimum_jerk(std::vector<double>(6, 0.0), q1, 0.2, 0.01);
+    PlanOptions opt;
+    opt.channels = kChanQ | kChanDq | kChanDdq | kChanU | kChanJacc;
+    serialize_plan(traj, 0.01, opt);
+    opt.format = PlanFormat::Binary;
+    serialize_plan(traj, 0.01, opt);
+    trace::prepareThread();
+}
+
+// Helper: Server-Timing header of a plan response (durations in ms; stages that did not
+// run for this response, e.g. plan on a cache hit, are left out), e.g.
+//   decode;dur=0.021, plan;dur=1.304, serialize;dur=0.512, samples;desc="1001"
+static void addServerTiming(const HttpResponsePtr &resp, uint64_t decode_ns, uint64_t plan_ns,
+                            uint64_t serialize_ns, size_t samples, bool cache_hit = false)
+{
+    char buf[192];
+    int n = 0;
+    const uint64_t durs[3] = {decode_ns, plan_ns, serialize_ns};
+    const char *names[3] = {"decode", "plan", "serialize"};
+    for (int i = 0; i < 3; ++i) {
+        if (durs[i]) n += std::snprintf(buf + n, sizeof(buf) - n, "%s;dur=%.3f, ", names[i], (double)durs[i] / 1e6);
+    }
+    if (cache_hit) n += std::snprintf(buf + n, sizeof(buf) - n, "cache;desc=\"hit\", ");
+    std::snprintf(buf + n, sizeof(buf) - n, "samples;desc=\"%zu\"", samples);
+    resp->addHeader("Server-Timing", buf);
+}
+
+// Helper: per-request allocation log line (custom_config.alloc_stats.log_requests) and
+// aggregate; no-op unless built with ROBOT_ARM_ALLOC_STATS
+static void finishAllocStats(const char *route, const alloc_stats::RequestUsage &usage)
+{
+    if (!alloc_stats::kEnabled) return;
+    alloc_stats::finishRequest(usage);
+    static const bool log = customSection("alloc_stats").get("log_requests", true).asBool();
+    if (log) LOG_INFO << "alloc " << route << " " << alloc_stats::format(usage);
+}
+
+// Constructor: reads custom_config; robots start idle at the zero pose (ExecutionEngine)
+ArmController::ArmController()
+{
+    const auto ctor_start = Readiness::Clock::now();
+
+    // Plan cache settings: custom_config.plan_cache
+    const auto &cfg = customSection("plan_cache");
+    cache_enabled_   = cfg.get("enabled", true).asBool();
+    cache_q_quantum_ = cfg.get("q_quantum", 1e-6).asDouble();
+    cache_t_quantum_ = cfg.get("t_quantum", 1e-6).asDouble();
+    for (double *quantum : {&cache_q_quantum_, &cache_t_quantum_}) {
+        if (!(*quantum > 0.0) || !std::isfinite(*quantum)) {
+            LOG_WARN << "plan_cache: quanta must be finite and > 0, using 1e-6";
+            *quantum = 1e-6;
+        }
+    }
+    const double capacity_mb = cfg.get("capacity_mb", 64.0).asDouble();
+    const unsigned shards    = cfg.get("shards", 16).asUInt();
+    cache_ = std::make_unique<PlanCache>((size_t)(capacity_mb * 1024.0 * 1024.0), shards);
+
+    // Stored trajectories: custom_config.trajectory_store
+    const auto &ts = customSection("trajectory_store");
+    store_ = std::make_unique<TrajectoryStore>(ts.get("max_entries", 10000).asUInt(),
+                                               ts.get("ttl_s", 300.0).asDouble());
+    max_window_samples_ = ts.get("max_window_samples", 200000).asUInt();
+
+    // Planning workers: custom_config.worker_pool (threads = 0: one per hardware thread)
+    // Requests costing more than inline_max_cost (samples x dof) are planned off the IO thread
+    const auto &wp = customSection("worker_pool");
+    std::vector<int> cpus;
+    for (const auto &c : wp["cpus"]) cpus.push_back(c.asInt());
+    if (cpus.empty() && wp.get("pin_cores", false).asBool()) {
+        const unsigned n = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 0; i < n; ++i) cpus.push_back((int)i);
+    }
+    workers_ = std::make_unique<WorkerPool>(wp.get("threads", 0).asUInt(),
+                                            wp.get("max_queue", 1024).asUInt(),
+                                            cpus);
+    inline_max_cost_ = wp.get("inline_max_cost", 3000).asUInt();
+
+    // Admission control: custom_config.admission
+    const auto &ac = customSection("admission");
+    AdmissionControl::Config acfg;
+    admission_enabled_ = ac.get("enabled", true).asBool();
+    acfg.budget_bytes = (uint64_t)(ac.get("budget_mb", 512.0).asDouble() * 1024.0 * 1024.0);
+    acfg.max_request_bytes = (uint64_t)(ac.get("max_request_mb", 256.0).asDouble() * 1024.0 * 1024.0);
+    acfg.max_queue = ac.get("max_queue", 256).asUInt();
+    acfg.max_wait_s = ac.get("max_wait_ms", 2000.0).asDouble() / 1000.0;
+    admission_ = std::make_unique<AdmissionControl>(acfg);
+
+    // Waiters past max_wait are answered with 503 even when nothing completes
+    app().getLoop()->runEvery(0.05, [this]() { admission_->expire(); });
+    batch_max_items_ = customSection("plan_batch").get("max_items", 100000).asUInt();
+
+    // Trajectory execution: custom_config.execution; one periodic tick drives every robot
+    const auto &ex = customSection("execution");
+    ExecutionEngine::Config ecfg;
+    ecfg.max_robots = ex.get("max_robots", 4096).asUInt();
+    ecfg.tick_s = std::max(0.001, ex.get("tick_ms", 10.0).asDouble() / 1000.0);
+    ecfg.wheel_slots = ex.get("wheel_slots", 512).asUInt();
+    ecfg.stop_time_s = ex.get("stop_time_s", 0.3).asDouble();
+    ecfg.start_tolerance = ex.get("start_tolerance", 1e-3).asDouble();
+    ecfg.speed_ramp_s = ex.get("speed_ramp_s", 0.2).asDouble();
+    ecfg.min_speed = ex.get("min_speed", 0.1).asDouble();
+    if (!(ecfg.min_speed >= ExecutionEngine::kMinSpeed)) {
+        LOG_WARN << "execution.min_speed must be >= " << ExecutionEngine::kMinSpeed << ", using "
+                 << ExecutionEngine::kMinSpeed;
+        ecfg.min_speed = ExecutionEngine::kMinSpeed;
+    }
+    ecfg.max_speed = ex.get("max_speed", 1.0).asDouble();
+    engine_ = std::make_unique<ExecutionEngine>(ecfg);
+    LoopMonitor::Config lcfg;
+    lcfg.period_s = ecfg.tick_s;
+    lcfg.deadline_s = ex.get("deadline_ms", 0.0).asDouble() / 1000.0;
+    lcfg.history = customSection("loop_monitor").get("history", 64).asUInt();
+    engine_loop_ = std::make_unique<LoopMonitor>("execution", lcfg);
+    app().getLoop()->runEvery(ecfg.tick_s, [this]() {
+        LoopMonitor::Tick tick(*engine_loop_);
+        engine_->advance(ExecutionEngine::Clock::now());
+    });
+
+    // Stage timings (metrics, Server-Timing): calibrate the TSC before the first request
+    tsc::calibrate();
+
+    // Cancellation: custom_config.cancellation (X-Deadline-Ms overrides the default)
+    default_deadline_ms_ = customSection("cancellation").get("default_deadline_ms", 0.0).asDouble();
+
+    // Hardware counters: every sample_every-th plan request (0 = off), see /debug/perf
+    const auto &pc = customSection("perf_counters");
+    perf_sampler_ = std::make_unique<perf::Sampler>(pc.get("sample_every", 0).asUInt64());
+    if (perf_sampler_->every() && !perf::Counters::thread().available()) {
+        LOG_WARN << "perf_counters: " << perf::Counters::thread().reason() << "; requests are not measured";
+    }
+
+    // Request tracing: custom_config.tracing (sample_every = 0: only /debug/trace capture windows)
+    const auto &tr = customSection("tracing");
+    trace::setSampleEvery(tr.get("sample_every", 0).asUInt64());
+    trace::setCapacity(tr.get("buffer_events", 16384).asUInt());
+    trace_max_seconds_ = tr.get("max_seconds", 60.0).asDouble();
+
+    // Request recording for robot_arm_replay: custom_config.request_log (off by default)
+    const auto &rl = customSection("request_log");
+    if (rl.get("enabled", false).asBool()) {
+        const std::string path = rl.get("path", "requests.ralog").asString();
+        try {
+            recorder_ = std::make_unique<reqlog::Recorder>(path, rl.get("queue_records", 65536).asUInt(),
+                                                           rl.get("flush_ms", 500.0).asDouble() / 1000.0);
+            LOG_INFO << "request_log: recording plan requests and jog frames to " << path;
+        } catch (const std::exception &e) {
+            LOG_WARN << e.what() << "; requests are not recorded";
+        }
+    }
+
+    // Memory accounting: custom_config.memory; limits per account name, alerts logged and exported
+    const auto &mc = customSection("memory");
+    const auto &limits = mc["limits_mb"];
+    for (const auto &name : limits.getMemberNames()) {
+        memacct::Account::setLimit(name, (int64_t)(limits[name].asDouble() * 1024.0 * 1024.0));
+    }
+    rss_limit_bytes_ = (uint64_t)(mc.get("rss_limit_mb", 0.0).asDouble() * 1024.0 * 1024.0);
+    app().getLoop()->runEvery(std::max(0.1, mc.get("check_ms", 1000.0).asDouble() / 1000.0),
+                              [this]() { checkMemory(); });
+
+    // Startup warm-up: custom_config.warmup; /ready answers 200 once it is done
+    const auto &wu = customSection("warmup");
+    reject_until_ready_ = wu.get("reject_until_ready", true).asBool();
+    prefill_timeout_s_ = wu.get("prefill_timeout_s", 60.0).asDouble();
+    for (const auto &m : wu["moves"]) {
+        PlanMove move;
+        if (readMove(m, move)) warmup_moves_.push_back(std::move(move));
+        else LOG_WARN << "warmup: ignoring malformed move " << write_json_compact(m);
+    }
+    snapshot_path_ = wu.get("snapshot", "").asString();
+    snapshot_entries_ = wu.get("snapshot_entries", 1000).asUInt();
+    const double snapshot_interval_s = wu.get("snapshot_interval_s", 300.0).asDouble();
+    if (!snapshot_path_.empty() && snapshot_interval_s > 0.0) {
+        app().getLoop()->runEvery(snapshot_interval_s, [this]() {
+            workers_->submit([this]() { saveCacheSnapshot(); });   // off the loop of the execution tick
+        });
+    }
+    // Precompiled canonical moves: custom_config.trajectory_library (robot_arm_trajlib output);
+    // mapped during the warm-up, re-mapped when the file at path is replaced
+    const auto &tl = customSection("trajectory_library");
+    library_path_ = tl.get("path", "").asString();
+    const double library_check_s = tl.get("check_s", 2.0).asDouble();
+    if (!library_path_.empty() && library_check_s > 0.0) {
+        app().getLoop()->runEvery(library_check_s, [this]() {
+            if (!readiness_.ready() || library_loading_.exchange(true)) return;
+            workers_->submit([this]() {
+                reloadLibrary();
+                library_loading_.store(false);
+            });
+        });
+    }
+
+    readiness_.addPhase("config", std::chrono::duration<double>(Readiness::Clock::now() - ctor_start).count());
+    // The controller is created before app().run(): the IO loops the warm-up primes exist
+    // only once the framework runs, so it starts from there
+    app().registerBeginningAdvice([this]() { warmup_thread_ = std::thread([this]() { warmUp(); }); });
+}
+
+ArmController::~ArmController()
+{
+    stopping_.store(true);
+    if (warmup_thread_.joinable()) warmup_thread_.join();
+    saveCacheSnapshot();
+}
+
+// Warm-up thread: codecs (here and on every IO thread), worker threads, trajectory library,
+// plan cache prefill
+void ArmController::warmUp()
+{
+    {
+        Readiness::Phase phase(readiness_, "codecs");
+        warmThread();
+        // Queued on the IO loops ahead of their first request
+        for (size_t i = 0; i < app().getThreadNum(); ++i) {
+            if (auto *loop = app().getIOLoop(i)) loop->queueInLoop([]() { warmThread(); });
+        }
+    }
+    warmWorkers();
+    if (!library_path_.empty()) {
+        Readiness::Phase phase(readiness_, "library");
+        reloadLibrary();
+    }
+    if (cache_enabled_) prefillCache();
+    readiness_.markReady();
+
+    const auto r = readiness_.snapshot();
+    LOG_INFO << "ready: " << r.time_to_ready_s * 1e3 << " ms after the controller was created"
+             << (r.process_time_to_ready_s >= 0.0
+                     ? ", " + std::to_string((int)(r.process_time_to_ready_s * 1e3)) + " ms after process start"
+                     : std::string());
+}
+
+// Every worker runs one warm-up task: each waits until all have started, so no worker takes two
+void ArmController::warmWorkers()
+{
+    struct Barrier {
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t started = 0, done = 0;
+    };
+    const size_t n = workers_->size();
+    const bool perf_on = perf_sampler_->every() != 0;
+    auto b = std::make_shared<Barrier>();
+    Readiness::Phase phase(readiness_, "workers", n);
+    for (size_t i = 0; i < n; ++i) {
+        workers_->submit([this, b, n, perf_on]() {
+            {
+                std::unique_lock<std::mutex> lock(b->mutex);
+                ++b->started;
+                b->cv.notify_all();
+                b->cv.wait_for(lock, std::chrono::seconds(2), [&b, n]() { return b->started >= n; });
+            }
+            warmThread();
+            if (perf_on) perf::Counters::thread();   // opens this thread's counters
+            readiness_.step();
+            std::lock_guard<std::mutex> lock(b->mutex);
+            ++b->done;
+            b->cv.notify_all();
+        });
+    }
+    std::unique_lock<std::mutex> lock(b->mutex);
+    b->cv.wait(lock, [&b, n]() { return b->done >= n; });
+}
+
+// Plans custom_config.warmup.moves and the moves of the snapshot into the plan cache on the
+// workers; waits at most prefill_timeout_s (the rest keeps planning after ready).
+// Plans are keyed by their start pose, the robot's commanded pose when a request arrives.
+// After a restart the robot holds its startup pose, so only snapshot moves starting there
+// can be hit; moves chained from other poses are skipped. Configured moves are taken as is.
+void ArmController::prefillCache()
+{
+    std::vector<PlanMove> moves = warmup_moves_;
+    std::ifstream in(snapshot_path_, std::ios::binary);
+    if (!snapshot_path_.empty() && in) {
+        Json::Value root;
         std::string errs;
-        std::unique_ptr<Json::CharReader> reader(b.newCharReader());
-        if (!reader->parse(body.data(), body.data() + body.size(), &root, &errs)) {
-            auto resp = HttpResponse::newHttpJsonResponse(Json::Value("Bad JSON body"));
-            resp->setStatusCode(k400BadRequest);
-            callback(resp);
+        Json::CharReaderBuilder b;
+        if (!Json::parseFromStream(b, in, &root, &errs) || !root["moves"].isArray()) {
+            LOG_WARN << "warmup: cannot read snapshot " << snapshot_path_ << ": " << errs;
+        } else {
+            std::vector<double> home;
+            engine_->target(kPlanRobot, home);
+            auto fromHome = [this, &home](const PlanMove &m) {
+                if (m.q0.size() != home.size()) return false;
+                for (size_t i = 0; i < home.size(); ++i) {
+                    if (plan_quantize(m.q0[i], cache_q_quantum_) != plan_quantize(home[i], cache_q_quantum_)) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            size_t chained = 0;
+            for (const auto &m : root["moves"]) {
+                PlanMove move;
+                if (!readMove(m, move)) continue;
+                if (fromHome(move)) moves.push_back(std::move(move));
+                else ++chained;
+            }
+            if (chained) LOG_INFO << "warmup: " << chained << " snapshot moves start away from the startup pose, not prefilled";
+        }
+    }
+    if (moves.empty()) return;
+
+    struct Pending {
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t left = 0;
+        std::atomic<size_t> failed{0};
+    };
+    auto p = std::make_shared<Pending>();
+    p->left = moves.size();
+    Readiness::Phase phase(readiness_, "prefill", moves.size());
+    for (auto &m : moves) {
+        workers_->submit([this, p, m = std::move(m)]() {
+            try {
+                bool hit = false;
+                planCached(m.q0, m.q1, m.T, m.dt, m.opt, nullptr, hit);
+            } catch (const std::exception &) {
+                p->failed.fetch_add(1, std::memory_order_relaxed);
+            }
+            readiness_.step();
+            std::lock_guard<std::mutex> lock(p->mutex);
+            if (--p->left == 0) p->cv.notify_all();
+        });
+    }
+    const auto until = Readiness::Clock::now() +
+        std::chrono::duration_cast<Readiness::Clock::duration>(std::chrono::duration<double>(prefill_timeout_s_));
+    std::unique_lock<std::mutex> lock(p->mutex);
+    while (p->left && !stopping_.load() && Readiness::Clock::now() < until) {
+        p->cv.wait_for(lock, std::chrono::milliseconds(100));
+    }
+    if (p->left) LOG_WARN << "warmup: prefill timed out, " << p->left << " of " << moves.size() << " moves still planning";
+    if (p->failed) LOG_WARN << "warmup: " << p->failed.load() << " moves could not be planned";
+}
+
+std::shared_ptr<const trajlib::Library> ArmController::library()
+{
+    std::lock_guard<std::mutex> lock(library_mutex_);
+    return library_;
+}
+
+// Maps the library file if it is not the version already mapped (or rejected). Runs on the
+// warm-up thread, then on a worker per check; a file that fails validation is logged and
+// the previous version keeps serving.
+void ArmController::reloadLibrary()
+{
+    trajlib::FileId id;
+    if (!trajlib::fileId(library_path_, id)) {
+        std::lock_guard<std::mutex> lock(library_mutex_);
+        if (!library_id_set_) {
+            LOG_WARN << "trajectory_library: " << library_path_ << " not found";
+            library_id_set_ = true;   // logged once until a file appears
+        }
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(library_mutex_);
+        if (library_id_set_ && id == library_id_) return;
+    }
+    std::shared_ptr<const trajlib::Library> lib;
+    try {
+        lib = trajlib::Library::open(library_path_);
+    } catch (const std::exception &e) {
+        library_errors_.fetch_add(1, std::memory_order_relaxed);
+        LOG_WARN << e.what() << "; keeping the previous version";
+        std::lock_guard<std::mutex> lock(library_mutex_);
+        library_id_ = id;
+        library_id_set_ = true;
+        return;
+    }
+    std::shared_ptr<const trajlib::Library> old;
+    {
+        std::lock_guard<std::mutex> lock(library_mutex_);
+        old = std::move(library_);
+        library_ = lib;
+        library_id_ = id;
+        library_id_set_ = true;
+    }
+    if (old) library_swaps_.fetch_add(1, std::memory_order_relaxed);
+    LOG_INFO << "trajectory_library: version " << lib->version() << ", " << lib->entries() << " moves ("
+             << lib->bytes() << " bytes) mapped from " << library_path_
+             << (old ? ", replacing version " + std::to_string(old->version()) : std::string());
+}
+
+// Hottest plan cache keys as moves (custom_config.warmup.snapshot), replaced atomically.
+// Not before ready: a restart must not overwrite the snapshot with a half prefilled cache.
+void ArmController::saveCacheSnapshot()
+{
+    if (snapshot_path_.empty() || !cache_enabled_ || !readiness_.ready()) return;
+    Json::Value moves(Json::arrayValue);
+    for (const auto &key : cache_->hottest(snapshot_entries_)) {
+        PlanMove m;
+        if (plan_key_move(key, m, cache_q_quantum_, cache_t_quantum_)) moves.append(moveJson(m));
+    }
+    Json::Value root(Json::objectValue);
+    root["moves"] = moves;
+    const std::string tmp = snapshot_path_ + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out << write_json_compact(root);
+        if (!out) {
+            LOG_WARN << "warmup: cannot write snapshot " << tmp;
+            return;
+        }
+    }
+    if (std::rename(tmp.c_str(), snapshot_path_.c_str()) != 0) {
+        LOG_WARN << "warmup: cannot replace snapshot " << snapshot_path_;
+    }
+}
+
+// Logs accounts that went over their limit since the last check, and RSS crossing rss_limit_mb
+void ArmController::checkMemory()
+{
+    for (const auto &u : memacct::usage()) {
+        uint64_t &seen = mem_alerts_seen_[u.name];
+        if (u.alerts > seen) {
+            LOG_WARN << "memory: " << u.name << " went over its limit (" << (u.limit >> 20) << " MB), now "
+                     << (u.bytes >> 20) << " MB, high water " << (u.high_water >> 20) << " MB";
+        }
+        seen = u.alerts;
+    }
+    if (!rss_limit_bytes_) return;
+    const auto p = memacct::processMemory();
+    const bool over = p.rss > rss_limit_bytes_;
+    if (over && !rss_over_) {
+        rss_alerts_.fetch_add(1, std::memory_order_relaxed);
+        LOG_WARN << "memory: resident set " << (p.rss >> 20) << " MB over rss_limit_mb ("
+                 << (rss_limit_bytes_ >> 20) << " MB)";
+    }
+    rss_over_ = over;
+}
+
+// Helper: record fields shared by both routes (headers and query as the handlers read them)
+static reqlog::Request logRecord(const HttpRequestPtr &req, reqlog::Kind kind, const PlanOptions &opt,
+                                 uint64_t arrival)
+{
+    reqlog::Request r;
+    r.t_ns = arrival;
+    r.kind = kind;
+    r.format = (uint8_t)opt.format;
+    r.channels = opt.channels;
+    if (req->getParameter("store") == "1") r.flags |= reqlog::kStore;
+    const auto &deadline = req->getHeader("x-deadline-ms");
+    if (!deadline.empty()) {
+        r.flags |= reqlog::kDeadline;
+        r.deadline_ms = std::atof(deadline.c_str());
+    }
+    const auto &session = req->getHeader("x-session-id");
+    if (!session.empty()) {
+        r.flags |= reqlog::kSession;
+        r.session = session;
+    }
+    return r;
+}
+
+void ArmController::recordPlanCall(const HttpRequestPtr &req, const PlanCall &call, uint64_t arrival)
+{
+    reqlog::Request r = logRecord(req, reqlog::Kind::Plan, call.opt, arrival);
+    std::copy(call.q_target6.begin(), call.q_target6.begin() + 6, r.q_target);
+    r.T = call.T;
+    r.dt = call.dt;
+    recorder_->record(r);
+}
+
+void ArmController::recordBatchJob(const HttpRequestPtr &req, const BatchJob &job, uint64_t arrival)
+{
+    reqlog::Request r = logRecord(req, reqlog::Kind::Batch, job.opt, arrival);
+    r.items.resize(job.items.size());
+    for (size_t i = 0; i < job.items.size(); ++i) {
+        const BatchItem &b = job.items[i];
+        reqlog::Item &it = r.items[i];
+        if (!b.error.empty()) {
+            it.flags = reqlog::kItemInvalid;
+            continue;
+        }
+        // q0 taken from the current state is not part of the request
+        if (b.has_q0) {
+            it.flags |= reqlog::kItemQ0;
+            std::copy(b.q0.begin(), b.q0.begin() + 6, it.q0);
+        }
+        std::copy(b.q1.begin(), b.q1.begin() + 6, it.q1);
+        it.T = b.T;
+        it.dt = b.dt;
+    }
+    recorder_->record(r);
+}
+
+// Cancellation token of a plan request: deadline (X-Deadline-Ms, relative), client
+// connection liveness, and X-Session-Id (a newer request of the session supersedes this one)
+CancelTokenPtr ArmController::makeToken(const HttpRequestPtr &req)
+{
+    auto token = std::make_shared<CancelToken>();
+
+    const auto &deadline_hdr = req->getHeader("x-deadline-ms");
+    const double deadline_ms = deadline_hdr.empty() ? default_deadline_ms_ : std::atof(deadline_hdr.c_str());
+    if (deadline_ms > 0.0) {
+        token->setDeadline(CancelToken::Clock::now() +
+                           std::chrono::duration_cast<CancelToken::Clock::duration>(
+                               std::chrono::duration<double, std::milli>(deadline_ms)));
+    }
+
+    std::weak_ptr<trantor::TcpConnection> conn = req->getConnectionPtr();
+    if (!conn.expired()) {
+        token->setProbe([conn]() {
+            auto c = conn.lock();
+            return c && c->connected();
+        });
+    }
+
+    const auto &session = req->getHeader("x-session-id");
+    if (!session.empty()) {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        auto &slot = sessions_[session];
+        if (auto prev = slot.lock()) prev->cancel(CancelToken::Reason::Superseded);
+        slot = token;
+
+        // Finished requests leave expired entries behind; sweep when the map doubles
+        if (sessions_.size() >= sessions_prune_at_) {
+            for (auto it = sessions_.begin(); it != sessions_.end();) {
+                if (it->second.expired()) it = sessions_.erase(it);
+                else ++it;
+            }
+            sessions_prune_at_ = std::max<size_t>(1024, sessions_.size() * 2);
+        }
+    }
+    return token;
+}
+
+// Answer for a request whose token fired (counted once per request, by reason)
+HttpResponsePtr ArmController::cancelledResponse(const CancelToken &token)
+{
+    const auto why = token.reason();
+    cancelled_by_reason_[(size_t)why].fetch_add(1, std::memory_order_relaxed);
+    switch (why) {
+    case CancelToken::Reason::Deadline:
+        return makeError("Planning deadline exceeded", k504GatewayTimeout);
+    case CancelToken::Reason::Superseded:
+        return makeError("Superseded by a newer request of this session", k409Conflict);
+    default:
+        return makeError("Plan request cancelled", k503ServiceUnavailable);
+    }
+}
+
+// Hands an answered plan to the engine: robot kPlanRobot follows it from now on (at rate 1,
+// as the body is played; blended from its current state if still moving, see
+// ExecutionEngine::follow), and the next plan starts from its end (ExecutionEngine::target)
+void ArmController::commitPlan(const QuinticTrajectory &coeffs)
+{
+    engine_->follow(kPlanRobot, coeffs, ExecutionEngine::Clock::now());
+}
+
+// Canonical key of a plan request (quantized, see plan_cache.hpp);
+// used by the plan cache and by request coalescing
+PlanKey ArmController::planKey(const std::vector<double> &q0,
+                               const std::vector<double> &q1,
+                               double T, double dt,
+                               const PlanOptions &opt) const
+{
+    return make_plan_key(q0, q1, T, dt, opt, cache_q_quantum_, cache_t_quantum_);
+}
+
+// Cached body for the key, or nullptr (also when the cache is disabled)
+PlanCache::Body ArmController::cachedPlan(const PlanKey &key)
+{
+    return cache_enabled_ ? cache_->get(key) : nullptr;
+}
+
+// Helper: quintic coefficients of a rest-to-rest move (throws on bad T)
+static QuinticTrajectory solveCoeffs(const std::vector<double> &q0,
+                                     const std::vector<double> &q1,
+                                     double T)
+{
+    trace::Span span("quintic_coeffs");
+    return make_quintic_trajectory(q0, q1, T);
+}
+
+// Sample the solved coefficients + serialize and store the body in the cache
+// (unless cache_insert is false). Throws PlanCancelled once should_stop() returns true.
+PlanCache::Body ArmController::computePlan(const PlanKey &key,
+                                           const QuinticTrajectory &coeffs,
+                                           double dt,
+                                           const PlanOptions &opt,
+                                           const StopPredicate &should_stop,
+                                           PlanResult *timing,
+                                           bool cache_insert)
+{
+    // Compute PMP + minimum-jerk trajectory: returns list of points {t, q}
+    std::vector<PMPPoint> pmp_traj;
+    uint64_t planned = 0;   // end of the plan stage, start of serialize
+    {
+        alloc_stats::Scope scope(alloc_stats::Region::Plan);
+        perf::Scope counters(perf::Stage::Plan);
+        metrics::StageTimer timer(metrics::Stage::Plan);
+        trace::Span span("sampling");
+        pmp_traj = plan_pmp_minimum_jerk(coeffs, dt, should_stop);
+        counters.setSamples(pmp_traj.size());
+        const uint64_t ns = timer.stop();
+        if (timing) timing->plan_ns = ns;
+        planned = timer.end();
+    }
+    metrics::recordPlan(pmp_traj.size());
+
+    // Serialize once: { dt, unit, trajectory: [ {t, q[6]}, ... ] } or packed binary
+    PlanCache::Body body;
+    {
+        alloc_stats::Scope scope(alloc_stats::Region::Serialize);
+        perf::Scope counters(perf::Stage::Serialize);
+        metrics::StageTimer timer(metrics::Stage::Serialize, planned);
+        trace::Span span("serialize");
+        counters.setSamples(pmp_traj.size());
+        body = std::make_shared<const std::string>(serialize_plan(pmp_traj, dt, opt, should_stop));
+        if (timing) timing->serialize_ns = timer.stop();
+    }
+    if (cache_enabled_ && cache_insert) cache_->put(key, body);
+    return body;
+}
+
+// Runs the computation of a single-flight leader and publishes it to all waiters
+void ArmController::leadPlan(const PlanKey &key, const PlanFlights::Ticket &ticket,
+                             const QuinticTrajectory &coeffs,
+                             double dt,
+                             const PlanOptions &opt,
+                             bool cache_insert)
+{
+    PlanResult cancelled;
+    cancelled.error = "Plan request cancelled";
+    cancelled.status = k503ServiceUnavailable;
+    cancelled.cancelled = true;
+
+    flights_.begin(ticket);
+    PlanResult r;
+    if (ticket.flight->cancelled()) {
+        r = cancelled;  // every waiter left, nobody receives this
+    } else {
+        // Waiters whose token fired are answered at the next block boundary;
+        // the work is abandoned once none is left
+        auto should_stop = [this, &key, &ticket, &cancelled]() {
+            return flights_.poll(key, ticket, cancelled);
+        };
+        const uint64_t cpu0 = thread_cpu_ns();
+        try {
+            r.body = computePlan(key, coeffs, dt, opt, should_stop, &r, cache_insert);
+        } catch (const PlanCancelled &) {
+            r = cancelled;
+            plans_abandoned_.fetch_add(1, std::memory_order_relaxed);
+            wasted_cpu_ns_.fetch_add(thread_cpu_ns() - cpu0, std::memory_order_relaxed);
+        } catch (const std::exception &e) {
+            r.error = e.what();
+        }
+    }
+    flights_.complete(key, ticket, r);
+}
+
+// Plan + serialize, going through the plan cache when enabled (looked up only when
+// cache_insert is false). Blocking, for worker pool tasks (batch items, prefill):
+// identical concurrent calls share one computation once its leader is running.
+// Throws std::runtime_error on bad parameters (e.g. T too small) or cancellation.
+PlanCache::Body ArmController::planCached(const std::vector<double> &q0,
+                                          const std::vector<double> &q1,
+                                          double T, double dt,
+                                          const PlanOptions &opt,
+                                          const CancelTokenPtr &token,
+                                          bool &cache_hit,
+                                          bool cache_insert)
+{
+    if (const auto lib = library()) {
+        trajlib::Library::Entry e;
+        if (lib->find(lib->key(q0, q1, T, dt, opt), e)) {
+            library_hits_.fetch_add(1, std::memory_order_relaxed);
+            cache_hit = true;
+            return std::make_shared<const std::string>(e.body, e.body_size);
+        }
+    }
+    const PlanKey key = planKey(q0, q1, T, dt, opt);
+    auto body = cachedPlan(key);
+    cache_hit = (body != nullptr);
+    if (cache_hit) return body;
+
+    // Solved before joining: bad parameters throw here, never inside a flight
+    const QuinticTrajectory coeffs = solveCoeffs(q0, q1, T);
+
+    PlanFlights::Cancelled isCancelled;
+    if (token) isCancelled = [token]() { return token->cancelled(); };
+    auto ticket = flights_.join(key, nullptr, isCancelled);
+    if (ticket.leader) {
+        leadPlan(key, ticket, coeffs, dt, opt, cache_insert);
+    } else if (!ticket.flight->running()) {
+        // Callers run on the worker pool: a leader that has not started may be queued behind
+        // this very task, and blocking here could leave no worker to run it. Plan without it.
+        flights_.leave(key, ticket);
+        auto should_stop = [&isCancelled]() { return isCancelled && isCancelled(); };
+        try {
+            return computePlan(key, coeffs, dt, opt, should_stop, nullptr, cache_insert);
+        } catch (const PlanCancelled &) {
+            throw std::runtime_error("Plan request cancelled");
+        }
+    }
+
+    // The leader is running on another thread: wait for it, leaving once this request is cancelled
+    PlanResult r;
+    while (!flights_.waitFor(ticket, std::chrono::milliseconds(10), r)) {
+        if (isCancelled && isCancelled()) {
+            flights_.leave(key, ticket);
+            throw std::runtime_error("Plan request cancelled");
+        }
+    }
+    if (!r.body) throw std::runtime_error(r.error);
+    return r.body;
+}
+
+// HTTP handler: POST /arm/plan_pmp_q
+void ArmController::handlePlanPMP_Q(const HttpRequestPtr &req,
+                                   std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    if (reject_until_ready_ && !readiness_.ready()) {
+        callback(makeOverloaded("Warming up", k503ServiceUnavailable));
+        return;
+    }
+    const uint64_t arrival = recorder_ ? recorder_->now() : 0;
+    auto call = std::make_shared<PlanCall>();
+    call->perf_sampled = perf_sampler_->next();
+    call->trace_id = trace::startRequest();
+    if (call->trace_id) call->trace_start_ns = trace::nowNs();
+    {
+        alloc_stats::Scope parse(alloc_stats::Region::Parse, &call->alloc);
+        perf::Sampled sampled(call->perf_sampled);
+        perf::Scope counters(perf::Stage::Parse);
+        metrics::StageTimer timer(metrics::Stage::Decode, call->timer.start());
+        trace::Bind bind(call->trace_id);
+        trace::Span span("decode");
+
+        auto json = requestJson(req);
+        if (!json) {
+            callback(makeError("Bad JSON body"));
+            return;
+        }
+
+        // Validate that q_target exists and is an array
+        if (!json->isMember("q_target") || !(*json)["q_target"].isArray()) {
+            callback(makeError("Not enough parameters: q_target (array)"));
+            return;
+        }
+
+        // Read 6-DOF target configuration in radians (at least 6 values)
+        if (!readQ6((*json)["q_target"], call->q_target6)) {
+            callback(makeError("q_target must have 6 finite values"));
+            return;
+        }
+
+        // Read optional parameters (defaults if missing)
+        if (!readT(*json, call->T)) {
+            callback(makeError("T must be a number in (0, 3600] s"));
+            return;
+        }
+        if (json->isMember("dt") && !(*json)["dt"].isNumeric()) {
+            callback(makeError("dt must be finite"));
+            return;
+        }
+        call->dt = json->isMember("dt") ? (*json)["dt"].asDouble() : 0.02;
+        if (!std::isfinite(call->dt)) {
+            callback(makeError("dt must be finite"));
             return;
         }
-        json = std::make_shared<Json::Value>(root);
+
+        // Output options: format ("json" | "bin") from body or query, channels from body
+        const std::string fmt = json->isMember("format") ? (*json)["format"].asString()
+                                                         : req->getParameter("format");
+        if (!parse_plan_format(fmt, call->opt.format)) {
+            callback(makeError("format must be \"json\" or \"bin\""));
+            return;
+        }
+        if (json->isMember("channels") && !parse_plan_channels((*json)["channels"], call->opt.channels)) {
+            callback(makeError("channels must be an array of \"q\", \"dq\", \"ddq\", \"u\", \"J_acc\""));
+            return;
+        }
+        call->decode_ns = timer.stop();
+    }
+    if (recorder_) recordPlanCall(req, *call, arrival);
+    const double T = call->T;
+    const double dt = call->dt;
+    const PlanOptions &opt = call->opt;
+
+    call->store = req->getParameter("store") == "1";
+    call->token = makeToken(req);
+    call->loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+    call->callback = std::move(callback);
+
+    // Admission control: every request that may plan is charged (stored handles keep
+    // coefficients only). A library or cache hit gives the reservation back as soon as it
+    // is found in executePlan: probing the cache first would let an eviction in between
+    // run a heavy miss uncharged.
+    const uint64_t cost = call->store ? 0 : estimate_plan_bytes(pmp_sample_count(T, dt), 6, opt);
+    if (cost == 0 || !admission_enabled_) {
+        executePlan(call);
+        return;
+    }
+
+    auto onReady = [this, call, cost](bool admitted) {
+        call->loop->queueInLoop([this, call, cost, admitted]() {
+            if (!admitted) {
+                call->callback(makeOverloaded("Planning queue wait exceeded", k503ServiceUnavailable));
+                return;
+            }
+            call->cost = cost;
+            executePlan(call);
+        });
+    };
+    switch (admission_->acquire(cost, std::move(onReady))) {
+    case AdmissionControl::Decision::Admitted:
+        call->cost = cost;
+        executePlan(call);
+        break;
+    case AdmissionControl::Decision::Queued:
+        break; // onReady continues on this loop
+    case AdmissionControl::Decision::Rejected:
+        call->callback(makeOverloaded("Too many planning requests in flight", k429TooManyRequests));
+        break;
+    case AdmissionControl::Decision::TooLarge:
+        call->callback(makeError("Request too large: reduce T/dt (estimated " +
+                                 std::to_string(cost >> 20) + " MB)", k413RequestEntityTooLarge));
+        break;
+    }
+}
+
+// Completes a plan request: returns its admission budget and answers on the request's loop
+void ArmController::finishPlan(const std::shared_ptr<PlanCall> &call, const HttpResponsePtr &resp)
+{
+    if (call->cost) {
+        admission_->release(call->cost);
+        call->cost = 0;
+    }
+    auto reply = [call, resp]() {
+        uint64_t sent;
+        {
+            alloc_stats::Scope send(alloc_stats::Region::Send, &call->alloc);
+            metrics::StageTimer timer(metrics::Stage::Send);
+            trace::Bind bind(call->trace_id);
+            trace::Span span("send");
+            call->callback(resp);
+            timer.stop();
+            sent = timer.end();
+        }
+        call->timer.finish(sent);
+        trace::record(call->trace_id, "plan_pmp_q", call->trace_start_ns, trace::nowNs());
+        finishAllocStats("/arm/plan_pmp_q", call->alloc);
+    };
+    if (!call->loop || call->loop->isInLoopThread()) {
+        reply();
+    } else {
+        call->loop->queueInLoop(std::move(reply));
+    }
+}
+
+// Runs an admitted /arm/plan_pmp_q request (on its IO loop)
+void ArmController::executePlan(const std::shared_ptr<PlanCall> &call)
+{
+    alloc_stats::Scope scope(alloc_stats::Region::Other, &call->alloc);
+    perf::Sampled sampled(call->perf_sampled);
+    trace::Bind bind(call->trace_id);
+
+    // Cancelled while waiting for admission: the arm state is left untouched
+    if (call->token->cancelled()) {
+        finishPlan(call, cancelledResponse(*call->token));
+        return;
+    }
+
+    const auto &q_target6 = call->q_target6;
+    const double T = call->T;
+    const double dt = call->dt;
+    const PlanOptions opt = call->opt;
+
+    // Held until the response is built: the entry points into this version's mapping
+    const auto lib = library();
+    trajlib::Library::Entry lib_entry;
+    bool from_library = false;
+
+    std::vector<double> q0_6;
+    uint64_t stored_id = 0;
+    std::string error;
+    HttpStatusCode error_code = k400BadRequest;
+    {
+        // Start point: where the engine's robot ends up (the last answered plan's target).
+        // The plan is handed to the engine only once this request answers with a body
+        // (commitPlan): a rejected, cancelled or failed plan leaves the robot as it was, so a
+        // retry plans the same move. Concurrent requests start from the same pose until one
+        // of them is answered.
+        {
+            trace::Span span("state_read");
+            engine_->target(kPlanRobot, q0_6);
+        }
+        q0_6.resize(6, 0.0);
+
+        // Canonical moves come precompiled from the trajectory library: nothing is computed.
+        // Otherwise coefficients are cheap (one 6x6 solve per joint) and validate T before
+        // anything is committed; only the O(N) sampling + serialization may go to a worker,
+        // which reuses these coefficients
+        QuinticTrajectory &coeffs = call->coeffs;
+        from_library = lib && lib->find(lib->key(q0_6, q_target6, T, dt, opt), lib_entry);
+        if (from_library) {
+            coeffs = lib_entry.trajectory();
+        } else {
+            try {
+                coeffs = solveCoeffs(q0_6, q_target6, T);
+            } catch (const std::exception &e) {
+                error = e.what();
+            }
+        }
+
+        // ?store=1: keep only the coefficients server-side and return a handle;
+        // samples are fetched later through /arm/trajectory/{id}
+        if (error.empty() && call->store) {
+            stored_id = store_->put(coeffs, dt);
+            if (stored_id == 0) {
+                error = "Trajectory store is full";
+                error_code = k503ServiceUnavailable;
+            }
+        }
+    }
+    if (!error.empty()) {
+        finishPlan(call, makeError(error, error_code));
+        return;
+    }
+
+    // A stored trajectory is not followed: /arm/execute runs it from this start pose
+    if (call->store) {
+        Json::Value out(Json::objectValue);
+        out["id"] = TrajectoryStore::formatId(stored_id);
+        out["T"] = T;
+        out["dt"] = dt;
+        out["dof"] = 6;
+        out["unit"] = "rad";
+        out["ttl_s"] = store_->ttlSeconds();
+        finishPlan(call, HttpResponse::newHttpJsonResponse(out));
+        return;
+    }
+
+    // The library body is copied into the response (Drogon owns its buffer); the mapping
+    // itself is shared with every process serving the same file
+    if (from_library) {
+        library_hits_.fetch_add(1, std::memory_order_relaxed);
+        commitPlan(call->coeffs);
+        HttpResponsePtr resp;
+        {
+            alloc_stats::Scope send(alloc_stats::Region::Send);
+            resp = makePlanResponse(lib_entry.body, lib_entry.body_size, opt.format);
+            resp->addHeader("X-Plan-Cache", "library");
+            addServerTiming(resp, call->decode_ns, 0, 0, pmp_sample_count(T, dt), true);
+        }
+        finishPlan(call, resp);
+        return;
     }
 
-    // Validate that q_target exists and is an array
-    if (!json->isMember("q_target") || !(*json)["q_target"].isArray()) {
-        auto resp = HttpResponse::newHttpJsonResponse(Json::Value("Not enough parameters: q_target (array)"));
-        resp->setStatusCode(k400BadRequest);
-        callback(resp);
+    // Repeated moves are served from the plan cache (key: quantized request)
+    const PlanKey key = planKey(q0_6, q_target6, T, dt, opt);
+    if (auto body = cachedPlan(key)) {
+        commitPlan(call->coeffs);
+        HttpResponsePtr resp;
+        {
+            alloc_stats::Scope send(alloc_stats::Region::Send);
+            resp = makePlanResponse(*body, opt.format);
+            resp->addHeader("X-Plan-Cache", "hit");
+            addServerTiming(resp, call->decode_ns, 0, 0, pmp_sample_count(T, dt), true);
+        }
+        finishPlan(call, resp);
         return;
     }
 
-    // Validate q_target has at least 6 values
-    const auto& arr = (*json)["q_target"];
-    if (arr.size() < 6) {
-        auto resp = HttpResponse::newHttpJsonResponse(Json::Value("q_target must have 6 values"));
-        resp->setStatusCode(k400BadRequest);
-        callback(resp);
+    // Identical concurrent requests attach to one computation (single-flight);
+    // every waiter gets the same serialized body. Only waiters that receive it commit the
+    // plan: after a 503, a cancellation or a deadline the next plan starts from q0 again.
+    // Since nothing is committed before an answer, a herd of identical requests reads the
+    // same start point and shares one key.
+    auto onResult = [this, call, opt](const PlanResult &r) {
+        alloc_stats::Scope send(alloc_stats::Region::Send, &call->alloc);
+        HttpResponsePtr resp;
+        if (r.body) {
+            commitPlan(call->coeffs);
+            resp = makePlanResponse(*r.body, opt.format);
+            resp->addHeader("X-Plan-Cache", "miss");
+            addServerTiming(resp, call->decode_ns, r.plan_ns, r.serialize_ns, pmp_sample_count(call->T, call->dt));
+        } else if (r.cancelled) {
+            resp = cancelledResponse(*call->token);
+        } else if (r.status == k503ServiceUnavailable) {
+            resp = makeOverloaded(r.error, r.status);
+        } else {
+            resp = makeError(r.error, r.status);
+        }
+        finishPlan(call, resp);
+    };
+    auto token = call->token;
+    auto ticket = flights_.join(key, std::move(onResult), [token]() { return token->cancelled(); });
+    if (!ticket.leader) {
+        // Followers allocate nothing of their own: give their admission budget back now
+        if (call->cost) {
+            admission_->release(call->cost);
+            call->cost = 0;
+        }
         return;
     }
 
-    // Read 6-DOF target configuration in radians
-    std::vector<double> q_target6 = {
-        arr[0].asDouble(),
-        arr[1].asDouble(),
-        arr[2].asDouble(),
-        arr[3].asDouble(),
-        arr[4].asDouble(),
-        arr[5].asDouble()
+    // The leader's charge belongs to the computation, not to its waiter: a cancelled leader
+    // is answered at once while the work goes on for the followers, so the budget is
+    // returned only once the flight completes
+    const uint64_t flight_cost = call->cost;
+    call->cost = 0;
+    auto releaseFlight = [this, flight_cost]() {
+        if (flight_cost) admission_->release(flight_cost);
     };
 
-    // Read optional parameters (defaults if missing)
-    double T  = json->isMember("T")  ? (*json)["T"].asDouble()  : 1.0;
-    double dt = json->isMember("dt") ? (*json)["dt"].asDouble() : 0.02;
+    // Cheap plans run inline; heavy ones go to the planning workers so that one long T
+    // or tiny dt never stalls the other connections of this IO loop
+    auto plan = [this, call, key, ticket, dt, opt, releaseFlight]() {
+        alloc_stats::Scope scope(alloc_stats::Region::Other, &call->alloc);
+        perf::Sampled sampled(call->perf_sampled);
+        trace::Bind bind(call->trace_id);
+        leadPlan(key, ticket, call->coeffs, dt, opt);
+        releaseFlight();
+    };
 
-    // Ensure internal state vectors are 6 DOF (safety for older / inconsistent state)
-    auto st = dyn_.state();
-    if (st.q.size() < 6) dyn_.setState({0,0,0,0,0,0}, {0,0,0,0,0,0});
+    const size_t cost = pmp_sample_count(T, dt) * q0_6.size();
+    if (cost <= inline_max_cost_) {
+        plan();
+        return;
+    }
 
-    // Current joint state q0 (rad) as start point for planning
-    auto q0 = dyn_.state().q;
-    std::vector<double> q0_6 = { q0[0], q0[1], q0[2], q0[3], q0[4], q0[5] };
+    // Responses are completed on the IO loop that received each request (finishPlan)
+    if (!workers_->trySubmit(plan)) {
+        PlanResult r;
+        r.error = "Planning queue is full";
+        r.status = k503ServiceUnavailable;
+        flights_.complete(key, ticket, r);
+        releaseFlight();
+    }
+}
 
-    // Compute PMP + minimum-jerk trajectory: returns list of points {t, q}
-    auto pmp_traj = plan_pmp_minimum_jerk(q0_6, q_target6, T, dt);
+// HTTP handler: POST /arm/plan_batch
+// Body: { items: [ {q0?, q_target, T?, dt?}, ... ], format?, channels? } or a bare items array.
+// Items are planned in parallel on the worker pool; per-item errors are reported in place.
+void ArmController::handlePlanBatch(const HttpRequestPtr &req,
+                                    std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    if (reject_until_ready_ && !readiness_.ready()) {
+        callback(makeOverloaded("Warming up", k503ServiceUnavailable));
+        return;
+    }
+    const uint64_t arrival = recorder_ ? recorder_->now() : 0;
+    auto job = std::make_shared<BatchJob>();
+    job->mem = &batch_mem_;
+    job->perf_sampled = perf_sampler_->next();
+    {
+        alloc_stats::Scope parse(alloc_stats::Region::Parse, &job->alloc);
+        perf::Sampled sampled(job->perf_sampled);
+        perf::Scope counters(perf::Stage::Parse);
+        metrics::StageTimer timer(metrics::Stage::Decode, job->timer.start());
 
-    // Update internal dynamics state to final pose (so next request starts from last target)
-    auto st2 = dyn_.state();
-    std::vector<double> q6  = st2.q;
-    std::vector<double> dq6 = st2.dq;
-    if (q6.size()  < 6) q6  = {0,0,0,0,0,0};
-    if (dq6.size() < 6) dq6 = {0,0,0,0,0,0};
+        auto json = requestJson(req);
+        if (!json) {
+            callback(makeError("Bad JSON body"));
+            return;
+        }
+        const Json::Value &items = json->isArray() ? *json : (*json)["items"];
+        if (!items.isArray()) {
+            callback(makeError("Not enough parameters: items (array)"));
+            return;
+        }
+        if (items.size() > batch_max_items_) {
+            callback(makeError("Too many items: at most " + std::to_string(batch_max_items_),
+                               k413RequestEntityTooLarge));
+            return;
+        }
+
+        const Json::Value &opts = json->isArray() ? Json::Value::nullSingleton() : *json;
+        const std::string fmt = opts.isMember("format") ? opts["format"].asString()
+                                                        : req->getParameter("format");
+        if (!parse_plan_format(fmt, job->opt.format)) {
+            callback(makeError("format must be \"json\" or \"bin\""));
+            return;
+        }
+        if (opts.isMember("channels") && !parse_plan_channels(opts["channels"], job->opt.channels)) {
+            callback(makeError("channels must be an array of \"q\", \"dq\", \"ddq\", \"u\", \"J_acc\""));
+            return;
+        }
+
+        // Items without q0 start where /arm/plan_pmp_q would (the batch does not move the arm)
+        std::vector<double> cur;
+        engine_->target(kPlanRobot, cur);
+        cur.resize(6, 0.0);
+
+        const size_t n = items.size();
+        job->items.resize(n);
+        job->bodies.resize(n);
+        job->ok.assign(n, 0);
+        job->charge((int64_t)(n * (sizeof(BatchItem) + 12 * sizeof(double) + sizeof(std::string) + 1)));
+        uint64_t retained = 0;   // finished bodies held until they are streamed out
+        uint64_t peak = 0;       // largest single item while it is planned and serialized
+        size_t planned = 0;
+        for (Json::ArrayIndex i = 0; i < n; ++i) {
+            const Json::Value &it = items[i];
+            BatchItem &b = job->items[i];
+            if (!it.isObject() || !readQ6(it["q_target"], b.q1)) {
+                b.error = "q_target must have 6 finite values";
+                continue;
+            }
+            b.has_q0 = it.isMember("q0");
+            if (!b.has_q0) b.q0 = cur;
+            else if (!readQ6(it["q0"], b.q0)) {
+                b.error = "q0 must have 6 finite values";
+                continue;
+            }
+            b.T  = it.get("T", 1.0).asDouble();
+            b.dt = it.get("dt", 0.02).asDouble();
+            if (!std::isfinite(b.T) || !std::isfinite(b.dt)) {
+                b.error = "T and dt must be finite";
+                continue;
+            }
+
+            // Item bodies are held until the batch is sent, planning transients only while
+            // a worker is on the item
+            const size_t samples = pmp_sample_count(b.T, b.dt);
+            const uint64_t body = estimate_plan_body_bytes(samples, 6, job->opt);
+            retained = (body > UINT64_MAX - retained) ? UINT64_MAX : retained + body;
+            peak = std::max(peak, estimate_plan_bytes(samples, 6, job->opt));
+            ++planned;
+            job->samples += samples;
+        }
+        // Charge: every retained body plus one planning peak per worker that can be on this batch
+        const uint64_t workers = std::min<uint64_t>(planned, workers_->size());
+        const uint64_t transient = (workers && peak > UINT64_MAX / workers) ? UINT64_MAX : peak * workers;
+        job->cost = (transient > UINT64_MAX - retained) ? UINT64_MAX : retained + transient;
+        job->decode_ns = timer.stop();
+    }
+    if (recorder_) recordBatchJob(req, *job, arrival);
+
+    job->token = makeToken(req);
+    job->loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+    job->callback = std::move(callback);
+
+    if (!admission_enabled_ || job->cost == 0) {
+        job->cost = 0;
+        runBatch(job);
+        return;
+    }
+    auto onReady = [this, job](bool admitted) {
+        job->loop->queueInLoop([this, job, admitted]() {
+            if (!admitted) {
+                job->cost = 0;
+                job->callback(makeOverloaded("Planning queue wait exceeded", k503ServiceUnavailable));
+                return;
+            }
+            runBatch(job);
+        });
+    };
+    switch (admission_->acquire(job->cost, std::move(onReady))) {
+    case AdmissionControl::Decision::Admitted:
+        runBatch(job);
+        break;
+    case AdmissionControl::Decision::Queued:
+        break; // onReady continues on this loop
+    case AdmissionControl::Decision::Rejected:
+        job->callback(makeOverloaded("Too many planning requests in flight", k429TooManyRequests));
+        break;
+    case AdmissionControl::Decision::TooLarge:
+        job->callback(makeError("Batch too large: split it (estimated " +
+                                std::to_string(job->cost >> 20) + " MB)", k413RequestEntityTooLarge));
+        break;
+    }
+}
+
+// Plans an admitted batch on the worker pool
+void ArmController::runBatch(const std::shared_ptr<BatchJob> &job)
+{
+    const size_t n = job->items.size();
+    job->plan_start = tsc::now();
+
+    // Respond once the last chunk is done. The envelope is streamed: item bodies are framed
+    // and released as the connection drains instead of being concatenated into one buffer.
+    auto finish = [this, job]() {
+        const uint64_t t_planned = tsc::now();
+        if (job->cost) admission_->release(job->cost);
+        HttpResponsePtr resp;
+        {
+            alloc_stats::Scope send(alloc_stats::Region::Send, &job->alloc);
+            if (job->token->cancelled()) {
+                resp = cancelledResponse(*job->token);
+            } else {
+                auto writer = std::make_shared<BatchEnvelopeWriter>(std::move(job->bodies), std::move(job->ok),
+                                                                    job->opt.format);
+                resp = HttpResponse::newStreamResponse(
+                    [job, writer](char *buf, size_t cap) -> size_t {
+                        if (!buf) return 0;   // aborted: the writer goes with this callback
+                        const size_t retained = writer->retained();
+                        const size_t n = writer->read(buf, cap);
+                        job->charge(-(int64_t)(retained - writer->retained()));
+                        metrics::recordResponseBytes(n);
+                        return n;
+                    },
+                    "", job->opt.format == PlanFormat::Binary ? CT_APPLICATION_OCTET_STREAM : CT_APPLICATION_JSON);
+                // plan: submission of the chunks to the last one done (items planned in parallel)
+                addServerTiming(resp, job->decode_ns, tsc::toNs(t_planned - job->plan_start), 0, job->samples);
+            }
+        }
+        auto reply = [job, resp]() {
+            uint64_t sent;
+            {
+                alloc_stats::Scope send(alloc_stats::Region::Send, &job->alloc);
+                metrics::StageTimer timer(metrics::Stage::Send);
+                job->callback(resp);
+                timer.stop();
+                sent = timer.end();
+            }
+            job->timer.finish(sent);
+            finishAllocStats("/arm/plan_batch", job->alloc);
+        };
+        if (job->loop) job->loop->queueInLoop(reply);
+        else reply();
+    };
+    if (n == 0) {
+        finish();
+        return;
+    }
+
+    // A few chunks per worker balances uneven item costs without per-item task overhead
+    const size_t chunks = std::min(n, workers_->size() * 4);
+    const size_t per_chunk = (n + chunks - 1) / chunks;
+    job->chunks_left.store((n + per_chunk - 1) / per_chunk);
+
+    for (size_t begin = 0; begin < n; begin += per_chunk) {
+        const size_t end = std::min(n, begin + per_chunk);
+        workers_->submit([this, job, begin, end, finish]() {
+            {
+                alloc_stats::Scope scope(alloc_stats::Region::Other, &job->alloc);
+                perf::Sampled sampled(job->perf_sampled);
+                int64_t held = 0;
+                for (size_t i = begin; i < end; ++i) {
+                    BatchItem &b = job->items[i];
+                    if (!b.error.empty()) {
+                        job->bodies[i] = std::move(b.error);
+                        continue;
+                    }
+                    if (job->token->cancelled()) {
+                        job->bodies[i] = "Plan request cancelled";
+                        continue;
+                    }
+                    try {
+                        bool hit = false;
+                        // Lookup only: one large batch must not evict the interactive working set
+                        job->bodies[i] = *planCached(b.q0, b.q1, b.T, b.dt, job->opt, job->token, hit, false);
+                        job->ok[i] = 1;
+                    } catch (const std::exception &e) {
+                        job->bodies[i] = e.what();
+                    }
+                    held += (int64_t)job->bodies[i].size();
+                }
+                job->charge(held);
+            }
+            if (job->chunks_left.fetch_sub(1) == 1) finish();
+        });
+    }
+}
+
+// HTTP handler: GET /arm/trajectory/{id}?from=&to=&dt=&format=&channels=
+// Evaluates a time window of a stored trajectory on demand.
+void ArmController::handleTrajectoryWindow(const HttpRequestPtr &req,
+                                           std::function<void (const HttpResponsePtr &)> &&callback,
+                                           std::string id)
+{
+    uint64_t handle = 0;
+    TrajectoryStore::Entry entry;
+    if (!TrajectoryStore::parseId(id, handle) || !store_->get(handle, entry)) {
+        callback(makeError("Unknown or expired trajectory id", k404NotFound));
+        return;
+    }
+
+    // Optional query parameters (defaults: whole trajectory, dt of the original request)
+    auto param = [&req](const char *name, double def) {
+        const auto &v = req->getParameter(name);
+        return v.empty() ? def : std::atof(v.c_str());
+    };
+    const double from = param("from", 0.0);
+    const double to   = param("to", entry.traj.T);
+    const double dt   = param("dt", entry.dt);
+    if (!(dt > 0.0) || !(to >= from)) {
+        callback(makeError("Bad window: need dt > 0 and to >= from"));
+        return;
+    }
 
-    for (int i = 0; i < 6; ++i) {
-        q6[i]  = q_target6[i];
-        dq6[i] = 0.0; // stop at the end
+    PlanOptions opt;
+    if (!parse_plan_format(req->getParameter("format"), opt.format)) {
+        callback(makeError("format must be \"json\" or \"bin\""));
+        return;
+    }
+    const auto &channels = req->getParameter("channels");
+    if (!channels.empty() && !parse_plan_channels_csv(channels, opt.channels)) {
+        callback(makeError("channels must be a comma separated list of q,dq,ddq,u,J_acc"));
+        return;
+    }
+
+    auto call = std::make_shared<WindowCall>();
+    call->from = std::clamp(from, 0.0, entry.traj.T);
+    call->to   = std::clamp(to, call->from, entry.traj.T);
+    call->dt   = dt;
+    call->opt  = opt;
+    const size_t samples = window_sample_count(call->from, call->to, dt);
+    if (samples > max_window_samples_) {
+        callback(makeError("Window too large: at most " + std::to_string(max_window_samples_) +
+                           " samples per request"));
+        return;
+    }
+    call->traj = std::move(entry.traj);
+    call->token = makeToken(req);
+    call->loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+    call->callback = std::move(callback);
+
+    // Charged like a plan of the same size: a window holds the same samples and body
+    const uint64_t cost = estimate_plan_bytes(samples, call->traj.dof, opt);
+    if (!admission_enabled_) {
+        runWindow(call);
+        return;
+    }
+    auto onReady = [this, call, cost](bool admitted) {
+        call->loop->queueInLoop([this, call, cost, admitted]() {
+            if (!admitted) {
+                call->callback(makeOverloaded("Planning queue wait exceeded", k503ServiceUnavailable));
+                return;
+            }
+            call->cost = cost;
+            runWindow(call);
+        });
+    };
+    switch (admission_->acquire(cost, std::move(onReady))) {
+    case AdmissionControl::Decision::Admitted:
+        call->cost = cost;
+        runWindow(call);
+        break;
+    case AdmissionControl::Decision::Queued:
+        break; // onReady continues on this loop
+    case AdmissionControl::Decision::Rejected:
+        call->callback(makeOverloaded("Too many planning requests in flight", k429TooManyRequests));
+        break;
+    case AdmissionControl::Decision::TooLarge:
+        call->callback(makeError("Window too large: reduce to - from or increase dt (estimated " +
+                                 std::to_string(cost >> 20) + " MB)", k413RequestEntityTooLarge));
+        break;
     }
-    dyn_.setState(q6, dq6);
+}
 
-    // Build JSON response: { dt, unit, trajectory: [ {t, q[6]}, ... ] }
+// Samples + serializes an admitted trajectory window. Cheap windows run on the IO loop,
+// heavy ones on the planning workers; the response is sent from the request's loop.
+void ArmController::runWindow(const std::shared_ptr<WindowCall> &call)
+{
+    auto finish = [this, call](const HttpResponsePtr &resp) {
+        if (call->cost) {
+            admission_->release(call->cost);
+            call->cost = 0;
+        }
+        if (call->loop->isInLoopThread()) {
+            call->callback(resp);
+        } else {
+            call->loop->queueInLoop([call, resp]() { call->callback(resp); });
+        }
+    };
+    auto work = [this, call, finish]() {
+        CancelToken &token = *call->token;
+        auto should_stop = [&token]() { return token.cancelled(); };
+        HttpResponsePtr resp;
+        try {
+            const uint64_t t0 = tsc::now();
+            auto window = sample_pmp_window(call->traj, call->from, call->to, call->dt, should_stop);
+            const uint64_t t1 = tsc::now();
+            resp = makePlanResponse(serialize_plan(window, call->dt, call->opt, should_stop), call->opt.format);
+            addServerTiming(resp, 0, tsc::toNs(t1 - t0), tsc::toNs(tsc::now() - t1), window.size());
+        } catch (const PlanCancelled &) {
+            resp = cancelledResponse(token);
+        }
+        finish(resp);
+    };
+
+    const size_t cost = window_sample_count(call->from, call->to, call->dt) * call->traj.dof;
+    if (cost <= inline_max_cost_) {
+        work();
+        return;
+    }
+    if (!workers_->trySubmit(work)) {
+        finish(makeOverloaded("Planning queue is full", k503ServiceUnavailable));
+    }
+}
+
+// HTTP handler: GET /arm/state?robot=N
+// Commanded state evaluated on the active trajectory at request time
+void ArmController::handleState(const HttpRequestPtr &req,
+                                std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    size_t robot = 0;
+    ExecutionEngine::Snapshot st;
+    if (!readRobotId(req, Json::Value::nullSingleton(), robot) ||
+        !engine_->state(robot, ExecutionEngine::Clock::now(), st)) {
+        callback(makeError("Unknown robot", k404NotFound));
+        return;
+    }
+    callback(HttpResponse::newHttpJsonResponse(stateJson(robot, st)));
+}
+
+// HTTP handler: POST /arm/execute
+// Body: { robot?, q_target, T? }   move from the current commanded state (retargets a moving robot)
+//    or { robot?, trajectory: id } run a stored trajectory (?store=1) from rest at its start pose
+void ArmController::handleExecute(const HttpRequestPtr &req,
+                                  std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    auto json = requestJson(req);
+    if (!json) {
+        callback(makeError("Bad JSON body"));
+        return;
+    }
+    size_t robot = 0;
+    if (!readRobotId(req, *json, robot)) {
+        callback(makeError("robot must be a non-negative integer"));
+        return;
+    }
+
+    const auto now = ExecutionEngine::Clock::now();
+    uint64_t seq = 0;
+    ExecutionEngine::Result res;
+    if (json->isMember("trajectory")) {
+        uint64_t handle = 0;
+        TrajectoryStore::Entry entry;
+        if (!TrajectoryStore::parseId((*json)["trajectory"].asString(), handle) ||
+            !store_->get(handle, entry)) {
+            callback(makeError("Unknown or expired trajectory id", k404NotFound));
+            return;
+        }
+        res = engine_->execute(robot, entry.traj, now, &seq);
+    } else {
+        std::vector<double> q_target6;
+        if (!readQ6((*json)["q_target"], q_target6)) {
+            callback(makeError("Not enough parameters: q_target (6 values) or trajectory (id)"));
+            return;
+        }
+        double T = 1.0;
+        if (!readT(*json, T)) {
+            callback(makeError("T must be a number in (0, 3600] s"));
+            return;
+        }
+        try {
+            res = engine_->moveTo(robot, q_target6, T, now, &seq);
+        } catch (const std::exception &e) {
+            callback(makeError(e.what()));
+            return;
+        }
+    }
+
+    switch (res) {
+    case ExecutionEngine::Result::UnknownRobot:
+        callback(makeError("Unknown robot", k404NotFound));
+        return;
+    case ExecutionEngine::Result::StartMismatch:
+        callback(makeError("Trajectory does not start at the robot's current pose at rest", k409Conflict));
+        return;
+    case ExecutionEngine::Result::Ok:
+        break;
+    }
+    ExecutionEngine::Snapshot st;
+    engine_->state(robot, now, st);
+    callback(HttpResponse::newHttpJsonResponse(stateJson(robot, st)));
+}
+
+// HTTP handler: POST /arm/stop  (body { robot? } or ?robot=)
+// Decelerates smoothly to rest within custom_config.execution.stop_time_s
+void ArmController::handleStop(const HttpRequestPtr &req,
+                               std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    auto json = requestJson(req);
+    size_t robot = 0;
+    if (!readRobotId(req, json ? *json : Json::Value::nullSingleton(), robot)) {
+        callback(makeError("robot must be a non-negative integer"));
+        return;
+    }
+    const auto now = ExecutionEngine::Clock::now();
+    if (engine_->stop(robot, now) == ExecutionEngine::Result::UnknownRobot) {
+        callback(makeError("Unknown robot", k404NotFound));
+        return;
+    }
+    ExecutionEngine::Snapshot st;
+    engine_->state(robot, now, st);
+    callback(HttpResponse::newHttpJsonResponse(stateJson(robot, st)));
+}
+
+// HTTP handler: POST /arm/speed  { robot?, speed }  (fraction of nominal, 0.1 .. 1.0)
+// Speed override: the active move is re-timed in place, no replanning
+void ArmController::handleSpeed(const HttpRequestPtr &req,
+                                std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    auto json = requestJson(req);
+    if (!json) {
+        callback(makeError("Bad JSON body"));
+        return;
+    }
+    size_t robot = 0;
+    if (!readRobotId(req, *json, robot)) {
+        callback(makeError("robot must be a non-negative integer"));
+        return;
+    }
+    if (!(*json)["speed"].isNumeric()) {
+        callback(makeError("Not enough parameters: speed (fraction of nominal)"));
+        return;
+    }
+    const auto now = ExecutionEngine::Clock::now();
+    if (engine_->setSpeed(robot, (*json)["speed"].asDouble(), now) == ExecutionEngine::Result::UnknownRobot) {
+        callback(makeError("Unknown robot", k404NotFound));
+        return;
+    }
+    ExecutionEngine::Snapshot st;
+    engine_->state(robot, now, st);
+    callback(HttpResponse::newHttpJsonResponse(stateJson(robot, st)));
+}
+
+// HTTP handler: GET /debug/admission
+void ArmController::handleAdmissionStats(const HttpRequestPtr &,
+                                         std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    const auto s = admission_->stats();
     Json::Value out(Json::objectValue);
-    out["dt"] = dt;
-    out["unit"] = "rad";
-    out["trajectory"] = Json::arrayValue;
+    out["enabled"] = admission_enabled_;
+    out["budget_bytes"] = (Json::UInt64)s.budget_bytes;
+    out["in_flight_bytes"] = (Json::UInt64)s.in_flight_bytes;
+    out["in_flight_requests"] = (Json::UInt64)s.in_flight_requests;
+    out["queue_depth"] = (Json::UInt64)s.queue_depth;
+    out["queue_depth_max"] = (Json::UInt64)s.queue_depth_max;
+    out["admitted"] = (Json::UInt64)s.admitted;
+    out["queued"] = (Json::UInt64)s.queued;
+    out["rejected_queue_full"] = (Json::UInt64)s.rejected_queue_full;
+    out["rejected_too_large"] = (Json::UInt64)s.rejected_too_large;
+    out["timed_out"] = (Json::UInt64)s.timed_out;
+    out["worker_queue_depth"] = (Json::UInt64)workers_->queueDepth();
+
+    // Cancelled requests by reason and CPU spent on plans abandoned half-way
+    Json::Value cn(Json::objectValue);
+    for (auto why : {CancelToken::Reason::Cancelled, CancelToken::Reason::Deadline,
+                     CancelToken::Reason::Disconnected, CancelToken::Reason::Superseded}) {
+        cn[CancelToken::reasonName(why)] = (Json::UInt64)cancelled_by_reason_[(size_t)why].load();
+    }
+    cn["abandoned_plans"] = (Json::UInt64)plans_abandoned_.load();
+    cn["wasted_cpu_ms"] = (double)wasted_cpu_ns_.load() / 1e6;
+    cn["default_deadline_ms"] = default_deadline_ms_;
+    out["cancellation"] = cn;
+    callback(HttpResponse::newHttpJsonResponse(out));
+}
+
+// HTTP handler: GET /debug/alloc
+// Heap allocations by region since start (all zero unless built with ROBOT_ARM_ALLOC_STATS)
+void ArmController::handleAllocStats(const HttpRequestPtr &,
+                                     std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    const auto t = alloc_stats::totals();
+    Json::Value out(Json::objectValue);
+    out["enabled"] = alloc_stats::kEnabled;
+    out["requests"] = (Json::UInt64)t.requests;
+    out["max_request_allocs"] = (Json::UInt64)t.max_request_allocs;
+    Json::Value regions(Json::objectValue);
+    for (size_t i = 0; i < alloc_stats::kRegions; ++i) {
+        const auto &c = t.region[i];
+        Json::Value r(Json::objectValue);
+        r["allocs"] = (Json::UInt64)c.allocs;
+        r["bytes"] = (Json::UInt64)c.bytes;
+        r["frees"] = (Json::UInt64)c.frees;
+        r["allocs_per_request"] = t.requests ? (double)c.allocs / (double)t.requests : 0.0;
+        regions[alloc_stats::regionName((alloc_stats::Region)i)] = r;
+    }
+    out["regions"] = regions;
+    callback(HttpResponse::newHttpJsonResponse(out));
+}
+
+// HTTP handler: GET /debug/perf
+// Hardware counters of the sampled requests per stage: IPC, misses per trajectory sample
+void ArmController::handlePerfStats(const HttpRequestPtr &,
+                                    std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    const perf::Counters &counters = perf::Counters::thread();
+    Json::Value out(Json::objectValue);
+    out["available"] = counters.available();
+    if (!counters.available()) out["reason"] = counters.reason();
+    out["sample_every"] = (Json::UInt64)perf_sampler_->every();
+    Json::Value stages(Json::objectValue);
+    for (size_t i = 0; i < perf::kStages; ++i) {
+        const auto t = perf::stageTotals((perf::Stage)i);
+        Json::Value st(Json::objectValue);
+        st["calls"] = (Json::UInt64)t.calls;
+        st["samples"] = (Json::UInt64)t.samples;
+        st["ipc"] = t.ipc();
+        Json::Value per_sample(Json::objectValue), per_call(Json::objectValue);
+        for (size_t e = 0; e < perf::kEvents; ++e) {
+            if (!(counters.events() & (1u << e))) continue;   // not counted on this CPU
+            per_call[perf::eventName(e)] = t.perCall(e);
+            if (t.samples) per_sample[perf::eventName(e)] = t.perSample(e);
+        }
+        st["per_call"] = per_call;
+        st["per_sample"] = per_sample;
+        stages[perf::stageName((perf::Stage)i)] = st;
+    }
+    out["stages"] = stages;
+    callback(HttpResponse::newHttpJsonResponse(out));
+}
+
+// HTTP handler: GET /metrics
+// Prometheus text format: request metrics (metrics.hpp) and gauges of the planning components
+void ArmController::handleMetrics(const HttpRequestPtr &,
+                                  std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    std::string out;
+    out.reserve(32 * 1024);
+    metrics::writeRequestMetrics(out);
+    writeLoopMetrics(out);
+    memacct::writeMemoryMetrics(out);
+    const auto ready = readiness_.snapshot();
+    metrics::writeGauge(out, "robot_arm_ready", "1 once the startup warm-up is done", ready.ready ? 1.0 : 0.0);
+    if (ready.ready) {
+        metrics::writeGauge(out, "robot_arm_time_to_ready_seconds", "Process start (or controller creation) to ready",
+                            ready.process_time_to_ready_s >= 0.0 ? ready.process_time_to_ready_s
+                                                                 : ready.time_to_ready_s);
+    }
+    metrics::writeHeader(out, "robot_arm_warmup_phase_seconds", "gauge", "Duration of the startup phases");
+    for (const auto &ph : ready.phases) {
+        metrics::writeSample(out, "robot_arm_warmup_phase_seconds", "phase=\"" + ph.name + "\"", ph.seconds);
+    }
+    if (rss_limit_bytes_) {
+        metrics::writeGauge(out, "robot_arm_process_resident_limit_bytes", "Configured RSS alert limit",
+                            (double)rss_limit_bytes_);
+        metrics::writeHeader(out, "robot_arm_process_resident_limit_exceeded_total", "counter",
+                             "Times the resident set grew past its limit");
+        metrics::writeSample(out, "robot_arm_process_resident_limit_exceeded_total", "",
+                             (double)rss_alerts_.load(std::memory_order_relaxed));
+    }
 
-    for (const auto &p : pmp_traj) {
-        Json::Value item(Json::objectValue);
-        item["t"] = p.t;
-        item["q"] = to_q6_json(p.q); // ensures always 6 values (pads if needed)
-        out["trajectory"].append(item);
+    metrics::writeGauge(out, "robot_arm_worker_queue_depth", "Planning tasks waiting for a worker",
+                        (double)workers_->queueDepth());
+    metrics::writeGauge(out, "robot_arm_worker_threads", "Planning worker threads", (double)workers_->size());
+    const auto a = admission_->stats();
+    metrics::writeGauge(out, "robot_arm_admission_in_flight_bytes", "Admitted planning cost in flight",
+                        (double)a.in_flight_bytes);
+    metrics::writeGauge(out, "robot_arm_admission_queue_depth", "Planning requests waiting for admission",
+                        (double)a.queue_depth);
+    metrics::writeHeader(out, "robot_arm_admission_rejected_total", "counter",
+                         "Planning requests refused by admission control");
+    metrics::writeSample(out, "robot_arm_admission_rejected_total", "reason=\"queue_full\"",
+                         (double)a.rejected_queue_full);
+    metrics::writeSample(out, "robot_arm_admission_rejected_total", "reason=\"too_large\"",
+                         (double)a.rejected_too_large);
+    metrics::writeSample(out, "robot_arm_admission_rejected_total", "reason=\"timed_out\"",
+                         (double)a.timed_out);
+    const auto c = cache_->stats();
+    metrics::writeGauge(out, "robot_arm_plan_cache_bytes", "Plan cache size", (double)c.bytes);
+    metrics::writeGauge(out, "robot_arm_plan_cache_entries", "Plan cache entries", (double)c.entries);
+    if (!library_path_.empty()) {
+        const auto lib = library();
+        metrics::writeGauge(out, "robot_arm_trajectory_library_entries", "Moves in the mapped trajectory library",
+                            lib ? (double)lib->entries() : 0.0);
+        metrics::writeGauge(out, "robot_arm_trajectory_library_version", "Version of the mapped trajectory library",
+                            lib ? (double)lib->version() : 0.0);
+        metrics::writeHeader(out, "robot_arm_trajectory_library_hits_total", "counter",
+                             "Plans served from the trajectory library");
+        metrics::writeSample(out, "robot_arm_trajectory_library_hits_total", "",
+                             (double)library_hits_.load(std::memory_order_relaxed));
+        metrics::writeHeader(out, "robot_arm_trajectory_library_swaps_total", "counter",
+                             "New library versions mapped while serving");
+        metrics::writeSample(out, "robot_arm_trajectory_library_swaps_total", "",
+                             (double)library_swaps_.load(std::memory_order_relaxed));
+        metrics::writeHeader(out, "robot_arm_trajectory_library_load_errors_total", "counter",
+                             "Library files rejected (the previous version kept serving)");
+        metrics::writeSample(out, "robot_arm_trajectory_library_load_errors_total", "",
+                             (double)library_errors_.load(std::memory_order_relaxed));
     }
+    if (recorder_) {
+        const auto r = recorder_->stats();
+        metrics::writeHeader(out, "robot_arm_request_log_records_total", "counter", "Requests and jog frames recorded");
+        metrics::writeSample(out, "robot_arm_request_log_records_total", "", (double)r.records);
+        metrics::writeHeader(out, "robot_arm_request_log_dropped_total", "counter",
+                             "Records dropped (queue full)");
+        metrics::writeSample(out, "robot_arm_request_log_dropped_total", "", (double)r.dropped);
+        metrics::writeHeader(out, "robot_arm_request_log_failed_total", "counter",
+                             "Records lost to a write error (recording stopped)");
+        metrics::writeSample(out, "robot_arm_request_log_failed_total", "", (double)r.failed);
+    }
+
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setContentTypeString("text/plain; version=0.0.4; charset=utf-8");
+    resp->setBody(std::move(out));
+    callback(resp);
+}
+
+// HTTP handler: GET /debug/trace?seconds=N
+// Chrome trace-event JSON of the traced requests. seconds > 0 traces every request for
+// that long (at most custom_config.tracing.max_seconds) and answers when the window ends;
+// without it the spans still held in the per-thread buffers are returned.
+void ArmController::handleTrace(const HttpRequestPtr &req,
+                                std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    auto respond = [](const std::function<void (const HttpResponsePtr &)> &cb, uint64_t since_ns) {
+        auto resp = HttpResponse::newHttpResponse();
+        resp->setContentTypeCode(CT_APPLICATION_JSON);
+        resp->setBody(trace::chromeJson(trace::collect(since_ns)));
+        cb(resp);
+    };
 
-    // Send response
+    const double seconds = std::min(std::atof(req->getParameter("seconds").c_str()), trace_max_seconds_);
+    if (!(seconds > 0.0)) {
+        respond(callback, 0);
+        return;
+    }
+    const uint64_t since = trace::nowNs();
+    trace::captureFor(seconds);
+    trantor::EventLoop::getEventLoopOfCurrentThread()->runAfter(
+        seconds, [respond, since, cb = std::move(callback)]() { respond(cb, since); });
+}
+
+// HTTP handler: GET /debug/loops
+// Jitter of the periodic loops (loop_monitor.hpp): percentiles are histogram bucket bounds,
+// last_miss lists the ticks up to the latest deadline miss (custom_config.loop_monitor.history)
+void ArmController::handleLoops(const HttpRequestPtr &,
+                                std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    auto dist = [](const metrics::Histogram &h, uint64_t max_ns) {
+        Json::Value d(Json::objectValue);
+        d["p50_us"] = histogramQuantile(h, 0.5) / 1e3;
+        d["p99_us"] = histogramQuantile(h, 0.99) / 1e3;
+        d["p999_us"] = histogramQuantile(h, 0.999) / 1e3;
+        d["max_us"] = (double)max_ns / 1e3;
+        return d;
+    };
+    Json::Value out(Json::objectValue);
+    for (const LoopMonitor *m : LoopMonitor::all()) {
+        const auto st = m->stats();
+        Json::Value l(Json::objectValue);
+        l["period_ms"] = (double)m->periodNs() / 1e6;
+        l["deadline_ms"] = (double)m->deadlineNs() / 1e6;
+        l["ticks"] = (Json::UInt64)st.ticks;
+        l["deadline_misses"] = (Json::UInt64)st.misses;
+        l["skipped"] = (Json::UInt64)st.skipped;
+        l["interval"] = dist(m->intervals(), st.max_interval_ns);
+        l["wake_latency"] = dist(m->wakeLatencies(), st.max_wake_latency_ns);
+        l["compute"] = dist(m->computeTimes(), st.max_compute_ns);
+        Json::Value miss(Json::arrayValue);
+        for (const auto &t : m->lastMissDump()) {
+            Json::Value r(Json::objectValue);
+            r["seq"] = (Json::UInt64)t.seq;
+            r["interval_us"] = (double)t.interval_ns / 1e3;
+            r["wake_latency_us"] = (double)t.wake_latency_ns / 1e3;
+            r["compute_us"] = (double)t.compute_ns / 1e3;
+            r["missed"] = t.missed;
+            miss.append(r);
+        }
+        l["last_miss"] = miss;
+        out[m->name()] = l;
+    }
+    callback(HttpResponse::newHttpJsonResponse(out));
+}
+
+// HTTP handler: GET /debug/memory
+// Per-subsystem byte accounts (memory_accounting.hpp) next to the allocator and kernel view;
+// unaccounted_bytes = malloc in-use minus the accounts (libraries, Drogon buffers, estimate error)
+void ArmController::handleMemory(const HttpRequestPtr &,
+                                 std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    Json::Value out(Json::objectValue);
+    Json::Value accounts(Json::objectValue);
+    int64_t accounted = 0;
+    for (const auto &u : memacct::usage()) {
+        Json::Value a(Json::objectValue);
+        a["bytes"] = (Json::Int64)u.bytes;
+        a["high_water_bytes"] = (Json::Int64)u.high_water;
+        a["limit_bytes"] = (Json::Int64)u.limit;
+        a["limit_exceeded"] = (Json::UInt64)u.alerts;
+        accounts[u.name] = a;
+        accounted += u.bytes;
+    }
+    out["accounts"] = accounts;
+    out["accounted_bytes"] = (Json::Int64)accounted;
+
+    const auto m = memacct::allocatorStats();
+    Json::Value alloc(Json::objectValue);
+    alloc["available"] = m.available;
+    if (m.available) {
+        alloc["heap_bytes"] = (Json::UInt64)m.heap;
+        alloc["mmapped_bytes"] = (Json::UInt64)m.mmapped;
+        alloc["in_use_bytes"] = (Json::UInt64)m.in_use;
+        alloc["free_bytes"] = (Json::UInt64)m.free;
+        alloc["releasable_bytes"] = (Json::UInt64)m.releasable;
+        out["unaccounted_bytes"] = (Json::Int64)((int64_t)m.in_use - accounted);
+    }
+    out["allocator"] = alloc;
+
+    const auto p = memacct::processMemory();
+    Json::Value proc(Json::objectValue);
+    proc["available"] = p.available;
+    if (p.available) {
+        proc["rss_bytes"] = (Json::UInt64)p.rss;
+        proc["rss_peak_bytes"] = (Json::UInt64)p.rss_peak;
+        proc["rss_anon_bytes"] = (Json::UInt64)p.rss_anon;
+        proc["rss_file_bytes"] = (Json::UInt64)p.rss_file;
+        proc["virtual_bytes"] = (Json::UInt64)p.virt;
+    }
+    proc["rss_limit_bytes"] = (Json::UInt64)rss_limit_bytes_;
+    proc["rss_limit_exceeded"] = (Json::UInt64)rss_alerts_.load(std::memory_order_relaxed);
+    out["process"] = proc;
+    callback(HttpResponse::newHttpJsonResponse(out));
+}
+
+// HTTP handler: GET /ready
+// 200 once the startup warm-up is done, 503 before (with the current phase and its progress)
+void ArmController::handleReady(const HttpRequestPtr &,
+                                std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    const auto r = readiness_.snapshot();
+    Json::Value out(Json::objectValue);
+    out["ready"] = r.ready;
+    if (!r.ready) {
+        out["phase"] = r.phase;
+        out["done"] = (Json::UInt64)r.done;
+        out["total"] = (Json::UInt64)r.total;
+    } else {
+        out["time_to_ready_ms"] = r.time_to_ready_s * 1e3;
+        if (r.process_time_to_ready_s >= 0.0) out["process_time_to_ready_ms"] = r.process_time_to_ready_s * 1e3;
+    }
+    Json::Value phases(Json::arrayValue);
+    for (const auto &ph : r.phases) {
+        Json::Value p(Json::objectValue);
+        p["name"] = ph.name;
+        p["ms"] = ph.seconds * 1e3;
+        if (ph.items) p["items"] = (Json::UInt64)ph.items;
+        phases.append(p);
+    }
+    out["phases"] = phases;
     auto resp = HttpResponse::newHttpJsonResponse(out);
+    if (!r.ready) resp->setStatusCode(k503ServiceUnavailable);
     callback(resp);
 }
 
+// HTTP handler: GET /debug/plan_cache
+void ArmController::handlePlanCacheStats(const HttpRequestPtr &,
+                                         std::function<void (const HttpResponsePtr &)> &&callback)
+{
+    const auto s = cache_->stats();
+    Json::Value out(Json::objectValue);
+    out["enabled"] = cache_enabled_;
+    out["hits"] = (Json::UInt64)s.hits;
+    out["misses"] = (Json::UInt64)s.misses;
+    out["insertions"] = (Json::UInt64)s.insertions;
+    out["evictions"] = (Json::UInt64)s.evictions;
+    out["entries"] = (Json::UInt64)s.entries;
+    out["bytes"] = (Json::UInt64)s.bytes;
+    out["capacity_bytes"] = (Json::UInt64)s.capacity_bytes;
+    const uint64_t lookups = s.hits + s.misses;
+    out["hit_ratio"] = lookups ? (double)s.hits / (double)lookups : 0.0;
 
+    // Request coalescing in front of the planner
+    const auto f = flights_.stats();
+    Json::Value sf(Json::objectValue);
+    sf["flights"] = (Json::UInt64)f.flights;
+    sf["coalesced"] = (Json::UInt64)f.coalesced;
+    sf["cancelled"] = (Json::UInt64)f.cancelled;
+    sf["dropped"] = (Json::UInt64)f.dropped;
+    sf["in_flight"] = (Json::UInt64)f.in_flight;
+    out["single_flight"] = sf;
+    callback(HttpResponse::newHttpJsonResponse(out));
+}
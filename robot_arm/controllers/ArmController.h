@@ -2,23 +2,318 @@
 
 #include <drogon/HttpController.h>
 #include <functional>
-#include "dynamics.hpp"   // SimpleDynamics
+#include <memory>
+#include <mutex>
+#include "plan_cache.hpp" // PlanCache
+#include "trajectory_store.hpp" // TrajectoryStore
+#include "worker_pool.hpp"      // WorkerPool
+#include "admission.hpp"        // AdmissionControl
+#include "single_flight.hpp"    // SingleFlight
+#include "cancel_token.hpp"     // CancelToken
+#include "execution_engine.hpp" // ExecutionEngine
+#include "alloc_stats.hpp"      // alloc_stats::RequestUsage
+#include "perf_counters.hpp"    // perf::Sampler
+#include "metrics.hpp"          // metrics::RequestTimer
+#include "trace.hpp"            // trace::Span
+#include "loop_monitor.hpp"     // LoopMonitor
+#include "request_log.hpp"      // reqlog::Recorder
+#include "memory_accounting.hpp" // memacct::Account
+#include "warmup.hpp"             // Readiness
+#include "trajectory_library.hpp" // trajlib::Library
+#include <trantor/net/EventLoop.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unordered_map>
 
-class ArmController : public drogon::HttpController<ArmController> {
+// Not created by Drogon: main() registers it (and hands its engine to JogController)
+class ArmController : public drogon::HttpController<ArmController, false> {
 public:
     ArmController();
+    ~ArmController();
 
     METHOD_LIST_BEGIN
         ADD_METHOD_TO(ArmController::handlePlanPMP_Q,   "/arm/plan_pmp_q",drogon::Post);
+        ADD_METHOD_TO(ArmController::handlePlanBatch,   "/arm/plan_batch", drogon::Post);
+        ADD_METHOD_TO(ArmController::handleTrajectoryWindow, "/arm/trajectory/{id}", drogon::Get);
+        ADD_METHOD_TO(ArmController::handleState,       "/arm/state", drogon::Get);
+        ADD_METHOD_TO(ArmController::handleExecute,     "/arm/execute", drogon::Post);
+        ADD_METHOD_TO(ArmController::handleStop,        "/arm/stop", drogon::Post);
+        ADD_METHOD_TO(ArmController::handleSpeed,       "/arm/speed", drogon::Post);
+        ADD_METHOD_TO(ArmController::handlePlanCacheStats, "/debug/plan_cache", drogon::Get);
+        ADD_METHOD_TO(ArmController::handleAdmissionStats, "/debug/admission", drogon::Get);
+        ADD_METHOD_TO(ArmController::handleAllocStats,  "/debug/alloc", drogon::Get);
+        ADD_METHOD_TO(ArmController::handlePerfStats,   "/debug/perf", drogon::Get);
+        ADD_METHOD_TO(ArmController::handleMetrics,     "/metrics", drogon::Get);
+        ADD_METHOD_TO(ArmController::handleTrace,       "/debug/trace", drogon::Get);
+        ADD_METHOD_TO(ArmController::handleLoops,       "/debug/loops", drogon::Get);
+        ADD_METHOD_TO(ArmController::handleMemory,      "/debug/memory", drogon::Get);
+        ADD_METHOD_TO(ArmController::handleReady,       "/ready", drogon::Get);
     METHOD_LIST_END
 
 
     void handlePlanPMP_Q(const drogon::HttpRequestPtr &,
                     std::function<void (const drogon::HttpResponsePtr &)> &&);
-                    
+
+    void handlePlanBatch(const drogon::HttpRequestPtr &,
+                    std::function<void (const drogon::HttpResponsePtr &)> &&);
+
+    void handleTrajectoryWindow(const drogon::HttpRequestPtr &,
+                    std::function<void (const drogon::HttpResponsePtr &)> &&,
+                    std::string id);
+
+    void handleState(const drogon::HttpRequestPtr &,
+                    std::function<void (const drogon::HttpResponsePtr &)> &&);
+
+    void handleExecute(const drogon::HttpRequestPtr &,
+                    std::function<void (const drogon::HttpResponsePtr &)> &&);
+
+    void handleStop(const drogon::HttpRequestPtr &,
+                    std::function<void (const drogon::HttpResponsePtr &)> &&);
+
+    void handleSpeed(const drogon::HttpRequestPtr &,
+                    std::function<void (const drogon::HttpResponsePtr &)> &&);
+
+    void handlePlanCacheStats(const drogon::HttpRequestPtr &,
+                    std::function<void (const drogon::HttpResponsePtr &)> &&);
+
+    void handleAdmissionStats(const drogon::HttpRequestPtr &,
+                    std::function<void (const drogon::HttpResponsePtr &)> &&);
+
+    void handleAllocStats(const drogon::HttpRequestPtr &,
+                    std::function<void (const drogon::HttpResponsePtr &)> &&);
+
+    void handlePerfStats(const drogon::HttpRequestPtr &,
+                    std::function<void (const drogon::HttpResponsePtr &)> &&);
+
+    void handleMetrics(const drogon::HttpRequestPtr &,
+                    std::function<void (const drogon::HttpResponsePtr &)> &&);
+
+    void handleTrace(const drogon::HttpRequestPtr &,
+                    std::function<void (const drogon::HttpResponsePtr &)> &&);
+
+    void handleLoops(const drogon::HttpRequestPtr &,
+                    std::function<void (const drogon::HttpResponsePtr &)> &&);
+
+    void handleMemory(const drogon::HttpRequestPtr &,
+                    std::function<void (const drogon::HttpResponsePtr &)> &&);
+
+    void handleReady(const drogon::HttpRequestPtr &,
+                    std::function<void (const drogon::HttpResponsePtr &)> &&);
+
+
+    // Shared with the /arm/jog WebSocket channel (passed to JogController at registration)
+    ExecutionEngine &engine() { return *engine_; }
+
+    // Request log (custom_config.request_log), null when off; /arm/jog records its frames too
+    reqlog::Recorder *recorder() { return recorder_.get(); }
 
 private:
-    SimpleDynamics dyn_;  
+    // Outcome of one planner run, shared by all coalesced waiters
+    struct PlanResult {
+        PlanCache::Body body;              // nullptr on error
+        std::string error;
+        drogon::HttpStatusCode status = drogon::k400BadRequest;
+        bool cancelled = false;            // the waiter's request was cancelled
+        uint64_t plan_ns = 0;              // stage durations for Server-Timing
+        uint64_t serialize_ns = 0;
+    };
+    using PlanFlights = SingleFlight<PlanKey, PlanResult, PlanKeyHash>;
+
+    // One /arm/plan_pmp_q request between admission and response
+    struct PlanCall {
+        std::vector<double> q_target6;
+        double T = 1.0;
+        double dt = 0.02;
+        PlanOptions opt;
+        bool store = false;
+        QuinticTrajectory coeffs;          // handed to the engine once answered (commitPlan)
+        uint64_t cost = 0;                 // admission charge held (0 = none)
+        CancelTokenPtr token;
+        trantor::EventLoop *loop = nullptr;
+        std::function<void (const drogon::HttpResponsePtr &)> callback;
+        alloc_stats::RequestUsage alloc;   // empty unless ROBOT_ARM_ALLOC_STATS
+        bool perf_sampled = false;         // stages counted in perf::stageTotals
+        metrics::RequestTimer timer{metrics::Route::PlanPmpQ};
+        uint64_t trace_id = 0;             // != 0: spans recorded (trace.hpp)
+        uint64_t trace_start_ns = 0;
+        uint64_t decode_ns = 0;            // Server-Timing
+    };
+
+    // One /arm/trajectory/{id} request between admission and response
+    struct WindowCall {
+        QuinticTrajectory traj;            // copied out of the store: the entry may expire meanwhile
+        double from = 0.0;
+        double to = 0.0;
+        double dt = 0.02;
+        PlanOptions opt;
+        uint64_t cost = 0;                 // admission charge held (0 = none)
+        CancelTokenPtr token;
+        trantor::EventLoop *loop = nullptr;
+        std::function<void (const drogon::HttpResponsePtr &)> callback;
+    };
+
+    // One /arm/plan_batch request, shared by the worker tasks that plan its chunks
+    struct BatchItem {
+        std::vector<double> q0, q1;
+        double T = 1.0;
+        double dt = 0.02;
+        bool has_q0 = false;               // q0 given (else the current state)
+        std::string error;                 // set while parsing: item is not planned
+    };
+
+    struct BatchJob {
+        std::vector<BatchItem> items;
+        std::vector<std::string> bodies;   // serialized plan or error message per item
+        std::vector<uint8_t> ok;
+        PlanOptions opt;
+        uint64_t cost = 0;                 // admission charge held (0 = none)
+        std::atomic<size_t> chunks_left{0};
+        CancelTokenPtr token;
+        trantor::EventLoop *loop = nullptr;
+        std::function<void (const drogon::HttpResponsePtr &)> callback;
+        alloc_stats::RequestUsage alloc;   // empty unless ROBOT_ARM_ALLOC_STATS
+        bool perf_sampled = false;         // stages counted in perf::stageTotals
+        metrics::RequestTimer timer{metrics::Route::PlanBatch};
+        uint64_t decode_ns = 0;            // Server-Timing
+        uint64_t plan_start = 0;           // tsc::now() when the chunks were submitted
+        size_t samples = 0;                // of the valid items
+
+        // Items and bodies held by the job ("batch_jobs" account); bodies are returned as the
+        // envelope is streamed, the rest with the job
+        memacct::Account *mem = nullptr;
+        std::atomic<int64_t> mem_bytes{0};
+        void charge(int64_t n)
+        {
+            mem_bytes.fetch_add(n, std::memory_order_relaxed);
+            mem->add(n);
+        }
+        ~BatchJob()
+        {
+            if (mem) mem->sub(mem_bytes.load(std::memory_order_relaxed));
+        }
+    };
+
+    void executePlan(const std::shared_ptr<PlanCall> &call);
+    void finishPlan(const std::shared_ptr<PlanCall> &call, const drogon::HttpResponsePtr &resp);
+    void runBatch(const std::shared_ptr<BatchJob> &job);
+    void runWindow(const std::shared_ptr<WindowCall> &call);
+    CancelTokenPtr makeToken(const drogon::HttpRequestPtr &req);
+    drogon::HttpResponsePtr cancelledResponse(const CancelToken &token);
+
+    void commitPlan(const QuinticTrajectory &coeffs);
+    PlanKey planKey(const std::vector<double> &q0,
+                    const std::vector<double> &q1,
+                    double T, double dt,
+                    const PlanOptions &opt) const;
+    PlanCache::Body cachedPlan(const PlanKey &key);
+    PlanCache::Body computePlan(const PlanKey &key,
+                                const QuinticTrajectory &coeffs,
+                                double dt,
+                                const PlanOptions &opt,
+                                const StopPredicate &should_stop,
+                                PlanResult *timing = nullptr,
+                                bool cache_insert = true);
+    void leadPlan(const PlanKey &key, const PlanFlights::Ticket &ticket,
+                  const QuinticTrajectory &coeffs,
+                  double dt,
+                  const PlanOptions &opt,
+                  bool cache_insert = true);
+    PlanCache::Body planCached(const std::vector<double> &q0,
+                               const std::vector<double> &q1,
+                               double T, double dt,
+                               const PlanOptions &opt,
+                               const CancelTokenPtr &token,
+                               bool &cache_hit,
+                               bool cache_insert = true);
+
+    // Startup phase (custom_config.warmup); declared first: time to ready starts with the constructor
+    Readiness readiness_;
+    bool reject_until_ready_ = true;     // planning routes answer 503 until ready
+    double prefill_timeout_s_ = 60.0;
+    std::vector<PlanMove> warmup_moves_;
+    std::string snapshot_path_;          // hottest cache keys as moves ("" = none)
+    size_t snapshot_entries_ = 1000;
+    std::atomic<bool> stopping_{false};
+    std::thread warmup_thread_;
+    void warmUp();
+    void warmWorkers();
+    void prefillCache();
+    void saveCacheSnapshot();
+
+    // Serialized responses of repeated moves (custom_config.plan_cache)
+    std::unique_ptr<PlanCache> cache_;
+    bool cache_enabled_ = true;
+    double cache_q_quantum_ = 1e-6; // rad
+    double cache_t_quantum_ = 1e-6; // s
+
+    // Precompiled canonical moves served by lookup (custom_config.trajectory_library; null = none).
+    // Readers copy the pointer under library_mutex_; a new file version is mapped on a worker and
+    // swapped in, the old mapping goes away with its last reader.
+    std::mutex library_mutex_;
+    std::shared_ptr<const trajlib::Library> library_;
+    std::string library_path_;           // "" = no library
+    trajlib::FileId library_id_;         // file of the mapped (or last rejected) version
+    bool library_id_set_ = false;
+    std::atomic<bool> library_loading_{false};
+    std::atomic<uint64_t> library_hits_{0};
+    std::atomic<uint64_t> library_swaps_{0};
+    std::atomic<uint64_t> library_errors_{0};
+    std::shared_ptr<const trajlib::Library> library();
+    void reloadLibrary();
+
+    // Coefficient-only trajectories for ?store=1 (custom_config.trajectory_store)
+    std::unique_ptr<TrajectoryStore> store_;
+    size_t max_window_samples_ = 200000;
+
+    // Commanded state of every robot (custom_config.execution), the only owner of arm state:
+    // /arm/plan_pmp_q plans robot kPlanRobot from its target and commits answered plans to it
+    static constexpr size_t kPlanRobot = 0;
+    std::unique_ptr<ExecutionEngine> engine_;
+    std::unique_ptr<LoopMonitor> engine_loop_;   // jitter of the execution tick
+
+    // Identical concurrent plan requests share one computation
+    PlanFlights flights_;
+
+    // Cancellation: X-Deadline-Ms / connection close / X-Session-Id superseding
+    // (custom_config.cancellation)
+    double default_deadline_ms_ = 0.0;   // 0 = no deadline
+    std::mutex sessions_mutex_;
+    std::unordered_map<std::string, std::weak_ptr<CancelToken>> sessions_;
+    size_t sessions_prune_at_ = 1024;
+    std::atomic<uint64_t> cancelled_by_reason_[5] = {};  // indexed by CancelToken::Reason
+    std::atomic<uint64_t> plans_abandoned_{0};
+    std::atomic<uint64_t> wasted_cpu_ns_{0};
+
+    // Requests measured with hardware counters (custom_config.perf_counters)
+    std::unique_ptr<perf::Sampler> perf_sampler_;
+
+    // /debug/trace capture windows (custom_config.tracing)
+    double trace_max_seconds_ = 60.0;
+
+    // Decoded plan requests appended for robot_arm_replay (custom_config.request_log; null = off)
+    std::unique_ptr<reqlog::Recorder> recorder_;
+    void recordPlanCall(const drogon::HttpRequestPtr &req, const PlanCall &call, uint64_t arrival);
+    void recordBatchJob(const drogon::HttpRequestPtr &req, const BatchJob &job, uint64_t arrival);
+
+    // Memory of in-flight batches; limits and the RSS alert (custom_config.memory)
+    memacct::Account batch_mem_{"batch_jobs"};
+    uint64_t rss_limit_bytes_ = 0;       // 0 = no RSS alert
+    bool rss_over_ = false;              // main loop only
+    std::atomic<uint64_t> rss_alerts_{0};
+    std::unordered_map<std::string, uint64_t> mem_alerts_seen_;   // main loop only
+    void checkMemory();
+
+    // In-flight cost budget for planning requests (custom_config.admission)
+    std::unique_ptr<AdmissionControl> admission_;
+    bool admission_enabled_ = true;
+
+    // Planning threads (declared last: destroyed first, draining tasks that use the members above)
+    // custom_config.worker_pool, and the /arm/plan_batch limit
+    std::unique_ptr<WorkerPool> workers_;
+    size_t inline_max_cost_ = 3000;   // samples x dof planned directly on the IO thread
+    size_t batch_max_items_ = 100000;
 };
 
 
@@ -0,0 +1,231 @@
+#include "JogController.h"
+#include <drogon/HttpAppFramework.h>
+#include <json/json.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+
+#include "plan_codec.hpp"   // serialize_plan(...)
+
+using namespace drogon;
+
+// Helper: error message on the jog channel (the connection stays open)
+static void sendError(const WebSocketConnectionPtr &conn, const std::string &msg)
+{
+    Json::Value err(Json::objectValue);
+    err["error"] = msg;
+    conn->send(write_json_compact(err));
+}
+
+// Helper: ?robot= of the handshake, decimal digits only (empty: robot 0)
+static bool readRobot(const std::string &v, size_t &out)
+{
+    if (v.empty()) {
+        out = 0;
+        return true;
+    }
+    if (!std::isdigit((unsigned char)v[0])) return false;
+    char *end = nullptr;
+    errno = 0;
+    const unsigned long id = std::strtoul(v.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE) return false;
+    out = id;
+    return true;
+}
+
+// Helper: 6 finite numbers (same rule as q_target of the HTTP API)
+static bool readTarget(const Json::Value &arr, std::vector<double> &out)
+{
+    if (!arr.isArray() || arr.size() < 6) return false;
+    out.resize(6);
+    for (Json::ArrayIndex i = 0; i < 6; ++i) {
+        if (!arr[i].isNumeric()) return false;
+        out[i] = arr[i].asDouble();
+        if (!std::isfinite(out[i])) return false;
+    }
+    return true;
+}
+
+// Helper: handshake query that reproduces a session (robot_arm_replay)
+static std::string sessionQuery(size_t robot, PlanFormat format)
+{
+    return "robot=" + std::to_string(robot) + (format == PlanFormat::Binary ? "&format=bin" : "");
+}
+
+// engine: owned by ArmController (also serves /arm/state, /arm/execute); recorder: its
+// request log, null when off
+JogController::JogController(ExecutionEngine &engine, reqlog::Recorder *recorder)
+    : engine_(engine), recorder_(recorder)
+{
+    // Jog settings: custom_config.jog
+    const auto &cfg = app().getCustomConfig()["jog"];
+    const double tick_s = std::max(0.001, cfg.get("tick_ms", 20.0).asDouble() / 1000.0);
+    horizon_s_   = std::max(0.02, cfg.get("horizon_s", 0.25).asDouble());
+    setpoint_dt_ = std::max(0.001, cfg.get("setpoint_dt", 0.008).asDouble());
+    setpoints_   = std::max(1u, cfg.get("setpoints", 4).asUInt());
+
+    LoopMonitor::Config lcfg;
+    lcfg.period_s = tick_s;
+    lcfg.deadline_s = cfg.get("deadline_ms", 0.0).asDouble() / 1000.0;
+    lcfg.history = app().getCustomConfig()["loop_monitor"].get("history", 64).asUInt();
+    loop_ = std::make_unique<LoopMonitor>("jog", lcfg);
+
+    // One timer for every jog connection
+    app().getLoop()->runEvery(tick_s, [this]() { tick(); });
+}
+
+void JogController::handleNewConnection(const HttpRequestPtr &req,
+                                        const WebSocketConnectionPtr &conn)
+{
+    auto session = std::make_shared<Session>();
+    if (!readRobot(req->getParameter("robot"), session->robot)) {
+        sendError(conn, "robot must be a non-negative integer");
+        conn->shutdown();
+        return;
+    }
+    if (session->robot >= engine_.robots()) {
+        sendError(conn, "Unknown robot");
+        conn->shutdown();
+        return;
+    }
+    if (!parse_plan_format(req->getParameter("format"), session->opt.format)) {
+        sendError(conn, "format must be \"json\" or \"bin\"");
+        conn->shutdown();
+        return;
+    }
+    session->opt.channels = kChanQ | kChanDq;
+    session->id = next_id_.fetch_add(1, std::memory_order_relaxed);
+    if (recorder_) record(reqlog::Kind::JogOpen, session->id, sessionQuery(session->robot, session->opt.format));
+
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    sessions_[conn.get()] = {conn, session};
+    mem_.add(kSessionBytes);
+}
+
+void JogController::handleConnectionClosed(const WebSocketConnectionPtr &conn)
+{
+    uint64_t id = 0;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        auto it = sessions_.find(conn.get());
+        if (it == sessions_.end()) return;
+        id = it->second.second->id;
+        sessions_.erase(it);
+        mem_.sub(kSessionBytes);
+    }
+    if (recorder_) record(reqlog::Kind::JogClose, id);
+}
+
+// Appends one jog record to the request log (never blocks, see reqlog::Recorder::record)
+void JogController::record(reqlog::Kind kind, uint64_t conn, std::string text)
+{
+    reqlog::Request r;
+    r.t_ns = recorder_->now();
+    r.kind = kind;
+    r.channels = 0;
+    r.conn = conn;
+    r.text = std::move(text);
+    recorder_->record(r);
+}
+
+// Messages only record the newest target; the tick does the work
+void JogController::handleNewMessage(const WebSocketConnectionPtr &conn,
+                                     std::string &&message,
+                                     const WebSocketMessageType &type)
+{
+    if (type != WebSocketMessageType::Text) return;
+
+    std::shared_ptr<Session> session;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        auto it = sessions_.find(conn.get());
+        if (it == sessions_.end()) return;
+        session = it->second.second;
+    }
+    // Recorded as received (also malformed ones): the replay sends the same bytes
+    if (recorder_) record(reqlog::Kind::JogFrame, session->id, message);
+
+    Json::Value msg;
+    Json::CharReaderBuilder b;
+    std::string errs;
+    std::unique_ptr<Json::CharReader> reader(b.newCharReader());
+    if (!reader->parse(message.data(), message.data() + message.size(), &msg, &errs) || !msg.isObject()) {
+        sendError(conn, "Bad JSON message");
+        return;
+    }
+
+    // Speed override is O(1) and applied right away (see ExecutionEngine::setSpeed)
+    if (msg.isMember("speed")) {
+        if (!msg["speed"].isNumeric() || !std::isfinite(msg["speed"].asDouble())) {
+            sendError(conn, "speed must be a finite number");
+            return;
+        }
+        engine_.setSpeed(session->robot, msg["speed"].asDouble(), ExecutionEngine::Clock::now());
+        if (!msg.isMember("q_target")) return;
+    }
+    if (msg.isMember("stop") && !msg["stop"].isBool()) {
+        sendError(conn, "stop must be true or false");
+        return;
+    }
+    if (msg.get("stop", false).asBool()) {
+        std::lock_guard<std::mutex> lock(session->mutex);
+        session->stop = true;
+        session->has_target = false;
+        return;
+    }
+    // Rejected before it reaches the session: a NaN target would poison every later setpoint
+    std::vector<double> target;
+    if (!readTarget(msg["q_target"], target)) {
+        sendError(conn, "q_target must have 6 finite numbers");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(session->mutex);
+    session->target.swap(target);
+    session->has_target = true;
+    session->stop = false;
+}
+
+// Applies the newest target of each session and streams the next setpoints of moving robots
+void JogController::tick()
+{
+    LoopMonitor::Tick monitored(*loop_);
+    std::vector<std::pair<WebSocketConnectionPtr, std::shared_ptr<Session>>> sessions;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        sessions.reserve(sessions_.size());
+        for (const auto &s : sessions_) sessions.push_back(s.second);
+    }
+
+    const auto now = ExecutionEngine::Clock::now();
+    std::vector<PMPPoint> window;
+    ExecutionEngine::Snapshot head;
+    for (const auto &entry : sessions) {
+        const auto &conn = entry.first;
+        Session &s = *entry.second;
+
+        std::vector<double> target;
+        bool retarget = false, stop = false;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (s.has_target) target.swap(s.target);
+            retarget = s.has_target;
+            stop = s.stop;
+            s.has_target = s.stop = false;
+        }
+        if (stop) engine_.stop(s.robot, now);
+        else if (retarget) engine_.moveTo(s.robot, target, horizon_s_, now);
+
+        engine_.sample(s.robot, now, setpoint_dt_, setpoints_, window, head);
+        const bool moving = head.status != ExecutionEngine::Status::Idle;
+        // While at rest only the first tick after a move (the final pose) is sent
+        if (!moving && !s.active && !retarget && !stop) continue;
+        s.active = moving;
+
+        const std::string body = serialize_plan(window, setpoint_dt_, s.opt);
+        conn->send(body, s.opt.format == PlanFormat::Binary ? WebSocketMessageType::Binary
+                                                            : WebSocketMessageType::Text);
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <drogon/WebSocketController.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "execution_engine.hpp" // ExecutionEngine
+#include "plan_codec.hpp"       // PlanOptions
+#include "loop_monitor.hpp"     // LoopMonitor
+#include "memory_accounting.hpp" // memacct::Account
+#include "request_log.hpp"      // reqlog::Recorder
+
+/*
+    /arm/jog: persistent jog channel (WebSocket) for slider / keyboard input.
+
+    Client -> server: {"q_target":[6 finite numbers]} (latest wins), {"stop":true},
+    {"speed":0.1..1.0} (speed override, applied immediately).
+    Only the newest target received during a tick is used: once per tick the
+    robot is retargeted from its current moving state (q, dq, ddq continuous)
+    and the next few setpoints are sent back in the /arm/plan_pmp_q body layout
+    (JSON, or PMPB binary with ?format=bin). Nothing is sent while at rest.
+
+    Handshake query: ?robot=N (default 0), ?format=json|bin.
+
+    Not created by Drogon: main() registers it with the execution engine it
+    drives and the request log (both owned by ArmController, which outlives
+    the server). With the log on, handshakes, text messages and closes are
+    recorded per connection for robot_arm_replay.
+*/
+
+class JogController : public drogon::WebSocketController<JogController, false> {
+public:
+    JogController(ExecutionEngine &engine, reqlog::Recorder *recorder);
+
+    void handleNewMessage(const drogon::WebSocketConnectionPtr &,
+                          std::string &&,
+                          const drogon::WebSocketMessageType &) override;
+    void handleNewConnection(const drogon::HttpRequestPtr &,
+                             const drogon::WebSocketConnectionPtr &) override;
+    void handleConnectionClosed(const drogon::WebSocketConnectionPtr &) override;
+
+    WS_PATH_LIST_BEGIN
+        WS_PATH_ADD("/arm/jog");
+    WS_PATH_LIST_END
+
+private:
+    // One connected jog client
+    struct Session {
+        uint64_t id = 0;                   // connection number in the request log
+        size_t robot = 0;
+        PlanOptions opt;
+        std::mutex mutex;                  // guards the fields below (message vs tick)
+        std::vector<double> target;        // newest target not applied yet
+        bool has_target = false;
+        bool stop = false;
+        bool active = false;               // robot was moving at the last tick
+    };
+
+    void tick();
+    void record(reqlog::Kind kind, uint64_t conn, std::string text = std::string());
+
+    ExecutionEngine &engine_;
+    reqlog::Recorder *recorder_;           // null: request log off
+    std::atomic<uint64_t> next_id_{1};
+    std::mutex sessions_mutex_;
+    std::unordered_map<drogon::WebSocketConnection *,
+                       std::pair<drogon::WebSocketConnectionPtr, std::shared_ptr<Session>>> sessions_;
+
+    // Session, its target and the map node ("jog_sessions"; Drogon's connection buffers are not seen)
+    static constexpr int64_t kSessionBytes = sizeof(Session) + 6 * sizeof(double) + 96;
+    memacct::Account mem_{"jog_sessions"};
+
+    // custom_config.jog
+    double horizon_s_ = 0.25;      // retarget duration
+    double setpoint_dt_ = 0.008;   // spacing of the setpoints sent back
+    size_t setpoints_ = 4;         // setpoints per tick
+    std::unique_ptr<LoopMonitor> loop_;   // jitter of tick() (/debug/loops, /metrics)
+};
@@ -0,0 +1,58 @@
+// robot_arm_difftest: property-based differential test of the planner engines
+// (see differential.hpp, planner_engines.hpp)
+//
+//   robot_arm_difftest [--iterations=20000] [--seed=1] [--engine=name]
+//
+// Exits with 1 when an engine disagrees with the reference beyond its tolerance.
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "differential.hpp"
+#include "planner_engines.hpp"
+
+static bool argValue(const char *arg, const char *name, std::string &out)
+{
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') return false;
+    out = arg + len + 1;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t iterations = 20000, seed = 1;
+    std::string engine, v;
+    for (int i = 1; i < argc; ++i) {
+        if (argValue(argv[i], "--iterations", v)) iterations = std::strtoull(v.c_str(), nullptr, 10);
+        else if (argValue(argv[i], "--seed", v)) seed = std::strtoull(v.c_str(), nullptr, 10);
+        else if (argValue(argv[i], "--engine", v)) engine = v;
+        else {
+            std::cerr << "unknown argument: " << argv[i] << "\n"
+                      << "usage: robot_arm_difftest [--iterations=N] [--seed=S] [--engine=NAME]\n";
+            return 2;
+        }
+    }
+
+    auto engines = difftest::registered_engines();
+    if (!engine.empty()) {
+        engines.erase(std::remove_if(engines.begin(), engines.end(),
+                                     [&engine](const difftest::Engine &e) { return e.name != engine; }),
+                      engines.end());
+        if (engines.empty()) {
+            std::cerr << "unknown engine: " << engine << "\n";
+            return 2;
+        }
+    }
+
+    difftest::Harness harness(std::move(engines));
+    std::mt19937_64 rng(seed);
+    for (uint64_t i = 0; i < iterations; ++i) harness.run(difftest::random_input(rng));
+
+    std::cout << "seed " << seed << ", ";
+    harness.print();
+    return harness.passed() ? 0 : 1;
+}
@@ -0,0 +1,346 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "trajectory.hpp"   // plan_pmp_minimum_jerk (the reference), pmp_sample_count
+
+/*
+    Differential testing of planner engines against the reference
+    plan_pmp_minimum_jerk() (quintic_coeffs() + direct polynomial evaluation).
+
+    An engine maps a request (q0, q1, T, dt) to the same sample grid as the
+    reference (N = max(2, round(T/dt)), t_k = min(k dt, T)) and declares the
+    channels it produces. For every request the harness runs the reference
+    and each engine and records, per engine and channel, the largest
+    absolute deviation and the largest relative one. The relative deviation
+    is taken against the channel's scale: the larger of its peak over the
+    trajectory and its natural unit for the move (|q|, dq/T, dq/T^2, ...),
+    so values at or crossing zero (dq at the ends, u mid-move, a grid with
+    only t = 0 and t = T) do not turn rounding noise into 100 % errors.
+
+    An engine fails on a request when it
+      - produces a different number of samples,
+      - rejects a request the reference plans,
+      - returns a non-finite value where the reference is finite,
+      - deviates by more than rel_tol * scale + abs_tol.
+    Engines with gate = false are candidates known to fail: they are
+    reported but do not fail the run.
+    Requests the reference rejects (T too small, singular solve6) are not
+    compared; an engine that plans them anyway is counted, not failed.
+*/
+
+namespace difftest {
+
+struct PlanInput {
+    std::vector<double> q0, q1;
+    double T = 1.0;
+    double dt = 0.01;
+};
+
+enum Channel : uint32_t { kT = 0, kQ, kDq, kDdq, kU, kLambda1, kLambda2, kLambda3, kJacc, kChannels };
+
+inline const char *channelName(size_t c)
+{
+    static const char *names[kChannels] = {"t", "q", "dq", "ddq", "u", "lambda1", "lambda2", "lambda3", "J_acc"};
+    return names[c];
+}
+
+constexpr uint32_t kAllChannels = (1u << kChannels) - 1;
+
+struct Engine {
+    std::string name;
+    std::function<std::vector<PMPPoint>(const PlanInput &)> plan;
+    double rel_tol = 1e-12;
+    uint32_t channels = kAllChannels;                          // bit c = Channel c is produced
+    std::function<bool(const PlanInput &)> supports = nullptr;  // nullptr = every request
+    double abs_tol = 0.0;                                      // e.g. below the range of float
+    bool gate = true;                                          // false: report only
+};
+
+struct ChannelStats {
+    double max_abs = 0.0;
+    double max_rel = 0.0;
+    PlanInput worst;                   // request with the largest relative deviation
+};
+
+struct EngineReport {
+    std::string name;
+    double rel_tol = 0.0;
+    uint32_t channels = 0;
+    bool gate = true;
+    uint64_t compared = 0;
+    uint64_t unsupported = 0;
+    uint64_t accepted_rejected = 0;    // planned a request the reference rejects
+    uint64_t failures = 0;
+    ChannelStats channel[kChannels];
+    std::vector<std::string> examples; // first failures, human readable
+};
+
+inline std::string describe(const PlanInput &in)
+{
+    double dq = 0.0;
+    for (size_t i = 0; i < in.q0.size(); ++i) dq = std::max(dq, std::fabs(in.q1[i] - in.q0[i]));
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "dof=%zu T=%.6g dt=%.6g N=%zu max|dq|=%.6g", in.q0.size(), in.T, in.dt,
+                  pmp_sample_count(in.T, in.dt) - 1, dq);
+    return buf;
+}
+
+// Value of channel c of sample p (joint i; scalar channels ignore i)
+inline double channelValue(const PMPPoint &p, size_t c, size_t i)
+{
+    switch (c) {
+    case kT:       return p.t;
+    case kQ:       return p.q[i];
+    case kDq:      return p.dq[i];
+    case kDdq:     return p.ddq[i];
+    case kU:       return p.u[i];
+    case kLambda1: return p.lambda1[i];
+    case kLambda2: return p.lambda2[i];
+    case kLambda3: return p.lambda3[i];
+    default:       return p.J_acc;
+    }
+}
+
+inline bool scalarChannel(size_t c) { return c == kT || c == kJacc; }
+
+// Natural unit of channel c for the move: d = max |q1 - q0|, q ~ max |q|, dq ~ d/T,
+// ddq ~ d/T^2, u ~ d/T^3, lambda2 ~ d/T^4, lambda1 ~ d/T^5, J_acc ~ d^2/T^5
+inline double naturalScale(const PlanInput &in, size_t c)
+{
+    double d = 0.0, q = 0.0;
+    for (size_t i = 0; i < in.q0.size(); ++i) {
+        d = std::max(d, std::fabs(in.q1[i] - in.q0[i]));
+        q = std::max(q, std::max(std::fabs(in.q0[i]), std::fabs(in.q1[i])));
+    }
+    const double T = in.T;
+    switch (c) {
+    case kT:       return T;
+    case kQ:       return q;
+    case kDq:      return d / T;
+    case kDdq:     return d / (T * T);
+    case kU:
+    case kLambda3: return d / (T * T * T);
+    case kLambda2: return d / (T * T * T * T);
+    case kLambda1: return d / (T * T * T * T * T);
+    default:       return d * d / (T * T * T * T * T);
+    }
+}
+
+class Harness {
+public:
+    explicit Harness(std::vector<Engine> engines) : engines_(std::move(engines))
+    {
+        for (const auto &e : engines_) {
+            EngineReport r;
+            r.name = e.name;
+            r.rel_tol = e.rel_tol;
+            r.channels = e.channels;
+            r.gate = e.gate;
+            reports_.push_back(r);
+        }
+    }
+
+    // Runs the reference and every engine on one request; false if a gating engine failed
+    bool run(const PlanInput &in)
+    {
+        ++requests_;
+        std::vector<PMPPoint> ref;
+        bool ref_ok = true;
+        try {
+            ref = plan_pmp_minimum_jerk(in.q0, in.q1, in.T, in.dt);
+        } catch (const std::exception &) {
+            ref_ok = false;
+            ++ref_rejected_;
+        }
+
+        bool ok = true;
+        for (size_t e = 0; e < engines_.size(); ++e) {
+            const Engine &eng = engines_[e];
+            EngineReport &rep = reports_[e];
+            if (eng.supports && !eng.supports(in)) {
+                ++rep.unsupported;
+                continue;
+            }
+            std::vector<PMPPoint> out;
+            bool eng_ok = true;
+            std::string what;
+            try {
+                out = eng.plan(in);
+            } catch (const std::exception &ex) {
+                eng_ok = false;
+                what = ex.what();
+            }
+            if (!ref_ok) {
+                if (eng_ok) ++rep.accepted_rejected;
+                continue;
+            }
+            ++rep.compared;
+            std::string why;
+            if (!eng_ok) why = "rejected: " + what;
+            else if (out.size() != ref.size()) {
+                why = std::to_string(out.size()) + " samples, reference " + std::to_string(ref.size());
+            } else {
+                why = compare(eng, rep, in, ref, out);
+            }
+            if (!why.empty()) {
+                if (eng.gate) ok = false;
+                ++rep.failures;
+                if (rep.examples.size() < 5) rep.examples.push_back(why + " (" + describe(in) + ")");
+            }
+        }
+        return ok;
+    }
+
+    const std::vector<EngineReport> &reports() const { return reports_; }
+    uint64_t requests() const { return requests_; }
+    uint64_t referenceRejected() const { return ref_rejected_; }
+
+    bool passed() const
+    {
+        for (const auto &r : reports_) {
+            if (r.gate && r.failures) return false;
+        }
+        return true;
+    }
+
+    void print() const
+    {
+        std::printf("%llu requests, %llu rejected by the reference\n", (unsigned long long)requests_,
+                    (unsigned long long)ref_rejected_);
+        for (const auto &r : reports_) {
+            std::printf("\nengine %-14s tolerance %.0e  compared %llu  failures %llu  unsupported %llu  "
+                        "planned-rejected %llu%s\n",
+                        r.name.c_str(), r.rel_tol, (unsigned long long)r.compared, (unsigned long long)r.failures,
+                        (unsigned long long)r.unsupported, (unsigned long long)r.accepted_rejected,
+                        r.gate ? "" : "  (report only)");
+            std::printf("  %-8s %14s %14s  %s\n", "channel", "max abs", "max rel", "worst request");
+            for (size_t c = 0; c < kChannels; ++c) {
+                const auto &s = r.channel[c];
+                if (!(r.channels & (1u << c))) continue;
+                std::printf("  %-8s %14.3e %14.3e  %s\n", channelName(c), s.max_abs, s.max_rel,
+                            s.max_rel > 0.0 ? describe(s.worst).c_str() : "-");
+            }
+            for (const auto &ex : r.examples) std::printf("  FAIL %s\n", ex.c_str());
+        }
+        std::fflush(stdout);
+    }
+
+private:
+    // Empty string when every produced channel is within tolerance
+    static std::string compare(const Engine &eng, EngineReport &rep, const PlanInput &in,
+                               const std::vector<PMPPoint> &ref, const std::vector<PMPPoint> &out)
+    {
+        const size_t dof = in.q0.size();
+        std::string why;
+        for (size_t c = 0; c < kChannels; ++c) {
+            if (!(eng.channels & (1u << c))) continue;
+            const size_t width = scalarChannel(c) ? 1 : dof;
+            double peak = 0.0;
+            for (const auto &p : ref) {
+                for (size_t i = 0; i < width; ++i) peak = std::max(peak, std::fabs(channelValue(p, c, i)));
+            }
+            double max_abs = 0.0;
+            bool finite = true;
+            for (size_t k = 0; k < ref.size(); ++k) {
+                for (size_t i = 0; i < width; ++i) {
+                    const double r = channelValue(ref[k], c, i), v = channelValue(out[k], c, i);
+                    if (std::isfinite(r) && !std::isfinite(v)) finite = false;
+                    else max_abs = std::max(max_abs, std::fabs(v - r));
+                }
+            }
+            const double scale = std::max(peak, naturalScale(in, c));
+            const double max_rel = scale > 0.0 ? max_abs / scale : max_abs;
+            ChannelStats &s = rep.channel[c];
+            s.max_abs = std::max(s.max_abs, max_abs);
+            if (max_rel > s.max_rel) {
+                s.max_rel = max_rel;
+                s.worst = in;
+            }
+            if (why.empty() && !finite) why = std::string(channelName(c)) + " is not finite";
+            if (why.empty() && max_abs > eng.rel_tol * scale + eng.abs_tol) {
+                char buf[96];
+                std::snprintf(buf, sizeof(buf), "%s deviates by %.3e (rel %.3e)", channelName(c), max_abs, max_rel);
+                why = buf;
+            }
+        }
+        return why;
+    }
+
+    std::vector<Engine> engines_;
+    std::vector<EngineReport> reports_;
+    uint64_t requests_ = 0;
+    uint64_t ref_rejected_ = 0;
+};
+
+// ------------------------------------------------------------
+// Request generators: property-based (random) and libFuzzer (bytes)
+// ------------------------------------------------------------
+constexpr size_t kMaxSamples = 20000;   // keeps one request well under a millisecond
+
+// Extreme but plannable-size requests: tiny and huge T, huge dq, dt > T, N = 2, odd dt
+inline PlanInput random_input(std::mt19937_64 &rng)
+{
+    auto uni = [&rng](double lo, double hi) { return std::uniform_real_distribution<double>(lo, hi)(rng); };
+    auto logUni = [&uni](double lo, double hi) { return std::exp(uni(std::log(lo), std::log(hi))); };
+    auto pick = [&rng](size_t n) { return std::uniform_int_distribution<size_t>(0, n - 1)(rng); };
+
+    PlanInput in;
+    const size_t dof = pick(4) == 0 ? 1 + pick(8) : 6;
+    const double scale = std::vector<double>{1e-12, 1e-3, 1.0, 3.14159, 1e3, 1e6}[pick(6)];
+    for (size_t i = 0; i < dof; ++i) {
+        const double q0 = pick(3) == 0 ? 0.0 : uni(-scale, scale);
+        const double dq = pick(8) == 0 ? 0.0 : uni(-scale, scale);
+        in.q0.push_back(q0);
+        in.q1.push_back(q0 + dq);
+    }
+
+    switch (pick(4)) {
+    case 0:  in.T = logUni(1e-9, 1e-2); break;   // tiny (mostly rejected by the reference)
+    case 1:  in.T = logUni(1e2, 1e5); break;     // very long
+    default: in.T = logUni(1e-2, 1e2); break;
+    }
+    switch (pick(6)) {
+    case 0:  in.dt = in.T * logUni(1.0, 100.0); break;                // dt >= T: N = 2
+    case 1:  in.dt = in.T / 2.0; break;                               // N = 2 exactly
+    case 2:  in.dt = in.T / (double)(3 + pick(20)); break;            // few samples
+    case 3:  in.dt = in.T / (std::floor(logUni(1.0, kMaxSamples)) + 0.37); break;  // not a divisor of T
+    default: in.dt = in.T / std::floor(logUni(1.0, kMaxSamples)); break;
+    }
+    return in;
+}
+
+// libFuzzer input: bytes -> a request in the same ranges (false: skip this input)
+inline bool decode_input(const uint8_t *data, size_t size, PlanInput &in)
+{
+    size_t pos = 0;
+    auto u8 = [&]() -> uint8_t { return pos < size ? data[pos++] : 0; };
+    auto unit = [&]() {       // [0, 1] from 4 bytes
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v = (v << 8) | u8();
+        return (double)v / 4294967295.0;
+    };
+    auto logRange = [&unit](double lo, double hi) { return std::exp(std::log(lo) + unit() * (std::log(hi) - std::log(lo))); };
+
+    if (size < 12) return false;
+    const size_t dof = 1 + u8() % 8;
+    const double scale = logRange(1e-12, 1e7);
+    in.q0.clear();
+    in.q1.clear();
+    for (size_t i = 0; i < dof; ++i) {
+        const double q0 = (unit() * 2.0 - 1.0) * scale;
+        in.q0.push_back(q0);
+        in.q1.push_back(q0 + (unit() * 2.0 - 1.0) * scale);
+    }
+    in.T = logRange(1e-10, 1e6);
+    in.dt = in.T * logRange(1.0 / (double)kMaxSamples, 1e3);
+    return pmp_sample_count(in.T, in.dt) <= kMaxSamples + 1;
+}
+
+} // namespace difftest
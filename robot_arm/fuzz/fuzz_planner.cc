@@ -0,0 +1,22 @@
+// libFuzzer entry point of the differential planner test (clang, -DROBOT_ARM_FUZZ=ON):
+//
+//   ./robot_arm_fuzz_planner -max_total_time=600 corpus/
+//
+// Aborts with the deviation report on the first request an engine gets wrong.
+#include <cstdint>
+#include <cstdlib>
+
+#include "differential.hpp"
+#include "planner_engines.hpp"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static difftest::Harness harness(difftest::registered_engines());
+    difftest::PlanInput in;
+    if (!difftest::decode_input(data, size, in)) return 0;
+    if (!harness.run(in)) {
+        harness.print();
+        std::abort();
+    }
+    return 0;
+}
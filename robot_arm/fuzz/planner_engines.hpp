@@ -0,0 +1,308 @@
+#pragma once
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <json/json.h>
+
+#include "differential.hpp"
+#include "trajectory.hpp"   // make_quintic_trajectory, eval_pmp_point
+#include "plan_codec.hpp"   // serialize_plan_binary, serialize_plan_json
+
+/*
+    Engines checked against the reference by the differential harness.
+
+    Production paths:
+      coeffs_eval    make_quintic_trajectory() + eval_pmp_point(), the path of
+                     /arm/trajectory/{id} and the execution engine
+      wire_binary    reference samples through serialize_plan_binary() and back
+      wire_json      reference samples through serialize_plan_json() and back
+                     (6 DOF: the JSON layout pads/truncates to UR5e vectors;
+                     N <= 2000 to keep the run short)
+
+    Candidate fast paths (not used by the server until they pass here):
+      closed_form    rest-to-rest coefficients 10/-15/6 dq/T^k, no solve6, Horner
+      forward_diff   closed-form coefficients, samples by forward differencing
+      float_output   closed form in normalized time, values rounded to float32
+*/
+
+namespace difftest {
+
+// Sample grid of the reference: N = max(2, round(T/dt)), t_k = min(k dt, T)
+inline int reference_steps(double T, double dt)
+{
+    return std::max(2, (int)std::round(T / std::max(dt, 1e-9)));
+}
+
+inline void resize_point(PMPPoint &p, size_t dof)
+{
+    p.q.assign(dof, 0.0);
+    p.dq.assign(dof, 0.0);
+    p.ddq.assign(dof, 0.0);
+    p.u.assign(dof, 0.0);
+    p.lambda1.assign(dof, 0.0);
+    p.lambda2.assign(dof, 0.0);
+    p.lambda3.assign(dof, 0.0);
+}
+
+// J_acc exactly as the reference accumulates it
+inline void accumulate_cost(std::vector<PMPPoint> &out, double dt)
+{
+    double J = 0.0;
+    for (auto &p : out) {
+        double u2 = 0.0;
+        for (double u : p.u) u2 += u * u;
+        J += 0.5 * u2 * dt;
+        p.J_acc = J;
+    }
+}
+
+// Rest-to-rest minimum-jerk coefficients without the 6x6 solve
+inline void closed_form_coeffs(double q0, double q1, double T, double a[6])
+{
+    if (T <= 1e-9) throw std::runtime_error("closed_form: T too small");
+    const double d = q1 - q0, T3 = T * T * T;
+    a[0] = q0;
+    a[1] = 0.0;
+    a[2] = 0.0;
+    a[3] = 10.0 * d / T3;
+    a[4] = -15.0 * d / (T3 * T);
+    a[5] = 6.0 * d / (T3 * T * T);
+}
+
+inline void eval_horner(const double a[6], double t, PMPPoint &p, size_t i)
+{
+    p.q[i]   = a[0] + t * (a[1] + t * (a[2] + t * (a[3] + t * (a[4] + t * a[5]))));
+    p.dq[i]  = a[1] + t * (2.0 * a[2] + t * (3.0 * a[3] + t * (4.0 * a[4] + t * 5.0 * a[5])));
+    p.ddq[i] = 2.0 * a[2] + t * (6.0 * a[3] + t * (12.0 * a[4] + t * 20.0 * a[5]));
+    p.u[i]   = 6.0 * a[3] + t * (24.0 * a[4] + t * 60.0 * a[5]);
+    p.lambda3[i] = -p.u[i];
+    p.lambda2[i] = 24.0 * a[4] + 120.0 * a[5] * t;
+    p.lambda1[i] = -120.0 * a[5];
+}
+
+inline std::vector<PMPPoint> plan_coeffs_eval(const PlanInput &in)
+{
+    const auto tr = make_quintic_trajectory(in.q0, in.q1, in.T);
+    const int N = reference_steps(in.T, in.dt);
+    std::vector<PMPPoint> out((size_t)N + 1);
+    for (int k = 0; k <= N; ++k) eval_pmp_point(tr, std::min(k * in.dt, in.T), out[(size_t)k]);
+    accumulate_cost(out, in.dt);
+    return out;
+}
+
+inline std::vector<PMPPoint> plan_closed_form(const PlanInput &in)
+{
+    const size_t dof = in.q0.size();
+    std::vector<double> a(6 * dof);
+    for (size_t i = 0; i < dof; ++i) closed_form_coeffs(in.q0[i], in.q1[i], in.T, &a[6 * i]);
+
+    const int N = reference_steps(in.T, in.dt);
+    std::vector<PMPPoint> out((size_t)N + 1);
+    for (int k = 0; k <= N; ++k) {
+        PMPPoint &p = out[(size_t)k];
+        p.t = std::min(k * in.dt, in.T);
+        resize_point(p, dof);
+        for (size_t i = 0; i < dof; ++i) eval_horner(&a[6 * i], p.t, p, i);
+    }
+    accumulate_cost(out, in.dt);
+    return out;
+}
+
+// Polynomial of degree `deg` sampled at t = k h by forward differences:
+// deg + 1 direct evaluations, then additions only
+class ForwardDiff {
+public:
+    ForwardDiff(const double *c, int deg, double h) : deg_(deg)
+    {
+        for (int j = 0; j <= deg; ++j) {
+            const double t = j * h;
+            double v = 0.0;
+            for (int m = deg; m >= 0; --m) v = v * t + c[m];
+            d_[j] = v;
+        }
+        for (int order = 1; order <= deg; ++order) {
+            for (int j = deg; j >= order; --j) d_[j] -= d_[j - 1];
+        }
+    }
+
+    double value() const { return d_[0]; }
+
+    void step()
+    {
+        for (int j = 0; j < deg_; ++j) d_[j] += d_[j + 1];
+    }
+
+private:
+    int deg_;
+    double d_[6] = {};
+};
+
+inline std::vector<PMPPoint> plan_forward_diff(const PlanInput &in)
+{
+    const size_t dof = in.q0.size();
+    const int N = reference_steps(in.T, in.dt);
+    std::vector<PMPPoint> out((size_t)N + 1);
+    for (auto &p : out) resize_point(p, dof);
+    for (int k = 0; k <= N; ++k) out[(size_t)k].t = std::min(k * in.dt, in.T);
+
+    for (size_t i = 0; i < dof; ++i) {
+        double a[6];
+        closed_form_coeffs(in.q0[i], in.q1[i], in.T, a);
+        const double da[5] = {a[1], 2.0 * a[2], 3.0 * a[3], 4.0 * a[4], 5.0 * a[5]};
+        const double dda[4] = {2.0 * a[2], 6.0 * a[3], 12.0 * a[4], 20.0 * a[5]};
+        const double ua[3] = {6.0 * a[3], 24.0 * a[4], 60.0 * a[5]};
+        ForwardDiff q(a, 5, in.dt), dq(da, 4, in.dt), ddq(dda, 3, in.dt), u(ua, 2, in.dt);
+        for (int k = 0; k <= N; ++k) {
+            PMPPoint &p = out[(size_t)k];
+            if (k * in.dt > in.T) {
+                eval_horner(a, p.t, p, i);    // last sample clamped to T: off the uniform grid
+                continue;
+            }
+            p.q[i] = q.value();
+            p.dq[i] = dq.value();
+            p.ddq[i] = ddq.value();
+            p.u[i] = u.value();
+            p.lambda3[i] = -p.u[i];
+            p.lambda2[i] = 24.0 * a[4] + 120.0 * a[5] * p.t;
+            p.lambda1[i] = -120.0 * a[5];
+            q.step();
+            dq.step();
+            ddq.step();
+            u.step();
+        }
+    }
+    accumulate_cost(out, in.dt);
+    return out;
+}
+
+inline std::vector<PMPPoint> plan_float_output(const PlanInput &in)
+{
+    if (in.T <= 1e-9) throw std::runtime_error("float_output: T too small");
+    const size_t dof = in.q0.size();
+    const int N = reference_steps(in.T, in.dt);
+    const double T = in.T;
+    auto f = [](double v) { return (double)(float)v; };
+
+    std::vector<PMPPoint> out((size_t)N + 1);
+    for (int k = 0; k <= N; ++k) {
+        PMPPoint &p = out[(size_t)k];
+        p.t = std::min(k * in.dt, T);
+        resize_point(p, dof);
+        const double s = p.t / T;
+        for (size_t i = 0; i < dof; ++i) {
+            const double d = in.q1[i] - in.q0[i];
+            p.q[i]   = in.q0[i] + d * s * s * s * (10.0 + s * (-15.0 + 6.0 * s));
+            p.dq[i]  = d / T * s * s * (30.0 + s * (-60.0 + 30.0 * s));
+            p.ddq[i] = d / (T * T) * s * (60.0 + s * (-180.0 + 120.0 * s));
+            p.u[i]   = d / (T * T * T) * (60.0 + s * (-360.0 + 360.0 * s));
+            p.lambda3[i] = -p.u[i];
+            p.lambda2[i] = d / (T * T * T * T) * (-360.0 + 720.0 * s);
+            p.lambda1[i] = -720.0 * d / (T * T * T * T * T);
+        }
+    }
+    accumulate_cost(out, in.dt);   // J_acc is accumulated in double, then rounded like the rest
+    for (auto &p : out) {
+        for (auto *v : {&p.q, &p.dq, &p.ddq, &p.u, &p.lambda1, &p.lambda2, &p.lambda3}) {
+            for (double &x : *v) x = f(x);
+        }
+        p.J_acc = f(p.J_acc);
+    }
+    return out;
+}
+
+constexpr uint32_t kWireChannels = (1u << kT) | (1u << kQ) | (1u << kDq) | (1u << kDdq) | (1u << kU) | (1u << kJacc);
+constexpr uint32_t kWirePlanChannels = kChanQ | kChanDq | kChanDdq | kChanU | kChanJacc;
+
+inline std::vector<PMPPoint> plan_wire_binary(const PlanInput &in)
+{
+    const auto ref = plan_pmp_minimum_jerk(in.q0, in.q1, in.T, in.dt);
+    const std::string body = serialize_plan_binary(ref, in.dt, kWirePlanChannels);
+
+    uint16_t dof = 0;
+    uint32_t channels = 0, n = 0;
+    if (body.size() < kPlanBinaryHeaderSize || body.compare(0, 4, "PMPB") != 0) {
+        throw std::runtime_error("wire_binary: bad header");
+    }
+    std::memcpy(&dof, body.data() + 6, 2);
+    std::memcpy(&channels, body.data() + 8, 4);
+    std::memcpy(&n, body.data() + 12, 4);
+    const size_t row = plan_binary_sample_doubles(dof, channels);
+    if (body.size() != kPlanBinaryHeaderSize + (size_t)n * row * sizeof(double)) {
+        throw std::runtime_error("wire_binary: bad size");
+    }
+
+    std::vector<PMPPoint> out(n);
+    const char *src = body.data() + kPlanBinaryHeaderSize;
+    auto get = [&src](double *dst, size_t count) {
+        std::memcpy(dst, src, count * sizeof(double));
+        src += count * sizeof(double);
+    };
+    for (auto &p : out) {
+        resize_point(p, dof);
+        get(&p.t, 1);
+        get(p.q.data(), dof);
+        get(p.dq.data(), dof);
+        get(p.ddq.data(), dof);
+        get(p.u.data(), dof);
+        get(&p.J_acc, 1);
+    }
+    return out;
+}
+
+inline std::vector<PMPPoint> plan_wire_json(const PlanInput &in)
+{
+    const auto ref = plan_pmp_minimum_jerk(in.q0, in.q1, in.T, in.dt);
+    const std::string body = serialize_plan_json(ref, in.dt, kWirePlanChannels);
+
+    Json::CharReaderBuilder builder;
+    Json::Value root;
+    std::string errs;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    if (!reader->parse(body.data(), body.data() + body.size(), &root, &errs)) {
+        throw std::runtime_error("wire_json: " + errs);
+    }
+    const auto &arr = root["trajectory"];
+    std::vector<PMPPoint> out(arr.size());
+    for (Json::ArrayIndex k = 0; k < arr.size(); ++k) {
+        PMPPoint &p = out[k];
+        resize_point(p, 6);
+        p.t = arr[k]["t"].asDouble();
+        for (Json::ArrayIndex i = 0; i < 6; ++i) {
+            p.q[i] = arr[k]["q"][i].asDouble();
+            p.dq[i] = arr[k]["dq"][i].asDouble();
+            p.ddq[i] = arr[k]["ddq"][i].asDouble();
+            p.u[i] = arr[k]["u"][i].asDouble();
+        }
+        p.J_acc = arr[k]["J_acc"].asDouble();
+    }
+    return out;
+}
+
+// Every engine under test, with its tolerance (relative to the channel scale)
+inline std::vector<Engine> registered_engines()
+{
+    std::vector<Engine> engines;
+    auto add = [&engines](const char *name, std::function<std::vector<PMPPoint>(const PlanInput &)> plan,
+                          double rel_tol) -> Engine & {
+        Engine e;
+        e.name = name;
+        e.plan = std::move(plan);
+        e.rel_tol = rel_tol;
+        engines.push_back(std::move(e));
+        return engines.back();
+    };
+    add("coeffs_eval", plan_coeffs_eval, 1e-12);
+    add("wire_binary", plan_wire_binary, 0.0).channels = kWireChannels;
+    Engine &json = add("wire_json", plan_wire_json, 0.0);
+    json.channels = kWireChannels;
+    json.supports = [](const PlanInput &in) { return in.q0.size() == 6 && pmp_sample_count(in.T, in.dt) <= 2001; };
+    add("closed_form", plan_closed_form, 1e-9);
+    add("float_output", plan_float_output, 1e-7).abs_tol = 1.18e-38;  // FLT_MIN: smaller values flush
+    // Error grows with N (about N^5 eps for q): far off beyond a few hundred samples
+    add("forward_diff", plan_forward_diff, 1e-6).gate = false;
+    return engines;
+}
+
+} // namespace difftest
@@ -0,0 +1,184 @@
+#pragma once
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <algorithm>
+
+#include "plan_codec.hpp"   // PlanOptions, plan_binary_sample_doubles()
+
+/*
+    Admission control for planning requests.
+
+    Every request that will plan is charged its estimated peak memory
+    (estimate_plan_bytes) against a global in-flight budget:
+      - fits and nobody waits      -> Admitted, run now
+      - does not fit, queue has room -> Queued, onReady(true) once it fits,
+                                        onReady(false) after max_wait
+      - queue full                 -> Rejected      (HTTP 429 + Retry-After)
+      - larger than max_request    -> TooLarge      (HTTP 413)
+    Waiters are admitted in FIFO order. onReady runs on the thread that
+    calls release()/expire(); callers re-dispatch to their own loop.
+*/
+
+// ------------------------------------------------------------
+// Estimated peak bytes held while planning + serializing one request:
+//   trajectory : samples x (sizeof(PMPPoint) + 7 vectors x (dof doubles + ~16 B allocator header))
+//   output     : samples x numbers per sample x
+//                  JSON   ~88 B (about 24 text chars + a transient Json::Value node)
+//                  binary   8 B
+// ------------------------------------------------------------
+inline uint64_t estimate_plan_bytes(size_t samples, size_t dof, const PlanOptions &opt)
+{
+    const double numbers = (double)plan_binary_sample_doubles(dof, opt.channels);
+    const double per_number = opt.format == PlanFormat::Binary ? 8.0 : 88.0;
+    const double per_sample = (double)sizeof(PMPPoint) + 7.0 * (8.0 * (double)dof + 16.0)
+                            + numbers * per_number;
+    const double total = (double)samples * per_sample;
+    return total >= 1.8e19 ? UINT64_MAX : (uint64_t)total;
+}
+
+// Estimated size of the serialized body alone (what a finished batch item keeps until it is
+// sent): numbers per sample x ~24 text chars (JSON) or 8 B (binary)
+inline uint64_t estimate_plan_body_bytes(size_t samples, size_t dof, const PlanOptions &opt)
+{
+    const double numbers = (double)plan_binary_sample_doubles(dof, opt.channels);
+    const double per_number = opt.format == PlanFormat::Binary ? 8.0 : 24.0;
+    const double total = (double)samples * numbers * per_number;
+    return total >= 1.8e19 ? UINT64_MAX : (uint64_t)total;
+}
+
+class AdmissionControl {
+public:
+    using Clock = std::chrono::steady_clock;
+    using OnReady = std::function<void(bool admitted)>;
+
+    enum class Decision { Admitted, Queued, Rejected, TooLarge };
+
+    struct Config {
+        uint64_t budget_bytes = 512ull << 20;       // global in-flight budget
+        uint64_t max_request_bytes = 256ull << 20;  // single request cap (clamped to budget)
+        size_t max_queue = 256;                     // waiting requests
+        double max_wait_s = 2.0;                    // queue wait before 503
+    };
+
+    struct Stats {
+        uint64_t in_flight_bytes = 0;
+        uint64_t in_flight_requests = 0;
+        uint64_t budget_bytes = 0;
+        uint64_t queue_depth = 0;
+        uint64_t queue_depth_max = 0;
+        uint64_t admitted = 0;
+        uint64_t queued = 0;
+        uint64_t rejected_queue_full = 0;
+        uint64_t rejected_too_large = 0;
+        uint64_t timed_out = 0;
+    };
+
+    explicit AdmissionControl(const Config &cfg)
+        : cfg_(cfg)
+    {
+        cfg_.max_request_bytes = std::min(cfg_.max_request_bytes, cfg_.budget_bytes);
+    }
+
+    // onReady is only kept (and later called exactly once) when Queued is returned
+    Decision acquire(uint64_t cost, OnReady onReady)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cost > cfg_.max_request_bytes) {
+            ++stats_.rejected_too_large;
+            return Decision::TooLarge;
+        }
+        if (waiters_.empty() && in_flight_ + cost <= cfg_.budget_bytes) {
+            admitLocked(cost);
+            return Decision::Admitted;
+        }
+        if (waiters_.size() >= cfg_.max_queue) {
+            ++stats_.rejected_queue_full;
+            return Decision::Rejected;
+        }
+        const auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                                 std::chrono::duration<double>(cfg_.max_wait_s));
+        waiters_.push_back(Waiter{cost, deadline, std::move(onReady)});
+        ++stats_.queued;
+        stats_.queue_depth_max = std::max<uint64_t>(stats_.queue_depth_max, waiters_.size());
+        return Decision::Queued;
+    }
+
+    // Returns budget of a finished request and admits waiters that now fit
+    void release(uint64_t cost)
+    {
+        std::vector<std::pair<OnReady, bool>> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            in_flight_ -= std::min(cost, in_flight_);
+            --stats_.in_flight_requests;
+            drainLocked(Clock::now(), ready);
+        }
+        for (auto &r : ready) r.first(r.second);
+    }
+
+    // Fails waiters past their max_wait; call periodically
+    void expire()
+    {
+        std::vector<std::pair<OnReady, bool>> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            drainLocked(Clock::now(), ready);
+        }
+        for (auto &r : ready) r.first(r.second);
+    }
+
+    Stats stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats st = stats_;
+        st.in_flight_bytes = in_flight_;
+        st.budget_bytes = cfg_.budget_bytes;
+        st.queue_depth = waiters_.size();
+        return st;
+    }
+
+    const Config &config() const { return cfg_; }
+
+private:
+    struct Waiter {
+        uint64_t cost;
+        Clock::time_point deadline;
+        OnReady onReady;
+    };
+
+    void admitLocked(uint64_t cost)
+    {
+        in_flight_ += cost;
+        ++stats_.in_flight_requests;
+        ++stats_.admitted;
+    }
+
+    // Times out expired waiters (anywhere in the queue), then admits from the head in FIFO order
+    void drainLocked(Clock::time_point now, std::vector<std::pair<OnReady, bool>> &ready)
+    {
+        for (auto it = waiters_.begin(); it != waiters_.end();) {
+            if (it->deadline <= now) {
+                ready.emplace_back(std::move(it->onReady), false);
+                ++stats_.timed_out;
+                it = waiters_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        while (!waiters_.empty() && in_flight_ + waiters_.front().cost <= cfg_.budget_bytes) {
+            admitLocked(waiters_.front().cost);
+            ready.emplace_back(std::move(waiters_.front().onReady), true);
+            waiters_.pop_front();
+        }
+    }
+
+    Config cfg_;
+    mutable std::mutex mutex_;
+    std::deque<Waiter> waiters_;
+    uint64_t in_flight_ = 0;
+    Stats stats_;
+};
@@ -0,0 +1,224 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+    Opt-in heap allocation accounting (cmake -DROBOT_ARM_ALLOC_STATS=ON).
+
+    alloc_hooks.cc replaces the global operator new/delete and counts every
+    allocation (count, bytes) and free in thread-local counters of the
+    thread's current region. A Scope switches the region for its lifetime:
+
+        alloc_stats::Scope s(alloc_stats::Region::Plan);
+
+    When a Scope ends, its delta is added to the process-wide totals and to
+    the RequestUsage bound on the thread (Scope(region, &usage) binds one),
+    so one request can be followed across the IO loop and planning workers.
+    A Scope of Region::Other only binds the request (its delta goes to the
+    process-wide totals); allocations outside any Scope are not counted.
+
+    Without the option Scope and RequestUsage are empty and the hooks are
+    not compiled: no cost on the allocation path.
+*/
+
+namespace alloc_stats {
+
+#ifdef ROBOT_ARM_ALLOC_STATS
+constexpr bool kEnabled = true;
+#else
+constexpr bool kEnabled = false;
+#endif
+
+enum class Region : uint8_t { Other = 0, Parse, Plan, Serialize, Send };
+constexpr size_t kRegions = 5;
+
+inline const char *regionName(Region r)
+{
+    static const char *names[kRegions] = {"other", "parse", "plan", "serialize", "send"};
+    return names[(size_t)r];
+}
+
+struct Counters {
+    uint64_t allocs = 0;
+    uint64_t bytes = 0;
+    uint64_t frees = 0;
+};
+
+// Process-wide totals per region (summed at Scope exit, not per allocation)
+struct Totals {
+    std::array<Counters, kRegions> region{};
+    uint64_t requests = 0;             // finished RequestUsage records
+    uint64_t max_request_allocs = 0;   // worst single request
+};
+
+#ifdef ROBOT_ARM_ALLOC_STATS
+
+// Filled by the Scopes bound to one request; they may run on several threads
+// (IO loop, planning worker), hence relaxed atomics updated at Scope exit
+struct RequestUsage {
+    std::atomic<uint64_t> allocs_by[kRegions] = {};
+    std::atomic<uint64_t> bytes_by[kRegions] = {};
+
+    uint64_t allocs(Region r) const { return allocs_by[(size_t)r].load(std::memory_order_relaxed); }
+    uint64_t bytes(Region r) const { return bytes_by[(size_t)r].load(std::memory_order_relaxed); }
+    uint64_t allocs() const
+    {
+        uint64_t n = 0;
+        for (size_t i = 0; i < kRegions; ++i) n += allocs((Region)i);
+        return n;
+    }
+    uint64_t bytes() const
+    {
+        uint64_t n = 0;
+        for (size_t i = 0; i < kRegions; ++i) n += bytes((Region)i);
+        return n;
+    }
+};
+
+namespace detail {
+
+// Constant-initialized and trivially destructible: safe to touch from operator new
+struct ThreadState {
+    Region region = Region::Other;
+    RequestUsage *request = nullptr;
+    Counters local[kRegions];
+};
+inline thread_local ThreadState t_state;
+
+struct GlobalCounters {
+    std::atomic<uint64_t> allocs{0}, bytes{0}, frees{0};
+};
+inline GlobalCounters g_region[kRegions];
+inline std::atomic<uint64_t> g_requests{0};
+inline std::atomic<uint64_t> g_max_request_allocs{0};
+
+} // namespace detail
+
+// Called by the operator new/delete hooks
+inline void on_alloc(size_t n)
+{
+    auto &t = detail::t_state;
+    auto &c = t.local[(size_t)t.region];
+    ++c.allocs;
+    c.bytes += n;
+}
+
+inline void on_free()
+{
+    auto &t = detail::t_state;
+    ++t.local[(size_t)t.region].frees;
+}
+
+class Scope {
+public:
+    explicit Scope(Region r, RequestUsage *request = nullptr)
+    {
+        auto &t = detail::t_state;
+        prev_region_ = t.region;
+        prev_request_ = t.request;
+        if (request) t.request = request;
+        active_ = (r != prev_region_ || t.request != prev_request_);
+        if (!active_) return;            // nested scope of the same region: the outer one counts
+        region_ = r;
+        t.region = r;
+        start_ = t.local[(size_t)r];
+    }
+
+    ~Scope()
+    {
+        auto &t = detail::t_state;
+        if (active_) {
+            const Counters &now = t.local[(size_t)region_];
+            Counters d;
+            d.allocs = now.allocs - start_.allocs;
+            d.bytes = now.bytes - start_.bytes;
+            d.frees = now.frees - start_.frees;
+            auto &g = detail::g_region[(size_t)region_];
+            g.allocs.fetch_add(d.allocs, std::memory_order_relaxed);
+            g.bytes.fetch_add(d.bytes, std::memory_order_relaxed);
+            g.frees.fetch_add(d.frees, std::memory_order_relaxed);
+            if (t.request && region_ != Region::Other) {
+                t.request->allocs_by[(size_t)region_].fetch_add(d.allocs, std::memory_order_relaxed);
+                t.request->bytes_by[(size_t)region_].fetch_add(d.bytes, std::memory_order_relaxed);
+            }
+        }
+        t.region = prev_region_;
+        t.request = prev_request_;
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    Region region_ = Region::Other;
+    Region prev_region_;
+    RequestUsage *prev_request_;
+    Counters start_;
+    bool active_ = false;
+};
+
+// Adds a finished request to the aggregate (requests, worst request)
+inline void finishRequest(const RequestUsage &u)
+{
+    detail::g_requests.fetch_add(1, std::memory_order_relaxed);
+    const uint64_t n = u.allocs();
+    uint64_t cur = detail::g_max_request_allocs.load(std::memory_order_relaxed);
+    while (n > cur && !detail::g_max_request_allocs.compare_exchange_weak(cur, n, std::memory_order_relaxed)) {
+    }
+}
+
+inline Totals totals()
+{
+    Totals t;
+    for (size_t i = 0; i < kRegions; ++i) {
+        t.region[i].allocs = detail::g_region[i].allocs.load(std::memory_order_relaxed);
+        t.region[i].bytes = detail::g_region[i].bytes.load(std::memory_order_relaxed);
+        t.region[i].frees = detail::g_region[i].frees.load(std::memory_order_relaxed);
+    }
+    t.requests = detail::g_requests.load(std::memory_order_relaxed);
+    t.max_request_allocs = detail::g_max_request_allocs.load(std::memory_order_relaxed);
+    return t;
+}
+
+// One log line: "parse=3/412B plan=14/96KB ... total=40/190KB"
+inline std::string format(const RequestUsage &u)
+{
+    auto amount = [](uint64_t allocs, uint64_t bytes) {
+        return std::to_string(allocs) + "/" +
+               (bytes >= 10240 ? std::to_string(bytes >> 10) + "KB" : std::to_string(bytes) + "B");
+    };
+    std::string s;
+    for (size_t i = 1; i < kRegions; ++i) {
+        s += regionName((Region)i);
+        s += "=" + amount(u.allocs((Region)i), u.bytes((Region)i)) + " ";
+    }
+    s += "total=" + amount(u.allocs(), u.bytes());
+    return s;
+}
+
+#else // !ROBOT_ARM_ALLOC_STATS
+
+struct RequestUsage {
+    uint64_t allocs(Region) const { return 0; }
+    uint64_t bytes(Region) const { return 0; }
+    uint64_t allocs() const { return 0; }
+    uint64_t bytes() const { return 0; }
+};
+
+class Scope {
+public:
+    explicit Scope(Region, RequestUsage * = nullptr) {}
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+};
+
+inline void finishRequest(const RequestUsage &) {}
+inline Totals totals() { return Totals(); }
+inline std::string format(const RequestUsage &) { return std::string(); }
+
+#endif
+
+} // namespace alloc_stats
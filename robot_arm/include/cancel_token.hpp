@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <cstdint>
+#include <ctime>
+
+/*
+    Cancellation token for one request.
+
+    A token is cancelled when
+      - cancel() is called (e.g. superseded by a newer request of the same session),
+      - its deadline has passed,
+      - its liveness probe reports the client gone (connection closed).
+    Workers poll cancelled() at block boundaries and abandon work early.
+    The probe is only consulted every kProbeInterval polls to keep polling cheap.
+    setDeadline()/setProbe() must be called before the token is shared.
+*/
+
+class CancelToken {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Reason : uint8_t { None, Cancelled, Deadline, Disconnected, Superseded };
+
+    static constexpr unsigned kProbeInterval = 8;
+
+    void cancel(Reason why = Reason::Cancelled)
+    {
+        uint8_t none = (uint8_t)Reason::None;
+        reason_.compare_exchange_strong(none, (uint8_t)why, std::memory_order_relaxed);
+    }
+
+    void setDeadline(Clock::time_point deadline)
+    {
+        deadline_ = deadline;
+        has_deadline_ = true;
+    }
+
+    // probe() returns false once the client is gone
+    void setProbe(std::function<bool()> probe) { probe_ = std::move(probe); }
+
+    bool cancelled()
+    {
+        if (reason_.load(std::memory_order_relaxed) != (uint8_t)Reason::None) return true;
+        if (has_deadline_ && Clock::now() >= deadline_) {
+            cancel(Reason::Deadline);
+            return true;
+        }
+        if (probe_ && polls_.fetch_add(1, std::memory_order_relaxed) % kProbeInterval == 0 && !probe_()) {
+            cancel(Reason::Disconnected);
+            return true;
+        }
+        return false;
+    }
+
+    Reason reason() const { return (Reason)reason_.load(std::memory_order_relaxed); }
+
+    static const char *reasonName(Reason r)
+    {
+        switch (r) {
+        case Reason::None:         return "none";
+        case Reason::Cancelled:    return "cancelled";
+        case Reason::Deadline:     return "deadline";
+        case Reason::Disconnected: return "disconnected";
+        case Reason::Superseded:   return "superseded";
+        }
+        return "unknown";
+    }
+
+private:
+    std::atomic<uint8_t> reason_{(uint8_t)Reason::None};
+    std::atomic<unsigned> polls_{0};
+    Clock::time_point deadline_{};
+    bool has_deadline_ = false;
+    std::function<bool()> probe_;
+};
+
+using CancelTokenPtr = std::shared_ptr<CancelToken>;
+
+// CPU time consumed by the calling thread (ns), used to account abandoned work
+inline uint64_t thread_cpu_ns()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
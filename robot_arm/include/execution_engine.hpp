@@ -0,0 +1,458 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+
+#include "trajectory.hpp"    // QuinticTrajectory, eval_pmp_point()
+#include "timer_wheel.hpp"   // TimerWheel
+#include "time_scaling.hpp"  // TimeLaw
+#include "memory_accounting.hpp" // memacct::Account
+
+/*
+    Server-side execution of trajectories for many robots.
+
+    Each robot is either idle (holding a pose) or following one active
+    quintic trajectory that started at a steady_clock time point. The
+    commanded state is never stepped: state() evaluates the active
+    polynomial at the request time, which is O(dof) per query.
+
+    Completion is driven by a timer wheel advanced from one periodic
+    callback (advance()); when a trajectory ends the robot switches to
+    holding its final pose. There are no per-robot threads or timers.
+
+    Each robot also has a speed override (UR pendant slider, min..max of
+    nominal). Trajectories are followed through a time law s(t) (see
+    time_scaling.hpp): changing the override re-anchors the law at the
+    current point and ramps the rate smoothly, without replanning.
+
+    Robots are numbered 0 .. max_robots-1 and start idle at the zero pose.
+    Locks are sharded by robot id. The engine is the only owner of robot
+    state: /arm/plan_pmp_q plans from target() of robot 0 and hands the
+    answered plan to follow(), so /arm/state shows what the client plays
+    (or, when the plan arrives mid-move, a continuous blend towards it).
+
+    The robot table and the trajectories it holds are the "execution_state"
+    memory account.
+*/
+
+class ExecutionEngine {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Status : uint8_t { Idle, Moving, Stopping };
+    enum class Result { Ok, UnknownRobot, StartMismatch };
+
+    struct Config {
+        size_t max_robots = 4096;
+        size_t dof = 6;
+        double tick_s = 0.01;          // timer wheel resolution
+        size_t wheel_slots = 512;
+        double stop_time_s = 0.3;      // duration of a controlled stop
+        double start_tolerance = 1e-3; // rad, execute(): trajectory start vs current pose
+        double speed_ramp_s = 0.2;     // rate ramp after an override change
+        double min_speed = 0.1;        // override range (fraction of nominal), > 0
+        double max_speed = 1.0;
+    };
+
+    // Lowest accepted min_speed: the time law divides by the rate at its anchor
+    static constexpr double kMinSpeed = 1e-3;
+
+    struct Snapshot {
+        Status status = Status::Idle;
+        uint64_t seq = 0;              // bumps on every execute / stop
+        double t = 0.0;                // trajectory time s reached (s)
+        double T = 0.0;                // trajectory duration (0 when idle)
+        double speed = 1.0;            // override set for the robot
+        double rate = 0.0;             // current ds/dt (0 at rest)
+        std::vector<double> q, dq, ddq;
+    };
+
+    struct Stats {
+        uint64_t robots = 0;
+        uint64_t started = 0;
+        uint64_t stopped = 0;
+        uint64_t completed = 0;
+        uint64_t timers = 0;           // pending completion timers
+    };
+
+    explicit ExecutionEngine(const Config &cfg)
+        : cfg_(checked(cfg)), robots_(cfg.max_robots), wheel_(cfg.wheel_slots), epoch_(Clock::now())
+    {
+        for (auto &r : robots_) r.hold.assign(cfg_.dof, 0.0);
+        mem_.add((int64_t)(robots_.capacity() * sizeof(Robot) + robots_.size() * cfg_.dof * sizeof(double)));
+    }
+
+    static const char *statusName(Status s)
+    {
+        switch (s) {
+        case Status::Idle:     return "idle";
+        case Status::Moving:   return "moving";
+        case Status::Stopping: return "stopping";
+        }
+        return "unknown";
+    }
+
+    size_t robots() const { return robots_.size(); }
+    size_t dof() const { return cfg_.dof; }
+
+    // Commanded state of robot id at `now`; false for an unknown id
+    bool state(size_t id, Clock::time_point now, Snapshot &out) const
+    {
+        if (id >= robots_.size()) return false;
+        std::lock_guard<std::mutex> lock(shard(id));
+        evalLocked(robots_[id], now, out);
+        return true;
+    }
+
+    // Pose robot id ends at: the final pose of its active trajectory (or stop), else the
+    // pose it holds. Plans chained on the robot start here; false for an unknown id.
+    bool target(size_t id, std::vector<double> &out) const
+    {
+        if (id >= robots_.size()) return false;
+        std::lock_guard<std::mutex> lock(shard(id));
+        const Robot &r = robots_[id];
+        if (r.status == Status::Idle) {
+            out = r.hold;
+        } else {
+            PMPPoint end;
+            eval_pmp_point(r.traj, r.traj.T, end);
+            out = std::move(end.q);
+        }
+        return true;
+    }
+
+    // n setpoints at now, now+dt, ... (t relative to now, q/dq/ddq filled); `head` is the
+    // state at now. One lock for the whole window; false for an unknown id.
+    bool sample(size_t id, Clock::time_point now, double dt, size_t n,
+                std::vector<PMPPoint> &out, Snapshot &head) const
+    {
+        if (id >= robots_.size()) return false;
+        const auto step = seconds(dt);
+        out.resize(n);
+        std::lock_guard<std::mutex> lock(shard(id));
+        evalLocked(robots_[id], now, head);
+        Snapshot s;
+        for (size_t k = 0; k < n; ++k) {
+            evalLocked(robots_[id], now + step * (long)k, s);
+            out[k].t = (double)k * dt;
+            out[k].q = std::move(s.q);
+            out[k].dq = std::move(s.dq);
+            out[k].ddq = std::move(s.ddq);
+        }
+        return true;
+    }
+
+    // Moves robot id from its current commanded state (q, dq, ddq continuous)
+    // to q_target in T seconds. Throws std::runtime_error on a bad T.
+    Result moveTo(size_t id, const std::vector<double> &q_target, double T,
+                  Clock::time_point now, uint64_t *seq = nullptr)
+    {
+        if (id >= robots_.size()) return Result::UnknownRobot;
+        Clock::time_point end;
+        uint64_t s = 0;
+        {
+            std::lock_guard<std::mutex> lock(shard(id));
+            Robot &r = robots_[id];
+            Snapshot cur;
+            evalLocked(r, now, cur);
+            s = retargetLocked(r, cur, q_target, T, r.speed, now, end);
+        }
+        started_.fetch_add(1, std::memory_order_relaxed);
+        scheduleEnd(id, s, end);
+        if (seq) *seq = s;
+        return Result::Ok;
+    }
+
+    // Runs a precomputed trajectory (e.g. from the trajectory store). Its start must
+    // match the current commanded pose and the robot must be at rest.
+    Result execute(size_t id, const QuinticTrajectory &tr, Clock::time_point now,
+                   uint64_t *seq = nullptr)
+    {
+        if (id >= robots_.size()) return Result::UnknownRobot;
+        Clock::time_point end;
+        uint64_t s = 0;
+        {
+            std::lock_guard<std::mutex> lock(shard(id));
+            Robot &r = robots_[id];
+            Snapshot cur;
+            evalLocked(r, now, cur);
+            if (cur.status != Status::Idle || tr.dof != cfg_.dof) return Result::StartMismatch;
+            for (size_t i = 0; i < cfg_.dof; ++i) {
+                if (std::fabs(tr.coeffs[6 * i] - cur.q[i]) > cfg_.start_tolerance) return Result::StartMismatch;
+            }
+            s = startLocked(r, tr, TimeLaw::constant(r.speed), Status::Moving, now, end);
+        }
+        started_.fetch_add(1, std::memory_order_relaxed);
+        scheduleEnd(id, s, end);
+        if (seq) *seq = s;
+        return Result::Ok;
+    }
+
+    // Hands robot id a plan answered to a client (planned from target()). At rest at the
+    // plan's start, the plan runs as is at nominal speed whatever the override: the client
+    // plays the body back at rate 1, so state() matches it. Otherwise (still moving) the
+    // robot blends: it is retargeted from its current state (q, dq, ddq continuous, no jump)
+    // to the plan's end pose in the plan's T, also at rate 1; state() then shows the blend.
+    Result follow(size_t id, const QuinticTrajectory &tr, Clock::time_point now, uint64_t *seq = nullptr)
+    {
+        if (id >= robots_.size()) return Result::UnknownRobot;
+        if (tr.dof != cfg_.dof) return Result::StartMismatch;
+        Clock::time_point end;
+        uint64_t s = 0;
+        {
+            std::lock_guard<std::mutex> lock(shard(id));
+            Robot &r = robots_[id];
+            Snapshot cur;
+            evalLocked(r, now, cur);
+            bool at_start = cur.status == Status::Idle;
+            for (size_t i = 0; at_start && i < cfg_.dof; ++i) {
+                at_start = std::fabs(tr.coeffs[6 * i] - cur.q[i]) <= cfg_.start_tolerance;
+            }
+            if (at_start) {
+                s = startLocked(r, tr, TimeLaw::constant(1.0), Status::Moving, now, end);
+            } else {
+                PMPPoint goal;
+                eval_pmp_point(tr, tr.T, goal);
+                s = retargetLocked(r, cur, goal.q, tr.T, 1.0, now, end);
+            }
+        }
+        started_.fetch_add(1, std::memory_order_relaxed);
+        scheduleEnd(id, s, end);
+        if (seq) *seq = s;
+        return Result::Ok;
+    }
+
+    // Brings robot id to rest in stop_time_s along a smooth (continuous acceleration) profile
+    Result stop(size_t id, Clock::time_point now, uint64_t *seq = nullptr)
+    {
+        if (id >= robots_.size()) return Result::UnknownRobot;
+        Clock::time_point end;
+        uint64_t s = 0;
+        {
+            std::lock_guard<std::mutex> lock(shard(id));
+            Robot &r = robots_[id];
+            Snapshot cur;
+            evalLocked(r, now, cur);
+            if (cur.status == Status::Idle) {
+                if (seq) *seq = r.seq;
+                return Result::Ok;
+            }
+            // q1 = q0 + v0*Ts/2 keeps the quintic's velocity monotone (no reversal) when a0 = 0.
+            // Stops run in physical time (rate 1) whatever the override.
+            const double Ts = cfg_.stop_time_s;
+            std::vector<double> q_stop(cfg_.dof);
+            for (size_t i = 0; i < cfg_.dof; ++i) q_stop[i] = cur.q[i] + 0.5 * cur.dq[i] * Ts;
+            QuinticTrajectory tr = make_quintic_trajectory(cur.q, cur.dq, cur.ddq, q_stop, {}, {}, Ts);
+            s = startLocked(r, std::move(tr), TimeLaw::constant(1.0), Status::Stopping, now, end);
+        }
+        stopped_.fetch_add(1, std::memory_order_relaxed);
+        scheduleEnd(id, s, end);
+        if (seq) *seq = s;
+        return Result::Ok;
+    }
+
+    // Sets the speed override (clamped to min_speed..max_speed). A moving robot keeps
+    // its trajectory: the time law is re-anchored at `now` and the rate ramps to the
+    // new value over speed_ramp_s. O(1), no replanning. Stops are not scaled.
+    Result setSpeed(size_t id, double speed, Clock::time_point now)
+    {
+        if (id >= robots_.size()) return Result::UnknownRobot;
+        speed = std::clamp(speed, cfg_.min_speed, cfg_.max_speed);
+        Clock::time_point end;
+        uint64_t s = 0;
+        {
+            std::lock_guard<std::mutex> lock(shard(id));
+            Robot &r = robots_[id];
+            r.speed = speed;
+            Snapshot cur;
+            evalLocked(r, now, cur);
+            if (cur.status != Status::Moving) return Result::Ok;
+
+            TimeLaw law;
+            law.s0 = cur.t;
+            law.r0 = cur.rate;
+            law.r1 = speed;
+            law.ramp = cfg_.speed_ramp_s;
+            r.law = law;
+            r.start = now;
+            end = now + seconds(law.timeTo(r.traj.T));
+            s = r.seq;
+        }
+        // The previous completion timer finds the move unfinished and is ignored
+        scheduleEnd(id, s, end);
+        return Result::Ok;
+    }
+
+    // Fires completion timers due by `now`; call every tick_s from one thread
+    void advance(Clock::time_point now)
+    {
+        due_.clear();
+        {
+            std::lock_guard<std::mutex> lock(wheel_mutex_);
+            wheel_.advance(toTick(now), [this](const Timer &t) { due_.push_back(t); });
+        }
+        for (const Timer &t : due_) {
+            std::lock_guard<std::mutex> lock(shard(t.robot));
+            Robot &r = robots_[t.robot];
+            if (r.seq != t.seq || r.status == Status::Idle) continue; // superseded by a newer command
+            double s, rate, dr;
+            r.law.eval(std::chrono::duration<double>(now - r.start).count(), s, rate, dr);
+            if (s < r.traj.T - 1e-9) continue;                         // rescheduled by setSpeed()
+            PMPPoint end;
+            eval_pmp_point(r.traj, r.traj.T, end);
+            r.hold = end.q;
+            r.status = Status::Idle;
+            completed_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    Stats stats() const
+    {
+        Stats st;
+        st.robots = robots_.size();
+        st.started = started_.load(std::memory_order_relaxed);
+        st.stopped = stopped_.load(std::memory_order_relaxed);
+        st.completed = completed_.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(wheel_mutex_);
+        st.timers = wheel_.size();
+        return st;
+    }
+
+    const Config &config() const { return cfg_; }
+
+private:
+    struct Robot {
+        Status status = Status::Idle;
+        uint64_t seq = 0;
+        Clock::time_point start;       // anchor of the time law
+        TimeLaw law;
+        double speed = 1.0;            // override
+        QuinticTrajectory traj;        // valid unless Idle
+        std::vector<double> hold;      // pose while Idle
+    };
+
+    struct Timer {
+        uint32_t robot;
+        uint64_t seq;
+    };
+
+    static constexpr size_t kShards = 64;
+
+    std::mutex &shard(size_t id) const { return shards_[id % kShards]; }
+
+    uint64_t toTick(Clock::time_point t) const
+    {
+        const double s = std::chrono::duration<double>(t - epoch_).count();
+        return s <= 0.0 ? 0 : (uint64_t)(s / cfg_.tick_s);
+    }
+
+    // Override range with a positive floor (NaN falls back to the floor too)
+    static Config checked(Config c)
+    {
+        c.min_speed = std::max(kMinSpeed, c.min_speed);
+        c.max_speed = std::max(c.min_speed, c.max_speed);
+        return c;
+    }
+
+    static Clock::duration seconds(double s)
+    {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(s));
+    }
+
+    // New quintic from the current state to q_target in T, followed at `rate`. It continues
+    // from the current rate: the quintic lives in trajectory time, dq = q' r and
+    // ddq = q'' r^2 at the anchor (dr = 0 there). Throws std::runtime_error on a bad T.
+    uint64_t retargetLocked(Robot &r, const Snapshot &cur, const std::vector<double> &q_target, double T,
+                            double rate, Clock::time_point now, Clock::time_point &end)
+    {
+        TimeLaw law = TimeLaw::constant(rate);
+        if (cur.status != Status::Idle && cur.rate > 0.0 && cur.rate != rate) {
+            law.r0 = cur.rate;
+            law.ramp = cfg_.speed_ramp_s;
+        }
+        std::vector<double> v0(cfg_.dof), a0(cfg_.dof);
+        for (size_t i = 0; i < cfg_.dof; ++i) {
+            v0[i] = cur.dq[i] / law.r0;
+            a0[i] = cur.ddq[i] / (law.r0 * law.r0);
+        }
+        QuinticTrajectory tr = make_quintic_trajectory(cur.q, v0, a0, q_target, {}, {}, T);
+        return startLocked(r, std::move(tr), law, Status::Moving, now, end);
+    }
+
+    uint64_t startLocked(Robot &r, QuinticTrajectory tr, const TimeLaw &law, Status status,
+                         Clock::time_point now, Clock::time_point &end)
+    {
+        const size_t held = r.traj.coeffs.capacity();
+        r.traj = std::move(tr);
+        mem_.add(((int64_t)r.traj.coeffs.capacity() - (int64_t)held) * (int64_t)sizeof(double));
+        r.law = law;
+        r.start = now;
+        r.status = status;
+        end = now + seconds(law.timeTo(r.traj.T));
+        return ++r.seq;
+    }
+
+    void scheduleEnd(size_t id, uint64_t seq, Clock::time_point end)
+    {
+        // Round up: the timer never fires before the trajectory has ended
+        const uint64_t due = toTick(end) + 1;
+        std::lock_guard<std::mutex> lock(wheel_mutex_);
+        wheel_.schedule(due, Timer{(uint32_t)id, seq});
+    }
+
+    // Past the end (timer not fired yet) the robot already reports its final pose at rest
+    void evalLocked(const Robot &r, Clock::time_point now, Snapshot &out) const
+    {
+        out.seq = r.seq;
+        out.speed = r.speed;
+        if (r.status == Status::Idle) {
+            out.status = Status::Idle;
+            out.t = out.T = out.rate = 0.0;
+            out.q = r.hold;
+            out.dq.assign(cfg_.dof, 0.0);
+            out.ddq.assign(cfg_.dof, 0.0);
+            return;
+        }
+        double s, rate, dr;
+        r.law.eval(std::chrono::duration<double>(now - r.start).count(), s, rate, dr);
+        PMPPoint p;
+        eval_pmp_point(r.traj, s, p);
+        out.T = r.traj.T;
+        out.t = p.t;
+        out.q = std::move(p.q);
+        if (s >= r.traj.T) {
+            out.status = Status::Idle;
+            out.rate = 0.0;
+            out.dq.assign(cfg_.dof, 0.0);
+            out.ddq.assign(cfg_.dof, 0.0);
+        } else {
+            // q(s(t)): chain rule through the time law
+            out.status = r.status;
+            out.rate = rate;
+            out.dq.resize(cfg_.dof);
+            out.ddq.resize(cfg_.dof);
+            for (size_t i = 0; i < cfg_.dof; ++i) {
+                out.dq[i] = p.dq[i] * rate;
+                out.ddq[i] = p.ddq[i] * rate * rate + p.dq[i] * dr;
+            }
+        }
+    }
+
+    Config cfg_;
+    std::vector<Robot> robots_;
+    mutable std::array<std::mutex, kShards> shards_;
+
+    mutable std::mutex wheel_mutex_;
+    TimerWheel<Timer> wheel_;
+    std::vector<Timer> due_;           // advance() scratch, reused
+    const Clock::time_point epoch_;
+
+    std::atomic<uint64_t> started_{0};
+    std::atomic<uint64_t> stopped_{0};
+    std::atomic<uint64_t> completed_{0};
+    memacct::Account mem_{"execution_state"};
+};
@@ -0,0 +1,258 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "metrics.hpp"   // metrics::Histogram, exposition helpers
+
+/*
+    Jitter and deadline monitoring of periodic loops (execution tick, jog tick).
+
+    The loop body is bracketed by a Tick:
+
+        void tick() { LoopMonitor::Tick t(monitor_); ... }
+
+    Ticks are compared with the ideal fixed-rate grid scheduled_k = start + k * period.
+    Per tick:
+      interval      wake-up to previous wake-up
+      wake latency  wake-up behind its grid slot
+      compute       wake-up to end of the body
+    A deadline miss is a tick ending more than `deadline` after its slot
+    (default one period: the next tick is already due). Wake-ups a whole
+    period late jump the grid forward and count the slots as skipped.
+
+    The last `history` ticks are kept in a ring on the loop thread; on a miss
+    it is copied out (newest last), so /debug/loops shows what led up to the
+    latest miss. Recording is a few clock reads and histogram updates on the
+    loop thread; readers (/metrics, /debug/loops) only load atomics, except
+    for the miss dump which is copied under a mutex.
+
+    Monitors register themselves in a process-wide list for the exporters.
+*/
+
+class LoopMonitor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config {
+        double period_s = 0.01;
+        double deadline_s = 0.0;       // 0: one period
+        size_t history = 64;           // ticks kept for the miss dump (0: no dump)
+    };
+
+    // One tick as seen on the grid (ns, relative to the tick's slot)
+    struct TickRecord {
+        uint64_t seq = 0;
+        int64_t wake_latency_ns = 0;
+        uint64_t interval_ns = 0;
+        uint64_t compute_ns = 0;
+        bool missed = false;
+    };
+
+    struct Stats {
+        uint64_t ticks = 0;
+        uint64_t misses = 0;
+        uint64_t skipped = 0;          // grid slots without a tick
+        uint64_t max_interval_ns = 0, max_wake_latency_ns = 0, max_compute_ns = 0;
+    };
+
+    LoopMonitor(std::string name, const Config &cfg)
+        : name_(std::move(name)), cfg_(cfg),
+          period_ns_((uint64_t)(std::max(cfg.period_s, 1e-6) * 1e9)),
+          deadline_ns_(cfg.deadline_s > 0.0 ? (uint64_t)(cfg.deadline_s * 1e9) : period_ns_),
+          ring_(cfg.history)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        registry().push_back(this);
+    }
+
+    ~LoopMonitor()
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        auto &r = registry();
+        r.erase(std::remove(r.begin(), r.end(), this), r.end());
+    }
+
+    LoopMonitor(const LoopMonitor &) = delete;
+    LoopMonitor &operator=(const LoopMonitor &) = delete;
+
+    // RAII bracket of one loop iteration (loop thread only)
+    class Tick {
+    public:
+        explicit Tick(LoopMonitor &m) : m_(m), wake_(nowNs()) {}
+        ~Tick() { m_.record(wake_, nowNs()); }
+        Tick(const Tick &) = delete;
+        Tick &operator=(const Tick &) = delete;
+
+    private:
+        LoopMonitor &m_;
+        uint64_t wake_;
+    };
+
+    const std::string &name() const { return name_; }
+    const Config &config() const { return cfg_; }
+    uint64_t periodNs() const { return period_ns_; }
+    uint64_t deadlineNs() const { return deadline_ns_; }
+
+    const metrics::Histogram &intervals() const { return interval_; }
+    const metrics::Histogram &wakeLatencies() const { return wake_latency_; }
+    const metrics::Histogram &computeTimes() const { return compute_; }
+
+    Stats stats() const
+    {
+        Stats s;
+        s.ticks = ticks_.load(std::memory_order_relaxed);
+        s.misses = misses_.load(std::memory_order_relaxed);
+        s.skipped = skipped_.load(std::memory_order_relaxed);
+        s.max_interval_ns = max_interval_.load(std::memory_order_relaxed);
+        s.max_wake_latency_ns = max_wake_latency_.load(std::memory_order_relaxed);
+        s.max_compute_ns = max_compute_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    // Ticks up to and including the latest deadline miss, oldest first (empty: none yet)
+    std::vector<TickRecord> lastMissDump() const
+    {
+        std::lock_guard<std::mutex> lock(dump_mutex_);
+        return dump_;
+    }
+
+    // Every live monitor (the exporters iterate over a copy)
+    static std::vector<LoopMonitor *> all()
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        return registry();
+    }
+
+    static uint64_t nowNs()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch())
+            .count();
+    }
+
+private:
+    void record(uint64_t wake, uint64_t end)
+    {
+        TickRecord r;
+        r.seq = seq_++;
+        if (r.seq == 0) {
+            slot_ = wake;                 // the first tick defines the grid
+        } else {
+            r.interval_ns = wake - last_wake_;
+            slot_ += period_ns_;
+            if (wake >= slot_ + period_ns_) {
+                const uint64_t behind = (wake - slot_) / period_ns_;
+                skipped_.fetch_add(behind, std::memory_order_relaxed);
+                slot_ += behind * period_ns_;
+            }
+            interval_.record(r.interval_ns);
+            storeMax(max_interval_, r.interval_ns);
+        }
+        last_wake_ = wake;
+        r.wake_latency_ns = (int64_t)(wake - slot_);   // early wake-ups: negative, counted as 0
+        r.compute_ns = end - wake;
+        r.missed = end > slot_ + deadline_ns_;
+
+        const uint64_t latency = r.wake_latency_ns > 0 ? (uint64_t)r.wake_latency_ns : 0;
+        wake_latency_.record(latency);
+        compute_.record(r.compute_ns);
+        storeMax(max_wake_latency_, latency);
+        storeMax(max_compute_, r.compute_ns);
+        ticks_.fetch_add(1, std::memory_order_relaxed);
+
+        if (!ring_.empty()) ring_[r.seq % ring_.size()] = r;
+        if (!r.missed) return;
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        if (ring_.empty()) return;
+
+        std::vector<TickRecord> dump;
+        const uint64_t n = std::min<uint64_t>(seq_, ring_.size());
+        dump.reserve(n);
+        for (uint64_t i = seq_ - n; i < seq_; ++i) dump.push_back(ring_[i % ring_.size()]);
+        std::lock_guard<std::mutex> lock(dump_mutex_);
+        dump_.swap(dump);
+    }
+
+    static void storeMax(std::atomic<uint64_t> &m, uint64_t v)
+    {
+        if (v > m.load(std::memory_order_relaxed)) m.store(v, std::memory_order_relaxed);   // single writer
+    }
+
+    static std::vector<LoopMonitor *> &registry()
+    {
+        static std::vector<LoopMonitor *> r;
+        return r;
+    }
+    static std::mutex &registryMutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+
+    std::string name_;
+    Config cfg_;
+    uint64_t period_ns_;
+    uint64_t deadline_ns_;
+
+    // Loop thread only
+    uint64_t seq_ = 0;
+    uint64_t slot_ = 0;
+    uint64_t last_wake_ = 0;
+    std::vector<TickRecord> ring_;
+
+    metrics::Histogram interval_, wake_latency_, compute_;   // ns
+    std::atomic<uint64_t> ticks_{0}, misses_{0}, skipped_{0};
+    std::atomic<uint64_t> max_interval_{0}, max_wake_latency_{0}, max_compute_{0};
+
+    mutable std::mutex dump_mutex_;
+    std::vector<TickRecord> dump_;
+};
+
+// Upper bound (in recorded units) below which a fraction q of a histogram's values lie
+inline double histogramQuantile(const metrics::Histogram &h, double q)
+{
+    const auto s = h.snapshot();
+    if (!s.total) return 0.0;
+    const double target = q * (double)s.total;
+    uint64_t cum = 0;
+    for (size_t k = 0; k < (size_t)metrics::Histogram::kBuckets; ++k) {
+        cum += s.count[k];
+        if ((double)cum >= target) return h.upperBound(k);
+    }
+    return h.upperBound(metrics::Histogram::kBuckets - 1) * 2.0;
+}
+
+// Prometheus families of every registered loop
+inline void writeLoopMetrics(std::string &out)
+{
+    const auto loops = LoopMonitor::all();
+    auto label = [](const LoopMonitor *m) { return "loop=\"" + m->name() + "\""; };
+
+    metrics::writeHeader(out, "robot_arm_loop_ticks_total", "counter", "Ticks of periodic loops");
+    for (const auto *m : loops) metrics::writeSample(out, "robot_arm_loop_ticks_total", label(m), (double)m->stats().ticks);
+    metrics::writeHeader(out, "robot_arm_loop_deadline_misses_total", "counter",
+                         "Ticks that ended after their deadline");
+    for (const auto *m : loops) {
+        metrics::writeSample(out, "robot_arm_loop_deadline_misses_total", label(m), (double)m->stats().misses);
+    }
+    metrics::writeHeader(out, "robot_arm_loop_skipped_total", "counter", "Grid slots without a tick");
+    for (const auto *m : loops) metrics::writeSample(out, "robot_arm_loop_skipped_total", label(m), (double)m->stats().skipped);
+    metrics::writeHeader(out, "robot_arm_loop_period_seconds", "gauge", "Configured loop period");
+    for (const auto *m : loops) {
+        metrics::writeSample(out, "robot_arm_loop_period_seconds", label(m), (double)m->periodNs() * 1e-9);
+    }
+
+    metrics::writeHeader(out, "robot_arm_loop_interval_seconds", "histogram", "Time between consecutive ticks");
+    for (const auto *m : loops) metrics::writeHistogram(out, "robot_arm_loop_interval_seconds", label(m), m->intervals(), 1e-9);
+    metrics::writeHeader(out, "robot_arm_loop_wake_latency_seconds", "histogram",
+                         "Tick wake-up behind its fixed-rate slot");
+    for (const auto *m : loops) {
+        metrics::writeHistogram(out, "robot_arm_loop_wake_latency_seconds", label(m), m->wakeLatencies(), 1e-9);
+    }
+    metrics::writeHeader(out, "robot_arm_loop_compute_seconds", "histogram", "Work done per tick");
+    for (const auto *m : loops) metrics::writeHistogram(out, "robot_arm_loop_compute_seconds", label(m), m->computeTimes(), 1e-9);
+}
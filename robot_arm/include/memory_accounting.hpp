@@ -0,0 +1,256 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "metrics.hpp"   // exposition helpers
+
+/*
+    Memory footprint accounting per subsystem.
+
+    Each component that holds memory proportional to its load (plan cache,
+    trajectory store, execution state, worker queue, batch jobs, jog sessions,
+    request log queue, trace rings) owns an Account and moves its byte count
+    as it grows and shrinks:
+
+        memacct::Account mem_{"plan_cache"};
+        mem_.add(charge);  ...  mem_.sub(charge);
+
+    Counts are the component's own estimate (payload plus container overhead),
+    not allocator truth; the allocator and the kernel view (mallinfo2, RSS)
+    are reported next to them by /debug/memory so the untracked remainder is
+    visible. Updates are relaxed atomics; the high-water mark is a relaxed
+    CAS max.
+
+    A limit can be set per account name (setLimit, custom_config.memory).
+    Crossing it upwards counts an alert; the controller logs new alerts and
+    /metrics exports them. Limits apply per instance: the server has one
+    instance per name.
+
+    Accounts register themselves in a process-wide list for the exporters.
+*/
+
+namespace memacct {
+
+class Account {
+public:
+    explicit Account(std::string name) : name_(std::move(name))
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        auto it = limits().find(name_);
+        if (it != limits().end()) limit_.store(it->second, std::memory_order_relaxed);
+        registry().push_back(this);
+    }
+
+    ~Account()
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        auto &r = registry();
+        r.erase(std::remove(r.begin(), r.end(), this), r.end());
+    }
+
+    Account(const Account &) = delete;
+    Account &operator=(const Account &) = delete;
+
+    void add(int64_t n)
+    {
+        const int64_t now = bytes_.fetch_add(n, std::memory_order_relaxed) + n;
+        if (n > 0) raised(now - n, now);
+    }
+    void sub(int64_t n) { add(-n); }
+
+    // Components that recompute their footprint (arena capacities) instead of tracking deltas
+    void set(int64_t v)
+    {
+        const int64_t before = bytes_.exchange(v, std::memory_order_relaxed);
+        if (v > before) raised(before, v);
+    }
+
+    const std::string &name() const { return name_; }
+    int64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+    int64_t highWater() const { return high_water_.load(std::memory_order_relaxed); }
+    int64_t limit() const { return limit_.load(std::memory_order_relaxed); }
+    uint64_t alerts() const { return alerts_.load(std::memory_order_relaxed); }
+
+    // Every live account (the exporters iterate over a copy)
+    static std::vector<Account *> all()
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        return registry();
+    }
+
+    // Limit (bytes, 0 = none) for live and future accounts of this name
+    static void setLimit(const std::string &name, int64_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        limits()[name] = bytes;
+        for (Account *a : registry()) {
+            if (a->name_ == name) a->limit_.store(bytes, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    void raised(int64_t before, int64_t now)
+    {
+        int64_t hw = high_water_.load(std::memory_order_relaxed);
+        while (now > hw && !high_water_.compare_exchange_weak(hw, now, std::memory_order_relaxed)) {
+        }
+        const int64_t lim = limit_.load(std::memory_order_relaxed);
+        if (lim > 0 && now > lim && before <= lim) alerts_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static std::vector<Account *> &registry()
+    {
+        static std::vector<Account *> r;
+        return r;
+    }
+    static std::map<std::string, int64_t> &limits()
+    {
+        static std::map<std::string, int64_t> l;
+        return l;
+    }
+    static std::mutex &registryMutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+
+    std::string name_;
+    std::atomic<int64_t> bytes_{0};
+    std::atomic<int64_t> high_water_{0};
+    std::atomic<int64_t> limit_{0};
+    std::atomic<uint64_t> alerts_{0};    // upward crossings of the limit
+};
+
+// Accounts summed per name, sorted by name
+struct Usage {
+    std::string name;
+    int64_t bytes = 0;
+    int64_t high_water = 0;            // sum of the instances' marks (upper bound)
+    int64_t limit = 0;
+    uint64_t alerts = 0;
+};
+
+inline std::vector<Usage> usage()
+{
+    std::map<std::string, Usage> by_name;
+    for (const Account *a : Account::all()) {
+        Usage &u = by_name[a->name()];
+        u.name = a->name();
+        u.bytes += a->bytes();
+        u.high_water += a->highWater();
+        u.limit = a->limit();
+        u.alerts += a->alerts();
+    }
+    std::vector<Usage> out;
+    out.reserve(by_name.size());
+    for (auto &kv : by_name) out.push_back(std::move(kv.second));
+    return out;
+}
+
+// ------------------------------------------------------------
+// Process and allocator view
+// ------------------------------------------------------------
+struct ProcessMemory {
+    bool available = false;            // /proc/self/status readable
+    uint64_t rss = 0;                  // VmRSS
+    uint64_t rss_peak = 0;             // VmHWM
+    uint64_t virt = 0;                 // VmSize
+    uint64_t rss_anon = 0;             // RssAnon
+    uint64_t rss_file = 0;             // RssFile
+};
+
+// Linux only (available = false elsewhere); values in bytes
+inline ProcessMemory processMemory()
+{
+    ProcessMemory m;
+    std::ifstream in("/proc/self/status");
+    std::string line;
+    while (std::getline(in, line)) {
+        auto field = [&line](const char *key, uint64_t &out) {
+            const size_t n = std::char_traits<char>::length(key);
+            if (line.compare(0, n, key) != 0) return false;
+            out = std::strtoull(line.c_str() + n, nullptr, 10) * 1024;   // "kB"
+            return true;
+        };
+        if (field("VmRSS:", m.rss) || field("VmHWM:", m.rss_peak) || field("VmSize:", m.virt) ||
+            field("RssAnon:", m.rss_anon) || field("RssFile:", m.rss_file)) {
+            m.available = true;
+        }
+    }
+    return m;
+}
+
+struct AllocatorStats {
+    bool available = false;            // glibc malloc only
+    uint64_t heap = 0;                 // arena: obtained from the kernel via brk / arenas
+    uint64_t mmapped = 0;              // large blocks mapped individually
+    uint64_t in_use = 0;               // allocated (heap + mmapped)
+    uint64_t free = 0;                 // free in the arenas, kept by malloc
+    uint64_t releasable = 0;           // free at the top of the main heap (malloc_trim)
+};
+
+inline AllocatorStats allocatorStats()
+{
+    AllocatorStats s;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    const struct mallinfo2 mi = ::mallinfo2();
+    s.available = true;
+    s.heap = mi.arena;
+    s.mmapped = mi.hblkhd;
+    s.in_use = mi.uordblks + mi.hblkhd;
+    s.free = mi.fordblks;
+    s.releasable = mi.keepcost;
+#endif
+    return s;
+}
+
+// Prometheus families of the accounts, the allocator and the process
+inline void writeMemoryMetrics(std::string &out)
+{
+    const auto accounts = usage();
+    auto label = [](const Usage &u) { return "account=\"" + u.name + "\""; };
+
+    metrics::writeHeader(out, "robot_arm_memory_bytes", "gauge", "Bytes held per subsystem (own estimate)");
+    for (const auto &u : accounts) metrics::writeSample(out, "robot_arm_memory_bytes", label(u), (double)u.bytes);
+    metrics::writeHeader(out, "robot_arm_memory_high_water_bytes", "gauge", "Peak bytes held per subsystem");
+    for (const auto &u : accounts) {
+        metrics::writeSample(out, "robot_arm_memory_high_water_bytes", label(u), (double)u.high_water);
+    }
+    metrics::writeHeader(out, "robot_arm_memory_limit_bytes", "gauge", "Configured alert limit per subsystem");
+    for (const auto &u : accounts) {
+        if (u.limit > 0) metrics::writeSample(out, "robot_arm_memory_limit_bytes", label(u), (double)u.limit);
+    }
+    metrics::writeHeader(out, "robot_arm_memory_limit_exceeded_total", "counter",
+                         "Times a subsystem grew past its limit");
+    for (const auto &u : accounts) {
+        metrics::writeSample(out, "robot_arm_memory_limit_exceeded_total", label(u), (double)u.alerts);
+    }
+
+    const AllocatorStats a = allocatorStats();
+    if (a.available) {
+        metrics::writeHeader(out, "robot_arm_malloc_bytes", "gauge", "glibc malloc state (mallinfo2)");
+        metrics::writeSample(out, "robot_arm_malloc_bytes", "kind=\"heap\"", (double)a.heap);
+        metrics::writeSample(out, "robot_arm_malloc_bytes", "kind=\"mmapped\"", (double)a.mmapped);
+        metrics::writeSample(out, "robot_arm_malloc_bytes", "kind=\"in_use\"", (double)a.in_use);
+        metrics::writeSample(out, "robot_arm_malloc_bytes", "kind=\"free\"", (double)a.free);
+    }
+    const ProcessMemory p = processMemory();
+    if (p.available) {
+        metrics::writeHeader(out, "robot_arm_process_resident_bytes", "gauge", "Resident set size (VmRSS)");
+        metrics::writeSample(out, "robot_arm_process_resident_bytes", "", (double)p.rss);
+        metrics::writeHeader(out, "robot_arm_process_resident_peak_bytes", "gauge", "Peak resident set size (VmHWM)");
+        metrics::writeSample(out, "robot_arm_process_resident_peak_bytes", "", (double)p.rss_peak);
+    }
+}
+
+} // namespace memacct
@@ -0,0 +1,340 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "tsc_clock.hpp"
+
+/*
+    Always-on request metrics in Prometheus text format (GET /metrics).
+
+    Counters and histograms are sharded per thread: each thread gets one of
+    kShards cache-line aligned slots and updates it with relaxed atomics, so
+    recording never takes a lock and threads do not bounce each other's
+    lines (two threads share a slot only beyond kShards threads; the atomics
+    keep that correct). A scrape sums the shards.
+
+    Histogram buckets are powers of two of the recorded integer (ns for
+    latencies, samples for plan sizes): the bucket of a value is one
+    count-leading-zeros, and recording is two fetch_adds on the thread's
+    slot (bench case metrics/histogram_record).
+
+    Request metrics (g_requests):
+      robot_arm_request_duration_seconds{route}   handler entry to response handed to the connection
+      robot_arm_stage_duration_seconds{stage}     decode, plan, serialize, send
+      robot_arm_plan_samples                      samples per computed plan
+      robot_arm_response_bytes_total              plan response bodies
+      robot_arm_requests_in_flight{route}         gauge
+    Gauges of other components (queue depths, cache size) are written by the
+    /metrics handler with writeGauge().
+
+    Timers read tsc::now() (one rdtsc where the TSC is invariant).
+*/
+
+namespace metrics {
+
+constexpr size_t kShards = 32;
+
+namespace detail {
+
+inline std::atomic<uint32_t> g_next_shard{0};
+
+inline size_t shard()
+{
+    static thread_local const size_t idx = g_next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return idx;
+}
+
+} // namespace detail
+
+// ------------------------------------------------------------
+// Counter
+// ------------------------------------------------------------
+class Counter {
+public:
+    void add(uint64_t n = 1) { slots_[detail::shard()].v.fetch_add(n, std::memory_order_relaxed); }
+
+    uint64_t value() const
+    {
+        uint64_t n = 0;
+        for (const auto &s : slots_) n += s.v.load(std::memory_order_relaxed);
+        return n;
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> v{0};
+    };
+    Slot slots_[kShards];
+};
+
+// ------------------------------------------------------------
+// Histogram: bucket k counts values <= 2^(min_log2 + k) (and above the previous
+// bound); the last one is +Inf
+// ------------------------------------------------------------
+class Histogram {
+public:
+    static constexpr int kBuckets = 28;
+
+    // Values up to 2^min_log2 share the first bucket
+    explicit Histogram(int min_log2 = 10) : min_log2_(min_log2) {}
+
+    void record(uint64_t v)
+    {
+        Slot &s = slots_[detail::shard()];
+        s.count[bucket(v)].fetch_add(1, std::memory_order_relaxed);
+        s.sum.fetch_add(v, std::memory_order_relaxed);
+    }
+
+    size_t bucket(uint64_t v) const
+    {
+        const uint64_t x = v ? v - 1 : 0;
+        const int bits = x ? 64 - __builtin_clzll(x) : 0;   // v <= 2^bits
+        const int k = bits - min_log2_;
+        return k <= 0 ? 0 : (k >= kBuckets ? kBuckets : (size_t)k);
+    }
+
+    // Upper bound (inclusive, Prometheus "le") of bucket k < kBuckets
+    double upperBound(size_t k) const { return (double)(1ull << (min_log2_ + (int)k)); }
+
+    struct Snapshot {
+        uint64_t count[kBuckets + 1] = {};
+        uint64_t sum = 0;
+        uint64_t total = 0;
+    };
+
+    Snapshot snapshot() const
+    {
+        Snapshot out;
+        for (const auto &s : slots_) {
+            for (size_t k = 0; k <= kBuckets; ++k) out.count[k] += s.count[k].load(std::memory_order_relaxed);
+            out.sum += s.sum.load(std::memory_order_relaxed);
+        }
+        for (size_t k = 0; k <= kBuckets; ++k) out.total += out.count[k];
+        return out;
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> count[kBuckets + 1] = {};
+        std::atomic<uint64_t> sum{0};
+    };
+    int min_log2_;
+    Slot slots_[kShards];
+};
+
+// ------------------------------------------------------------
+// Exposition
+// ------------------------------------------------------------
+inline void writeHeader(std::string &out, const char *name, const char *type, const char *help)
+{
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+inline void writeNumber(std::string &out, double v)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", v);
+    out += buf;
+}
+
+// One sample line: name{labels} value (labels: `route="x"` or empty)
+inline void writeSample(std::string &out, const char *name, const std::string &labels, double v)
+{
+    out += name;
+    if (!labels.empty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    writeNumber(out, v);
+    out += '\n';
+}
+
+inline void writeGauge(std::string &out, const char *name, const char *help, double v)
+{
+    writeHeader(out, name, "gauge", help);
+    writeSample(out, name, "", v);
+}
+
+// _bucket (cumulative, le in exported units), _sum and _count; scale converts the
+// recorded integers (1e-9: ns to seconds). The header is written once per family.
+inline void writeHistogram(std::string &out, const char *name, const std::string &labels,
+                           const Histogram &h, double scale)
+{
+    const auto s = h.snapshot();
+    const std::string bucket = std::string(name) + "_bucket";
+    const std::string sep = labels.empty() ? "" : labels + ",";
+    uint64_t cum = 0;
+    char le[48];
+    for (size_t k = 0; k < (size_t)Histogram::kBuckets; ++k) {
+        cum += s.count[k];
+        std::snprintf(le, sizeof(le), "le=\"%.9g\"", h.upperBound(k) * scale);
+        writeSample(out, bucket.c_str(), sep + le, (double)cum);
+    }
+    writeSample(out, bucket.c_str(), sep + "le=\"+Inf\"", (double)s.total);
+    writeSample(out, (std::string(name) + "_sum").c_str(), labels, (double)s.sum * scale);
+    writeSample(out, (std::string(name) + "_count").c_str(), labels, (double)s.total);
+}
+
+// ------------------------------------------------------------
+// Request metrics
+// ------------------------------------------------------------
+enum class Route : uint8_t { PlanPmpQ = 0, PlanBatch };
+constexpr size_t kRoutes = 2;
+inline const char *routeName(Route r)
+{
+    static const char *names[kRoutes] = {"/arm/plan_pmp_q", "/arm/plan_batch"};
+    return names[(size_t)r];
+}
+
+enum class Stage : uint8_t { Decode = 0, Plan, Serialize, Send };
+constexpr size_t kStages = 4;
+inline const char *stageName(Stage s)
+{
+    static const char *names[kStages] = {"decode", "plan", "serialize", "send"};
+    return names[(size_t)s];
+}
+
+struct RequestMetrics {
+    Histogram duration[kRoutes];                     // ns
+    Histogram stage[kStages];                        // ns
+    Histogram plan_samples{0};                       // samples per plan
+    Counter requests[kRoutes];
+    Counter plan_samples_total;
+    Counter response_bytes;
+    std::atomic<int64_t> in_flight[kRoutes] = {};
+};
+inline RequestMetrics g_requests;
+
+inline uint64_t elapsedNs(uint64_t since_ticks) { return tsc::toNs(tsc::now() - since_ticks); }
+
+// Times one stage on the current thread: recorded by stop() or at scope exit.
+// A caller already holding a tsc::now() reading (the request start, the end()
+// of the previous stage) passes it in, so back-to-back stages cost one TSC read
+// per boundary plus the histogram record (bench case metrics/stage_timer).
+class StageTimer {
+public:
+    explicit StageTimer(Stage s) : StageTimer(s, tsc::now()) {}
+    StageTimer(Stage s, uint64_t start_ticks) : stage_(s), t0_(start_ticks) {}
+    ~StageTimer() { stop(); }
+
+    // Records the stage once; returns its duration in ns (also on later calls)
+    uint64_t stop() { return done_ ? ns_ : stop(tsc::now()); }
+
+    // Same, ending the stage at a reading the caller already took
+    uint64_t stop(uint64_t now_ticks)
+    {
+        if (!done_) {
+            t1_ = now_ticks;
+            ns_ = tsc::toNs(t1_ - t0_);
+            g_requests.stage[(size_t)stage_].record(ns_);
+            done_ = true;
+        }
+        return ns_;
+    }
+
+    // Reading at which stop() ended the stage: the start of the next one
+    uint64_t end() const { return t1_; }
+
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+
+private:
+    Stage stage_;
+    uint64_t t0_;
+    uint64_t t1_ = 0;
+    uint64_t ns_ = 0;
+    bool done_ = false;
+};
+
+// Lives in a request object: in flight from construction, counted and timed by
+// finish() (or by the destructor on early error paths)
+class RequestTimer {
+public:
+    explicit RequestTimer(Route r) : route_(r), t0_(tsc::now())
+    {
+        g_requests.in_flight[(size_t)r].fetch_add(1, std::memory_order_relaxed);
+    }
+    ~RequestTimer() { finish(); }
+
+    // Reading taken at handler entry: the start of the decode stage
+    uint64_t start() const { return t0_; }
+
+    void finish() { finish(tsc::now()); }
+
+    // Ends the request at a reading the caller already took (the end of the send stage)
+    void finish(uint64_t now_ticks)
+    {
+        if (done_) return;
+        done_ = true;
+        const size_t r = (size_t)route_;
+        g_requests.duration[r].record(tsc::toNs(now_ticks - t0_));
+        g_requests.requests[r].add();
+        g_requests.in_flight[r].fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    RequestTimer(const RequestTimer &) = delete;
+    RequestTimer &operator=(const RequestTimer &) = delete;
+
+private:
+    Route route_;
+    uint64_t t0_;
+    bool done_ = false;
+};
+
+inline void recordPlan(size_t samples)
+{
+    g_requests.plan_samples.record(samples);
+    g_requests.plan_samples_total.add(samples);
+}
+
+inline void recordResponseBytes(size_t n) { g_requests.response_bytes.add(n); }
+
+// Request families of g_requests (the handler appends its gauges)
+inline void writeRequestMetrics(std::string &out)
+{
+    const RequestMetrics &m = g_requests;
+
+    writeHeader(out, "robot_arm_requests_total", "counter", "Completed planning requests");
+    for (size_t r = 0; r < kRoutes; ++r) {
+        writeSample(out, "robot_arm_requests_total", std::string("route=\"") + routeName((Route)r) + "\"",
+                    (double)m.requests[r].value());
+    }
+    writeHeader(out, "robot_arm_requests_in_flight", "gauge", "Planning requests being handled");
+    for (size_t r = 0; r < kRoutes; ++r) {
+        writeSample(out, "robot_arm_requests_in_flight", std::string("route=\"") + routeName((Route)r) + "\"",
+                    (double)m.in_flight[r].load(std::memory_order_relaxed));
+    }
+
+    writeHeader(out, "robot_arm_request_duration_seconds", "histogram",
+                "Planning request latency from handler entry to response send");
+    for (size_t r = 0; r < kRoutes; ++r) {
+        writeHistogram(out, "robot_arm_request_duration_seconds",
+                       std::string("route=\"") + routeName((Route)r) + "\"", m.duration[r], 1e-9);
+    }
+    writeHeader(out, "robot_arm_stage_duration_seconds", "histogram", "Time spent per request stage");
+    for (size_t s = 0; s < kStages; ++s) {
+        writeHistogram(out, "robot_arm_stage_duration_seconds",
+                       std::string("stage=\"") + stageName((Stage)s) + "\"", m.stage[s], 1e-9);
+    }
+
+    writeHeader(out, "robot_arm_plan_samples", "histogram", "Trajectory samples per computed plan");
+    writeHistogram(out, "robot_arm_plan_samples", "", m.plan_samples, 1.0);
+    writeHeader(out, "robot_arm_plan_samples_total", "counter", "Trajectory samples computed");
+    writeSample(out, "robot_arm_plan_samples_total", "", (double)m.plan_samples_total.value());
+    writeHeader(out, "robot_arm_response_bytes_total", "counter", "Plan response body bytes");
+    writeSample(out, "robot_arm_response_bytes_total", "", (double)m.response_bytes.value());
+}
+
+} // namespace metrics
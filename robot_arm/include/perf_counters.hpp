@@ -0,0 +1,294 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+    Hardware performance counters (Linux perf_event_open) around the
+    request stages.
+
+    Each thread opens one counter group on first use: cycles (leader),
+    instructions, L1D read misses, LLC misses and branch misses, user
+    space only, so perf_event_paranoid <= 2 is enough. One read() of the
+    group per boundary; when the PMU multiplexes the group the deltas are
+    scaled by time_enabled / time_running.
+
+        perf::Counters &c = perf::Counters::thread();
+        perf::Reading a, b;
+        c.read(a); ...; c.read(b);        // b - a: events of the code between
+
+    Live requests are measured when sampled: a Sampled binder marks the
+    thread (like alloc_stats::Scope binds a request), and every Scope of a
+    stage on a marked thread adds its deltas to the process-wide StageTotals:
+
+        perf::Sampled bind(call->perf_sampled);
+        perf::Scope scope(perf::Stage::Plan);
+        ...; scope.setSamples(traj.size());
+
+    Unmarked threads do not touch the counters (one thread_local branch).
+
+    Fallback: without a PMU (VMs, containers), with perf_event_paranoid = 3
+    or on other systems available() is false, reason() says why, and reads
+    and scopes do nothing. Events the CPU lacks (LLC on some VMs) are
+    reported as missing while the others still count.
+*/
+
+namespace perf {
+
+enum Event : uint8_t { kCycles = 0, kInstructions, kL1dMisses, kLlcMisses, kBranchMisses, kEvents };
+
+inline const char *eventName(size_t e)
+{
+    static const char *names[kEvents] = {"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+    return names[e];
+}
+
+enum class Stage : uint8_t { Parse = 0, Plan, Serialize };
+constexpr size_t kStages = 3;
+
+inline const char *stageName(Stage s)
+{
+    static const char *names[kStages] = {"parse", "plan", "serialize"};
+    return names[(size_t)s];
+}
+
+// Counter values at one point (or a scaled difference of two readings)
+struct Reading {
+    uint64_t value[kEvents] = {};
+    uint64_t time_enabled = 0, time_running = 0;
+    uint32_t valid = 0;                // bit e = event e counted
+};
+
+// Events between a and b, extrapolated when the group was not always on the PMU
+inline Reading delta(const Reading &a, const Reading &b)
+{
+    Reading d;
+    d.valid = a.valid & b.valid;
+    d.time_enabled = b.time_enabled - a.time_enabled;
+    d.time_running = b.time_running - a.time_running;
+    const double scale = d.time_running && d.time_running < d.time_enabled
+                             ? (double)d.time_enabled / (double)d.time_running
+                             : 1.0;
+    for (size_t e = 0; e < kEvents; ++e) {
+        if (!(d.valid & (1u << e))) continue;
+        d.value[e] = (uint64_t)((double)(b.value[e] - a.value[e]) * scale);
+    }
+    return d;
+}
+
+// ------------------------------------------------------------
+// Per-thread counter group
+// ------------------------------------------------------------
+class Counters {
+public:
+    // The calling thread's group (opened on first call, closed at thread exit)
+    static Counters &thread()
+    {
+        static thread_local Counters c;
+        return c;
+    }
+
+    bool available() const { return leader_ >= 0; }
+    const std::string &reason() const { return reason_; }
+    uint32_t events() const { return valid_; }     // bit e = event e opened
+
+    // false (r untouched) when unavailable or the read failed
+    bool read(Reading &r) const
+    {
+#ifdef __linux__
+        if (leader_ < 0) return false;
+        // PERF_FORMAT_GROUP | TOTAL_TIME_ENABLED | TOTAL_TIME_RUNNING: nr, enabled, running, values[nr]
+        uint64_t buf[3 + kEvents];
+        const ssize_t n = ::read(leader_, buf, sizeof(buf));
+        if (n < (ssize_t)(3 * sizeof(uint64_t)) || buf[0] != (uint64_t)opened_) return false;
+        r.time_enabled = buf[1];
+        r.time_running = buf[2];
+        r.valid = valid_;
+        size_t k = 0;
+        for (size_t e = 0; e < kEvents; ++e) {
+            r.value[e] = (valid_ & (1u << e)) ? buf[3 + k++] : 0;
+        }
+        return true;
+#else
+        (void)r;
+        return false;
+#endif
+    }
+
+    ~Counters()
+    {
+#ifdef __linux__
+        for (int fd : fds_) {
+            if (fd >= 0) ::close(fd);
+        }
+#endif
+    }
+
+    Counters(const Counters &) = delete;
+    Counters &operator=(const Counters &) = delete;
+
+private:
+    Counters()
+    {
+        for (int &fd : fds_) fd = -1;
+#ifdef __linux__
+        static const uint32_t types[kEvents] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+                                                PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE};
+        static const uint64_t configs[kEvents] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (size_t e = 0; e < kEvents; ++e) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[e];
+            attr.config = configs[e];
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.disabled = (leader_ < 0) ? 1 : 0;   // the group starts when the leader is enabled
+            const int fd = (int)::syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0);
+            if (fd < 0) {
+                if (e == kCycles) {
+                    reason_ = std::string("perf_event_open: ") + std::strerror(errno);
+                    if (errno == ENOENT || errno == EOPNOTSUPP) reason_ += " (no hardware PMU)";
+                    else if (errno == EACCES || errno == EPERM) reason_ += " (see /proc/sys/kernel/perf_event_paranoid)";
+                    return;
+                }
+                continue;   // event missing on this CPU: the rest of the group still counts
+            }
+            fds_[e] = fd;
+            if (leader_ < 0) leader_ = fd;
+            valid_ |= 1u << e;
+            ++opened_;
+        }
+        ::ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+        reason_ = "hardware counters need Linux perf_event_open";
+#endif
+    }
+
+    int fds_[kEvents];
+    int leader_ = -1;
+    size_t opened_ = 0;
+    uint32_t valid_ = 0;
+    std::string reason_;
+};
+
+// ------------------------------------------------------------
+// Process-wide totals per stage (sampled requests)
+// ------------------------------------------------------------
+struct StageSnapshot {
+    uint64_t calls = 0;
+    uint64_t samples = 0;              // trajectory samples handled (Scope::setSamples)
+    uint64_t value[kEvents] = {};
+    uint64_t counted[kEvents] = {};    // calls in which event e was counted
+
+    double ipc() const
+    {
+        return value[kCycles] ? (double)value[kInstructions] / (double)value[kCycles] : 0.0;
+    }
+    // Mean events per trajectory sample (0 when the stage reported no samples)
+    double perSample(size_t e) const { return samples ? (double)value[e] / (double)samples : 0.0; }
+    double perCall(size_t e) const { return counted[e] ? (double)value[e] / (double)counted[e] : 0.0; }
+};
+
+namespace detail {
+
+struct StageTotals {
+    std::atomic<uint64_t> calls{0}, samples{0};
+    std::atomic<uint64_t> value[kEvents] = {};
+    std::atomic<uint64_t> counted[kEvents] = {};
+};
+inline StageTotals g_stage[kStages];
+inline thread_local bool t_sampled = false;
+
+} // namespace detail
+
+inline void record(Stage s, const Reading &d, uint64_t samples)
+{
+    auto &g = detail::g_stage[(size_t)s];
+    g.calls.fetch_add(1, std::memory_order_relaxed);
+    g.samples.fetch_add(samples, std::memory_order_relaxed);
+    for (size_t e = 0; e < kEvents; ++e) {
+        if (!(d.valid & (1u << e))) continue;
+        g.value[e].fetch_add(d.value[e], std::memory_order_relaxed);
+        g.counted[e].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+inline StageSnapshot stageTotals(Stage s)
+{
+    const auto &g = detail::g_stage[(size_t)s];
+    StageSnapshot out;
+    out.calls = g.calls.load(std::memory_order_relaxed);
+    out.samples = g.samples.load(std::memory_order_relaxed);
+    for (size_t e = 0; e < kEvents; ++e) {
+        out.value[e] = g.value[e].load(std::memory_order_relaxed);
+        out.counted[e] = g.counted[e].load(std::memory_order_relaxed);
+    }
+    return out;
+}
+
+// Every n-th call returns true (n = 0: never); decides which requests are measured
+class Sampler {
+public:
+    explicit Sampler(uint64_t every_n = 0) : every_(every_n) {}
+    bool next() { return every_ && counter_.fetch_add(1, std::memory_order_relaxed) % every_ == 0; }
+    uint64_t every() const { return every_; }
+
+private:
+    uint64_t every_;
+    std::atomic<uint64_t> counter_{0};
+};
+
+// Marks the thread as running a sampled request for its lifetime (restores on exit)
+class Sampled {
+public:
+    explicit Sampled(bool on) : prev_(detail::t_sampled) { detail::t_sampled = on; }
+    ~Sampled() { detail::t_sampled = prev_; }
+    Sampled(const Sampled &) = delete;
+    Sampled &operator=(const Sampled &) = delete;
+
+private:
+    bool prev_;
+};
+
+// Counts one stage on a sampled thread; nothing otherwise
+class Scope {
+public:
+    explicit Scope(Stage s) : stage_(s)
+    {
+        if (!detail::t_sampled) return;
+        active_ = Counters::thread().read(start_);
+    }
+
+    ~Scope()
+    {
+        if (!active_) return;
+        Reading end;
+        if (Counters::thread().read(end)) record(stage_, delta(start_, end), samples_);
+    }
+
+    void setSamples(uint64_t n) { samples_ = n; }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    Stage stage_;
+    Reading start_;
+    uint64_t samples_ = 0;
+    bool active_ = false;
+};
+
+} // namespace perf
@@ -0,0 +1,308 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <string>
+#include <list>
+#include <stdexcept>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "plan_codec.hpp"   // PlanOptions
+#include "memory_accounting.hpp" // memacct::Account
+
+/*
+    Bounded, sharded, concurrent LRU cache of serialized plan responses.
+
+    Key   : quantized (q0, q_target, T, dt, format, channels).
+            Requests that differ by less than the quantum share an entry.
+    Value : ready-to-send response body (shared, immutable).
+
+    Each shard has its own mutex, LRU list and byte budget
+    (capacity_bytes / shards). Counters are relaxed atomics; the charged
+    bytes are the "plan_cache" memory account.
+*/
+
+// Inline storage for up to 6-DOF moves: building a key never allocates
+struct PlanKey {
+    static constexpr size_t kMaxDof = 6;
+    static constexpr size_t kMaxWords = 3 + 2 * kMaxDof;   // head, q0, q1, T, dt
+
+    std::array<int64_t, kMaxWords> words{}; // quantized request fields, first size() used
+    uint8_t count = 0;
+    uint64_t hash = 0;
+
+    size_t size() const { return count; }
+    const int64_t *data() const { return words.data(); }
+    void push(int64_t w) { words[count++] = w; }
+
+    bool operator==(const PlanKey &o) const
+    {
+        return hash == o.hash && count == o.count && std::equal(data(), data() + count, o.data());
+    }
+};
+
+struct PlanKeyHash {
+    size_t operator()(const PlanKey &k) const { return (size_t)k.hash; }
+};
+
+// splitmix64 finalizer, used to mix quantized words into the key hash
+inline uint64_t plan_mix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Saturates at +-2^62 quanta (llround is undefined outside the int64 range); NaN maps to
+// INT64_MIN, callers reject non-finite input before keying (make_plan_key throws)
+inline int64_t plan_quantize(double v, double quantum)
+{
+    constexpr double kLimit = 4611686018427387904.0; // 2^62
+    const double x = v / quantum;
+    if (std::isnan(x)) return INT64_MIN;
+    if (x >= kLimit) return (int64_t)kLimit;
+    if (x <= -kLimit) return -(int64_t)kLimit;
+    return (int64_t)std::llround(x);
+}
+
+// Version of the key words and hash below; bump it with any change to either (persisted
+// keys, e.g. the trajectory library index, are rejected when it differs)
+constexpr uint16_t kPlanKeySchema = 1;
+
+// q_quantum: rad, t_quantum: s (both > 0, validated where they are configured).
+// Throws std::invalid_argument for more than PlanKey::kMaxDof joints or non-finite values.
+inline PlanKey make_plan_key(const std::vector<double> &q0,
+                             const std::vector<double> &q1,
+                             double T, double dt,
+                             const PlanOptions &opt,
+                             double q_quantum = 1e-6,
+                             double t_quantum = 1e-6)
+{
+    if (q0.size() > PlanKey::kMaxDof || q1.size() > PlanKey::kMaxDof) {
+        throw std::invalid_argument("plan key: more than 6 joints");
+    }
+    auto finite = [](double v) { return std::isfinite(v); };
+    if (!std::all_of(q0.begin(), q0.end(), finite) || !std::all_of(q1.begin(), q1.end(), finite) ||
+        !std::isfinite(T) || !std::isfinite(dt)) {
+        throw std::invalid_argument("plan key: non-finite value");
+    }
+
+    PlanKey k;
+    k.push(((int64_t)q0.size() << 40) | ((int64_t)opt.format << 32) | opt.channels);
+    for (double v : q0) k.push(plan_quantize(v, q_quantum));
+    for (double v : q1) k.push(plan_quantize(v, q_quantum));
+    k.push(plan_quantize(T, t_quantum));
+    k.push(plan_quantize(dt, t_quantum));
+
+    uint64_t h = 0x243f6a8885a308d3ULL;
+    for (size_t i = 0; i < k.size(); ++i) h = plan_mix64(h ^ (uint64_t)k.words[i]);
+    k.hash = h;
+    return k;
+}
+
+// A request that maps to a key (dequantized: any request with this key has the same body)
+struct PlanMove {
+    std::vector<double> q0, q1;
+    double T = 0.0;
+    double dt = 0.0;
+    PlanOptions opt;
+};
+
+// Inverse of make_plan_key with the same quanta; false for a malformed key
+inline bool plan_key_move(const PlanKey &k, PlanMove &out,
+                          double q_quantum = 1e-6,
+                          double t_quantum = 1e-6)
+{
+    if (k.size() < 3) return false;
+    const uint64_t head = (uint64_t)k.words[0];
+    const size_t n0 = (size_t)(head >> 40);
+    if (k.size() < n0 + 3) return false;
+    const size_t n1 = k.size() - 3 - n0;
+    out.opt.format = (PlanFormat)((head >> 32) & 0xff);
+    out.opt.channels = (uint32_t)head;
+    out.q0.resize(n0);
+    out.q1.resize(n1);
+    for (size_t i = 0; i < n0; ++i) out.q0[i] = (double)k.words[1 + i] * q_quantum;
+    for (size_t i = 0; i < n1; ++i) out.q1[i] = (double)k.words[1 + n0 + i] * q_quantum;
+    out.T = (double)k.words[1 + n0 + n1] * t_quantum;
+    out.dt = (double)k.words[2 + n0 + n1] * t_quantum;
+    return true;
+}
+
+class PlanCache {
+public:
+    using Body = std::shared_ptr<const std::string>;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t insertions = 0;
+        uint64_t evictions = 0;
+        uint64_t entries = 0;
+        uint64_t bytes = 0;
+        uint64_t capacity_bytes = 0;
+    };
+
+    // Approximate per-entry bookkeeping cost (list node, map node, shared_ptr control block)
+    static constexpr size_t kEntryOverhead = 160;
+
+    explicit PlanCache(size_t capacity_bytes, size_t shards = 16)
+        : capacity_bytes_(capacity_bytes),
+          shards_(std::max<size_t>(1, shards))
+    {
+        shard_capacity_ = capacity_bytes_ / shards_.size();
+    }
+
+    // Returns the cached body or nullptr
+    Body get(const PlanKey &key)
+    {
+        Shard &s = shardFor(key);
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            auto it = s.index.find(key);
+            if (it != s.index.end()) {
+                s.lru.splice(s.lru.begin(), s.lru, it->second); // mark most recently used
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return it->second->body;
+            }
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    // Presence check without touching LRU order or hit/miss counters
+    bool contains(const PlanKey &key)
+    {
+        Shard &s = shardFor(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.index.find(key) != s.index.end();
+    }
+
+    // Inserts or replaces; evicts least recently used entries to stay under the shard budget
+    void put(const PlanKey &key, Body body)
+    {
+        if (!body) return;
+        const size_t charge = chargeOf(*body);
+        if (charge > shard_capacity_) return; // never cache entries larger than a shard
+
+        Shard &s = shardFor(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+
+        auto it = s.index.find(key);
+        if (it != s.index.end()) {
+            s.bytes -= it->second->charge;
+            mem_.sub((int64_t)it->second->charge);
+            s.lru.erase(it->second);
+            s.index.erase(it);
+            entries_.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        while (!s.lru.empty() && s.bytes + charge > shard_capacity_) {
+            auto &victim = s.lru.back();
+            s.bytes -= victim.charge;
+            mem_.sub((int64_t)victim.charge);
+            s.index.erase(victim.key);
+            s.lru.pop_back();
+            entries_.fetch_sub(1, std::memory_order_relaxed);
+            evictions_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        s.lru.push_front(Entry{key, std::move(body), charge});
+        s.index.emplace(key, s.lru.begin());
+        s.bytes += charge;
+        mem_.add((int64_t)charge);
+        entries_.fetch_add(1, std::memory_order_relaxed);
+        insertions_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+        for (auto &s : shards_) {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            mem_.sub((int64_t)s.bytes);
+            entries_.fetch_sub(s.lru.size(), std::memory_order_relaxed);
+            s.index.clear();
+            s.lru.clear();
+            s.bytes = 0;
+        }
+    }
+
+    // Up to n keys, most recently used first (interleaving the shards' LRU lists)
+    std::vector<PlanKey> hottest(size_t n)
+    {
+        std::vector<std::vector<PlanKey>> per_shard(shards_.size());
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            std::lock_guard<std::mutex> lock(shards_[i].mutex);
+            for (const auto &e : shards_[i].lru) {
+                if (per_shard[i].size() >= n) break;
+                per_shard[i].push_back(e.key);
+            }
+        }
+        std::vector<PlanKey> out;
+        for (size_t rank = 0; out.size() < n; ++rank) {
+            bool any = false;
+            for (auto &keys : per_shard) {
+                if (rank >= keys.size()) continue;
+                any = true;
+                if (out.size() < n) out.push_back(std::move(keys[rank]));
+            }
+            if (!any) break;
+        }
+        return out;
+    }
+
+    Stats stats() const
+    {
+        Stats st;
+        st.hits = hits_.load(std::memory_order_relaxed);
+        st.misses = misses_.load(std::memory_order_relaxed);
+        st.insertions = insertions_.load(std::memory_order_relaxed);
+        st.evictions = evictions_.load(std::memory_order_relaxed);
+        st.entries = entries_.load(std::memory_order_relaxed);
+        st.bytes = (uint64_t)mem_.bytes();
+        st.capacity_bytes = capacity_bytes_;
+        return st;
+    }
+
+private:
+    struct Entry {
+        PlanKey key;
+        Body body;
+        size_t charge;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> lru; // front = most recently used
+        std::unordered_map<PlanKey, std::list<Entry>::iterator, PlanKeyHash> index;
+        size_t bytes = 0;
+    };
+
+    static size_t chargeOf(const std::string &body)
+    {
+        return body.size() + sizeof(PlanKey) * 2 + kEntryOverhead;
+    }
+
+    Shard &shardFor(const PlanKey &key)
+    {
+        // high bits select the shard, low bits are used by the bucket index
+        return shards_[(size_t)(key.hash >> 48) % shards_.size()];
+    }
+
+    size_t capacity_bytes_;
+    size_t shard_capacity_;
+    std::vector<Shard> shards_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> insertions_{0};
+    std::atomic<uint64_t> evictions_{0};
+    std::atomic<uint64_t> entries_{0};
+    memacct::Account mem_{"plan_cache"};   // charged bytes
+};
@@ -0,0 +1,377 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <json/json.h>
+
+#include "trajectory.hpp"   // PMPPoint
+
+/*
+    Serialization of planned trajectories into ready-to-send HTTP bodies.
+
+    Formats:
+      - Json   : { dt, unit, trajectory: [ {t, q[6], ...}, ... ] }
+                 (the original /arm/plan_pmp_q response layout)
+      - Binary : packed little-endian doubles, see serialize_plan_binary()
+
+    Channels select which per-sample vectors are emitted.
+    Default is q only, which matches the original response.
+*/
+
+enum class PlanFormat : uint8_t {
+    Json   = 0,
+    Binary = 1
+};
+
+enum PlanChannel : uint32_t {
+    kChanQ    = 1u << 0,   // q(t)
+    kChanDq   = 1u << 1,   // dq(t)
+    kChanDdq  = 1u << 2,   // ddq(t)
+    kChanU    = 1u << 3,   // u(t) = jerk
+    kChanJacc = 1u << 4    // accumulated cost J_acc(t)
+};
+
+struct PlanOptions {
+    PlanFormat format = PlanFormat::Json;
+    uint32_t channels = kChanQ;
+};
+
+// Parses "json" / "bin" (also "binary"). Returns false on unknown names.
+inline bool parse_plan_format(const std::string &s, PlanFormat &out)
+{
+    if (s.empty() || s == "json") { out = PlanFormat::Json; return true; }
+    if (s == "bin" || s == "binary") { out = PlanFormat::Binary; return true; }
+    return false;
+}
+
+// Parses ["q","dq","ddq","u","J_acc"] into a channel mask. Returns false on unknown names.
+inline bool parse_plan_channels(const Json::Value &arr, uint32_t &out)
+{
+    if (!arr.isArray()) return false;
+    uint32_t mask = 0;
+    for (const auto &v : arr) {
+        const std::string name = v.asString();
+        if      (name == "q")     mask |= kChanQ;
+        else if (name == "dq")    mask |= kChanDq;
+        else if (name == "ddq")   mask |= kChanDdq;
+        else if (name == "u")     mask |= kChanU;
+        else if (name == "J_acc") mask |= kChanJacc;
+        else return false;
+    }
+    if (mask == 0) return false;
+    out = mask;
+    return true;
+}
+
+// Inverse of parse_plan_channels: ["q", "dq", ...]
+inline Json::Value plan_channels_json(uint32_t mask)
+{
+    Json::Value arr(Json::arrayValue);
+    if (mask & kChanQ)    arr.append("q");
+    if (mask & kChanDq)   arr.append("dq");
+    if (mask & kChanDdq)  arr.append("ddq");
+    if (mask & kChanU)    arr.append("u");
+    if (mask & kChanJacc) arr.append("J_acc");
+    return arr;
+}
+
+// Same as parse_plan_channels for a comma separated query value: "q,dq,u"
+inline bool parse_plan_channels_csv(const std::string &csv, uint32_t &out)
+{
+    Json::Value arr(Json::arrayValue);
+    size_t pos = 0;
+    while (pos <= csv.size()) {
+        size_t end = csv.find(',', pos);
+        if (end == std::string::npos) end = csv.size();
+        arr.append(csv.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    return parse_plan_channels(arr, out);
+}
+
+inline const char *plan_content_type(PlanFormat f)
+{
+    return f == PlanFormat::Binary ? "application/octet-stream" : "application/json";
+}
+
+// ------------------------------------------------------------
+// JSON: vectors are always padded to 6 values (UR5e), as before.
+// ------------------------------------------------------------
+inline Json::Value plan_vec6_json(const std::vector<double> &v_in)
+{
+    Json::Value v(Json::arrayValue);
+    for (int i = 0; i < 6; ++i) {
+        v.append((i < (int)v_in.size()) ? v_in[i] : 0.0);
+    }
+    return v;
+}
+
+inline std::string write_json_compact(const Json::Value &v)
+{
+    // Same writer settings Drogon uses for newHttpJsonResponse()
+    Json::StreamWriterBuilder builder;
+    builder["commentStyle"] = "None";
+    builder["indentation"] = "";
+    return Json::writeString(builder, v);
+}
+
+inline Json::Value plan_point_json(const PMPPoint &p, uint32_t channels)
+{
+    Json::Value item(Json::objectValue);
+    item["t"] = p.t;
+    if (channels & kChanQ)    item["q"]   = plan_vec6_json(p.q);
+    if (channels & kChanDq)   item["dq"]  = plan_vec6_json(p.dq);
+    if (channels & kChanDdq)  item["ddq"] = plan_vec6_json(p.ddq);
+    if (channels & kChanU)    item["u"]   = plan_vec6_json(p.u);
+    if (channels & kChanJacc) item["J_acc"] = p.J_acc;
+    return item;
+}
+
+inline std::string serialize_plan_json(const std::vector<PMPPoint> &traj,
+                                       double dt, uint32_t channels = kChanQ,
+                                       const StopPredicate &should_stop = nullptr)
+{
+    Json::Value out(Json::objectValue);
+    out["dt"] = dt;
+    out["unit"] = "rad";
+    out["trajectory"] = Json::arrayValue;
+
+    auto &arr = out["trajectory"];
+    for (size_t k = 0; k < traj.size(); ++k) {
+        check_stop(should_stop, k);
+        arr.append(plan_point_json(traj[k], channels));
+    }
+    check_stop(should_stop, 0); // writing the text is the most expensive step
+    return write_json_compact(out);
+}
+
+// ------------------------------------------------------------
+// Binary layout (little-endian, no padding):
+//   char[4]  magic    "PMPB"
+//   uint16   version  (1)
+//   uint16   dof
+//   uint32   channels (PlanChannel mask)
+//   uint32   n        number of samples
+//   float64  dt
+//   n x sample:
+//     float64 t
+//     float64 q[dof]    if kChanQ
+//     float64 dq[dof]   if kChanDq
+//     float64 ddq[dof]  if kChanDdq
+//     float64 u[dof]    if kChanU
+//     float64 J_acc     if kChanJacc
+// ------------------------------------------------------------
+constexpr uint16_t kPlanBinaryVersion = 1;
+constexpr size_t   kPlanBinaryHeaderSize = 4 + 2 + 2 + 4 + 4 + 8;
+
+inline size_t plan_binary_sample_doubles(size_t dof, uint32_t channels)
+{
+    size_t n = 1; // t
+    if (channels & kChanQ)    n += dof;
+    if (channels & kChanDq)   n += dof;
+    if (channels & kChanDdq)  n += dof;
+    if (channels & kChanU)    n += dof;
+    if (channels & kChanJacc) n += 1;
+    return n;
+}
+
+inline void plan_binary_write_header(std::string &out, size_t dof, uint32_t channels,
+                                     uint32_t n, double dt)
+{
+    const uint16_t version = kPlanBinaryVersion;
+    const uint16_t dof16 = (uint16_t)dof;
+    out.append("PMPB", 4);
+    out.append(reinterpret_cast<const char *>(&version), 2);
+    out.append(reinterpret_cast<const char *>(&dof16), 2);
+    out.append(reinterpret_cast<const char *>(&channels), 4);
+    out.append(reinterpret_cast<const char *>(&n), 4);
+    out.append(reinterpret_cast<const char *>(&dt), 8);
+}
+
+inline void plan_binary_write_point(char *dst, const PMPPoint &p, size_t dof, uint32_t channels)
+{
+    auto put = [&dst](const double *src, size_t count) {
+        std::memcpy(dst, src, count * sizeof(double));
+        dst += count * sizeof(double);
+    };
+    put(&p.t, 1);
+    if (channels & kChanQ)    put(p.q.data(), dof);
+    if (channels & kChanDq)   put(p.dq.data(), dof);
+    if (channels & kChanDdq)  put(p.ddq.data(), dof);
+    if (channels & kChanU)    put(p.u.data(), dof);
+    if (channels & kChanJacc) put(&p.J_acc, 1);
+}
+
+inline std::string serialize_plan_binary(const std::vector<PMPPoint> &traj,
+                                         double dt, uint32_t channels = kChanQ,
+                                         const StopPredicate &should_stop = nullptr)
+{
+    const size_t dof = traj.empty() ? 0 : traj.front().q.size();
+    const size_t row = plan_binary_sample_doubles(dof, channels) * sizeof(double);
+
+    std::string out;
+    out.reserve(kPlanBinaryHeaderSize + row * traj.size());
+    plan_binary_write_header(out, dof, channels, (uint32_t)traj.size(), dt);
+
+    const size_t base = out.size();
+    out.resize(base + row * traj.size());
+    char *dst = &out[base];
+    for (size_t k = 0; k < traj.size(); ++k) {
+        check_stop(should_stop, k);
+        plan_binary_write_point(dst, traj[k], dof, channels);
+        dst += row;
+    }
+    return out;
+}
+
+// should_stop is polled at block boundaries; throws PlanCancelled (see trajectory.hpp)
+inline std::string serialize_plan(const std::vector<PMPPoint> &traj,
+                                  double dt, const PlanOptions &opt,
+                                  const StopPredicate &should_stop = nullptr)
+{
+    if (opt.format == PlanFormat::Binary) return serialize_plan_binary(traj, dt, opt.channels, should_stop);
+    return serialize_plan_json(traj, dt, opt.channels, should_stop);
+}
+
+// ------------------------------------------------------------
+// Batch envelopes (/arm/plan_batch). Item i carries either a serialized
+// plan body (ok) or an error message; one failing item never fails the batch.
+//
+// JSON: [ {"index":0,"ok":true,"plan":{...}}, {"index":1,"ok":false,"error":"..."}, ... ]
+//       plan bodies are spliced in verbatim, no re-parsing.
+//
+// Binary (little-endian):
+//   char[4]  magic "PMPS"
+//   uint32   count
+//   count x item:
+//     uint32 index
+//     uint32 status   0 = ok (payload: PMPB body), 1 = error (payload: UTF-8 message)
+//     uint32 length   payload bytes
+//     payload
+//
+// BatchEnvelopeWriter produces the envelope piecewise for a streamed response,
+// so a large batch is never assembled in one buffer.
+// ------------------------------------------------------------
+class BatchEnvelopeWriter {
+public:
+    BatchEnvelopeWriter(std::vector<std::string> &&bodies, std::vector<uint8_t> ok, PlanFormat format)
+        : bodies_(std::move(bodies)), ok_(std::move(ok)), format_(format)
+    {
+        for (const auto &b : bodies_) retained_ += b.size();
+    }
+
+    // Copies up to cap bytes of the envelope into dst; 0 once everything was produced.
+    // Item bodies are released as soon as they have been copied out.
+    size_t read(char *dst, size_t cap)
+    {
+        size_t n = 0;
+        while (n < cap) {
+            if (pos_ == len_ && !advance()) break;
+            const size_t m = std::min(cap - n, len_ - pos_);
+            std::memcpy(dst + n, seg_ + pos_, m);
+            pos_ += m;
+            n += m;
+        }
+        return n;
+    }
+
+    // Bytes of item bodies not released yet
+    size_t retained() const { return retained_; }
+
+private:
+    enum class Step { Head, Frame, Body, Tail, Done };
+
+    bool binary() const { return format_ == PlanFormat::Binary; }
+
+    void segment(const char *p, size_t n)
+    {
+        seg_ = p;
+        len_ = n;
+        pos_ = 0;
+    }
+
+    void release(size_t i)
+    {
+        retained_ -= bodies_[i].size();
+        std::string().swap(bodies_[i]);
+    }
+
+    bool advance()
+    {
+        frame_.clear();
+        switch (step_) {
+        case Step::Head:
+            if (binary()) {
+                const uint32_t count = (uint32_t)bodies_.size();
+                frame_.append("PMPS", 4);
+                frame_.append(reinterpret_cast<const char *>(&count), 4);
+            } else {
+                frame_ += '[';
+            }
+            step_ = bodies_.empty() ? Step::Tail : Step::Frame;
+            break;
+        case Step::Frame: {
+            const uint32_t i = (uint32_t)item_;
+            if (i) release(i - 1);
+            if (binary()) {
+                const uint32_t status = ok_[i] ? 0u : 1u;
+                const uint32_t length = (uint32_t)bodies_[i].size();
+                frame_.append(reinterpret_cast<const char *>(&i), 4);
+                frame_.append(reinterpret_cast<const char *>(&status), 4);
+                frame_.append(reinterpret_cast<const char *>(&length), 4);
+            } else {
+                if (i) frame_ += "},";
+                frame_ += "{\"index\":";
+                frame_ += std::to_string(i);
+                if (ok_[i]) {
+                    frame_ += ",\"ok\":true,\"plan\":";
+                } else {
+                    frame_ += ",\"ok\":false,\"error\":";
+                    frame_ += write_json_compact(Json::Value(bodies_[i]));
+                }
+            }
+            step_ = Step::Body;
+            break;
+        }
+        case Step::Body: {
+            const std::string &b = bodies_[item_];
+            if (binary() || ok_[item_]) segment(b.data(), b.size());
+            else segment(nullptr, 0);   // the error message went out with the frame
+            step_ = ++item_ < bodies_.size() ? Step::Frame : Step::Tail;
+            return true;
+        }
+        case Step::Tail:
+            if (item_) release(item_ - 1);
+            if (!binary()) frame_ += bodies_.empty() ? "]" : "}]";
+            step_ = Step::Done;
+            break;
+        case Step::Done:
+            return false;
+        }
+        segment(frame_.data(), frame_.size());
+        return true;
+    }
+
+    std::vector<std::string> bodies_;
+    std::vector<uint8_t> ok_;
+    PlanFormat format_;
+    Step step_ = Step::Head;
+    size_t item_ = 0;
+    size_t retained_ = 0;
+    std::string frame_;                // framing bytes between item bodies
+    const char *seg_ = nullptr;        // segment being copied out
+    size_t len_ = 0;
+    size_t pos_ = 0;
+};
+
+// Whole envelope in one string (same bytes as streaming a BatchEnvelopeWriter)
+inline std::string serialize_batch(std::vector<std::string> bodies, std::vector<uint8_t> ok, PlanFormat format)
+{
+    BatchEnvelopeWriter w(std::move(bodies), std::move(ok), format);
+    std::string out;
+    char buf[16384];
+    for (size_t n; (n = w.read(buf, sizeof(buf))) != 0;) out.append(buf, n);
+    return out;
+}
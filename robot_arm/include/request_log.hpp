@@ -0,0 +1,461 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "memory_accounting.hpp" // memacct::Account
+
+/*
+    Binary log of decoded plan requests and jog channel frames, for replaying
+    production traffic (tools/replay: robot_arm_replay).
+
+    File layout (host byte order, little-endian on every supported target):
+
+      header   char magic[8] = "RAREQLG1", uint64 start (unix ns)
+      record   uint32 size                 bytes after this field
+               uint64 t_ns                 arrival, ns after the recorder started
+               uint8  kind                 Kind
+               uint8  format               PlanFormat
+               uint8  flags                kStore | kDeadline | kSession
+               uint8  reserved
+               uint32 channels             PlanChannel mask
+               [double deadline_ms]        kDeadline (X-Deadline-Ms)
+               [uint16 n, char[n]]         kSession  (X-Session-Id)
+        Plan:  double q_target[6], T, dt
+        Batch: uint32 items, per item: uint8 item flags (kItemQ0 | kItemInvalid),
+               [double q0[6]], double q_target[6], T, dt (invalid items: flags only)
+        Jog*:  uint64 conn, uint32 n, char[n] text
+               conn numbers the /arm/jog connections of the recorder; text is the
+               handshake query (JogOpen), the client's text message (JogFrame) or
+               empty (JogClose)
+
+    A plan request is about 100 bytes instead of ~200 of JSON. Records are
+    appended in completion order of decoding, so t_ns is only nearly
+    monotonic; readAll() sorts by arrival.
+
+    Recording is opt-in (custom_config.request_log; the file is rewritten
+    at every start, times are relative to it). The request thread
+    encodes the record into one buffer and pushes it into a bounded
+    lock-free queue (Vyukov MPMC ring with per-slot sequence numbers); a
+    writer thread drains it into the file. A full queue drops the record
+    (counted) instead of blocking the request. A failed write or flush
+    leaves the file truncated at an unknown record: recording stops there
+    and the records that did not reach the file are counted as failed.
+*/
+
+namespace reqlog {
+
+constexpr char kMagic[8] = {'R', 'A', 'R', 'E', 'Q', 'L', 'G', '1'};
+
+enum class Kind : uint8_t { Plan = 1, Batch = 2, JogOpen = 3, JogFrame = 4, JogClose = 5 };
+
+inline bool isJog(Kind k) { return k == Kind::JogOpen || k == Kind::JogFrame || k == Kind::JogClose; }
+
+enum Flags : uint8_t { kStore = 1u << 0, kDeadline = 1u << 1, kSession = 1u << 2 };
+enum ItemFlags : uint8_t { kItemQ0 = 1u << 0, kItemInvalid = 1u << 1 };
+
+struct Item {
+    uint8_t flags = 0;
+    double q0[6] = {};
+    double q1[6] = {};
+    double T = 1.0, dt = 0.02;
+};
+
+// One decoded request (plan: q_target/T/dt; batch: items; jog: conn/text)
+struct Request {
+    uint64_t t_ns = 0;
+    Kind kind = Kind::Plan;
+    uint8_t format = 0;
+    uint8_t flags = 0;
+    uint32_t channels = 1;
+    double deadline_ms = 0.0;
+    std::string session;
+    double q_target[6] = {};
+    double T = 1.0, dt = 0.02;
+    std::vector<Item> items;
+    uint64_t conn = 0;
+    std::string text;
+};
+
+inline uint64_t steadyNs()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ------------------------------------------------------------
+// Encoding
+// ------------------------------------------------------------
+namespace detail {
+
+template <class T>
+inline void put(std::string &out, const T &v)
+{
+    out.append(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+inline void putDoubles(std::string &out, const double *v, size_t n)
+{
+    out.append(reinterpret_cast<const char *>(v), n * sizeof(double));
+}
+
+class Cursor {
+public:
+    Cursor(const char *p, size_t n) : p_(p), end_(p + n) {}
+
+    template <class T>
+    T get()
+    {
+        T v;
+        need(sizeof(T));
+        std::memcpy(&v, p_, sizeof(T));
+        p_ += sizeof(T);
+        return v;
+    }
+    void getDoubles(double *v, size_t n)
+    {
+        need(n * sizeof(double));
+        std::memcpy(v, p_, n * sizeof(double));
+        p_ += n * sizeof(double);
+    }
+    std::string getString(size_t n)
+    {
+        need(n);
+        std::string s(p_, n);
+        p_ += n;
+        return s;
+    }
+
+private:
+    void need(size_t n) const
+    {
+        if ((size_t)(end_ - p_) < n) throw std::runtime_error("request log: truncated record");
+    }
+    const char *p_;
+    const char *end_;
+};
+
+} // namespace detail
+
+// Record including its size prefix
+inline std::string encode(const Request &r)
+{
+    std::string out;
+    out.reserve(24 + 8 * 14 + r.session.size() + r.text.size() + r.items.size() * (1 + 8 * 14));
+    detail::put<uint32_t>(out, 0);                       // size, patched below
+    detail::put<uint64_t>(out, r.t_ns);
+    detail::put<uint8_t>(out, (uint8_t)r.kind);
+    detail::put<uint8_t>(out, r.format);
+    detail::put<uint8_t>(out, r.flags);
+    detail::put<uint8_t>(out, 0);
+    detail::put<uint32_t>(out, r.channels);
+    if (r.flags & kDeadline) detail::put<double>(out, r.deadline_ms);
+    if (r.flags & kSession) {
+        const uint16_t n = (uint16_t)std::min<size_t>(r.session.size(), UINT16_MAX);
+        detail::put<uint16_t>(out, n);
+        out.append(r.session, 0, n);
+    }
+    if (r.kind == Kind::Plan) {
+        detail::putDoubles(out, r.q_target, 6);
+        detail::put<double>(out, r.T);
+        detail::put<double>(out, r.dt);
+    } else if (isJog(r.kind)) {
+        detail::put<uint64_t>(out, r.conn);
+        detail::put<uint32_t>(out, (uint32_t)r.text.size());
+        out += r.text;
+    } else {
+        detail::put<uint32_t>(out, (uint32_t)r.items.size());
+        for (const Item &it : r.items) {
+            detail::put<uint8_t>(out, it.flags);
+            if (it.flags & kItemInvalid) continue;
+            if (it.flags & kItemQ0) detail::putDoubles(out, it.q0, 6);
+            detail::putDoubles(out, it.q1, 6);
+            detail::put<double>(out, it.T);
+            detail::put<double>(out, it.dt);
+        }
+    }
+    const uint32_t size = (uint32_t)(out.size() - sizeof(uint32_t));
+    std::memcpy(&out[0], &size, sizeof(size));
+    return out;
+}
+
+// Body of one record (without the size prefix); throws on a malformed record
+inline Request decode(const char *p, size_t n)
+{
+    detail::Cursor c(p, n);
+    Request r;
+    r.t_ns = c.get<uint64_t>();
+    const uint8_t kind = c.get<uint8_t>();
+    if (kind < (uint8_t)Kind::Plan || kind > (uint8_t)Kind::JogClose) {
+        throw std::runtime_error("request log: unknown record kind " + std::to_string(kind));
+    }
+    r.kind = (Kind)kind;
+    r.format = c.get<uint8_t>();
+    r.flags = c.get<uint8_t>();
+    (void)c.get<uint8_t>();
+    r.channels = c.get<uint32_t>();
+    if (r.flags & kDeadline) r.deadline_ms = c.get<double>();
+    if (r.flags & kSession) r.session = c.getString(c.get<uint16_t>());
+    if (r.kind == Kind::Plan) {
+        c.getDoubles(r.q_target, 6);
+        r.T = c.get<double>();
+        r.dt = c.get<double>();
+    } else if (isJog(r.kind)) {
+        r.conn = c.get<uint64_t>();
+        r.text = c.getString(c.get<uint32_t>());
+    } else {
+        r.items.resize(c.get<uint32_t>());
+        for (Item &it : r.items) {
+            it.flags = c.get<uint8_t>();
+            if (it.flags & kItemInvalid) continue;
+            if (it.flags & kItemQ0) c.getDoubles(it.q0, 6);
+            c.getDoubles(it.q1, 6);
+            it.T = c.get<double>();
+            it.dt = c.get<double>();
+        }
+    }
+    return r;
+}
+
+// ------------------------------------------------------------
+// Bounded MPMC queue of encoded records (Vyukov): one CAS per push/pop, no locks
+// ------------------------------------------------------------
+class RecordQueue {
+public:
+    explicit RecordQueue(size_t capacity)
+    {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        slots_ = std::unique_ptr<Slot[]>(new Slot[n]);
+        mask_ = n - 1;
+        for (size_t i = 0; i < n; ++i) slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // Bytes of the slot array (records in the slots are not included)
+    size_t slotBytes() const { return (mask_ + 1) * sizeof(Slot); }
+
+    // false when full (rec untouched)
+    bool push(std::string &rec)
+    {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &s = slots_[pos & mask_];
+            const size_t seq = s.seq.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    s.data.swap(rec);
+                    s.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(std::string &out)
+    {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &s = slots_[pos & mask_];
+            const size_t seq = s.seq.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out.swap(s.data);
+                    s.data.clear();
+                    s.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<size_t> seq{0};
+        std::string data;
+    };
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) std::atomic<size_t> head_{0};
+};
+
+// ------------------------------------------------------------
+// Recorder: request threads push, one writer thread appends to the file
+// ------------------------------------------------------------
+class Recorder {
+public:
+    struct Stats {
+        uint64_t records = 0;          // written to the file
+        uint64_t dropped = 0;          // queue full
+        uint64_t failed = 0;           // lost to an I/O error (recording stopped)
+        uint64_t bytes = 0;
+    };
+
+    Recorder(const std::string &path, size_t queue_records, double flush_s = 0.5)
+        : path_(path), queue_(queue_records), start_ns_(steadyNs()),
+          flush_ns_((uint64_t)(flush_s * 1e9))
+    {
+        mem_.add((int64_t)queue_.slotBytes());
+        // Arrival times are relative to this recorder: a new one starts a new file
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_) throw std::runtime_error("request log: cannot open " + path + ": " + std::strerror(errno));
+        std::setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+        std::string header(kMagic, sizeof(kMagic));
+        const uint64_t unix_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::system_clock::now().time_since_epoch()).count();
+        detail::put<uint64_t>(header, unix_ns);
+        if (std::fwrite(header.data(), 1, header.size(), file_) != header.size()) {
+            const int err = errno;
+            std::fclose(file_);
+            throw std::runtime_error("request log: cannot write " + path + ": " + std::strerror(err));
+        }
+        writer_ = std::thread([this]() { run(); });
+    }
+
+    ~Recorder()
+    {
+        stop_.store(true, std::memory_order_release);
+        writer_.join();
+        std::fclose(file_);
+    }
+
+    Recorder(const Recorder &) = delete;
+    Recorder &operator=(const Recorder &) = delete;
+
+    const std::string &path() const { return path_; }
+
+    // Arrival time for Request::t_ns (call at handler entry)
+    uint64_t now() const { return steadyNs() - start_ns_; }
+
+    // Any thread; never blocks
+    void record(const Request &r)
+    {
+        std::string rec = encode(r);
+        const int64_t size = (int64_t)rec.size();
+        mem_.add(size);                         // before the push: the writer may pop it at once
+        if (!queue_.push(rec)) {
+            mem_.sub(size);
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    Stats stats() const
+    {
+        Stats s;
+        s.records = records_.load(std::memory_order_relaxed);
+        s.dropped = dropped_.load(std::memory_order_relaxed);
+        s.failed = failed_.load(std::memory_order_relaxed);
+        s.bytes = bytes_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    void run()
+    {
+        std::string rec;
+        uint64_t last_flush = steadyNs();
+        bool dirty = false;
+        for (;;) {
+            const bool stopping = stop_.load(std::memory_order_acquire);
+            size_t n = 0;
+            while (queue_.pop(rec)) {
+                mem_.sub((int64_t)rec.size());
+                ++n;
+                if (broken_ || std::fwrite(rec.data(), 1, rec.size(), file_) != rec.size()) {
+                    broken_ = true;
+                    failed_.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                records_.fetch_add(1, std::memory_order_relaxed);
+                bytes_.fetch_add(rec.size(), std::memory_order_relaxed);
+                ++unflushed_;
+                dirty = true;
+            }
+            if (stopping) break;                // drained after the stop was seen
+            const uint64_t now = steadyNs();
+            if (dirty && now - last_flush >= flush_ns_) {
+                flush();
+                last_flush = now;
+                dirty = false;
+            }
+            if (!n) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        flush();
+    }
+
+    // Records buffered since the last successful flush are lost when it fails
+    void flush()
+    {
+        if (!broken_ && std::fflush(file_) != 0) {
+            broken_ = true;
+            records_.fetch_sub(unflushed_, std::memory_order_relaxed);
+            failed_.fetch_add(unflushed_, std::memory_order_relaxed);
+        }
+        unflushed_ = 0;
+    }
+
+    std::string path_;
+    RecordQueue queue_;
+    uint64_t start_ns_;
+    uint64_t flush_ns_;
+    std::FILE *file_ = nullptr;
+    std::atomic<bool> stop_{false};
+    bool broken_ = false;                   // writer thread: the file failed, stop writing
+    uint64_t unflushed_ = 0;                // writer thread: records written since the last flush
+    std::atomic<uint64_t> records_{0}, dropped_{0}, failed_{0}, bytes_{0};
+    memacct::Account mem_{"request_log"};   // queue slots and records waiting for the writer
+    std::thread writer_;
+};
+
+// ------------------------------------------------------------
+// Reader (replay tool)
+// ------------------------------------------------------------
+struct Log {
+    uint64_t start_unix_ns = 0;
+    std::vector<Request> requests;     // by arrival
+};
+
+// Whole file; throws on a bad header or a malformed record (a truncated last record,
+// e.g. from a killed server, is ignored)
+inline Log readAll(const std::string &path)
+{
+    std::unique_ptr<std::FILE, int (*)(std::FILE *)> f(std::fopen(path.c_str(), "rb"), &std::fclose);
+    if (!f) throw std::runtime_error("request log: cannot open " + path);
+    char magic[8];
+    Log log;
+    if (std::fread(magic, 1, 8, f.get()) != 8 || std::memcmp(magic, kMagic, 8) != 0 ||
+        std::fread(&log.start_unix_ns, sizeof(uint64_t), 1, f.get()) != 1) {
+        throw std::runtime_error("request log: " + path + " is not a request log");
+    }
+    std::string buf;
+    uint32_t size = 0;
+    while (std::fread(&size, sizeof(size), 1, f.get()) == 1) {
+        buf.resize(size);
+        if (std::fread(&buf[0], 1, size, f.get()) != size) break;
+        log.requests.push_back(decode(buf.data(), buf.size()));
+    }
+    std::stable_sort(log.requests.begin(), log.requests.end(),
+                     [](const Request &a, const Request &b) { return a.t_ns < b.t_ns; });
+    return log;
+}
+
+} // namespace reqlog
@@ -0,0 +1,213 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+
+/*
+    Single-flight: concurrent requests with the same key share one computation.
+
+    join() attaches a waiter to the in-flight computation of a key, or starts
+    a new one and makes the caller its leader. The leader computes and calls
+    complete(); every attached waiter then receives the same result, either
+    through its callback or by blocking in waitFor().
+
+    Waiters are reference counted: leave() detaches one (client gone, or a
+    blocking waiter that stops waiting), and when the last waiter leaves the
+    flight is cancelled. The leader checks cancelled() and may abandon the
+    work; new joiners never attach to a cancelled flight.
+
+    A waiter may also pass an isCancelled predicate (its request token).
+    The leader calls poll() at block boundaries: waiters whose predicate
+    fires are detached and callbacks are answered right away with the given
+    result, and poll() returns true once nobody is left to receive the
+    computation. Blocking waiters check their own token between waitFor()
+    slices and leave() (a no-op if poll() detached them already).
+
+    The leader calls begin() when the computation actually starts running.
+    A blocking waiter on a thread pool must not wait for a flight that is not
+    running() yet: its leader may be queued behind it on the same pool.
+*/
+
+template <class Key, class Result, class Hash = std::hash<Key>>
+class SingleFlight {
+public:
+    using Callback = std::function<void(const Result &)>;
+    using Cancelled = std::function<bool()>;
+
+    class Flight {
+    public:
+        bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+        bool running() const { return running_.load(std::memory_order_acquire); }
+
+    private:
+        friend class SingleFlight;
+        std::condition_variable cv_;
+        bool done_ = false;
+        Result result_{};
+        struct Waiter {
+            uint64_t id;
+            Callback cb;
+            Cancelled isCancelled;
+        };
+        std::vector<Waiter> waiters_;
+        size_t refs_ = 0;
+        uint64_t next_ticket_ = 1;
+        std::atomic<bool> cancelled_{false};
+        std::atomic<bool> running_{false};
+    };
+    using FlightPtr = std::shared_ptr<Flight>;
+
+    struct Ticket {
+        FlightPtr flight;
+        uint64_t id = 0;
+        bool leader = false;
+    };
+
+    struct Stats {
+        uint64_t flights = 0;     // computations started
+        uint64_t coalesced = 0;   // waiters attached to an existing computation
+        uint64_t cancelled = 0;   // computations whose waiters all left
+        uint64_t dropped = 0;     // waiters detached by poll() (cancelled requests)
+        uint64_t in_flight = 0;
+    };
+
+    // cb may be empty for waiters that block in waitFor()
+    Ticket join(const Key &key, Callback cb, Cancelled isCancelled = nullptr)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Ticket t;
+        auto it = flights_.find(key);
+        if (it != flights_.end() && !it->second->cancelled()) {
+            t.flight = it->second;
+            coalesced_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            t.flight = std::make_shared<Flight>();
+            t.leader = true;
+            flights_[key] = t.flight;
+            started_.fetch_add(1, std::memory_order_relaxed);
+        }
+        Flight &f = *t.flight;
+        t.id = f.next_ticket_++;
+        ++f.refs_;
+        f.waiters_.push_back({t.id, std::move(cb), std::move(isCancelled)});
+        return t;
+    }
+
+    // Leader: the computation is running on this thread (it was not merely queued)
+    void begin(const Ticket &t) { t.flight->running_.store(true, std::memory_order_release); }
+
+    // Blocks up to timeout for the leader to complete (waiters joined without a callback);
+    // false if it has not completed yet
+    template <class Rep, class Period>
+    bool waitFor(const Ticket &t, std::chrono::duration<Rep, Period> timeout, Result &out)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!t.flight->cv_.wait_for(lock, timeout, [&t] { return t.flight->done_; })) return false;
+        out = t.flight->result_;
+        return true;
+    }
+
+    // Detaches a waiter; its callback will not be called. Last one out cancels the flight.
+    // No-op once the flight completed or the waiter was already detached by poll().
+    void leave(const Key &key, const Ticket &t)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Flight &f = *t.flight;
+        if (f.done_) return;
+        for (auto it = f.waiters_.begin(); it != f.waiters_.end(); ++it) {
+            if (it->id == t.id) {
+                f.waiters_.erase(it);
+                releaseLocked(key, t.flight);
+                return;
+            }
+        }
+    }
+
+    // Leader: detaches waiters whose request was cancelled (their callbacks receive
+    // `dropped` on this thread). True when the flight has nobody left to serve.
+    bool poll(const Key &key, const Ticket &t, const Result &dropped)
+    {
+        std::vector<Callback> callbacks;
+        bool abandoned = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Flight &f = *t.flight;
+            if (f.done_) return false;
+            for (auto it = f.waiters_.begin(); it != f.waiters_.end();) {
+                if (it->isCancelled && it->isCancelled()) {
+                    if (it->cb) callbacks.push_back(std::move(it->cb));
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    it = f.waiters_.erase(it);
+                    releaseLocked(key, t.flight);
+                } else {
+                    ++it;
+                }
+            }
+            abandoned = f.cancelled();
+        }
+        for (auto &cb : callbacks) cb(dropped);
+        return abandoned;
+    }
+
+    // Leader publishes the result to every attached waiter (callbacks run on this thread)
+    void complete(const Key &key, const Ticket &t, const Result &r)
+    {
+        std::vector<typename Flight::Waiter> waiters;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Flight &f = *t.flight;
+            f.result_ = r;
+            f.done_ = true;
+            waiters.swap(f.waiters_);
+            forgetLocked(key, t.flight);
+        }
+        t.flight->cv_.notify_all();
+        for (auto &w : waiters) {
+            if (w.cb) w.cb(r);
+        }
+    }
+
+    Stats stats() const
+    {
+        Stats st;
+        st.flights = started_.load(std::memory_order_relaxed);
+        st.coalesced = coalesced_.load(std::memory_order_relaxed);
+        st.cancelled = cancelled_.load(std::memory_order_relaxed);
+        st.dropped = dropped_.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex_);
+        st.in_flight = flights_.size();
+        return st;
+    }
+
+private:
+    // One waiter gone; the last one out cancels the flight
+    void releaseLocked(const Key &key, const FlightPtr &flight)
+    {
+        Flight &f = *flight;
+        if (f.refs_ > 0 && --f.refs_ == 0) {
+            f.cancelled_.store(true, std::memory_order_relaxed);
+            cancelled_.fetch_add(1, std::memory_order_relaxed);
+            forgetLocked(key, flight);
+        }
+    }
+
+    // A newer flight may already own the key (after cancellation): only erase our own
+    void forgetLocked(const Key &key, const FlightPtr &f)
+    {
+        auto it = flights_.find(key);
+        if (it != flights_.end() && it->second == f) flights_.erase(it);
+    }
+
+    mutable std::mutex mutex_;
+    std::unordered_map<Key, FlightPtr, Hash> flights_;
+    std::atomic<uint64_t> started_{0};
+    std::atomic<uint64_t> coalesced_{0};
+    std::atomic<uint64_t> cancelled_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
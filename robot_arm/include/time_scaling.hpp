@@ -0,0 +1,75 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+/*
+    Time law s(t) for speed override.
+
+    A trajectory q(s) is followed in trajectory time s; the rate r = ds/dt
+    is the speed override (1 = nominal). Starting at an anchor (t = 0,
+    s = s0, rate r0) the rate moves to r1 over `ramp` seconds along a
+    smoothstep, so r is C1 and the commanded acceleration stays continuous:
+
+        x = t / ramp
+        r(t) = r0 + (r1 - r0) * (3x^2 - 2x^3)
+        s(t) = s0 + r0 t + (r1 - r0) * ramp * (x^3 - x^4 / 2)     (t <= ramp)
+        s(t) = s(ramp) + r1 (t - ramp)                              (t >  ramp)
+
+    Physical derivatives follow by the chain rule:
+        dq/dt   = q'(s) r
+        d2q/dt2 = q''(s) r^2 + q'(s) dr/dt
+    Each evaluation is O(1).
+*/
+
+struct TimeLaw {
+    double s0 = 0.0;     // trajectory time at the anchor
+    double r0 = 1.0;     // rate at the anchor
+    double r1 = 1.0;     // rate after the ramp
+    double ramp = 0.0;   // ramp duration (s), 0 = constant rate r1
+
+    static TimeLaw constant(double rate, double s0 = 0.0)
+    {
+        TimeLaw law;
+        law.s0 = s0;
+        law.r0 = law.r1 = rate;
+        return law;
+    }
+
+    // Trajectory time, rate and rate derivative `t` seconds after the anchor
+    void eval(double t, double &s, double &r, double &dr) const
+    {
+        if (t < 0.0) t = 0.0;
+        if (t < ramp) {
+            const double x = t / ramp;
+            const double x2 = x * x;
+            const double d = r1 - r0;
+            s  = s0 + r0 * t + d * ramp * (x2 * x - 0.5 * x2 * x2);
+            r  = r0 + d * (3.0 * x2 - 2.0 * x2 * x);
+            dr = d * 6.0 * x * (1.0 - x) / ramp;
+            return;
+        }
+        s  = s0 + 0.5 * (r0 + r1) * ramp + r1 * (t - ramp);
+        r  = r1;
+        dr = 0.0;
+    }
+
+    // Seconds after the anchor at which s reaches s_end (rates must be > 0)
+    double timeTo(double s_end) const
+    {
+        const double s_ramp = s0 + 0.5 * (r0 + r1) * ramp;
+        if (s_end >= s_ramp) return ramp + (s_end - s_ramp) / r1;
+
+        // Inside the ramp: s is increasing, bisect
+        double lo = 0.0, hi = ramp;
+        for (int i = 0; i < 50; ++i) {
+            const double mid = 0.5 * (lo + hi);
+            double s, r, dr;
+            eval(mid, s, r, dr);
+            (s < s_end ? lo : hi) = mid;
+        }
+        return hi;
+    }
+
+    // Ramp time still to go `t` seconds after the anchor
+    double rampLeft(double t) const { return std::max(0.0, ramp - t); }
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+    Hashed timing wheel.
+
+    Time is counted in ticks. An entry due at tick d lives in slot d % slots;
+    advance(now) visits every slot passed since the previous call and fires
+    the entries that are due (entries more than one revolution away stay in
+    their slot). schedule() and advance() are O(1) amortized per entry, so
+    thousands of timers cost one periodic callback instead of one timer each.
+
+    Not thread safe: callers serialize access.
+*/
+
+template <class Payload>
+class TimerWheel {
+public:
+    explicit TimerWheel(size_t slots = 512)
+        : slots_(slots ? slots : 1)
+    {
+    }
+
+    // Entries due at or before the current tick fire on the next advance()
+    void schedule(uint64_t due_tick, const Payload &p)
+    {
+        if (due_tick <= now_) due_tick = now_ + 1;
+        slots_[due_tick % slots_.size()].push_back(Entry{due_tick, p});
+        ++size_;
+    }
+
+    // Moves the wheel to tick `now`, calling fire(payload) for every entry due
+    template <class Fn>
+    void advance(uint64_t now, Fn &&fire)
+    {
+        if (now <= now_) return;
+        // A long pause (more than one revolution) only needs one pass over the wheel
+        const uint64_t first = (now - now_ > slots_.size()) ? now - slots_.size() + 1 : now_ + 1;
+        now_ = now;
+        for (uint64_t tick = first; tick <= now; ++tick) {
+            auto &slot = slots_[tick % slots_.size()];
+            for (size_t i = 0; i < slot.size();) {
+                if (slot[i].due <= now) {
+                    Payload p = slot[i].payload;
+                    slot[i] = slot.back();
+                    slot.pop_back();
+                    --size_;
+                    fire(p);
+                } else {
+                    ++i;
+                }
+            }
+        }
+    }
+
+    uint64_t now() const { return now_; }
+    size_t size() const { return size_; }
+
+private:
+    struct Entry {
+        uint64_t due;
+        Payload payload;
+    };
+
+    std::vector<std::vector<Entry>> slots_;
+    uint64_t now_ = 0;
+    size_t size_ = 0;
+};
@@ -0,0 +1,254 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "memory_accounting.hpp" // memacct::Account
+
+/*
+    Per-request span tracing, exported as Chrome trace-event JSON
+    (chrome://tracing, ui.perfetto.dev).
+
+    A traced request binds its id on every thread that works on it (like
+    perf::Sampled); Span records one complete event ("ph":"X") on scope exit:
+
+        trace::Bind bind(call->trace_id);          // 0: not traced, spans do nothing
+        trace::Span span("serialize");
+
+    Each thread writes into its own ring buffer (the newest `capacity`
+    events are kept). The owner thread is the only writer; a slot carries a
+    sequence number written around the payload, so a reader copying the ring
+    concurrently skips slots that were being overwritten instead of locking
+    the writer. Buffers stay registered after their thread exits, so a dump
+    still shows the work of finished threads (the "trace_rings" memory
+    account only grows).
+
+    Which requests are traced is decided by a Sampler (every n-th request)
+    and by capture windows (/debug/trace?seconds=N traces every request
+    until the window ends), so tracing can stay enabled in production.
+*/
+
+namespace trace {
+
+using Clock = std::chrono::steady_clock;
+
+inline uint64_t nowNs()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+struct Event {
+    const char *name = nullptr;        // string literal
+    uint64_t begin_ns = 0;             // steady clock
+    uint64_t dur_ns = 0;
+    uint64_t request = 0;
+    uint32_t tid = 0;
+};
+
+// ------------------------------------------------------------
+// Single-writer ring of events
+// ------------------------------------------------------------
+class Ring {
+public:
+    Ring(size_t capacity, uint32_t tid) : slots_(std::max<size_t>(capacity, 16)), tid_(tid) {}
+
+    uint32_t tid() const { return tid_; }
+    size_t bytes() const { return slots_.size() * sizeof(Slot); }
+
+    // Owner thread only
+    void push(const char *name, uint64_t begin_ns, uint64_t dur_ns, uint64_t request)
+    {
+        const uint64_t i = head_.load(std::memory_order_relaxed);
+        Slot &s = slots_[i % slots_.size()];
+        s.seq.store(2 * i + 1, std::memory_order_relaxed);        // odd: being written
+        std::atomic_thread_fence(std::memory_order_release);
+        s.name.store(name, std::memory_order_relaxed);
+        s.begin_ns.store(begin_ns, std::memory_order_relaxed);
+        s.dur_ns.store(dur_ns, std::memory_order_relaxed);
+        s.request.store(request, std::memory_order_relaxed);
+        s.seq.store(2 * i + 2, std::memory_order_release);
+        head_.store(i + 1, std::memory_order_release);
+    }
+
+    // Any thread: appends the consistent events ending at or after since_ns
+    void collect(uint64_t since_ns, std::vector<Event> &out) const
+    {
+        const uint64_t head = head_.load(std::memory_order_acquire);
+        const uint64_t n = std::min<uint64_t>(head, slots_.size());
+        for (uint64_t i = head - n; i < head; ++i) {
+            const Slot &s = slots_[i % slots_.size()];
+            if (s.seq.load(std::memory_order_acquire) != 2 * i + 2) continue;   // overwritten or in progress
+            Event e;
+            e.name = s.name.load(std::memory_order_relaxed);
+            e.begin_ns = s.begin_ns.load(std::memory_order_relaxed);
+            e.dur_ns = s.dur_ns.load(std::memory_order_relaxed);
+            e.request = s.request.load(std::memory_order_relaxed);
+            e.tid = tid_;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != 2 * i + 2) continue;
+            if (e.begin_ns + e.dur_ns >= since_ns) out.push_back(e);
+        }
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<const char *> name{nullptr};
+        std::atomic<uint64_t> begin_ns{0}, dur_ns{0}, request{0};
+    };
+    std::vector<Slot> slots_;
+    std::atomic<uint64_t> head_{0};
+    uint32_t tid_;
+};
+
+// ------------------------------------------------------------
+// Process-wide state
+// ------------------------------------------------------------
+namespace detail {
+
+struct Registry {
+    std::mutex mutex;                                  // registration and dumps only
+    std::vector<std::shared_ptr<Ring>> rings;
+    std::atomic<size_t> capacity{16384};               // events per thread (new threads)
+    std::atomic<uint64_t> sample_every{0};             // 0: sampling off
+    std::atomic<uint64_t> counter{0};
+    std::atomic<uint64_t> next_id{1};
+    std::atomic<uint64_t> capture_until_ns{0};         // trace everything before this time
+    memacct::Account mem{"trace_rings"};
+};
+inline Registry g_registry;
+inline thread_local uint64_t t_request = 0;
+
+inline Ring &threadRing()
+{
+    static thread_local std::shared_ptr<Ring> ring = []() {
+        std::lock_guard<std::mutex> lock(g_registry.mutex);
+        auto r = std::make_shared<Ring>(g_registry.capacity.load(), (uint32_t)g_registry.rings.size() + 1);
+        g_registry.rings.push_back(r);
+        g_registry.mem.add((int64_t)r->bytes());
+        return r;
+    }();
+    return *ring;
+}
+
+} // namespace detail
+
+// Ring size for threads that record their first event after this call
+inline void setCapacity(size_t events) { detail::g_registry.capacity.store(events); }
+
+// Every n-th request is traced (0 = only during capture windows)
+inline void setSampleEvery(uint64_t n) { detail::g_registry.sample_every.store(n); }
+inline uint64_t sampleEvery() { return detail::g_registry.sample_every.load(std::memory_order_relaxed); }
+
+// Allocates the calling thread's ring now instead of at its first traced span (startup warm-up)
+inline void prepareThread() { detail::threadRing(); }
+
+// Traces every request until now + seconds
+inline void captureFor(double seconds)
+{
+    const uint64_t until = nowNs() + (uint64_t)(seconds * 1e9);
+    uint64_t cur = detail::g_registry.capture_until_ns.load();
+    while (until > cur && !detail::g_registry.capture_until_ns.compare_exchange_weak(cur, until)) {
+    }
+}
+
+// Id of a new request if it is to be traced, 0 otherwise
+inline uint64_t startRequest()
+{
+    auto &g = detail::g_registry;
+    const uint64_t every = g.sample_every.load(std::memory_order_relaxed);
+    const bool sampled = every && g.counter.fetch_add(1, std::memory_order_relaxed) % every == 0;
+    if (!sampled && nowNs() >= g.capture_until_ns.load(std::memory_order_relaxed)) return 0;
+    return g.next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Records an event measured by the caller (spans crossing threads, e.g. a whole request)
+inline void record(uint64_t request, const char *name, uint64_t begin_ns, uint64_t end_ns)
+{
+    if (!request) return;
+    detail::threadRing().push(name, begin_ns, end_ns > begin_ns ? end_ns - begin_ns : 0, request);
+}
+
+// Binds a request to the thread for its lifetime (restores the previous one on exit)
+class Bind {
+public:
+    explicit Bind(uint64_t request) : prev_(detail::t_request) { detail::t_request = request; }
+    ~Bind() { detail::t_request = prev_; }
+    Bind(const Bind &) = delete;
+    Bind &operator=(const Bind &) = delete;
+
+private:
+    uint64_t prev_;
+};
+
+// One span of the bound request; nothing when the thread has no traced request
+class Span {
+public:
+    explicit Span(const char *name) : name_(name), request_(detail::t_request)
+    {
+        if (request_) begin_ = nowNs();
+    }
+    ~Span()
+    {
+        if (request_) detail::threadRing().push(name_, begin_, nowNs() - begin_, request_);
+    }
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+
+private:
+    const char *name_;
+    uint64_t request_;
+    uint64_t begin_ = 0;
+};
+
+// Events of every thread ending at or after since_ns, oldest first
+inline std::vector<Event> collect(uint64_t since_ns)
+{
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> lock(detail::g_registry.mutex);
+        rings = detail::g_registry.rings;
+    }
+    std::vector<Event> out;
+    for (const auto &r : rings) r->collect(since_ns, out);
+    std::sort(out.begin(), out.end(), [](const Event &a, const Event &b) { return a.begin_ns < b.begin_ns; });
+    return out;
+}
+
+// { "traceEvents": [ {name, cat, ph: "X", ts, dur (us), pid, tid, args: {request}} ... ] }
+inline std::string chromeJson(const std::vector<Event> &events)
+{
+    std::string out;
+    out.reserve(64 + events.size() * 128);
+    out += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    char buf[256];
+    bool first = true;
+    uint32_t max_tid = 0;
+    for (const auto &e : events) max_tid = std::max(max_tid, e.tid);
+    for (uint32_t tid = 1; tid <= max_tid; ++tid) {
+        std::snprintf(buf, sizeof(buf),
+                      "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+                      first ? "" : ",", tid, tid);
+        out += buf;
+        first = false;
+    }
+    for (const auto &e : events) {
+        std::snprintf(buf, sizeof(buf),
+                      "%s{\"name\":\"%s\",\"cat\":\"robot_arm\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                      "\"pid\":1,\"tid\":%u,\"args\":{\"request\":%llu}}",
+                      first ? "" : ",", e.name, (double)e.begin_ns / 1e3, (double)e.dur_ns / 1e3, e.tid,
+                      (unsigned long long)e.request);
+        out += buf;
+        first = false;
+    }
+    out += "]}";
+    return out;
+}
+
+} // namespace trace
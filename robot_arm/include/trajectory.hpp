@@ -3,6 +3,7 @@
 #include <cmath>
 #include <algorithm>
 #include <stdexcept>
+#include <functional>
 
 /*
   
@@ -36,6 +37,22 @@ struct PMPPoint {
 };  
 
 
+// ------------------------------------------------------------
+// Cooperative cancellation: planners poll should_stop() every
+// kCancelCheckBlock samples and throw PlanCancelled when it returns true.
+// ------------------------------------------------------------
+using StopPredicate = std::function<bool()>;
+constexpr int kCancelCheckBlock = 256;
+
+struct PlanCancelled : std::runtime_error {
+    PlanCancelled() : std::runtime_error("plan cancelled") {}
+};
+
+inline void check_stop(const StopPredicate& should_stop, size_t k)
+{
+    if (should_stop && (k % kCancelCheckBlock) == 0 && should_stop()) throw PlanCancelled();
+}
+
 // ------------------------------------------------------------
 // Helper: solve 6x6 linear system (Gaussian elimination with pivoting) Ax=b
 // ------------------------------------------------------------
@@ -140,6 +157,18 @@ inline std::vector<double> quintic_coeffs(double q0, double v0, double a0,
     return solve6(A, b);
 }
 
+// ------------------------------------------------------------
+// Number of samples produced by plan_minjerk() / plan_pmp_minimum_jerk():
+//   N = max(2, round(T/dt)),  samples k = 0..N
+// Cheap to evaluate, used to estimate request cost before planning.
+// ------------------------------------------------------------
+inline size_t pmp_sample_count(double T, double dt)
+{
+    const double n = std::round(T / std::max(dt, 1e-9));
+    if (!(n < 1e15)) return (size_t)1e15;   // also catches NaN
+    return (size_t)std::max(2.0, n) + 1;
+}
+
 // ------------------------------------------------------------
 // Plan min-jerk using quintic.
 // Default boundary velocities/accelerations are zero.
@@ -148,7 +177,8 @@ inline std::vector<double> quintic_coeffs(double q0, double v0, double a0,
 inline std::vector<std::vector<double>> plan_minjerk(
     const std::vector<double>& q0,
     const std::vector<double>& q1,
-    double T, double dt)
+    double T, double dt,
+    const StopPredicate& should_stop = nullptr)
 {
     const size_t dof = q0.size();
     if (q1.size() != dof) throw std::runtime_error("plan_minjerk: size mismatch");
@@ -164,6 +194,7 @@ inline std::vector<std::vector<double>> plan_minjerk(
     }
 
     for (int k = 0; k <= N; ++k) {
+        check_stop(should_stop, (size_t)k);
         double t = k * dt;
         if (t > T) t = T;
 
@@ -185,6 +216,49 @@ inline std::vector<std::vector<double>> plan_minjerk(
     return out;
 }
 
+// ------------------------------------------------------------
+// Quintic trajectory in coefficient form (no samples stored).
+// Evaluates the same polynomials as plan_pmp_minimum_jerk() at any t,
+// so a long motion can be sampled window by window on demand.
+//
+// coeffs: dof x 6, row-major: joint i uses coeffs[6*i + 0..5]
+// ------------------------------------------------------------
+struct QuinticTrajectory {
+    double T = 0.0;
+    size_t dof = 0;
+    std::vector<double> coeffs;
+};
+
+// General boundary conditions per joint (v0/a0/v1/a1 may be empty = zeros)
+inline QuinticTrajectory make_quintic_trajectory(
+    const std::vector<double>& q0, const std::vector<double>& v0, const std::vector<double>& a0,
+    const std::vector<double>& q1, const std::vector<double>& v1, const std::vector<double>& a1,
+    double T)
+{
+    const size_t dof = q0.size();
+    if (q1.size() != dof) throw std::runtime_error("make_quintic_trajectory: size mismatch");
+    auto at = [](const std::vector<double>& v, size_t i) { return i < v.size() ? v[i] : 0.0; };
+
+    QuinticTrajectory tr;
+    tr.T = T;
+    tr.dof = dof;
+    tr.coeffs.resize(dof * 6);
+    for (size_t i = 0; i < dof; ++i) {
+        auto a = quintic_coeffs(q0[i], at(v0, i), at(a0, i), q1[i], at(v1, i), at(a1, i), T);
+        std::copy(a.begin(), a.end(), tr.coeffs.begin() + 6 * i);
+    }
+    return tr;
+}
+
+// Standard rest-to-rest move: v0=a0=v1=a1=0
+inline QuinticTrajectory make_quintic_trajectory(
+    const std::vector<double>& q0,
+    const std::vector<double>& q1,
+    double T)
+{
+    return make_quintic_trajectory(q0, {}, {}, q1, {}, {}, T);
+}
+
 // ------------------------------------------------------------
 // Plan PMP minimum-jerk trajectory explicitly (quintic + derivatives).
 // Returns q, dq, ddq, u(=jerk), costates, and J_acc (accumulated cost).
@@ -221,14 +295,16 @@ inline std::vector<std::vector<double>> plan_minjerk(
 //
 // Accumulated cost (numerical approximation):
 //   J_acc(t_k) ≈ Σ_{j=0..k} (1/2) ||u(t_j)||^2 dt
+//
+// This overload samples already solved coefficients, so a caller that
+// has them (e.g. from the trajectory library) does not solve them twice.
 // ------------------------------------------------------------
 inline std::vector<PMPPoint> plan_pmp_minimum_jerk(
-    const std::vector<double>& q0,
-    const std::vector<double>& q1,
-    double T, double dt)
+    const QuinticTrajectory& tr, double dt,
+    const StopPredicate& should_stop = nullptr)
 {
-    const size_t dof = q0.size(); // DOF = degrees of freedom = number of joints
-    if (q1.size() != dof) throw std::runtime_error("plan_pmp_minimum_jerk: size mismatch");
+    const size_t dof = tr.dof; // DOF = degrees of freedom = number of joints
+    const double T = tr.T;
 
     // Number of samples N (at least 2) on [0, T] with step dt:
     //   N ≈ round(T/dt)
@@ -237,19 +313,6 @@ inline std::vector<PMPPoint> plan_pmp_minimum_jerk(
     std::vector<PMPPoint> out;
     out.reserve((size_t)N + 1);
 
-    // ------------------------------------------------------------
-    //   For each joint i, compute quintic coefficients enforcing:
-    //    q(0)=q0, dq(0)=0, ddq(0)=0
-    //    q(T)=q1, dq(T)=0, ddq(T)=0
-    //
-    // This builds a 6x6 linear system and solves:
-    //    A a = b   ⇒ a = [a0..a5]
-    // ------------------------------------------------------------
-    std::vector<std::vector<double>> coeffs(dof);
-    for (size_t i = 0; i < dof; ++i) {
-        coeffs[i] = quintic_coeffs(q0[i], 0.0, 0.0, q1[i], 0.0, 0.0, T);
-    }
-
     // ------------------------------------------------------------
     //    Initialize accumulated cost:
     //    J_acc(0) = 0
@@ -260,6 +323,8 @@ inline std::vector<PMPPoint> plan_pmp_minimum_jerk(
     //    Sample the trajectory at t_k = k*dt, k=0..N
     // ------------------------------------------------------------
     for (int k = 0; k <= N; ++k) {
+        check_stop(should_stop, (size_t)k); // abandon early if the request is cancelled
+
         double t = k * dt;
         if (t > T) t = T; // clamp last sample to exactly T
 
@@ -287,7 +352,7 @@ inline std::vector<PMPPoint> plan_pmp_minimum_jerk(
         //    and then (λ1, λ2, λ3) for PMP visibility
         // ------------------------------------------------------------
         for (size_t i = 0; i < dof; ++i) {
-            const auto& a = coeffs[i]; // a[0]..a[5]
+            const double* a = &tr.coeffs[6 * i]; // a[0]..a[5]
 
             // q_i(t) = a0 + a1 t + a2 t^2 + a3 t^3 + a4 t^4 + a5 t^5
             p.q[i] = a[0] + a[1]*tt + a[2]*tt2 + a[3]*tt3 + a[4]*tt4 + a[5]*tt5;
@@ -342,4 +407,90 @@ inline std::vector<PMPPoint> plan_pmp_minimum_jerk(
     }
 
     return out;
-}
\ No newline at end of file
+}
+
+// Rest-to-rest move from q0 to q1: for each joint i, solve quintic
+// coefficients enforcing q(0)=q0, dq(0)=ddq(0)=0, q(T)=q1, dq(T)=ddq(T)=0
+// (a 6x6 system A a = b), then sample them as above.
+inline std::vector<PMPPoint> plan_pmp_minimum_jerk(
+    const std::vector<double>& q0,
+    const std::vector<double>& q1,
+    double T, double dt,
+    const StopPredicate& should_stop = nullptr)
+{
+    if (q1.size() != q0.size()) throw std::runtime_error("plan_pmp_minimum_jerk: size mismatch");
+    return plan_pmp_minimum_jerk(make_quintic_trajectory(q0, q1, T), dt, should_stop);
+}
+
+// Evaluate q, dq, ddq, u and costates of one sample at time t (clamped to [0, T]).
+// Same formulas as plan_pmp_minimum_jerk(); p.J_acc is left untouched.
+inline void eval_pmp_point(const QuinticTrajectory& tr, double t, PMPPoint& p)
+{
+    if (t < 0.0) t = 0.0;
+    if (t > tr.T) t = tr.T;
+
+    const double tt  = t;
+    const double tt2 = tt * tt;
+    const double tt3 = tt2 * tt;
+    const double tt4 = tt3 * tt;
+    const double tt5 = tt4 * tt;
+
+    const size_t dof = tr.dof;
+    p.t = t;
+    p.q.resize(dof);
+    p.dq.resize(dof);
+    p.ddq.resize(dof);
+    p.u.resize(dof);
+    p.lambda1.resize(dof);
+    p.lambda2.resize(dof);
+    p.lambda3.resize(dof);
+
+    for (size_t i = 0; i < dof; ++i) {
+        const double* a = &tr.coeffs[6 * i];
+        p.q[i]   = a[0] + a[1]*tt + a[2]*tt2 + a[3]*tt3 + a[4]*tt4 + a[5]*tt5;
+        p.dq[i]  = a[1] + 2.0*a[2]*tt + 3.0*a[3]*tt2 + 4.0*a[4]*tt3 + 5.0*a[5]*tt4;
+        p.ddq[i] = 2.0*a[2] + 6.0*a[3]*tt + 12.0*a[4]*tt2 + 20.0*a[5]*tt3;
+        p.u[i]   = 6.0*a[3] + 24.0*a[4]*tt + 60.0*a[5]*tt2;
+
+        p.lambda3[i] = -p.u[i];
+        p.lambda2[i] = 24.0*a[4] + 120.0*a[5]*tt;
+        p.lambda1[i] = -120.0*a[5];
+    }
+}
+
+// ------------------------------------------------------------
+// Sample a time window [from, to] of a stored trajectory with step dt.
+// Samples: t_k = from + k*dt while t_k < to, plus a last sample at exactly `to`.
+// J_acc is accumulated from the start of the window (not from t=0).
+// ------------------------------------------------------------
+inline size_t window_sample_count(double from, double to, double dt)
+{
+    if (!(to > from)) return 1;
+    const double n = std::ceil((to - from) / std::max(dt, 1e-9) - 1e-9);
+    if (!(n < 1e15)) return (size_t)1e15;   // compared as double: the cast is undefined out of range
+    return (size_t)n + 1;
+}
+
+inline std::vector<PMPPoint> sample_pmp_window(const QuinticTrajectory& tr,
+                                               double from, double to, double dt,
+                                               const StopPredicate& should_stop = nullptr)
+{
+    from = std::clamp(from, 0.0, tr.T);
+    to   = std::clamp(to, from, tr.T);
+    const size_t n = window_sample_count(from, to, dt);
+
+    std::vector<PMPPoint> out(n);
+    double J_acc = 0.0;
+    for (size_t k = 0; k < n; ++k) {
+        check_stop(should_stop, k);
+        double t = (k + 1 == n) ? to : from + (double)k * dt;
+        PMPPoint& p = out[k];
+        eval_pmp_point(tr, t, p);
+
+        double u2 = 0.0;
+        for (size_t i = 0; i < tr.dof; ++i) u2 += p.u[i] * p.u[i];
+        J_acc += 0.5 * u2 * dt;
+        p.J_acc = J_acc;
+    }
+    return out;
+}
@@ -0,0 +1,368 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "plan_cache.hpp"   // PlanKey, make_plan_key, kPlanKeySchema
+#include "trajectory.hpp"   // QuinticTrajectory
+#include "memory_accounting.hpp" // memacct::Account
+
+/*
+    Precompiled trajectory library: canonical moves planned offline
+    (tools/trajlib: robot_arm_trajlib) and served by index lookup.
+
+    File layout (host byte order, little-endian on every supported target;
+    every section starts at a multiple of 64 bytes):
+
+      Header         64 bytes, see below
+      IndexRecord[]  entries x 64 bytes, sorted by key hash
+      per entry      int64 key words (make_plan_key with the header's quanta)
+                     double coeffs[dof * 6] (QuinticTrajectory layout)
+                     body: the ready-to-send /arm/plan_pmp_q response
+
+    format_version changes with the layout and key_schema with the key words
+    and hash of make_plan_key (kPlanKeySchema); readers reject files where
+    either differs, since stale keys would silently miss or hit wrong moves.
+    library_version is chosen by the compiler and only reported. checksum
+    (FNV-1a over everything after the header) is verified on open, so a
+    truncated or half-copied file is rejected instead of served.
+
+    The server maps the file read-only (MAP_SHARED: the page cache is shared
+    by every process serving the same library) and never writes it. A new
+    version must be dropped in with rename() (the compiler writes a temp
+    file and renames it): the mapping of the old inode stays valid until
+    its last reader lets go, while writing into the mapped file in place
+    would change bytes under running requests. Mapped bytes are the
+    "trajectory_library" memory account (file-backed, not heap).
+*/
+
+namespace trajlib {
+
+constexpr char kMagic[8] = {'R', 'A', 'T', 'R', 'J', 'L', 'B', '1'};
+constexpr uint16_t kFormatVersion = 2;
+constexpr size_t kAlign = 64;
+
+struct Header {
+    char magic[8];
+    uint16_t format_version;
+    uint16_t key_schema;               // kPlanKeySchema of the compiler
+    uint32_t entries;
+    uint64_t library_version;
+    double q_quantum;                  // key quanta (rad, s)
+    double t_quantum;
+    uint64_t index_offset;
+    uint64_t file_size;
+    uint64_t checksum;                 // FNV-1a 64 of bytes [sizeof(Header), file_size)
+};
+static_assert(sizeof(Header) == 64, "library header layout");
+
+struct IndexRecord {
+    uint64_t hash;                     // PlanKey::hash
+    uint64_t key_offset;
+    uint64_t coeffs_offset;
+    uint64_t body_offset;
+    uint64_t body_size;
+    double T;
+    double dt;
+    uint16_t key_words;
+    uint16_t dof;
+    uint8_t format;                    // PlanFormat of the body
+    uint8_t reserved[3];
+};
+static_assert(sizeof(IndexRecord) == 64, "library index layout");
+
+inline uint64_t fnv1a(const char *p, size_t n, uint64_t h = 0xcbf29ce484222325ULL)
+{
+    for (size_t i = 0; i < n; ++i) {
+        h ^= (uint8_t)p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// ------------------------------------------------------------
+// Builder (compiler tool): entries in memory, one image written at the end
+// ------------------------------------------------------------
+class Builder {
+public:
+    Builder(double q_quantum = 1e-6, double t_quantum = 1e-6) : q_quantum_(q_quantum), t_quantum_(t_quantum) {}
+
+    double qQuantum() const { return q_quantum_; }
+    double tQuantum() const { return t_quantum_; }
+    size_t size() const { return entries_.size(); }
+
+    // Key: make_plan_key(q0, q1, T, dt, opt, qQuantum(), tQuantum()); false if the key is already present
+    bool add(const PlanKey &key, const QuinticTrajectory &coeffs, double dt, PlanFormat format, std::string body)
+    {
+        if (!keys_.insert(key).second) return false;
+        entries_.push_back(Pending{key, coeffs, dt, format, std::move(body)});
+        return true;
+    }
+
+    std::string image(uint64_t library_version) const
+    {
+        std::vector<const Pending *> order;
+        for (const auto &e : entries_) order.push_back(&e);
+        std::sort(order.begin(), order.end(), [](const Pending *a, const Pending *b) { return a->key.hash < b->key.hash; });
+
+        std::string out(sizeof(Header), '\0');
+        pad(out);
+        const size_t index_offset = out.size();
+        out.resize(index_offset + order.size() * sizeof(IndexRecord), '\0');
+        pad(out);
+        for (size_t i = 0; i < order.size(); ++i) {
+            const Pending &e = *order[i];
+            IndexRecord r{};
+            r.hash = e.key.hash;
+            r.T = e.coeffs.T;
+            r.dt = e.dt;
+            r.key_words = (uint16_t)e.key.size();
+            r.dof = (uint16_t)e.coeffs.dof;
+            r.format = (uint8_t)e.format;
+            r.key_offset = append(out, e.key.data(), e.key.size() * sizeof(int64_t));
+            r.coeffs_offset = append(out, e.coeffs.coeffs.data(), e.coeffs.coeffs.size() * sizeof(double));
+            r.body_offset = append(out, e.body.data(), e.body.size());
+            r.body_size = e.body.size();
+            std::memcpy(&out[index_offset + i * sizeof(IndexRecord)], &r, sizeof(r));
+        }
+
+        Header h{};
+        std::memcpy(h.magic, kMagic, sizeof(kMagic));
+        h.format_version = kFormatVersion;
+        h.key_schema = kPlanKeySchema;
+        h.entries = (uint32_t)order.size();
+        h.library_version = library_version;
+        h.q_quantum = q_quantum_;
+        h.t_quantum = t_quantum_;
+        h.index_offset = index_offset;
+        h.file_size = out.size();
+        h.checksum = fnv1a(out.data() + sizeof(Header), out.size() - sizeof(Header));
+        std::memcpy(&out[0], &h, sizeof(h));
+        return out;
+    }
+
+    // Writes path.tmp, syncs it and renames it over path (readers see the old or the new file)
+    void write(const std::string &path, uint64_t library_version) const
+    {
+        const std::string data = image(library_version);
+        const std::string tmp = path + ".tmp";
+        const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) throw std::runtime_error("trajectory library: cannot create " + tmp + ": " + std::strerror(errno));
+        size_t off = 0;
+        while (off < data.size()) {
+            const ssize_t n = ::write(fd, data.data() + off, data.size() - off);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                ::close(fd);
+                throw std::runtime_error("trajectory library: cannot write " + tmp + ": " + std::strerror(errno));
+            }
+            off += (size_t)n;
+        }
+        const bool synced = ::fsync(fd) == 0;
+        ::close(fd);
+        if (!synced || std::rename(tmp.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("trajectory library: cannot replace " + path + ": " + std::strerror(errno));
+        }
+    }
+
+private:
+    struct Pending {
+        PlanKey key;
+        QuinticTrajectory coeffs;
+        double dt;
+        PlanFormat format;
+        std::string body;
+    };
+
+    static void pad(std::string &out) { out.resize((out.size() + kAlign - 1) / kAlign * kAlign, '\0'); }
+
+    static uint64_t append(std::string &out, const void *p, size_t n)
+    {
+        const uint64_t at = out.size();
+        out.append(static_cast<const char *>(p), n);
+        pad(out);
+        return at;
+    }
+
+    double q_quantum_, t_quantum_;
+    std::vector<Pending> entries_;
+    std::unordered_set<PlanKey, PlanKeyHash> keys_;   // duplicate check of add()
+};
+
+// ------------------------------------------------------------
+// Library (server): read-only mapping of one file version
+// ------------------------------------------------------------
+// Identity of the file behind a path (a rename in place changes the inode)
+struct FileId {
+    uint64_t dev = 0, ino = 0, size = 0;
+    int64_t mtime_ns = 0;
+    bool operator==(const FileId &o) const
+    {
+        return dev == o.dev && ino == o.ino && size == o.size && mtime_ns == o.mtime_ns;
+    }
+    bool operator!=(const FileId &o) const { return !(*this == o); }
+};
+
+// false if the path does not exist (or cannot be stat'ed)
+inline bool fileId(const std::string &path, FileId &out)
+{
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) return false;
+    out.dev = (uint64_t)st.st_dev;
+    out.ino = (uint64_t)st.st_ino;
+    out.size = (uint64_t)st.st_size;
+    out.mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+class Library {
+public:
+    // One entry, pointing into the mapping (valid while the Library is alive)
+    struct Entry {
+        const char *body = nullptr;
+        size_t body_size = 0;
+        PlanFormat format = PlanFormat::Json;
+        double T = 0.0;
+        double dt = 0.0;
+        size_t dof = 0;
+        const double *coeffs = nullptr;   // dof * 6
+
+        QuinticTrajectory trajectory() const
+        {
+            QuinticTrajectory tr;
+            tr.T = T;
+            tr.dof = dof;
+            tr.coeffs.assign(coeffs, coeffs + dof * 6);
+            return tr;
+        }
+    };
+
+    // Maps and validates path; throws std::runtime_error on any inconsistency
+    static std::shared_ptr<const Library> open(const std::string &path)
+    {
+        std::shared_ptr<Library> lib(new Library());
+        lib->path_ = path;
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw std::runtime_error("trajectory library: cannot open " + path + ": " + std::strerror(errno));
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(Header)) {
+            ::close(fd);
+            throw std::runtime_error("trajectory library: " + path + " is too short");
+        }
+        lib->size_ = (size_t)st.st_size;
+        void *p = ::mmap(nullptr, lib->size_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);   // the mapping keeps the inode
+        if (p == MAP_FAILED) throw std::runtime_error("trajectory library: cannot map " + path + ": " + std::strerror(errno));
+        lib->base_ = static_cast<const char *>(p);
+        ::madvise(p, lib->size_, MADV_WILLNEED);
+        lib->validate();
+        lib->mem_.add((int64_t)lib->size_);
+        return lib;
+    }
+
+    ~Library()
+    {
+        if (base_) ::munmap(const_cast<char *>(base_), size_);
+        mem_.sub(mem_.bytes());
+    }
+
+    Library(const Library &) = delete;
+    Library &operator=(const Library &) = delete;
+
+    const std::string &path() const { return path_; }
+    uint64_t version() const { return header().library_version; }
+    size_t entries() const { return header().entries; }
+    size_t bytes() const { return size_; }
+
+    // Key of a request in this library's quanta
+    PlanKey key(const std::vector<double> &q0, const std::vector<double> &q1, double T, double dt,
+                const PlanOptions &opt) const
+    {
+        return make_plan_key(q0, q1, T, dt, opt, header().q_quantum, header().t_quantum);
+    }
+
+    // Binary search by hash, then exact key words; no allocation
+    bool find(const PlanKey &k, Entry &out) const
+    {
+        const IndexRecord *first = index();
+        const IndexRecord *last = first + header().entries;
+        const IndexRecord *it = std::lower_bound(first, last, k.hash,
+                                                 [](const IndexRecord &r, uint64_t h) { return r.hash < h; });
+        for (; it != last && it->hash == k.hash; ++it) {
+            if (it->key_words != k.size() ||
+                std::memcmp(base_ + it->key_offset, k.data(), k.size() * sizeof(int64_t)) != 0) {
+                continue;
+            }
+            out.body = base_ + it->body_offset;
+            out.body_size = (size_t)it->body_size;
+            out.format = (PlanFormat)it->format;
+            out.T = it->T;
+            out.dt = it->dt;
+            out.dof = it->dof;
+            out.coeffs = reinterpret_cast<const double *>(base_ + it->coeffs_offset);
+            return true;
+        }
+        return false;
+    }
+
+private:
+    Library() = default;
+
+    const Header &header() const { return *reinterpret_cast<const Header *>(base_); }
+    const IndexRecord *index() const { return reinterpret_cast<const IndexRecord *>(base_ + header().index_offset); }
+
+    void validate() const
+    {
+        auto fail = [this](const std::string &why) {
+            throw std::runtime_error("trajectory library: " + path_ + ": " + why);
+        };
+        const Header &h = header();
+        if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) fail("not a trajectory library");
+        if (h.format_version != kFormatVersion) {
+            fail("format version " + std::to_string(h.format_version) + ", expected " + std::to_string(kFormatVersion));
+        }
+        if (h.key_schema != kPlanKeySchema) {
+            fail("key schema " + std::to_string(h.key_schema) + ", expected " + std::to_string(kPlanKeySchema) +
+                 " (recompile the library)");
+        }
+        if (!(h.q_quantum > 0.0) || !std::isfinite(h.q_quantum) || !(h.t_quantum > 0.0) || !std::isfinite(h.t_quantum)) {
+            fail("key quanta must be finite and > 0");
+        }
+        if (h.file_size != size_) fail("truncated (" + std::to_string(size_) + " of " + std::to_string(h.file_size) + " bytes)");
+        if (h.index_offset % kAlign || h.index_offset > size_ ||
+            (size_ - h.index_offset) / sizeof(IndexRecord) < h.entries) {
+            fail("bad index");
+        }
+        if (fnv1a(base_ + sizeof(Header), size_ - sizeof(Header)) != h.checksum) fail("checksum mismatch");
+
+        auto inside = [this](uint64_t off, uint64_t n) { return off % 8 == 0 && off <= size_ && n <= size_ - off; };
+        const IndexRecord *r = index();
+        for (uint32_t i = 0; i < h.entries; ++i) {
+            if (i && r[i].hash < r[i - 1].hash) fail("index not sorted");
+            if (!inside(r[i].key_offset, (uint64_t)r[i].key_words * sizeof(int64_t)) ||
+                !inside(r[i].coeffs_offset, (uint64_t)r[i].dof * 6 * sizeof(double)) ||
+                !inside(r[i].body_offset, r[i].body_size)) {
+                fail("entry " + std::to_string(i) + " out of bounds");
+            }
+        }
+    }
+
+    std::string path_;
+    const char *base_ = nullptr;
+    size_t size_ = 0;
+    memacct::Account mem_{"trajectory_library"};
+};
+
+} // namespace trajlib
@@ -0,0 +1,241 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <algorithm>
+
+#include "trajectory.hpp"   // QuinticTrajectory
+#include "memory_accounting.hpp" // memacct::Account
+
+/*
+    Server-side storage of planned trajectories as coefficients only.
+
+    Slots live in one arena: slot metadata in `slots_`, coefficients in
+    `coeffs_` with a fixed stride of max_dof*6 doubles per slot.
+    Memory per stored trajectory is constant, independent of T/dt.
+
+    Id = (generation << 32) | slot. A reused slot bumps its generation,
+    so stale ids never resolve to a newer trajectory.
+
+    Entries expire `ttl` after their last access; expired slots are
+    reclaimed lazily (on access and on insert).
+
+    The arena capacity is the "trajectory_store" memory account; it only
+    grows (freed slots are reused, never returned).
+*/
+
+class TrajectoryStore {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        uint64_t entries = 0;
+        uint64_t capacity = 0;
+        uint64_t arena_bytes = 0;
+        uint64_t stored = 0;
+        uint64_t expired = 0;
+        uint64_t rejected = 0;   // store full
+    };
+
+    struct Entry {
+        QuinticTrajectory traj;
+        double dt = 0.02;        // sampling step used when the plan was requested
+    };
+
+    TrajectoryStore(size_t max_entries, double ttl_seconds, size_t max_dof = 6)
+        : max_entries_(max_entries),
+          max_dof_(max_dof),
+          stride_(max_dof * 6),
+          ttl_(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(ttl_seconds)))
+    {
+    }
+
+    // Returns the new id, or 0 if the store is full (after reclaiming expired slots)
+    uint64_t put(const QuinticTrajectory& tr, double dt)
+    {
+        if (tr.dof > max_dof_ || tr.coeffs.size() != tr.dof * 6) return 0;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto now = Clock::now();
+
+        uint32_t slot;
+        if (!acquireSlot(now, slot)) {
+            ++rejected_;
+            return 0;
+        }
+
+        Slot& s = slots_[slot];
+        s.used = true;
+        s.dof = (uint16_t)tr.dof;
+        s.T = tr.T;
+        s.dt = dt;
+        s.expires = now + ttl_;
+        std::copy(tr.coeffs.begin(), tr.coeffs.end(), coeffs_.begin() + (size_t)slot * stride_);
+
+        ++entries_;
+        ++stored_;
+        return ((uint64_t)s.generation << 32) | slot;
+    }
+
+    // Copies the trajectory out and refreshes its TTL; false if unknown or expired
+    bool get(uint64_t id, Entry& out)
+    {
+        const uint32_t slot = (uint32_t)(id & 0xffffffffu);
+        const uint32_t gen  = (uint32_t)(id >> 32);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (slot >= slots_.size()) return false;
+        Slot& s = slots_[slot];
+        if (!s.used || s.generation != gen) return false;
+
+        const auto now = Clock::now();
+        if (s.expires <= now) {
+            release(slot);
+            ++expired_;
+            return false;
+        }
+        s.expires = now + ttl_;
+
+        out.traj.T = s.T;
+        out.traj.dof = s.dof;
+        out.traj.coeffs.assign(coeffs_.begin() + (size_t)slot * stride_,
+                               coeffs_.begin() + (size_t)slot * stride_ + (size_t)s.dof * 6);
+        out.dt = s.dt;
+        return true;
+    }
+
+    bool erase(uint64_t id)
+    {
+        const uint32_t slot = (uint32_t)(id & 0xffffffffu);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (slot >= slots_.size()) return false;
+        if (!slots_[slot].used || slots_[slot].generation != (uint32_t)(id >> 32)) return false;
+        release(slot);
+        return true;
+    }
+
+    // Reclaims all expired slots; returns how many were reclaimed
+    size_t evictExpired()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return sweep(Clock::now());
+    }
+
+    Stats stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats st;
+        st.entries = entries_;
+        st.capacity = max_entries_;
+        st.arena_bytes = arenaBytes();
+        st.stored = stored_;
+        st.expired = expired_;
+        st.rejected = rejected_;
+        return st;
+    }
+
+    double ttlSeconds() const { return std::chrono::duration<double>(ttl_).count(); }
+
+    static std::string formatId(uint64_t id)
+    {
+        char buf[17];
+        std::snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)id);
+        return std::string(buf, 16);
+    }
+
+    static bool parseId(const std::string& s, uint64_t& id)
+    {
+        if (s.empty() || s.size() > 16) return false;
+        uint64_t v = 0;
+        for (char c : s) {
+            int d;
+            if (c >= '0' && c <= '9') d = c - '0';
+            else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+            else return false;
+            v = (v << 4) | (uint64_t)d;
+        }
+        id = v;
+        return true;
+    }
+
+private:
+    struct Slot {
+        uint32_t generation = 1;
+        uint16_t dof = 0;
+        bool used = false;
+        double T = 0.0;
+        double dt = 0.0;
+        Clock::time_point expires;
+    };
+
+    bool acquireSlot(Clock::time_point now, uint32_t& slot)
+    {
+        if (free_.empty() && slots_.size() >= max_entries_) {
+            if (sweep(now) == 0) return false;
+        } else if (now - last_sweep_ > std::chrono::seconds(1)) {
+            sweep(now);
+        }
+
+        if (!free_.empty()) {
+            slot = free_.back();
+            free_.pop_back();
+            return true;
+        }
+        slot = (uint32_t)slots_.size();
+        slots_.emplace_back();
+        coeffs_.resize(slots_.size() * stride_, 0.0);
+        mem_.set((int64_t)arenaBytes());
+        return true;
+    }
+
+    size_t arenaBytes() const
+    {
+        return slots_.capacity() * sizeof(Slot) + coeffs_.capacity() * sizeof(double)
+             + free_.capacity() * sizeof(uint32_t);
+    }
+
+    size_t sweep(Clock::time_point now)
+    {
+        last_sweep_ = now;
+        size_t n = 0;
+        for (uint32_t i = 0; i < (uint32_t)slots_.size(); ++i) {
+            if (slots_[i].used && slots_[i].expires <= now) {
+                release(i);
+                ++n;
+            }
+        }
+        expired_ += n;
+        return n;
+    }
+
+    void release(uint32_t slot)
+    {
+        Slot& s = slots_[slot];
+        s.used = false;
+        ++s.generation;
+        free_.push_back(slot);
+        --entries_;
+        mem_.set((int64_t)arenaBytes());
+    }
+
+    const size_t max_entries_;
+    const size_t max_dof_;
+    const size_t stride_;
+    const Clock::duration ttl_;
+
+    mutable std::mutex mutex_;
+    std::vector<Slot> slots_;
+    std::vector<double> coeffs_;   // arena: stride_ doubles per slot
+    std::vector<uint32_t> free_;
+    Clock::time_point last_sweep_{};
+
+    uint64_t entries_ = 0;
+    uint64_t stored_ = 0;
+    uint64_t expired_ = 0;
+    uint64_t rejected_ = 0;
+    memacct::Account mem_{"trajectory_store"};   // arena capacity
+};
@@ -0,0 +1,148 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+/*
+    Startup readiness: the warm-up phases and how long reaching /ready took.
+
+    The server starts in "starting"; the warm-up thread runs its phases in
+    sequence and records each one:
+
+        {
+            Readiness::Phase p(readiness, "prefill", moves.size());
+            ... readiness.step() per item done (any thread) ...
+        }   // phase duration recorded
+
+    then calls markReady(). Readers (/ready, /metrics, the request gate) only
+    load atomics, except for the phase list which is copied under a mutex.
+
+    Time to ready is measured from the creation of the Readiness object and,
+    when /proc is available, from the start of the process (includes loading
+    the binary, the config file and the framework before the controllers).
+*/
+
+class Readiness {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct PhaseRecord {
+        std::string name;
+        double seconds = 0.0;
+        uint64_t items = 0;
+    };
+
+    struct Snapshot {
+        bool ready = false;
+        std::string phase;                 // current phase ("" once ready)
+        uint64_t done = 0, total = 0;      // progress of the current phase
+        std::vector<PhaseRecord> phases;   // finished, in order
+        double time_to_ready_s = 0.0;      // since this object was created (0 until ready)
+        double process_time_to_ready_s = -1.0;   // since process start (-1: unknown)
+    };
+
+    Readiness() : start_(Clock::now()), process_age_at_start_(processAgeSeconds()) {}
+
+    Readiness(const Readiness &) = delete;
+    Readiness &operator=(const Readiness &) = delete;
+
+    // RAII phase bracket (warm-up thread)
+    class Phase {
+    public:
+        Phase(Readiness &r, const char *name, uint64_t total = 0) : r_(r), begin_(Clock::now())
+        {
+            std::lock_guard<std::mutex> lock(r_.mutex_);
+            r_.phase_ = name;
+            r_.done_.store(0, std::memory_order_relaxed);
+            r_.total_.store(total, std::memory_order_relaxed);
+        }
+        ~Phase()
+        {
+            PhaseRecord rec;
+            rec.seconds = std::chrono::duration<double>(Clock::now() - begin_).count();
+            rec.items = r_.done_.load(std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(r_.mutex_);
+            rec.name = r_.phase_;
+            r_.phases_.push_back(std::move(rec));
+        }
+        Phase(const Phase &) = delete;
+        Phase &operator=(const Phase &) = delete;
+
+    private:
+        Readiness &r_;
+        Clock::time_point begin_;
+    };
+
+    // Any thread: one item of the current phase done
+    void step() { done_.fetch_add(1, std::memory_order_relaxed); }
+
+    // Phase measured elsewhere (e.g. the controller constructor, before the warm-up thread)
+    void addPhase(const std::string &name, double seconds)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        phases_.push_back(PhaseRecord{name, seconds, 0});
+    }
+
+    void markReady()
+    {
+        const double s = std::chrono::duration<double>(Clock::now() - start_).count();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            phase_.clear();
+            time_to_ready_s_ = s;
+        }
+        ready_.store(true, std::memory_order_release);
+    }
+
+    bool ready() const { return ready_.load(std::memory_order_acquire); }
+
+    Snapshot snapshot() const
+    {
+        Snapshot s;
+        s.ready = ready();
+        s.done = done_.load(std::memory_order_relaxed);
+        s.total = total_.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex_);
+        s.phase = s.ready ? std::string() : phase_;
+        s.phases = phases_;
+        s.time_to_ready_s = time_to_ready_s_;
+        if (s.ready && process_age_at_start_ >= 0.0) {
+            s.process_time_to_ready_s = process_age_at_start_ + time_to_ready_s_;
+        }
+        return s;
+    }
+
+    // Seconds since this process started (Linux: /proc/self/stat start time vs /proc/uptime; -1 elsewhere)
+    static double processAgeSeconds()
+    {
+        std::ifstream uptime_in("/proc/uptime"), stat_in("/proc/self/stat");
+        double uptime = 0.0;
+        std::string stat;
+        if (!(uptime_in >> uptime) || !std::getline(stat_in, stat)) return -1.0;
+        // Field 22 (starttime, clock ticks after boot) counted after the ")" closing the command name
+        size_t pos = stat.rfind(')');
+        if (pos == std::string::npos) return -1.0;
+        for (int field = 2; field < 22 && pos != std::string::npos; ++field) pos = stat.find(' ', pos + 1);
+        if (pos == std::string::npos) return -1.0;
+        const double ticks = std::strtod(stat.c_str() + pos + 1, nullptr);
+        const long hz = ::sysconf(_SC_CLK_TCK);
+        return hz > 0 ? uptime - ticks / (double)hz : -1.0;
+    }
+
+private:
+    const Clock::time_point start_;
+    const double process_age_at_start_;
+    std::atomic<bool> ready_{false};
+    std::atomic<uint64_t> done_{0}, total_{0};
+
+    mutable std::mutex mutex_;
+    std::string phase_ = "starting";
+    std::vector<PhaseRecord> phases_;
+    double time_to_ready_s_ = 0.0;
+};
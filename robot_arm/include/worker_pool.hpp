@@ -0,0 +1,133 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "memory_accounting.hpp" // memacct::Account
+
+/*
+    Fixed-size pool of worker threads for compute-heavy planning.
+    Tasks are run in FIFO order; the destructor drains the queue and joins.
+
+    max_queue bounds trySubmit() (0 = unbounded); submit() always enqueues.
+    cpus pins worker i to cpus[i % cpus.size()] (Linux only, ignored elsewhere).
+
+    Waiting tasks are the "worker_queue" memory account, at kTaskBytes each
+    (the std::function plus a typical heap-allocated capture; what the
+    capture points to is accounted by its owner).
+*/
+
+class WorkerPool {
+public:
+    using Task = std::function<void()>;
+
+    static constexpr size_t kTaskBytes = sizeof(Task) + 64;
+
+    // threads == 0: one worker per hardware thread
+    explicit WorkerPool(size_t threads, size_t max_queue = 0, std::vector<int> cpus = {})
+        : max_queue_(max_queue)
+    {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        workers_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back([this] { run(); });
+            if (!cpus.empty()) pin(workers_.back(), cpus[i % cpus.size()]);
+        }
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        for (auto &t : workers_) t.join();
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    void submit(Task task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(std::move(task));
+            setDepth(queue_.size());
+        }
+        cv_.notify_one();
+    }
+
+    // Enqueues unless max_queue tasks are already waiting; false means rejected
+    bool trySubmit(Task task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (max_queue_ && queue_.size() >= max_queue_) return false;
+            queue_.push_back(std::move(task));
+            setDepth(queue_.size());
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    size_t size() const { return workers_.size(); }
+    size_t maxQueue() const { return max_queue_; }
+
+    // Tasks waiting to be picked up by a worker
+    size_t queueDepth() const { return depth_.load(std::memory_order_relaxed); }
+
+private:
+    static void pin(std::thread &t, int cpu)
+    {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+#else
+        (void)t;
+        (void)cpu;
+#endif
+    }
+
+    void setDepth(size_t n)
+    {
+        depth_.store(n, std::memory_order_relaxed);
+        mem_.set((int64_t)(n * kTaskBytes));
+    }
+
+    void run()
+    {
+        for (;;) {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) return; // stopping and drained
+                task = std::move(queue_.front());
+                queue_.pop_front();
+                setDepth(queue_.size());
+            }
+            task();
+        }
+    }
+
+    const size_t max_queue_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Task> queue_;
+    std::atomic<size_t> depth_{0};
+    memacct::Account mem_{"worker_queue"};
+    bool stopping_ = false;
+};
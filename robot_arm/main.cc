@@ -1,12 +1,20 @@
 #include <drogon/drogon.h>
+#include <memory>
 #include "controllers/ArmController.h"
+#include "controllers/JogController.h"
+
+int main(int argc, char *argv[]) {
+    // Optional config file: ./robot_arm ../config.json
+    // (backend settings live in its "custom_config" section)
+    if (argc > 1) drogon::app().loadConfigFile(argv[1]);
 
-int main() {
     drogon::app().addListener("0.0.0.0", 8848);
+
+    // Controllers read custom_config, so they are created after the config is loaded.
+    // Shared state is passed explicitly: the jog channel drives ArmController's engine.
+    auto arm = std::make_shared<ArmController>();
+    drogon::app().registerController(arm);
+    drogon::app().registerController(std::make_shared<JogController>(arm->engine(), arm->recorder()));
     drogon::app().run();
     return 0;
 }
-
-
-
-
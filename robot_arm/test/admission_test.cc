@@ -0,0 +1,67 @@
+#include <drogon/drogon_test.h>
+#include <thread>
+
+#include "admission.hpp"
+
+static AdmissionControl::Config config(uint64_t budget, size_t queue = 2, double wait_s = 5.0)
+{
+    AdmissionControl::Config c;
+    c.budget_bytes = budget;
+    c.max_request_bytes = budget;
+    c.max_queue = queue;
+    c.max_wait_s = wait_s;
+    return c;
+}
+
+DROGON_TEST(AdmissionDecisions)
+{
+    using D = AdmissionControl::Decision;
+    AdmissionControl ac(config(100, 1));
+    CHECK(ac.acquire(101, nullptr) == D::TooLarge);
+    CHECK(ac.acquire(60, nullptr) == D::Admitted);
+    CHECK(ac.acquire(60, [](bool) {}) == D::Queued);
+    CHECK(ac.acquire(10, nullptr) == D::Rejected);   // fits, but must not overtake the queue
+
+    const auto st = ac.stats();
+    CHECK(st.in_flight_bytes == 60 && st.queue_depth == 1);
+    CHECK(st.admitted == 1 && st.queued == 1 && st.rejected_queue_full == 1 && st.rejected_too_large == 1);
+}
+
+DROGON_TEST(AdmissionReleaseAdmitsInOrder)
+{
+    using D = AdmissionControl::Decision;
+    AdmissionControl ac(config(100, 4));
+    std::vector<int> order;
+    CHECK(ac.acquire(100, nullptr) == D::Admitted);
+    CHECK(ac.acquire(50, [&order](bool ok) { order.push_back(ok ? 1 : -1); }) == D::Queued);
+    CHECK(ac.acquire(50, [&order](bool ok) { order.push_back(ok ? 2 : -2); }) == D::Queued);
+    CHECK(ac.acquire(10, [&order](bool ok) { order.push_back(ok ? 3 : -3); }) == D::Queued);
+
+    ac.release(100);
+    CHECK((order == std::vector<int>{1, 2}));
+    ac.release(50);
+    CHECK((order == std::vector<int>{1, 2, 3}));
+    CHECK(ac.stats().in_flight_bytes == 60);
+}
+
+DROGON_TEST(AdmissionQueueTimeout)
+{
+    AdmissionControl ac(config(100, 4, 0.01));
+    int result = 0;
+    ac.acquire(100, nullptr);
+    ac.acquire(50, [&result](bool ok) { result = ok ? 1 : -1; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ac.expire();
+    CHECK(result == -1);
+    CHECK(ac.stats().timed_out == 1 && ac.stats().queue_depth == 0);
+}
+
+DROGON_TEST(AdmissionEstimates)
+{
+    PlanOptions json, bin;
+    bin.format = PlanFormat::Binary;
+    CHECK(estimate_plan_bytes(100, 6, json) > estimate_plan_bytes(100, 6, bin));
+    CHECK(estimate_plan_bytes(200, 6, json) > estimate_plan_bytes(100, 6, json));
+    CHECK(estimate_plan_bytes(SIZE_MAX, 6, json) == UINT64_MAX);
+    CHECK(estimate_plan_body_bytes(100, 6, bin) < estimate_plan_bytes(100, 6, bin));
+}
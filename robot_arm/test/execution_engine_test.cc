@@ -0,0 +1,130 @@
+#include <drogon/drogon_test.h>
+#include <cmath>
+
+#include "execution_engine.hpp"
+
+using Clock = ExecutionEngine::Clock;
+
+static ExecutionEngine::Config config()
+{
+    ExecutionEngine::Config c;
+    c.max_robots = 4;
+    c.dof = 2;
+    c.tick_s = 0.01;
+    return c;
+}
+
+static std::chrono::nanoseconds sec(double s) { return std::chrono::nanoseconds((int64_t)(s * 1e9)); }
+
+DROGON_TEST(ExecutionEngineMoveAndComplete)
+{
+    ExecutionEngine engine(config());
+    const auto t0 = Clock::now();
+    ExecutionEngine::Snapshot s;
+    REQUIRE(engine.state(0, t0, s));
+    CHECK(s.status == ExecutionEngine::Status::Idle && s.q == std::vector<double>({0.0, 0.0}));
+    CHECK(!engine.state(4, t0, s));
+    CHECK(engine.moveTo(4, {1.0, 1.0}, 1.0, t0) == ExecutionEngine::Result::UnknownRobot);
+
+    uint64_t seq = 0;
+    CHECK(engine.moveTo(0, {1.0, -1.0}, 1.0, t0, &seq) == ExecutionEngine::Result::Ok);
+    CHECK(seq > 0);
+    std::vector<double> target;
+    REQUIRE(engine.target(0, target));
+    CHECK(std::fabs(target[0] - 1.0) < 1e-9 && std::fabs(target[1] + 1.0) < 1e-9);
+
+    engine.state(0, t0 + sec(0.5), s);
+    CHECK(s.status == ExecutionEngine::Status::Moving);
+    CHECK(std::fabs(s.q[0] - 0.5) < 1e-9 && s.dq[0] > 0.0);   // symmetric quintic: halfway at T/2
+
+    engine.advance(t0 + sec(1.05));
+    engine.state(0, t0 + sec(1.1), s);
+    CHECK(s.status == ExecutionEngine::Status::Idle);
+    CHECK(std::fabs(s.q[0] - 1.0) < 1e-9 && s.dq[0] == 0.0);
+    CHECK(engine.stats().started == 1 && engine.stats().completed == 1);
+}
+
+DROGON_TEST(ExecutionEngineExecuteChecksStart)
+{
+    ExecutionEngine engine(config());
+    const auto t0 = Clock::now();
+    const auto away = make_quintic_trajectory({0.5, 0.0}, {1.0, 0.0}, 1.0);
+    CHECK(engine.execute(0, away, t0) == ExecutionEngine::Result::StartMismatch);
+    const auto home = make_quintic_trajectory({0.0, 0.0}, {1.0, 0.0}, 1.0);
+    CHECK(engine.execute(0, home, t0) == ExecutionEngine::Result::Ok);
+    CHECK(engine.execute(0, home, t0 + sec(0.1)) == ExecutionEngine::Result::StartMismatch);   // moving
+    const auto wrong_dof = make_quintic_trajectory({0.0}, {1.0}, 1.0);
+    CHECK(engine.follow(1, wrong_dof, t0) == ExecutionEngine::Result::StartMismatch);
+}
+
+DROGON_TEST(ExecutionEngineStop)
+{
+    ExecutionEngine engine(config());
+    const auto t0 = Clock::now();
+    engine.moveTo(0, {2.0, 0.0}, 1.0, t0);
+    const auto t1 = t0 + sec(0.5);
+    ExecutionEngine::Snapshot before, after;
+    engine.state(0, t1, before);
+    CHECK(engine.stop(0, t1) == ExecutionEngine::Result::Ok);
+    engine.state(0, t1, after);
+    CHECK(after.status == ExecutionEngine::Status::Stopping);
+    CHECK(std::fabs(after.q[0] - before.q[0]) < 1e-9 && std::fabs(after.dq[0] - before.dq[0]) < 1e-9);
+
+    const double Ts = engine.config().stop_time_s;
+    engine.advance(t1 + sec(Ts + 0.05));
+    engine.state(0, t1 + sec(Ts + 0.1), after);
+    CHECK(after.status == ExecutionEngine::Status::Idle && after.q[0] < 2.0);
+    CHECK(engine.stats().stopped == 1);
+}
+
+DROGON_TEST(ExecutionEngineSpeedOverride)
+{
+    auto cfg = config();
+    cfg.min_speed = 0.0;                  // clamped to kMinSpeed
+    ExecutionEngine engine(cfg);
+    CHECK(engine.config().min_speed == ExecutionEngine::kMinSpeed);
+
+    const auto t0 = Clock::now();
+    engine.moveTo(0, {1.0, 0.0}, 1.0, t0);
+    engine.setSpeed(0, 0.5, t0 + sec(0.2));
+    ExecutionEngine::Snapshot s;
+    engine.state(0, t0 + sec(1.0), s);   // ramp over: s = 0.2 + 0.15 + 0.5 * 0.6
+    CHECK(s.speed == 0.5 && std::fabs(s.rate - 0.5) < 1e-9);
+    CHECK(s.status == ExecutionEngine::Status::Moving && s.t < s.T);
+
+    engine.advance(t0 + sec(1.05));       // nominal end: rescheduled, still moving
+    engine.state(0, t0 + sec(1.1), s);
+    CHECK(s.status == ExecutionEngine::Status::Moving);
+
+    engine.setSpeed(0, 10.0, t0 + sec(1.1));   // clamped to max_speed
+    engine.state(0, t0 + sec(1.1), s);
+    CHECK(s.speed == engine.config().max_speed);
+}
+
+DROGON_TEST(ExecutionEngineFollowAnsweredPlans)
+{
+    ExecutionEngine engine(config());
+    const auto t0 = Clock::now();
+    engine.setSpeed(0, 0.5, t0);
+
+    // At rest at the plan's start: the plan runs as is at rate 1, whatever the override
+    const auto plan = make_quintic_trajectory({0.0, 0.0}, {1.0, 0.0}, 1.0);
+    CHECK(engine.follow(0, plan, t0) == ExecutionEngine::Result::Ok);
+    ExecutionEngine::Snapshot s;
+    engine.state(0, t0 + sec(0.25), s);
+    PMPPoint p;
+    eval_pmp_point(plan, 0.25, p);
+    CHECK(s.rate == 1.0 && std::fabs(s.q[0] - p.q[0]) < 1e-9);
+
+    // Mid-move: blends from the current state to the new plan's end, no jump
+    ExecutionEngine::Snapshot before, after;
+    const auto t1 = t0 + sec(0.5);
+    engine.state(0, t1, before);
+    const auto next = make_quintic_trajectory({1.0, 0.0}, {1.0, 2.0}, 1.0);
+    CHECK(engine.follow(0, next, t1) == ExecutionEngine::Result::Ok);
+    engine.state(0, t1, after);
+    CHECK(std::fabs(after.q[0] - before.q[0]) < 1e-9 && std::fabs(after.dq[0] - before.dq[0]) < 1e-9);
+    std::vector<double> target;
+    engine.target(0, target);
+    CHECK(std::fabs(target[0] - 1.0) < 1e-9 && std::fabs(target[1] - 2.0) < 1e-9);
+}
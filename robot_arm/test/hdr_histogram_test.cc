@@ -0,0 +1,36 @@
+#include <drogon/drogon_test.h>
+
+#include "hdr_histogram.hpp"
+
+DROGON_TEST(HdrHistogramPercentiles)
+{
+    HdrHistogram h;
+    CHECK(h.percentile(50.0) == 0 && h.min() == 0);
+    for (uint64_t v = 1; v <= 1000; ++v) h.record(v);
+    CHECK(h.count() == 1000 && h.min() == 1 && h.max() == 1000);
+    CHECK(h.mean() == 500.5);
+    CHECK(h.percentile(50.0) == 500);      // exact below 2048
+    CHECK(h.percentile(99.0) == 990);
+    CHECK(h.percentile(100.0) == 1000);
+}
+
+DROGON_TEST(HdrHistogramPrecision)
+{
+    HdrHistogram h;
+    const uint64_t v = 123456789;
+    h.record(v);
+    const uint64_t p = h.percentile(50.0);
+    CHECK(p == v);                         // capped at the recorded max
+    h.record(v - 1000);
+    const uint64_t low = h.percentile(50.0);
+    CHECK(low >= v - 1000 && (double)(low - (v - 1000)) <= 0.001 * (double)v);
+
+    HdrHistogram small(10000);
+    small.record(50000);                   // clamped to highest, still counted
+    CHECK(small.count() == 1 && small.max() == 10000);
+
+    HdrHistogram merged;
+    merged.merge(h);
+    merged.merge(small);
+    CHECK(merged.count() == 3 && merged.min() == 10000 && merged.max() == v);
+}
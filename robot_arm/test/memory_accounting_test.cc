@@ -0,0 +1,59 @@
+#include <drogon/drogon_test.h>
+#include <string>
+
+#include "memory_accounting.hpp"
+
+static const memacct::Usage *find(const std::vector<memacct::Usage> &all, const std::string &name)
+{
+    for (const auto &u : all) {
+        if (u.name == name) return &u;
+    }
+    return nullptr;
+}
+
+DROGON_TEST(MemoryAccountCounts)
+{
+    memacct::Account a("test_account");
+    a.add(100);
+    a.add(50);
+    a.sub(120);
+    CHECK(a.bytes() == 30 && a.highWater() == 150);
+    a.set(10);
+    CHECK(a.bytes() == 10 && a.highWater() == 150);
+    a.set(200);
+    CHECK(a.highWater() == 200);
+}
+
+DROGON_TEST(MemoryAccountLimitAlerts)
+{
+    memacct::Account::setLimit("test_limited", 100);
+    memacct::Account a("test_limited");
+    CHECK(a.limit() == 100);
+    a.add(80);
+    a.add(40);                             // crosses the limit
+    a.add(10);                             // already above: no new alert
+    CHECK(a.alerts() == 1);
+    a.sub(100);
+    a.set(150);                            // crosses again
+    CHECK(a.alerts() == 2);
+    memacct::Account::setLimit("test_limited", 0);
+    CHECK(a.limit() == 0);
+}
+
+DROGON_TEST(MemoryUsageSumsPerName)
+{
+    {
+        memacct::Account a("test_summed"), b("test_summed");
+        a.add(10);
+        b.add(32);
+        const auto all = memacct::usage();
+        const memacct::Usage *u = find(all, "test_summed");
+        REQUIRE(u != nullptr);
+        CHECK(u->bytes == 42);
+
+        std::string out;
+        memacct::writeMemoryMetrics(out);
+        CHECK(out.find("robot_arm_memory_bytes{account=\"test_summed\"} 42") != std::string::npos);
+    }
+    CHECK(find(memacct::usage(), "test_summed") == nullptr);   // unregistered on destruction
+}
@@ -0,0 +1,80 @@
+#include <drogon/drogon_test.h>
+#include <stdexcept>
+
+#include "plan_cache.hpp"
+
+static PlanCache::Body body(size_t n) { return std::make_shared<const std::string>(n, 'x'); }
+
+static PlanKey key(double q, double T = 1.0)
+{
+    return make_plan_key({0, 0, 0, 0, 0, 0}, {q, 0, 0, 0, 0, 0}, T, 0.02, PlanOptions{});
+}
+
+DROGON_TEST(PlanKeyQuantization)
+{
+    CHECK(key(0.5) == key(0.5 + 1e-8));       // below the quantum: same entry
+    CHECK(!(key(0.5) == key(0.5 + 1e-5)));
+    CHECK(!(key(0.5, 1.0) == key(0.5, 2.0)));
+    PlanOptions bin;
+    bin.format = PlanFormat::Binary;
+    CHECK(!(make_plan_key({0}, {1}, 1.0, 0.02, PlanOptions{}) == make_plan_key({0}, {1}, 1.0, 0.02, bin)));
+
+    CHECK_THROWS_AS(make_plan_key({0, 0, 0, 0, 0, 0, 0}, {0}, 1.0, 0.02, PlanOptions{}), std::invalid_argument);
+    CHECK_THROWS_AS(make_plan_key({0}, {std::nan("")}, 1.0, 0.02, PlanOptions{}), std::invalid_argument);
+}
+
+DROGON_TEST(PlanKeyRoundTrip)
+{
+    PlanOptions opt;
+    opt.format = PlanFormat::Binary;
+    opt.channels = kChanQ | kChanDq;
+    const PlanKey k = make_plan_key({0.1, -0.2}, {1.5, 2.5}, 1.25, 0.01, opt);
+    PlanMove m;
+    REQUIRE(plan_key_move(k, m));
+    CHECK(m.q0.size() == 2 && m.q1.size() == 2);
+    CHECK(std::fabs(m.q0[1] + 0.2) < 1e-9 && std::fabs(m.q1[0] - 1.5) < 1e-9);
+    CHECK(std::fabs(m.T - 1.25) < 1e-9 && std::fabs(m.dt - 0.01) < 1e-9);
+    CHECK(m.opt.format == PlanFormat::Binary && m.opt.channels == opt.channels);
+    CHECK(make_plan_key(m.q0, m.q1, m.T, m.dt, m.opt) == k);
+}
+
+DROGON_TEST(PlanCacheHitMiss)
+{
+    PlanCache cache(1 << 20, 4);
+    CHECK(cache.get(key(1.0)) == nullptr);
+    cache.put(key(1.0), body(100));
+    auto hit = cache.get(key(1.0));
+    REQUIRE(hit != nullptr);
+    CHECK(hit->size() == 100);
+    CHECK(cache.contains(key(1.0)));
+
+    const auto st = cache.stats();
+    CHECK(st.hits == 1 && st.misses == 1 && st.insertions == 1 && st.entries == 1);
+    CHECK(st.bytes == 100 + sizeof(PlanKey) * 2 + PlanCache::kEntryOverhead);
+
+    cache.clear();
+    CHECK(!cache.contains(key(1.0)));
+    CHECK(cache.stats().entries == 0 && cache.stats().bytes == 0);
+}
+
+DROGON_TEST(PlanCacheEvictsLeastRecentlyUsed)
+{
+    // One shard holding three 1000-byte bodies
+    const size_t charge = 1000 + sizeof(PlanKey) * 2 + PlanCache::kEntryOverhead;
+    PlanCache cache(3 * charge, 1);
+    cache.put(key(1.0), body(1000));
+    cache.put(key(2.0), body(1000));
+    cache.put(key(3.0), body(1000));
+    CHECK(cache.get(key(1.0)) != nullptr);   // 2 is now the oldest
+    cache.put(key(4.0), body(1000));
+    CHECK(!cache.contains(key(2.0)));
+    CHECK(cache.contains(key(1.0)) && cache.contains(key(3.0)) && cache.contains(key(4.0)));
+    CHECK(cache.stats().evictions == 1);
+
+    const auto hot = cache.hottest(2);
+    REQUIRE(hot.size() == 2);
+    CHECK(hot[0] == key(4.0) && hot[1] == key(1.0));
+
+    cache.put(key(5.0), body(4 * charge));   // larger than a shard: not cached
+    CHECK(!cache.contains(key(5.0)));
+}
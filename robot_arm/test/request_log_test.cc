@@ -0,0 +1,98 @@
+#include <drogon/drogon_test.h>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+#include "request_log.hpp"
+
+static reqlog::Request roundTrip(const reqlog::Request &r)
+{
+    const std::string rec = reqlog::encode(r);
+    uint32_t size = 0;
+    std::memcpy(&size, rec.data(), sizeof(size));
+    if (size != rec.size() - sizeof(size)) throw std::runtime_error("bad size prefix");
+    return reqlog::decode(rec.data() + sizeof(size), size);
+}
+
+DROGON_TEST(RequestLogPlanRecord)
+{
+    reqlog::Request r;
+    r.t_ns = 123456789;
+    r.format = 1;
+    r.flags = reqlog::kStore | reqlog::kDeadline | reqlog::kSession;
+    r.channels = 5;
+    r.deadline_ms = 12.5;
+    r.session = "abc";
+    for (int i = 0; i < 6; ++i) r.q_target[i] = 0.1 * i;
+    r.T = 2.0;
+    r.dt = 0.01;
+
+    const reqlog::Request d = roundTrip(r);
+    CHECK(d.kind == reqlog::Kind::Plan && d.t_ns == r.t_ns && d.format == 1 && d.flags == r.flags);
+    CHECK(d.channels == 5 && d.deadline_ms == 12.5 && d.session == "abc");
+    CHECK(d.q_target[5] == r.q_target[5] && d.T == 2.0 && d.dt == 0.01);
+}
+
+DROGON_TEST(RequestLogBatchAndJogRecords)
+{
+    reqlog::Request b;
+    b.kind = reqlog::Kind::Batch;
+    b.items.resize(3);
+    b.items[0].flags = reqlog::kItemQ0;
+    b.items[0].q0[2] = 0.5;
+    b.items[0].q1[1] = 1.5;
+    b.items[1].flags = reqlog::kItemInvalid;
+    b.items[2].T = 3.0;
+    const reqlog::Request db = roundTrip(b);
+    REQUIRE(db.items.size() == 3);
+    CHECK(db.items[0].q0[2] == 0.5 && db.items[0].q1[1] == 1.5);
+    CHECK(db.items[1].flags == reqlog::kItemInvalid && db.items[2].T == 3.0);
+
+    reqlog::Request j;
+    j.kind = reqlog::Kind::JogFrame;
+    j.conn = 7;
+    j.text = "{\"cmd\":\"jog\"}";
+    const reqlog::Request dj = roundTrip(j);
+    CHECK(dj.kind == reqlog::Kind::JogFrame && dj.conn == 7 && dj.text == j.text);
+}
+
+DROGON_TEST(RequestLogRejectsMalformedRecords)
+{
+    reqlog::Request r;
+    const std::string rec = reqlog::encode(r);
+    CHECK_THROWS_AS(reqlog::decode(rec.data() + 4, rec.size() - 5), std::runtime_error);   // truncated
+    std::string bad = rec;
+    bad[4 + 8] = 9;                        // unknown kind
+    CHECK_THROWS_AS(reqlog::decode(bad.data() + 4, bad.size() - 4), std::runtime_error);
+}
+
+DROGON_TEST(RequestLogQueue)
+{
+    reqlog::RecordQueue q(2);
+    std::string a = "a", b = "b", c = "c", out;
+    CHECK(q.push(a) && q.push(b));
+    CHECK(!q.push(c) && c == "c");         // full: left untouched
+    CHECK(q.pop(out) && out == "a");
+    CHECK(q.pop(out) && out == "b");
+    CHECK(!q.pop(out));
+}
+
+DROGON_TEST(RequestLogRecorderFile)
+{
+    const std::string path = "/tmp/robot_arm_test_" + std::to_string(::getpid()) + ".reqlog";
+    {
+        reqlog::Recorder rec(path, 64, 0.01);
+        for (uint64_t i = 0; i < 3; ++i) {
+            reqlog::Request r;
+            r.t_ns = 30 - i;               // recorded out of arrival order
+            r.T = 1.0 + (double)i;
+            rec.record(r);
+        }
+    }
+    const reqlog::Log log = reqlog::readAll(path);
+    std::remove(path.c_str());
+    REQUIRE(log.requests.size() == 3);
+    CHECK(log.start_unix_ns > 0);
+    CHECK(log.requests[0].t_ns == 28 && log.requests[0].T == 3.0);
+    CHECK(log.requests[2].t_ns == 30);
+}
@@ -0,0 +1,76 @@
+#include <drogon/drogon_test.h>
+#include <string>
+#include <thread>
+
+#include "single_flight.hpp"
+
+using Flights = SingleFlight<std::string, int>;
+
+DROGON_TEST(SingleFlightCoalesces)
+{
+    Flights sf;
+    int a = 0, b = 0;
+    auto leader = sf.join("k", [&a](const int &r) { a = r; });
+    auto waiter = sf.join("k", [&b](const int &r) { b = r; });
+    CHECK(leader.leader && !waiter.leader);
+    CHECK(leader.flight == waiter.flight);
+    CHECK(sf.join("other", nullptr).leader);
+
+    sf.complete("k", leader, 42);
+    CHECK(a == 42 && b == 42);
+    const auto st = sf.stats();
+    CHECK(st.flights == 2 && st.coalesced == 1 && st.in_flight == 1);
+    CHECK(sf.join("k", nullptr).leader);          // completed flights are forgotten
+}
+
+DROGON_TEST(SingleFlightLastLeaveCancels)
+{
+    Flights sf;
+    bool called = false;
+    auto leader = sf.join("k", nullptr);
+    auto waiter = sf.join("k", [&called](const int &) { called = true; });
+    sf.leave("k", waiter);
+    CHECK(!leader.flight->cancelled());
+    sf.leave("k", leader);
+    CHECK(leader.flight->cancelled());
+    CHECK(sf.stats().cancelled == 1);
+
+    auto next = sf.join("k", nullptr);            // never attaches to a cancelled flight
+    CHECK(next.leader && next.flight != leader.flight);
+    sf.complete("k", leader, 1);
+    CHECK(!called);
+}
+
+DROGON_TEST(SingleFlightPollDropsCancelledWaiters)
+{
+    Flights sf;
+    bool gone = false;
+    int dropped = 0, served = 0;
+    auto leader = sf.join("k", [&served](const int &r) { served = r; });
+    sf.join("k", [&dropped](const int &r) { dropped = r; }, [&gone]() { return gone; });
+
+    CHECK(!sf.poll("k", leader, -1));
+    gone = true;
+    CHECK(!sf.poll("k", leader, -1));             // the leader's own waiter is still there
+    CHECK(dropped == -1);
+    CHECK(sf.stats().dropped == 1);
+    sf.complete("k", leader, 7);
+    CHECK(served == 7 && dropped == -1);
+}
+
+DROGON_TEST(SingleFlightBlockingWaiter)
+{
+    Flights sf;
+    auto leader = sf.join("k", nullptr);
+    auto waiter = sf.join("k", nullptr);
+    int out = 0;
+    CHECK(!sf.waitFor(waiter, std::chrono::milliseconds(1), out));
+    CHECK(!leader.flight->running());
+    sf.begin(leader);
+    CHECK(leader.flight->running());
+
+    std::thread t([&]() { sf.complete("k", leader, 5); });
+    CHECK(sf.waitFor(waiter, std::chrono::seconds(5), out));
+    t.join();
+    CHECK(out == 5);
+}
@@ -0,0 +1,51 @@
+#include <drogon/drogon_test.h>
+#include <cmath>
+
+#include "time_scaling.hpp"
+
+static bool near(double a, double b, double eps = 1e-9) { return std::fabs(a - b) <= eps; }
+
+DROGON_TEST(TimeLawConstant)
+{
+    const TimeLaw law = TimeLaw::constant(0.5, 2.0);
+    double s, r, dr;
+    law.eval(4.0, s, r, dr);
+    CHECK(near(s, 4.0) && near(r, 0.5) && near(dr, 0.0));
+    law.eval(-1.0, s, r, dr);
+    CHECK(near(s, 2.0));
+    CHECK(near(law.timeTo(3.0), 2.0));
+    CHECK(near(law.rampLeft(1.0), 0.0));
+}
+
+DROGON_TEST(TimeLawRamp)
+{
+    TimeLaw law;
+    law.r0 = 1.0;
+    law.r1 = 0.5;
+    law.ramp = 0.2;
+    double s, r, dr;
+    law.eval(0.0, s, r, dr);
+    CHECK(near(s, 0.0) && near(r, 1.0) && near(dr, 0.0));
+    law.eval(0.1, s, r, dr);
+    CHECK(near(r, 0.75) && dr < 0.0);
+    law.eval(0.2, s, r, dr);
+    CHECK(near(s, 0.15) && near(r, 0.5) && near(dr, 0.0, 1e-6));   // s = (r0 + r1) / 2 * ramp
+
+    // s is the integral of r: compare with a midpoint sum across the ramp
+    double sum = 0.0;
+    const int n = 10000;
+    for (int i = 0; i < n; ++i) {
+        double si, ri, dri;
+        law.eval((i + 0.5) * 0.3 / n, si, ri, dri);
+        sum += ri * 0.3 / n;
+    }
+    law.eval(0.3, s, r, dr);
+    CHECK(near(s, sum, 1e-6));
+
+    // timeTo inverts eval inside and after the ramp
+    for (double t : {0.05, 0.15, 0.5}) {
+        law.eval(t, s, r, dr);
+        CHECK(near(law.timeTo(s), t, 1e-9));
+    }
+    CHECK(near(law.rampLeft(0.05), 0.15));
+}
@@ -0,0 +1,38 @@
+#include <drogon/drogon_test.h>
+#include <vector>
+
+#include "timer_wheel.hpp"
+
+DROGON_TEST(TimerWheelFiresWhenDue)
+{
+    TimerWheel<int> wheel(8);
+    std::vector<int> fired;
+    auto fire = [&fired](int p) { fired.push_back(p); };
+    wheel.schedule(3, 3);
+    wheel.schedule(5, 5);
+    wheel.schedule(0, 0);                 // past due: next tick
+    CHECK(wheel.size() == 3);
+
+    wheel.advance(2, fire);
+    CHECK((fired == std::vector<int>{0}));
+    wheel.advance(4, fire);
+    CHECK((fired == std::vector<int>{0, 3}));
+    wheel.advance(4, fire);               // time does not go back
+    wheel.advance(5, fire);
+    CHECK((fired == std::vector<int>{0, 3, 5}));
+    CHECK(wheel.size() == 0 && wheel.now() == 5);
+}
+
+DROGON_TEST(TimerWheelLongDelays)
+{
+    TimerWheel<int> wheel(4);
+    std::vector<int> fired;
+    auto fire = [&fired](int p) { fired.push_back(p); };
+    wheel.schedule(10, 10);               // more than one revolution away
+    wheel.schedule(2, 2);
+    wheel.advance(6, fire);
+    CHECK((fired == std::vector<int>{2}));
+    CHECK(wheel.size() == 1);
+    wheel.advance(1000, fire);            // long pause: one pass over the wheel
+    CHECK((fired == std::vector<int>{2, 10}));
+}
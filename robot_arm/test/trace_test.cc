@@ -0,0 +1,55 @@
+#include <drogon/drogon_test.h>
+#include <string>
+#include <vector>
+
+#include "trace.hpp"
+
+DROGON_TEST(TraceRingKeepsNewestEvents)
+{
+    trace::Ring ring(16, 3);
+    for (uint64_t i = 0; i < 20; ++i) ring.push("span", 100 + i, 1, i);
+    std::vector<trace::Event> out;
+    ring.collect(0, out);
+    REQUIRE(out.size() == 16);
+    CHECK(out.front().request == 4 && out.back().request == 19);
+    CHECK(out.front().tid == 3);
+
+    out.clear();
+    ring.collect(118, out);                // events ending at or after 118
+    CHECK(out.size() == 3);
+}
+
+DROGON_TEST(TraceSpansOfBoundRequests)
+{
+    const uint64_t since = trace::nowNs();
+    {
+        trace::Span untraced("untraced");  // no request bound: nothing recorded
+    }
+    {
+        trace::Bind bind(77);
+        trace::Span span("traced");
+    }
+    const auto events = trace::collect(since);
+    size_t traced = 0;
+    for (const auto &e : events) {
+        CHECK(std::string(e.name) != "untraced");
+        if (e.request == 77 && std::string(e.name) == "traced") ++traced;
+    }
+    CHECK(traced == 1);
+
+    const std::string json = trace::chromeJson(events);
+    CHECK(json.find("\"name\":\"traced\"") != std::string::npos);
+    CHECK(json.find("\"ph\":\"X\"") != std::string::npos);
+}
+
+DROGON_TEST(TraceSampling)
+{
+    trace::setSampleEvery(2);
+    int traced = 0;
+    for (int i = 0; i < 10; ++i) traced += trace::startRequest() != 0;
+    CHECK(traced == 5);
+    trace::setSampleEvery(0);
+    CHECK(trace::startRequest() == 0);
+    trace::captureFor(10.0);
+    CHECK(trace::startRequest() != 0);
+}
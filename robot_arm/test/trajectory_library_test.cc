@@ -0,0 +1,80 @@
+#include <drogon/drogon_test.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#include "trajectory_library.hpp"
+
+static std::string tempPath(const char *name)
+{
+    return "/tmp/robot_arm_test_" + std::to_string(::getpid()) + "_" + name + ".ratl";
+}
+
+static void overwrite(const std::string &path, const std::string &data)
+{
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << data;
+}
+
+DROGON_TEST(TrajectoryLibraryRoundTrip)
+{
+    trajlib::Builder b;
+    std::vector<PlanKey> keys;
+    for (int i = 0; i < 50; ++i) {
+        const std::vector<double> q0(6, 0.0), q1(6, 0.01 * i);
+        PlanOptions opt;
+        opt.format = i % 2 ? PlanFormat::Binary : PlanFormat::Json;
+        keys.push_back(make_plan_key(q0, q1, 1.0, 0.02, opt, b.qQuantum(), b.tQuantum()));
+        CHECK(b.add(keys.back(), make_quintic_trajectory(q0, q1, 1.0), 0.02, opt.format, "body" + std::to_string(i)));
+    }
+    CHECK(!b.add(keys[7], make_quintic_trajectory({0.0}, {1.0}, 1.0), 0.02, PlanFormat::Json, "dup"));
+    CHECK(b.size() == 50);
+
+    const std::string path = tempPath("roundtrip");
+    b.write(path, 42);
+    auto lib = trajlib::Library::open(path);
+    CHECK(lib->version() == 42 && lib->entries() == 50);
+
+    trajlib::Library::Entry e;
+    for (int i = 0; i < 50; ++i) {
+        REQUIRE(lib->find(keys[i], e));
+        CHECK(std::string(e.body, e.body_size) == "body" + std::to_string(i));
+        CHECK(e.format == (i % 2 ? PlanFormat::Binary : PlanFormat::Json));
+        CHECK(e.dof == 6 && e.T == 1.0 && e.dt == 0.02);
+    }
+    REQUIRE(lib->find(keys[3], e));
+    CHECK(e.trajectory().coeffs ==
+          make_quintic_trajectory(std::vector<double>(6, 0.0), std::vector<double>(6, 0.03), 1.0).coeffs);
+    CHECK(!lib->find(lib->key(std::vector<double>(6, 0.0), std::vector<double>(6, 5.0), 1.0, 0.02, PlanOptions{}), e));
+    std::remove(path.c_str());
+}
+
+DROGON_TEST(TrajectoryLibraryRejectsBadFiles)
+{
+    trajlib::Builder b;
+    const std::vector<double> q0(6, 0.0), q1(6, 1.0);
+    b.add(make_plan_key(q0, q1, 1.0, 0.02, PlanOptions{}), make_quintic_trajectory(q0, q1, 1.0), 0.02,
+          PlanFormat::Json, "body");
+    const std::string image = b.image(1);
+    const std::string path = tempPath("bad");
+
+    std::string corrupt = image;
+    corrupt.back() ^= 1;
+    overwrite(path, corrupt);
+    CHECK_THROWS_AS(trajlib::Library::open(path), std::runtime_error);   // checksum
+
+    overwrite(path, image.substr(0, image.size() - 64));
+    CHECK_THROWS_AS(trajlib::Library::open(path), std::runtime_error);   // truncated
+
+    trajlib::Header h;
+    std::string schema = image;
+    std::memcpy(&h, schema.data(), sizeof(h));
+    h.key_schema = kPlanKeySchema + 1;
+    std::memcpy(&schema[0], &h, sizeof(h));
+    overwrite(path, schema);
+    CHECK_THROWS_AS(trajlib::Library::open(path), std::runtime_error);   // key schema
+
+    overwrite(path, image);
+    CHECK_NOTHROW(trajlib::Library::open(path));
+    std::remove(path.c_str());
+}
@@ -0,0 +1,65 @@
+#include <drogon/drogon_test.h>
+#include <thread>
+
+#include "trajectory_store.hpp"
+
+static QuinticTrajectory move(double q1, size_t dof = 6)
+{
+    return make_quintic_trajectory(std::vector<double>(dof, 0.0), std::vector<double>(dof, q1), 1.0);
+}
+
+DROGON_TEST(TrajectoryStorePutGet)
+{
+    TrajectoryStore store(4, 60.0);
+    const auto tr = move(0.5);
+    const uint64_t id = store.put(tr, 0.01);
+    REQUIRE(id != 0);
+
+    TrajectoryStore::Entry e;
+    REQUIRE(store.get(id, e));
+    CHECK(e.traj.dof == 6 && e.traj.T == 1.0 && e.dt == 0.01);
+    CHECK(e.traj.coeffs == tr.coeffs);
+
+    CHECK(store.put(move(0.5, 7), 0.01) == 0);   // above max_dof
+    CHECK(!store.get(id + 1, e));
+}
+
+DROGON_TEST(TrajectoryStoreStaleIds)
+{
+    TrajectoryStore store(1, 60.0);
+    const uint64_t first = store.put(move(0.1), 0.02);
+    REQUIRE(first != 0);
+    CHECK(store.put(move(0.2), 0.02) == 0);      // full
+    CHECK(store.stats().rejected == 1);
+
+    CHECK(store.erase(first));
+    const uint64_t second = store.put(move(0.2), 0.02);
+    REQUIRE(second != 0);
+    CHECK((second & 0xffffffffu) == (first & 0xffffffffu));   // same slot, new generation
+    TrajectoryStore::Entry e;
+    CHECK(!store.get(first, e));
+    CHECK(store.get(second, e));
+}
+
+DROGON_TEST(TrajectoryStoreExpiry)
+{
+    TrajectoryStore store(2, 0.01);
+    const uint64_t id = store.put(move(0.3), 0.02);
+    REQUIRE(id != 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    CHECK(store.evictExpired() == 1);
+    TrajectoryStore::Entry e;
+    CHECK(!store.get(id, e));
+    CHECK(store.stats().entries == 0 && store.stats().expired == 1);
+}
+
+DROGON_TEST(TrajectoryStoreIdFormat)
+{
+    uint64_t id = 0;
+    CHECK(TrajectoryStore::formatId(0x100000002ULL) == "0000000100000002");
+    CHECK(TrajectoryStore::parseId("0000000100000002", id) && id == 0x100000002ULL);
+    CHECK(TrajectoryStore::parseId("AbC", id) && id == 0xabc);
+    CHECK(!TrajectoryStore::parseId("", id));
+    CHECK(!TrajectoryStore::parseId("12345678901234567", id));
+    CHECK(!TrajectoryStore::parseId("xyz", id));
+}
@@ -0,0 +1,29 @@
+#include <drogon/drogon_test.h>
+
+#include "warmup.hpp"
+
+DROGON_TEST(ReadinessPhases)
+{
+    Readiness r;
+    auto s = r.snapshot();
+    CHECK(!s.ready && s.phase == "starting");
+
+    r.addPhase("config", 0.25);
+    {
+        Readiness::Phase p(r, "prefill", 3);
+        r.step();
+        r.step();
+        s = r.snapshot();
+        CHECK(s.phase == "prefill" && s.done == 2 && s.total == 3);
+    }
+    CHECK(!r.ready());
+    r.markReady();
+
+    s = r.snapshot();
+    CHECK(s.ready && s.phase.empty());
+    REQUIRE(s.phases.size() == 2);
+    CHECK(s.phases[0].name == "config" && s.phases[0].seconds == 0.25);
+    CHECK(s.phases[1].name == "prefill" && s.phases[1].items == 2);
+    CHECK(s.time_to_ready_s >= s.phases[1].seconds);
+    if (Readiness::processAgeSeconds() >= 0.0) CHECK(s.process_time_to_ready_s >= s.time_to_ready_s);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstring>
+#include <string>
+
+/*
+    Command line helpers shared by the tools (loadgen, replay, fleet, trajlib).
+
+    Options are --name=value; argValue() matches one of them. Server
+    addresses are given as http://host:port URLs (plain HTTP, no path).
+*/
+
+namespace cli {
+
+// True when arg is "<name>=<value>"; out receives the value
+inline bool argValue(const char *arg, const char *name, std::string &out)
+{
+    const size_t len = std::strlen(name);
+    if (std::strncmp(arg, name, len) != 0 || arg[len] != '=') return false;
+    out = arg + len + 1;
+    return true;
+}
+
+// http://host[:port][/...] -> host, port ("80" when absent); the scheme is optional
+inline void splitUrl(const std::string &url, std::string &host, std::string &port)
+{
+    host = url;
+    if (host.rfind("http://", 0) == 0) host = host.substr(7);
+    host = host.substr(0, host.find('/'));
+    port = "80";
+    const size_t colon = host.rfind(':');
+    if (colon != std::string::npos) {
+        port = host.substr(colon + 1);
+        host = host.substr(0, colon);
+    }
+}
+
+} // namespace cli
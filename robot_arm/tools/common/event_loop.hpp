@@ -0,0 +1,101 @@
+#pragma once
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/*
+    Single-threaded epoll loop with one-shot timers (fleet simulator, replay of jog sessions).
+
+    Sockets register a Handler; its onEvent() gets the epoll event mask.
+    Timers are a min-heap of callbacks keyed by steady-clock time; the loop
+    sleeps in epoll_wait until the earliest one. lag() is how late the last
+    timer fired: when it grows the simulator itself is the bottleneck, not
+    the server.
+*/
+
+class EventLoop {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Handler {
+        virtual void onEvent(uint32_t events) = 0;
+        virtual ~Handler() = default;
+    };
+
+    EventLoop() : epfd_(::epoll_create1(EPOLL_CLOEXEC))
+    {
+        if (epfd_ < 0) throw std::runtime_error("epoll_create1 failed");
+    }
+    ~EventLoop() { ::close(epfd_); }
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    void add(int fd, uint32_t events, Handler *h) { ctl(EPOLL_CTL_ADD, fd, events, h); }
+    void modify(int fd, uint32_t events, Handler *h) { ctl(EPOLL_CTL_MOD, fd, events, h); }
+    void remove(int fd) { ::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr); }
+
+    void at(Clock::time_point when, std::function<void()> fn)
+    {
+        timers_.push(Timer{when, seq_++, std::move(fn)});
+    }
+    void after(double seconds, std::function<void()> fn)
+    {
+        at(Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds)),
+           std::move(fn));
+    }
+
+    // Runs events and timers until `until`
+    void runUntil(Clock::time_point until)
+    {
+        epoll_event events[256];
+        for (;;) {
+            auto now = Clock::now();
+            while (!timers_.empty() && timers_.top().when <= now) {
+                Timer t = timers_.top();
+                timers_.pop();
+                lag_ns_ = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - t.when).count();
+                t.fn();
+                now = Clock::now();
+            }
+            if (now >= until) return;
+            auto next = until;
+            if (!timers_.empty() && timers_.top().when < next) next = timers_.top().when;
+            const int wait_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                                    next - now + std::chrono::microseconds(999)).count();
+            const int n = ::epoll_wait(epfd_, events, 256, wait_ms);
+            if (n < 0 && errno != EINTR) throw std::runtime_error("epoll_wait failed");
+            for (int i = 0; i < n; ++i) static_cast<Handler *>(events[i].data.ptr)->onEvent(events[i].events);
+        }
+    }
+
+    uint64_t lagNs() const { return lag_ns_; }
+
+private:
+    struct Timer {
+        Clock::time_point when;
+        uint64_t seq;                      // FIFO among equal times
+        std::function<void()> fn;
+        bool operator>(const Timer &o) const { return when != o.when ? when > o.when : seq > o.seq; }
+    };
+
+    void ctl(int op, int fd, uint32_t events, Handler *h)
+    {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.ptr = h;
+        if (::epoll_ctl(epfd_, op, fd, &ev) != 0) throw std::runtime_error("epoll_ctl failed");
+    }
+
+    int epfd_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    uint64_t seq_ = 0;
+    uint64_t lag_ns_ = 0;
+};
@@ -0,0 +1,202 @@
+#pragma once
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <strings.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/*
+    Blocking HTTP/1.1 client over one keep-alive connection (load generator, replay).
+
+    request() sends one request and reads the whole response (Content-Length
+    bodies, or chunked ones for streamed responses such as /arm/plan_batch). The connection is reopened transparently
+    after the server closes it or on an I/O error.
+*/
+
+class HttpConnection {
+public:
+    struct Response {
+        int status = 0;            // 0 = transport error
+        size_t body_bytes = 0;
+        std::string error;
+    };
+
+    HttpConnection(std::string host, std::string port, double timeout_s = 30.0)
+        : host_(std::move(host)), port_(std::move(port)), timeout_s_(timeout_s)
+    {
+    }
+
+    ~HttpConnection() { close(); }
+
+    HttpConnection(const HttpConnection &) = delete;
+    HttpConnection &operator=(const HttpConnection &) = delete;
+
+    // extra_headers: complete "Name: value\r\n" lines
+    Response request(const std::string &method, const std::string &path,
+                     const std::string &body, const char *content_type = "application/json",
+                     const std::string &extra_headers = std::string())
+    {
+        std::string req;
+        req.reserve(body.size() + extra_headers.size() + 160);
+        req += method + " " + path + " HTTP/1.1\r\nHost: " + host_ + "\r\n";
+        req += extra_headers;
+        if (!body.empty()) {
+            req += "Content-Type: ";
+            req += content_type;
+            req += "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+        }
+        req += "\r\n";
+        req += body;
+
+        // A kept-alive connection may have been closed by the server: retry once on a fresh one
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            const bool reused = fd_ >= 0;
+            if (fd_ < 0 && !connect()) return fail("connect: " + std::string(std::strerror(errno)));
+            Response r;
+            if (sendAll(req) && readResponse(r)) return r;
+            close();
+            if (!reused) return fail("I/O error: " + std::string(std::strerror(errno)));
+        }
+        return fail("I/O error");
+    }
+
+    void close()
+    {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        buf_.clear();
+    }
+
+private:
+    static Response fail(std::string msg)
+    {
+        Response r;
+        r.error = std::move(msg);
+        return r;
+    }
+
+    bool connect()
+    {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *res = nullptr;
+        if (getaddrinfo(host_.c_str(), port_.c_str(), &hints, &res) != 0) return false;
+        for (addrinfo *ai = res; ai; ai = ai->ai_next) {
+            int fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) continue;
+            if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                timeval tv{};
+                tv.tv_sec = (time_t)timeout_s_;
+                tv.tv_usec = (suseconds_t)((timeout_s_ - (double)tv.tv_sec) * 1e6);
+                setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+                setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+                fd_ = fd;
+                break;
+            }
+            ::close(fd);
+        }
+        freeaddrinfo(res);
+        return fd_ >= 0;
+    }
+
+    bool sendAll(const std::string &data)
+    {
+        size_t off = 0;
+        while (off < data.size()) {
+            const ssize_t n = ::send(fd_, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            off += (size_t)n;
+        }
+        return true;
+    }
+
+    bool fill()
+    {
+        char tmp[65536];
+        const ssize_t n = ::recv(fd_, tmp, sizeof(tmp), 0);
+        if (n <= 0) return false;
+        buf_.append(tmp, (size_t)n);
+        return true;
+    }
+
+    bool readResponse(Response &r)
+    {
+        size_t hdr_end;
+        while ((hdr_end = buf_.find("\r\n\r\n")) == std::string::npos) {
+            if (!fill()) return false;
+        }
+        // Status line: HTTP/1.1 200 OK
+        const size_t sp = buf_.find(' ');
+        if (sp == std::string::npos || sp > hdr_end) return false;
+        r.status = std::atoi(buf_.c_str() + sp + 1);
+
+        size_t length = 0;
+        bool close_after = false, chunked = false;
+        size_t pos = buf_.find("\r\n") + 2;
+        while (pos < hdr_end) {
+            const size_t eol = buf_.find("\r\n", pos);
+            const size_t colon = buf_.find(':', pos);
+            if (colon != std::string::npos && colon < eol) {
+                const std::string name = buf_.substr(pos, colon - pos);
+                size_t v = colon + 1;
+                while (v < eol && buf_[v] == ' ') ++v;
+                if (strcasecmp(name.c_str(), "content-length") == 0) {
+                    length = std::strtoull(buf_.c_str() + v, nullptr, 10);
+                } else if (strcasecmp(name.c_str(), "connection") == 0) {
+                    close_after = strncasecmp(buf_.c_str() + v, "close", 5) == 0;
+                } else if (strcasecmp(name.c_str(), "transfer-encoding") == 0) {
+                    chunked = strncasecmp(buf_.c_str() + v, "chunked", 7) == 0;
+                }
+            }
+            pos = eol + 2;
+        }
+
+        if (chunked) {
+            buf_.erase(0, hdr_end + 4);
+            if (!readChunks(r)) return false;
+            if (close_after) close();
+            return true;
+        }
+        const size_t need = hdr_end + 4 + length;
+        while (buf_.size() < need) {
+            if (!fill()) return false;
+        }
+        r.body_bytes = length;
+        buf_.erase(0, need);
+        if (close_after) close();
+        return true;
+    }
+
+    // Chunked body: size line, data, CRLF per chunk up to the last (empty) one; no trailers
+    bool readChunks(Response &r)
+    {
+        r.body_bytes = 0;
+        for (;;) {
+            size_t eol;
+            while ((eol = buf_.find("\r\n")) == std::string::npos) {
+                if (!fill()) return false;
+            }
+            const size_t size = std::strtoull(buf_.c_str(), nullptr, 16);
+            while (buf_.size() < eol + 2 + size + 2) {
+                if (!fill()) return false;
+            }
+            buf_.erase(0, eol + 2 + size + 2);
+            r.body_bytes += size;
+            if (size == 0) return true;
+        }
+    }
+
+    std::string host_, port_;
+    double timeout_s_;
+    int fd_ = -1;
+    std::string buf_;
+};
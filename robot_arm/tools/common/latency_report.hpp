@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <json/json.h>
+
+#include "hdr_histogram.hpp"
+
+/*
+    Latency report of the load tools (robot_arm_loadgen, robot_arm_replay).
+
+    Latencies are recorded in microseconds. A report is a JSON object with
+    "config" and "results"; results carry latency_us / service_us blocks
+    written by latencyJson() and throughput_rps. --out writes it, and
+    --baseline compares the p50..max and throughput of two such reports.
+*/
+
+namespace report {
+
+inline Json::Value latencyJson(const HdrHistogram &h)
+{
+    Json::Value out(Json::objectValue);
+    out["count"] = (Json::UInt64)h.count();
+    out["mean"] = h.mean();
+    out["min"] = (Json::UInt64)h.min();
+    out["p50"] = (Json::UInt64)h.percentile(50.0);
+    out["p90"] = (Json::UInt64)h.percentile(90.0);
+    out["p99"] = (Json::UInt64)h.percentile(99.0);
+    out["p999"] = (Json::UInt64)h.percentile(99.9);
+    out["max"] = (Json::UInt64)h.max();
+    return out;
+}
+
+inline void printLatency(const char *label, const HdrHistogram &h)
+{
+    std::printf("  %-22s n=%-9llu p50=%-9llu p90=%-9llu p99=%-9llu p999=%-9llu max=%llu us\n", label,
+                (unsigned long long)h.count(), (unsigned long long)h.percentile(50.0),
+                (unsigned long long)h.percentile(90.0), (unsigned long long)h.percentile(99.0),
+                (unsigned long long)h.percentile(99.9), (unsigned long long)h.max());
+}
+
+// Side-by-side view of two reports; `from` names the latency origin ("intended send")
+inline void printComparison(const Json::Value &base, const Json::Value &cur, const char *from)
+{
+    std::printf("\ncomparison with baseline (latency from %s, us):\n", from);
+    std::printf("  %-10s %12s %12s %9s\n", "metric", "baseline", "current", "delta");
+    auto row = [](const char *name, double a, double b) {
+        const double d = a > 0.0 ? (b - a) / a * 100.0 : 0.0;
+        std::printf("  %-10s %12.1f %12.1f %+8.1f%%\n", name, a, b, d);
+    };
+    const auto &bl = base["results"]["latency_us"];
+    const auto &cl = cur["results"]["latency_us"];
+    for (const char *k : {"p50", "p90", "p99", "p999", "max"}) row(k, bl[k].asDouble(), cl[k].asDouble());
+    row("rps", base["results"]["throughput_rps"].asDouble(), cur["results"]["throughput_rps"].asDouble());
+}
+
+// --out: false (and a message) when the file cannot be written
+inline bool write(const std::string &path, const Json::Value &report)
+{
+    std::ofstream out(path);
+    Json::StreamWriterBuilder w;
+    w["indentation"] = "  ";
+    out << Json::writeString(w, report) << "\n";
+    out.flush();
+    if (!out) {
+        std::cerr << "cannot write report " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+// --baseline: prints the comparison; false (and a message) when the file cannot be read
+inline bool compare(const std::string &baseline_path, const Json::Value &report, const char *from)
+{
+    std::ifstream in(baseline_path);
+    Json::Value base;
+    Json::CharReaderBuilder b;
+    std::string errs;
+    if (!in || !Json::parseFromStream(b, in, &base, &errs)) {
+        std::cerr << "cannot read baseline " << baseline_path << "\n";
+        return false;
+    }
+    printComparison(base, report, from);
+    return true;
+}
+
+} // namespace report
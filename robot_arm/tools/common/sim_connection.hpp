@@ -0,0 +1,282 @@
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <strings.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "event_loop.hpp"
+
+/*
+    Non-blocking client connection on the simulator's EventLoop (robot_arm_fleet,
+    jog sessions of robot_arm_replay).
+
+    Http mode: keep-alive HTTP/1.1, one request at a time; onResponse gets the
+    status and body (Content-Length bodies, as sent by Drogon).
+    WebSocket mode: request() sends the upgrade handshake, then onOpen fires;
+    sendText() writes a masked text frame, onMessage gets every data frame
+    (pings are answered, fragmented messages are not expected from the server).
+
+    Any error or a close by the server closes the socket and calls onClose;
+    the owner decides whether to reconnect.
+*/
+
+// host/port -> first address (getaddrinfo); false when it does not resolve
+inline bool resolveAddress(const std::string &host, const std::string &port, sockaddr_storage &addr,
+                           socklen_t &len)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &res) != 0 || !res) return false;
+    addr = sockaddr_storage{};
+    std::memcpy(&addr, res->ai_addr, res->ai_addrlen);
+    len = (socklen_t)res->ai_addrlen;
+    freeaddrinfo(res);
+    return true;
+}
+
+class SimConnection : public EventLoop::Handler {
+public:
+    enum class Mode { Http, WebSocket };
+
+    std::function<void(int status, std::string &&body)> onResponse;
+    std::function<void()> onOpen;
+    std::function<void(std::string &&payload)> onMessage;
+    std::function<void(const char *why)> onClose;
+
+    SimConnection(EventLoop &loop, const sockaddr_storage &addr, socklen_t addr_len, std::string host)
+        : loop_(loop), addr_(addr), addr_len_(addr_len), host_(std::move(host))
+    {
+    }
+    ~SimConnection() override { close(nullptr); }
+
+    SimConnection(const SimConnection &) = delete;
+    SimConnection &operator=(const SimConnection &) = delete;
+
+    bool connected() const { return fd_ >= 0; }
+    bool busy() const { return waiting_; }
+
+    // Opens the socket (connect completes in the loop); false when the socket cannot be created
+    bool open()
+    {
+        fd_ = ::socket(addr_.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd_ < 0) return false;
+        int one = 1;
+        ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (::connect(fd_, (const sockaddr *)&addr_, addr_len_) != 0 && errno != EINPROGRESS) {
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        mode_ = Mode::Http;
+        ws_open_ = false;
+        in_.clear();
+        out_.clear();
+        loop_.add(fd_, EPOLLIN | EPOLLOUT | EPOLLRDHUP, this);
+        want_out_ = true;
+        return true;
+    }
+
+    // extra_headers: complete "Name: value\r\n" lines
+    void request(const char *method, const std::string &path, const std::string &body,
+                 const std::string &extra_headers = std::string())
+    {
+        std::string req;
+        req.reserve(body.size() + extra_headers.size() + 160);
+        req += method;
+        req += ' ';
+        req += path;
+        req += " HTTP/1.1\r\nHost: " + host_ + "\r\n";
+        req += extra_headers;
+        if (!body.empty()) req += "Content-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+        req += "\r\n";
+        req += body;
+        waiting_ = true;
+        write(req);
+    }
+
+    // Upgrade handshake; the connection switches to WebSocket frames on 101
+    void upgrade(const std::string &path)
+    {
+        mode_ = Mode::WebSocket;
+        request("GET", path, std::string(),
+                "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n");
+    }
+
+    void sendText(const std::string &payload) { writeFrame(0x1, payload); }
+
+    void close(const char *why)
+    {
+        if (fd_ < 0) return;
+        loop_.remove(fd_);
+        ::close(fd_);
+        fd_ = -1;
+        waiting_ = false;
+        if (why && onClose) onClose(why);
+    }
+
+    void onEvent(uint32_t events) override
+    {
+        if (events & (EPOLLERR | EPOLLHUP)) return close("connection error");
+        if (events & EPOLLOUT) flush();
+        if (fd_ >= 0 && (events & (EPOLLIN | EPOLLRDHUP))) readAll();
+    }
+
+private:
+    void write(const std::string &data)
+    {
+        if (fd_ < 0) return;
+        out_ += data;
+        flush();
+    }
+
+    void flush()
+    {
+        while (fd_ >= 0 && !out_.empty()) {
+            const ssize_t n = ::send(fd_, out_.data(), out_.size(), MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOTCONN) break;
+                return close("send failed");
+            }
+            out_.erase(0, (size_t)n);
+        }
+        if (fd_ < 0) return;
+        const bool want = !out_.empty();
+        if (want != want_out_) {
+            loop_.modify(fd_, EPOLLIN | EPOLLRDHUP | (want ? EPOLLOUT : 0u), this);
+            want_out_ = want;
+        }
+    }
+
+    void readAll()
+    {
+        char buf[65536];
+        for (;;) {
+            const ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+            if (n > 0) {
+                in_.append(buf, (size_t)n);
+                continue;
+            }
+            if (n == 0) return close("closed by server");
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return close("recv failed");
+        }
+        if (mode_ == Mode::WebSocket && ws_open_) parseFrames();
+        else parseResponse();
+    }
+
+    void parseResponse()
+    {
+        const size_t hdr_end = in_.find("\r\n\r\n");
+        if (hdr_end == std::string::npos) return;
+        const size_t sp = in_.find(' ');
+        const int status = sp < hdr_end ? std::atoi(in_.c_str() + sp + 1) : 0;
+        size_t length = 0;
+        bool close_after = false;
+        size_t pos = in_.find("\r\n") + 2;
+        while (pos < hdr_end) {
+            const size_t eol = in_.find("\r\n", pos);
+            const size_t colon = in_.find(':', pos);
+            if (colon != std::string::npos && colon < eol) {
+                size_t v = colon + 1;
+                while (v < eol && in_[v] == ' ') ++v;
+                if (colon - pos == 14 && strncasecmp(in_.c_str() + pos, "content-length", 14) == 0) {
+                    length = std::strtoull(in_.c_str() + v, nullptr, 10);
+                } else if (colon - pos == 10 && strncasecmp(in_.c_str() + pos, "connection", 10) == 0) {
+                    close_after = strncasecmp(in_.c_str() + v, "close", 5) == 0;
+                }
+            }
+            pos = eol + 2;
+        }
+
+        if (mode_ == Mode::WebSocket) {
+            in_.erase(0, hdr_end + 4);
+            waiting_ = false;
+            if (status != 101) return close("WebSocket upgrade refused");
+            ws_open_ = true;
+            if (onOpen) onOpen();
+            if (fd_ >= 0 && !in_.empty()) parseFrames();
+            return;
+        }
+        if (in_.size() < hdr_end + 4 + length) return;
+        std::string body = in_.substr(hdr_end + 4, length);
+        in_.erase(0, hdr_end + 4 + length);
+        waiting_ = false;
+        if (close_after) close(nullptr);
+        if (onResponse) onResponse(status, std::move(body));
+        if (close_after && onClose) onClose("closed by server");
+    }
+
+    void parseFrames()
+    {
+        for (;;) {
+            if (in_.size() < 2) return;
+            const uint8_t b0 = (uint8_t)in_[0], b1 = (uint8_t)in_[1];
+            size_t len = b1 & 0x7f, off = 2;
+            if (len == 126) {
+                if (in_.size() < 4) return;
+                len = ((size_t)(uint8_t)in_[2] << 8) | (uint8_t)in_[3];
+                off = 4;
+            } else if (len == 127) {
+                if (in_.size() < 10) return;
+                len = 0;
+                for (int i = 0; i < 8; ++i) len = (len << 8) | (uint8_t)in_[2 + i];
+                off = 10;
+            }
+            if (in_.size() < off + len) return;
+            std::string payload = in_.substr(off, len);
+            in_.erase(0, off + len);
+            const uint8_t opcode = b0 & 0x0f;
+            if (opcode == 0x8) return close("closed by server");
+            if (opcode == 0x9) writeFrame(0xA, payload);
+            else if (opcode <= 0x2 && onMessage) onMessage(std::move(payload));
+            if (fd_ < 0) return;
+        }
+    }
+
+    void writeFrame(uint8_t opcode, const std::string &payload)
+    {
+        std::string f;
+        f.reserve(payload.size() + 14);
+        f += (char)(0x80 | opcode);
+        if (payload.size() < 126) {
+            f += (char)(0x80 | payload.size());
+        } else if (payload.size() < 65536) {
+            f += (char)(0x80 | 126);
+            f += (char)(payload.size() >> 8);
+            f += (char)(payload.size() & 0xff);
+        } else {
+            f += (char)(0x80 | 127);
+            for (int i = 7; i >= 0; --i) f += (char)((uint64_t)payload.size() >> (8 * i));
+        }
+        mask_seed_ = mask_seed_ * 1664525u + 1013904223u;
+        char mask[4];
+        std::memcpy(mask, &mask_seed_, 4);
+        f.append(mask, 4);
+        for (size_t i = 0; i < payload.size(); ++i) f += (char)(payload[i] ^ mask[i & 3]);
+        write(f);
+    }
+
+    EventLoop &loop_;
+    sockaddr_storage addr_;
+    socklen_t addr_len_;
+    std::string host_;
+    int fd_ = -1;
+    Mode mode_ = Mode::Http;
+    bool ws_open_ = false;
+    bool waiting_ = false;             // request sent, response not complete
+    bool want_out_ = false;
+    uint32_t mask_seed_ = 0x9e3779b9u;
+    std::string in_, out_;
+};
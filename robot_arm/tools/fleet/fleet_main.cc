@@ -0,0 +1,560 @@
+// robot_arm_fleet: headless fleet of virtual Unity-like clients for scaling tests
+//
+//   robot_arm_fleet --url=http://127.0.0.1:8848 --clients=100:2000:100 --step=15
+//                   [--mix=slider=0.5,jog=0.3,pick_place=0.2] [--server-pid=PID]
+//                   [--fps=60] [--input-hz=20] [--robots=64] [--slo-ms=100] [--out=report.json]
+//
+// All clients run on one epoll loop. Each follows a behavior script:
+//   slider      drags a slider in bursts; every input re-plans /arm/plan_pmp_q (binary,
+//               X-Session-Id), at most one request in flight, newer input waits (latest wins)
+//   jog         streams slider targets over WS /arm/jog and consumes the setpoints
+//   pick_place  moves between a few poses: plan, play the trajectory back, dwell, repeat
+// Returned trajectories start playing on the client's next frame (--fps grid with a
+// per-client phase); staleness is the time from an input to the frame that first shows
+// a motion planned for it (jog: to the first setpoint message after it).
+//
+// The client count ramps in steps; each step reports throughput, latency and staleness
+// percentiles, errors, and the server's CPU / RSS (/proc of --server-pid) and queue
+// gauges (/metrics), then names the first step past the SLO or with falling per-client
+// throughput.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <json/json.h>
+
+#include "cli.hpp"             // tools/common
+#include "event_loop.hpp"
+#include "hdr_histogram.hpp"
+#include "sim_connection.hpp"
+
+using Clock = EventLoop::Clock;
+
+enum Behavior : size_t { kSlider = 0, kJog, kPickPlace, kBehaviors };
+static const char *kBehaviorNames[kBehaviors] = {"slider", "jog", "pick_place"};
+
+struct Options {
+    std::string host = "127.0.0.1", port = "8848";
+    size_t clients_from = 100, clients_to = 100, clients_step = 100;
+    double step_s = 15.0, settle_s = 3.0, connect_spread_s = 1.0;
+    double mix[kBehaviors] = {0.5, 0.3, 0.2};
+    double fps = 60.0, input_hz = 20.0;
+    size_t robots = 64;
+    double slo_ms = 100.0;
+    int server_pid = 0;
+    bool scrape_metrics = true;
+    uint64_t seed = 1;
+    std::string out_path;
+};
+
+// ------------------------------------------------------------
+// Measurements of the current step (reset when the step's window opens)
+// ------------------------------------------------------------
+struct StepStats {
+    HdrHistogram latency[kBehaviors];    // plan request round trip (us)
+    HdrHistogram staleness[kBehaviors];  // input to the frame showing it (us)
+    std::map<int, uint64_t> status;      // HTTP status of plan requests (0 = bad body)
+    uint64_t responses = 0, jog_messages = 0, bytes_in = 0, disconnects = 0;
+    uint64_t max_lag_ns = 0;             // simulator timer lateness
+
+    void reset() { *this = StepStats(); }
+};
+
+static double toUs(Clock::duration d)
+{
+    return (double)std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+// ------------------------------------------------------------
+// One virtual client
+// ------------------------------------------------------------
+class Client {
+public:
+    Client(size_t id, Behavior b, EventLoop &loop, const sockaddr_storage &addr, socklen_t len,
+           const std::string &host, const Options &opt, StepStats &stats)
+        : id_(id), behavior_(b), loop_(loop), conn_(loop, addr, len, host), opt_(opt), stats_(stats),
+          rng_(opt.seed * 7919 + id)
+    {
+        std::uniform_real_distribution<double> u(-1.0, 1.0);
+        for (double &x : q_) x = u(rng_);
+        for (auto &pose : poses_) {
+            for (double &x : pose) x = 1.2 * u(rng_);
+        }
+        frame_phase_ = std::uniform_real_distribution<double>(0.0, 1.0 / opt.fps)(rng_);
+        session_ = "X-Session-Id: fleet-" + std::to_string(id) + "\r\n";
+
+        conn_.onResponse = [this](int status, std::string &&body) { onResponse(status, body); };
+        conn_.onOpen = [this]() { idle(); };
+        conn_.onMessage = [this](std::string &&payload) { onJogMessage(payload); };
+        conn_.onClose = [this](const char *) {
+            ++stats_.disconnects;
+            in_flight_ = false;
+            loop_.after(0.5, [this]() { start(); });
+        };
+    }
+
+    void start()
+    {
+        ++generation_;                       // timers of the previous connection are void
+        if (!conn_.open()) {
+            ++stats_.disconnects;
+            loop_.after(1.0, [this]() { start(); });
+            return;
+        }
+        if (behavior_ == kJog) {
+            conn_.upgrade("/arm/jog?robot=" + std::to_string(id_ % std::max<size_t>(opt_.robots, 1)) + "&format=bin");
+        } else if (behavior_ == kSlider) {
+            idle();
+        } else {
+            nextPick();
+        }
+    }
+
+private:
+    // Timer of the current connection's script
+    template <class Fn>
+    void later(double seconds, Fn fn)
+    {
+        const uint64_t gen = generation_;
+        loop_.after(seconds, [this, gen, fn]() {
+            if (gen == generation_) fn();
+        });
+    }
+
+    // First frame boundary at or after t on this client's frame grid
+    Clock::time_point nextFrame(Clock::time_point t) const
+    {
+        const double frame = 1.0 / opt_.fps;
+        const double s = std::chrono::duration<double>(t.time_since_epoch()).count() - frame_phase_;
+        const double k = std::ceil(s / frame);
+        const double next = k * frame + frame_phase_;
+        return Clock::time_point(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(next)));
+    }
+
+    // Slider / jog: pause, then a drag of inputs at ~input_hz
+    void idle()
+    {
+        const double pause = std::uniform_real_distribution<double>(0.5, 3.0)(rng_);
+        const double drag = std::uniform_real_distribution<double>(1.0, 3.0)(rng_);
+        later(pause, [this, drag]() {
+            drag_end_ = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(drag));
+            input();
+        });
+    }
+
+    void input()
+    {
+        if (!conn_.connected()) return;
+        std::normal_distribution<double> step(0.0, 0.02);
+        for (double &x : q_) x = std::max(-1.5, std::min(1.5, x + step(rng_)));
+        const auto now = Clock::now();
+        if (!has_pending_) pending_since_ = now;
+        has_pending_ = true;
+
+        if (behavior_ == kJog) {
+            conn_.sendText("{\"q_target\":" + vec6(q_) + "}");
+        } else if (!in_flight_) {
+            sendSlider();
+        }
+
+        if (now >= drag_end_) {
+            idle();
+            return;
+        }
+        const double gap = std::exponential_distribution<double>(opt_.input_hz)(rng_);
+        later(gap, [this]() { input(); });
+    }
+
+    void sendSlider()
+    {
+        char body[320];
+        std::snprintf(body, sizeof(body), "{\"q_target\":%s,\"T\":0.3,\"dt\":%.6f}", vec6(q_).c_str(), 1.0 / opt_.fps);
+        request_input_ = pending_since_;
+        has_pending_ = false;
+        send(body, session_);
+    }
+
+    void nextPick()
+    {
+        if (!conn_.connected()) return;
+        pose_ = (pose_ + 1) % 3;
+        pick_T_ = std::uniform_real_distribution<double>(1.0, 2.0)(rng_);
+        char body[320];
+        std::snprintf(body, sizeof(body), "{\"q_target\":%s,\"T\":%.3f,\"dt\":0.02}", vec6(poses_[pose_]).c_str(), pick_T_);
+        request_input_ = Clock::now();
+        send(body, std::string());
+    }
+
+    void send(const std::string &body, const std::string &headers)
+    {
+        in_flight_ = true;
+        sent_ = Clock::now();
+        conn_.request("POST", "/arm/plan_pmp_q?format=bin", body, headers);
+    }
+
+    void onResponse(int status, const std::string &body)
+    {
+        in_flight_ = false;
+        const auto now = Clock::now();
+        // A trajectory to play: PMPB header with at least one sample
+        uint32_t samples = 0;
+        const bool ok = status == 200 && body.size() >= 24 && std::memcmp(body.data(), "PMPB", 4) == 0 &&
+                        (std::memcpy(&samples, body.data() + 12, 4), samples > 0);
+        ++stats_.status[ok || status != 200 ? status : 0];
+        ++stats_.responses;
+        stats_.bytes_in += body.size();
+        stats_.latency[behavior_].record((uint64_t)toUs(now - sent_));
+        if (ok) stats_.staleness[behavior_].record((uint64_t)toUs(nextFrame(now) - request_input_));
+
+        if (behavior_ == kSlider) {
+            if (has_pending_) sendSlider();
+            return;
+        }
+        // Pick-and-place: play the move back, dwell, next pose (retry after an error)
+        const double dwell = std::uniform_real_distribution<double>(0.3, 1.0)(rng_);
+        const double wait = ok ? std::chrono::duration<double>(nextFrame(now) - now).count() + pick_T_ + dwell : 1.0;
+        later(wait, [this]() { nextPick(); });
+    }
+
+    void onJogMessage(const std::string &payload)
+    {
+        ++stats_.jog_messages;
+        stats_.bytes_in += payload.size();
+        if (!has_pending_) return;
+        has_pending_ = false;
+        stats_.staleness[kJog].record((uint64_t)toUs(nextFrame(Clock::now()) - pending_since_));
+    }
+
+    static std::string vec6(const double *q)
+    {
+        char buf[160];
+        std::snprintf(buf, sizeof(buf), "[%.5f,%.5f,%.5f,%.5f,%.5f,%.5f]", q[0], q[1], q[2], q[3], q[4], q[5]);
+        return buf;
+    }
+
+    size_t id_;
+    Behavior behavior_;
+    EventLoop &loop_;
+    SimConnection conn_;
+    const Options &opt_;
+    StepStats &stats_;
+    std::mt19937_64 rng_;
+    std::string session_;
+
+    double q_[6];
+    double poses_[3][6];
+    size_t pose_ = 0;
+    double pick_T_ = 1.0;
+    double frame_phase_ = 0.0;
+    Clock::time_point drag_end_;
+    uint64_t generation_ = 0;
+    bool in_flight_ = false;
+    bool has_pending_ = false;               // input not yet sent (slider) / reflected (jog)
+    Clock::time_point pending_since_, request_input_, sent_;
+};
+
+// ------------------------------------------------------------
+// Server side: /proc of the server process and /metrics gauges
+// ------------------------------------------------------------
+struct ProcSample {
+    bool ok = false;
+    double cpu_s = 0.0;
+    double rss_mb = 0.0;
+    long threads = 0;
+};
+
+static ProcSample readProc(int pid)
+{
+    ProcSample s;
+    if (pid <= 0) return s;
+    std::ifstream in("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    if (!std::getline(in, line)) return s;
+    // Fields after the parenthesized command: state is field 3
+    std::istringstream rest(line.substr(line.rfind(')') + 2));
+    std::vector<std::string> f((std::istream_iterator<std::string>(rest)), std::istream_iterator<std::string>());
+    if (f.size() < 22) return s;
+    const double tck = (double)sysconf(_SC_CLK_TCK);
+    s.cpu_s = (std::stod(f[11]) + std::stod(f[12])) / tck;     // utime + stime
+    s.threads = std::stol(f[17]);
+    s.rss_mb = std::stod(f[21]) * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+    s.ok = true;
+    return s;
+}
+
+// GET /metrics on the loop (clients keep running meanwhile); empty on failure
+static std::string scrapeMetrics(EventLoop &loop, const sockaddr_storage &addr, socklen_t len, const std::string &host)
+{
+    SimConnection c(loop, addr, len, host);
+    std::string text;
+    bool done = false;
+    c.onResponse = [&](int status, std::string &&body) {
+        if (status == 200) text = std::move(body);
+        done = true;
+    };
+    c.onClose = [&](const char *) { done = true; };
+    if (!c.open()) return text;
+    c.request("GET", "/metrics", std::string());
+    const auto deadline = Clock::now() + std::chrono::seconds(2);
+    while (!done && Clock::now() < deadline) loop.runUntil(std::min(deadline, Clock::now() + std::chrono::milliseconds(10)));
+    return text;
+}
+
+// Sum of every sample of a metric family (labels ignored); -1 when absent
+static double metricSum(const std::string &text, const char *name)
+{
+    double sum = -1.0;
+    const size_t len = std::strlen(name);
+    size_t pos = 0;
+    while ((pos = text.find(name, pos)) != std::string::npos) {
+        const bool line_start = pos == 0 || text[pos - 1] == '\n';
+        const char next = pos + len < text.size() ? text[pos + len] : '\0';
+        if (line_start && (next == ' ' || next == '{')) {
+            const size_t sp = text.find(' ', text.find_first_of(" }", pos + len));
+            sum = std::max(sum, 0.0) + std::atof(text.c_str() + sp + 1);
+        }
+        pos += len;
+    }
+    return sum;
+}
+
+static Json::Value percentiles(const HdrHistogram &h)
+{
+    Json::Value out(Json::objectValue);
+    out["count"] = (Json::UInt64)h.count();
+    out["p50"] = (double)h.percentile(50.0) / 1e3;
+    out["p99"] = (double)h.percentile(99.0) / 1e3;
+    out["p999"] = (double)h.percentile(99.9) / 1e3;
+    out["max"] = (double)h.max() / 1e3;
+    return out;
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    std::string v, url = "http://127.0.0.1:8848";
+    for (int i = 1; i < argc; ++i) {
+        if (cli::argValue(argv[i], "--url", v)) url = v;
+        else if (cli::argValue(argv[i], "--clients", v)) {
+            // N or FROM:TO[:STEP]
+            unsigned long a = 0, b = 0, c = 0;
+            const int n = std::sscanf(v.c_str(), "%lu:%lu:%lu", &a, &b, &c);
+            opt.clients_from = a;
+            opt.clients_to = n >= 2 ? b : a;
+            opt.clients_step = n >= 3 ? c : std::max<size_t>(1, opt.clients_to - opt.clients_from);
+        }
+        else if (cli::argValue(argv[i], "--step", v)) opt.step_s = std::atof(v.c_str());
+        else if (cli::argValue(argv[i], "--settle", v)) opt.settle_s = std::atof(v.c_str());
+        else if (cli::argValue(argv[i], "--mix", v)) {
+            for (double &m : opt.mix) m = 0.0;
+            std::istringstream in(v);
+            std::string kv;
+            while (std::getline(in, kv, ',')) {
+                const size_t eq = kv.find('=');
+                size_t b = 0;
+                while (b < kBehaviors && kv.compare(0, eq, kBehaviorNames[b]) != 0) ++b;
+                if (b == kBehaviors || eq == std::string::npos) {
+                    std::cerr << "unknown behavior in --mix: " << kv << "\n";
+                    return 2;
+                }
+                opt.mix[b] = std::atof(kv.c_str() + eq + 1);
+            }
+        }
+        else if (cli::argValue(argv[i], "--fps", v)) opt.fps = std::max(1.0, std::atof(v.c_str()));
+        else if (cli::argValue(argv[i], "--input-hz", v)) opt.input_hz = std::max(0.1, std::atof(v.c_str()));
+        else if (cli::argValue(argv[i], "--robots", v)) opt.robots = std::strtoul(v.c_str(), nullptr, 10);
+        else if (cli::argValue(argv[i], "--slo-ms", v)) opt.slo_ms = std::atof(v.c_str());
+        else if (cli::argValue(argv[i], "--server-pid", v)) opt.server_pid = std::atoi(v.c_str());
+        else if (cli::argValue(argv[i], "--metrics", v)) opt.scrape_metrics = v != "0";
+        else if (cli::argValue(argv[i], "--seed", v)) opt.seed = std::strtoull(v.c_str(), nullptr, 10);
+        else if (cli::argValue(argv[i], "--out", v)) opt.out_path = v;
+        else {
+            std::cerr << "unknown argument: " << argv[i] << "\n"
+                      << "usage: robot_arm_fleet [--url=http://host:port] [--clients=N|FROM:TO[:STEP]] [--step=S]\n"
+                         "         [--settle=S] [--mix=slider=W,jog=W,pick_place=W] [--fps=N] [--input-hz=N]\n"
+                         "         [--robots=N] [--slo-ms=MS] [--server-pid=PID] [--metrics=0|1] [--seed=N]\n"
+                         "         [--out=FILE]\n";
+            return 2;
+        }
+    }
+    if (!opt.clients_to || opt.clients_to < opt.clients_from || !(opt.step_s > opt.settle_s)) {
+        std::cerr << "need 0 < FROM <= TO clients and --step > --settle\n";
+        return 2;
+    }
+
+    cli::splitUrl(url, opt.host, opt.port);
+
+    sockaddr_storage addr{};
+    socklen_t addr_len = 0;
+    if (!resolveAddress(opt.host, opt.port, addr, addr_len)) {
+        std::cerr << "cannot resolve " << opt.host << "\n";
+        return 2;
+    }
+
+    // One socket per client
+    rlimit lim{};
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < opt.clients_to + 64) {
+        std::cerr << "warning: open file limit " << lim.rlim_cur << " is below " << opt.clients_to
+                  << " clients (ulimit -n)\n";
+    }
+
+    EventLoop loop;
+    StepStats stats;
+    std::vector<std::unique_ptr<Client>> clients;
+    std::mt19937_64 rng(opt.seed);
+    std::discrete_distribution<size_t> pick(std::begin(opt.mix), std::end(opt.mix));
+
+    std::printf("robot_arm_fleet: %s  clients %zu..%zu step %zu  %gs per step (%gs settle)  mix slider=%g jog=%g pick_place=%g\n",
+                url.c_str(), opt.clients_from, opt.clients_to, opt.clients_step, opt.step_s, opt.settle_s,
+                opt.mix[kSlider], opt.mix[kJog], opt.mix[kPickPlace]);
+    std::printf("%8s %9s %9s %9s %9s %9s %9s %9s %7s %7s %8s %8s %6s\n", "clients", "plans/s", "jog_msg/s",
+                "lat_p50", "lat_p99", "lat_p999", "stale_p50", "stale_p99", "errors", "cpu%", "rss_mb",
+                "queue", "lag_ms");
+
+    Json::Value steps(Json::arrayValue);
+    double per_client_ref = 0.0;
+    size_t saturation = 0;
+    std::string saturation_why;
+    double misses_prev = -1.0;
+
+    for (size_t target = opt.clients_from; target <= opt.clients_to; target += opt.clients_step) {
+        // New clients connect spread over connect_spread_s (no SYN storm)
+        const size_t added = target - clients.size();
+        for (size_t i = 0; i < added; ++i) {
+            const size_t id = clients.size();
+            clients.push_back(std::make_unique<Client>(id, (Behavior)pick(rng), loop, addr, addr_len, opt.host, opt, stats));
+            Client *c = clients.back().get();
+            loop.after(opt.connect_spread_s * (double)i / (double)std::max<size_t>(added, 1), [c]() { c->start(); });
+        }
+
+        const auto step_start = Clock::now();
+        const auto window_start = step_start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.settle_s));
+        const auto step_end = step_start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.step_s));
+        loop.runUntil(window_start);
+        stats.reset();
+        const ProcSample p0 = readProc(opt.server_pid);
+        while (Clock::now() < step_end) {
+            loop.runUntil(std::min(step_end, Clock::now() + std::chrono::milliseconds(100)));
+            stats.max_lag_ns = std::max(stats.max_lag_ns, loop.lagNs());
+        }
+        const ProcSample p1 = readProc(opt.server_pid);
+        const double window = std::chrono::duration<double>(Clock::now() - window_start).count();
+
+        // After the window: the scrape is not measured
+        double queue = -1.0, misses = -1.0, in_flight = -1.0;
+        if (opt.scrape_metrics) {
+            const std::string metrics_text = scrapeMetrics(loop, addr, addr_len, opt.host);
+            queue = metricSum(metrics_text, "robot_arm_worker_queue_depth");
+            const double adm = metricSum(metrics_text, "robot_arm_admission_queue_depth");
+            if (adm >= 0.0) queue = std::max(queue, 0.0) + adm;
+            in_flight = metricSum(metrics_text, "robot_arm_requests_in_flight");
+            misses = metricSum(metrics_text, "robot_arm_loop_deadline_misses_total");
+        }
+        const double step_misses = misses >= 0.0 && misses_prev >= 0.0 ? misses - misses_prev : -1.0;
+        misses_prev = misses;
+
+        HdrHistogram lat, stale;
+        for (size_t b = 0; b < kBehaviors; ++b) {
+            lat.merge(stats.latency[b]);
+            stale.merge(stats.staleness[b]);
+        }
+        uint64_t errors = 0;
+        for (const auto &s : stats.status) {
+            if (s.first != 200) errors += s.second;
+        }
+        const double plans_s = (double)stats.responses / window;
+        const double jog_s = (double)stats.jog_messages / window;
+        const double cpu = p0.ok && p1.ok ? (p1.cpu_s - p0.cpu_s) / window * 100.0 : -1.0;
+
+        std::printf("%8zu %9.1f %9.1f %9.2f %9.2f %9.2f %9.2f %9.2f %7llu %7.0f %8.1f %8.0f %6.1f\n", target, plans_s, jog_s,
+                    lat.percentile(50.0) / 1e3, lat.percentile(99.0) / 1e3, lat.percentile(99.9) / 1e3,
+                    stale.percentile(50.0) / 1e3, stale.percentile(99.0) / 1e3,
+                    (unsigned long long)(errors + stats.disconnects), cpu, p1.ok ? p1.rss_mb : -1.0, queue,
+                    (double)stats.max_lag_ns / 1e6);
+        std::fflush(stdout);
+
+        // Saturation: SLO broken, or each client gets clearly less work done than at the first step
+        const double per_client = ((double)stats.responses + (double)stats.jog_messages) / window / (double)target;
+        if (per_client_ref == 0.0) per_client_ref = per_client;
+        if (!saturation) {
+            if (lat.count() && lat.percentile(99.0) / 1e3 > opt.slo_ms) saturation_why = "plan latency p99 above SLO";
+            else if (stale.count() && stale.percentile(99.0) / 1e3 > opt.slo_ms) saturation_why = "staleness p99 above SLO";
+            else if (per_client < 0.8 * per_client_ref) saturation_why = "throughput per client fell below 80 %";
+            if (!saturation_why.empty()) saturation = target;
+        }
+
+        Json::Value s(Json::objectValue);
+        s["clients"] = (Json::UInt64)target;
+        s["window_s"] = window;
+        s["plans_per_s"] = plans_s;
+        s["jog_messages_per_s"] = jog_s;
+        s["bytes_in_per_s"] = (double)stats.bytes_in / window;
+        Json::Value codes(Json::objectValue);
+        for (const auto &c : stats.status) codes[std::to_string(c.first)] = (Json::UInt64)c.second;
+        s["status"] = codes;
+        s["disconnects"] = (Json::UInt64)stats.disconnects;
+        s["latency_ms"] = percentiles(lat);
+        s["staleness_ms"] = percentiles(stale);
+        Json::Value per(Json::objectValue);
+        for (size_t b = 0; b < kBehaviors; ++b) {
+            Json::Value e(Json::objectValue);
+            if (b != kJog) e["latency_ms"] = percentiles(stats.latency[b]);
+            e["staleness_ms"] = percentiles(stats.staleness[b]);
+            per[kBehaviorNames[b]] = e;
+        }
+        s["per_behavior"] = per;
+        Json::Value server(Json::objectValue);
+        if (cpu >= 0.0) {
+            server["cpu_percent"] = cpu;
+            server["rss_mb"] = p1.rss_mb;
+            server["threads"] = (Json::Int64)p1.threads;
+        }
+        if (queue >= 0.0) server["queue_depth"] = queue;
+        if (in_flight >= 0.0) server["requests_in_flight"] = in_flight;
+        if (step_misses >= 0.0) server["loop_deadline_misses"] = step_misses;
+        s["server"] = server;
+        s["simulator_lag_ms"] = (double)stats.max_lag_ns / 1e6;
+        steps.append(s);
+    }
+
+    if (saturation) std::printf("saturation at %zu clients: %s\n", saturation, saturation_why.c_str());
+    else std::printf("no saturation up to %zu clients (SLO %g ms)\n", opt.clients_to, opt.slo_ms);
+
+    if (!opt.out_path.empty()) {
+        Json::Value report(Json::objectValue);
+        Json::Value cfg(Json::objectValue);
+        cfg["url"] = url;
+        cfg["step_s"] = opt.step_s;
+        cfg["settle_s"] = opt.settle_s;
+        cfg["fps"] = opt.fps;
+        cfg["input_hz"] = opt.input_hz;
+        cfg["slo_ms"] = opt.slo_ms;
+        Json::Value mix(Json::objectValue);
+        for (size_t b = 0; b < kBehaviors; ++b) mix[kBehaviorNames[b]] = opt.mix[b];
+        cfg["mix"] = mix;
+        report["config"] = cfg;
+        report["steps"] = steps;
+        report["saturation_clients"] = (Json::UInt64)saturation;
+        if (saturation) report["saturation_reason"] = saturation_why;
+        std::ofstream out(opt.out_path);
+        Json::StreamWriterBuilder w;
+        w["indentation"] = "  ";
+        out << Json::writeString(w, report) << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,344 @@
+// robot_arm_loadgen: open-loop HTTP load generator for the arm API
+//
+//   robot_arm_loadgen --url=http://127.0.0.1:8848 --rate=500 --duration=30
+//                     [--warmup=5] [--connections=64] [--mix=mix.json] [--seed=1]
+//                     [--out=report.json] [--baseline=old_report.json]
+//
+// Requests are issued at a constant arrival rate whether or not earlier ones
+// have completed (open loop). Latency is measured from each request's
+// intended send time, so server stalls show up as queueing delay instead of
+// silently lowering the request rate (no coordinated omission).
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <json/json.h>
+
+#include "cli.hpp"              // tools/common
+#include "hdr_histogram.hpp"
+#include "http_client.hpp"
+#include "latency_report.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// ------------------------------------------------------------
+// Request mix: { "mix": [ entry, ... ] }, entry fields (all optional):
+//   name, weight (1), path ("/arm/plan_pmp_q"), T (1.0) and dt (0.02) as a number
+//   or [min, max] (uniform), format ("json" | "bin"), channels (["q"]),
+//   target: "uniform" (each joint in [-range, range], range 1.5 rad)
+//         | "pool" (pool random targets reused, pool 16)
+//         | "fixed" (q_target), store (false), deadline_ms (none)
+// ------------------------------------------------------------
+struct MixEntry {
+    std::string name = "default";
+    double weight = 1.0;
+    std::string path = "/arm/plan_pmp_q";
+    double T_min = 1.0, T_max = 1.0;
+    double dt_min = 0.02, dt_max = 0.02;
+    std::string format = "json";
+    Json::Value channels;
+    std::string target = "uniform";
+    double range = 1.5;
+    std::vector<std::vector<double>> pool;
+    bool store = false;
+    double deadline_ms = 0.0;
+    std::string headers;    // extra request lines (X-Deadline-Ms)
+};
+
+static void readRange(const Json::Value &v, double &lo, double &hi)
+{
+    if (v.isArray() && v.size() == 2) {
+        lo = v[0].asDouble();
+        hi = v[1].asDouble();
+    } else if (v.isNumeric()) {
+        lo = hi = v.asDouble();
+    }
+}
+
+static std::vector<MixEntry> loadMix(const std::string &path, uint64_t seed)
+{
+    std::vector<MixEntry> mix;
+    if (path.empty()) {
+        mix.emplace_back();
+        return mix;
+    }
+    std::ifstream in(path);
+    Json::Value root;
+    Json::CharReaderBuilder b;
+    std::string errs;
+    if (!in || !Json::parseFromStream(b, in, &root, &errs)) {
+        throw std::runtime_error("cannot read mix " + path + ": " + errs);
+    }
+    std::mt19937_64 rng(seed);
+    for (const auto &e : root["mix"]) {
+        MixEntry m;
+        m.name = e.get("name", "entry" + std::to_string(mix.size())).asString();
+        m.weight = e.get("weight", 1.0).asDouble();
+        m.path = e.get("path", m.path).asString();
+        readRange(e["T"], m.T_min, m.T_max);
+        readRange(e["dt"], m.dt_min, m.dt_max);
+        m.format = e.get("format", "json").asString();
+        m.channels = e["channels"];
+        m.target = e.get("target", "uniform").asString();
+        m.range = e.get("range", 1.5).asDouble();
+        m.store = e.get("store", false).asBool();
+        m.deadline_ms = e.get("deadline_ms", 0.0).asDouble();
+        if (m.deadline_ms > 0.0) {
+            char line[64];
+            std::snprintf(line, sizeof(line), "X-Deadline-Ms: %.3f\r\n", m.deadline_ms);
+            m.headers = line;
+        }
+        if (m.target == "fixed") {
+            std::vector<double> q;
+            for (const auto &v : e["q_target"]) q.push_back(v.asDouble());
+            q.resize(6, 0.0);
+            m.pool.push_back(q);
+        } else if (m.target == "pool") {
+            std::uniform_real_distribution<double> u(-m.range, m.range);
+            const unsigned k = std::max(1u, e.get("pool", 16).asUInt());
+            for (unsigned i = 0; i < k; ++i) {
+                std::vector<double> q(6);
+                for (auto &x : q) x = u(rng);
+                m.pool.push_back(q);
+            }
+        }
+        mix.push_back(std::move(m));
+    }
+    if (mix.empty()) throw std::runtime_error("mix " + path + " has no entries");
+    return mix;
+}
+
+static std::string makeBody(const MixEntry &m, std::mt19937_64 &rng)
+{
+    auto pick = [&rng](double lo, double hi) {
+        return lo == hi ? lo : std::uniform_real_distribution<double>(lo, hi)(rng);
+    };
+    Json::Value body(Json::objectValue);
+    Json::Value q(Json::arrayValue);
+    if (!m.pool.empty()) {
+        const auto &p = m.pool[std::uniform_int_distribution<size_t>(0, m.pool.size() - 1)(rng)];
+        for (double v : p) q.append(v);
+    } else {
+        std::uniform_real_distribution<double> u(-m.range, m.range);
+        for (int i = 0; i < 6; ++i) q.append(u(rng));
+    }
+    body["q_target"] = q;
+    body["T"] = pick(m.T_min, m.T_max);
+    body["dt"] = pick(m.dt_min, m.dt_max);
+    body["format"] = m.format;
+    if (m.channels.isArray()) body["channels"] = m.channels;
+
+    Json::StreamWriterBuilder w;
+    w["indentation"] = "";
+    return Json::writeString(w, body);
+}
+
+// ------------------------------------------------------------
+// Per-worker results (merged at the end, no sharing while running)
+// ------------------------------------------------------------
+struct Stats {
+    std::vector<HdrHistogram> latency;   // per mix entry, from the intended send time (us)
+    std::vector<HdrHistogram> service;   // per mix entry, from the actual send time (us)
+    std::map<int, uint64_t> status;      // HTTP status -> count (0 = transport error)
+    uint64_t bytes_in = 0;
+    uint64_t completed = 0;
+};
+
+struct Arrival {
+    Clock::time_point intended;
+    size_t mix;
+    bool record;                         // false during warm-up
+};
+
+int main(int argc, char *argv[])
+{
+    std::string url = "http://127.0.0.1:8848", mix_path, out_path, baseline_path, v;
+    double rate = 100.0, duration = 10.0, warmup = 2.0, timeout = 30.0;
+    size_t connections = 64;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (cli::argValue(argv[i], "--url", v)) url = v;
+        else if (cli::argValue(argv[i], "--rate", v)) rate = std::atof(v.c_str());
+        else if (cli::argValue(argv[i], "--duration", v)) duration = std::atof(v.c_str());
+        else if (cli::argValue(argv[i], "--warmup", v)) warmup = std::atof(v.c_str());
+        else if (cli::argValue(argv[i], "--timeout", v)) timeout = std::atof(v.c_str());
+        else if (cli::argValue(argv[i], "--connections", v)) connections = std::max(1, std::atoi(v.c_str()));
+        else if (cli::argValue(argv[i], "--mix", v)) mix_path = v;
+        else if (cli::argValue(argv[i], "--seed", v)) seed = std::strtoull(v.c_str(), nullptr, 10);
+        else if (cli::argValue(argv[i], "--out", v)) out_path = v;
+        else if (cli::argValue(argv[i], "--baseline", v)) baseline_path = v;
+        else {
+            std::cerr << "unknown argument: " << argv[i] << "\n"
+                      << "usage: robot_arm_loadgen [--url=http://host:port] [--rate=RPS] [--duration=S]\n"
+                         "         [--warmup=S] [--connections=N] [--timeout=S] [--mix=FILE] [--seed=N]\n"
+                         "         [--out=FILE] [--baseline=FILE]\n";
+            return 2;
+        }
+    }
+    if (!(rate > 0.0) || !(duration > 0.0)) {
+        std::cerr << "rate and duration must be > 0\n";
+        return 2;
+    }
+
+    std::string host, port;
+    cli::splitUrl(url, host, port);
+
+    std::vector<MixEntry> mix;
+    try {
+        mix = loadMix(mix_path, seed);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 2;
+    }
+    std::vector<double> weights;
+    for (const auto &m : mix) weights.push_back(m.weight);
+
+    // Arrival queue: the dispatcher never waits for the workers
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Arrival> queue;
+    bool done = false;
+    size_t backlog_max = 0;
+
+    std::vector<Stats> stats(connections);
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < connections; ++w) {
+        stats[w].latency.assign(mix.size(), HdrHistogram());
+        stats[w].service.assign(mix.size(), HdrHistogram());
+        workers.emplace_back([&, w]() {
+            HttpConnection conn(host, port, timeout);
+            std::mt19937_64 rng(seed * 1000003ull + w);
+            Stats &st = stats[w];
+            for (;;) {
+                Arrival a;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&] { return done || !queue.empty(); });
+                    if (queue.empty()) return;
+                    a = queue.front();
+                    queue.pop_front();
+                }
+                const MixEntry &m = mix[a.mix];
+                std::string path = m.path;
+                if (m.store) path += (path.find('?') == std::string::npos ? "?" : "&") + std::string("store=1");
+                const std::string body = makeBody(m, rng);
+
+                const auto sent = Clock::now();
+                const auto r = conn.request("POST", path, body, "application/json", m.headers);
+                const auto end = Clock::now();
+                if (!a.record) continue;
+                st.latency[a.mix].record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(end - a.intended).count());
+                st.service[a.mix].record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(end - sent).count());
+                ++st.status[r.status];
+                st.bytes_in += r.body_bytes;
+                ++st.completed;
+            }
+        });
+    }
+
+    // Constant-rate dispatcher
+    std::mt19937_64 rng(seed);
+    std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+    const auto start = Clock::now();
+    const double total_s = warmup + duration;
+    const uint64_t total = (uint64_t)(total_s * rate);
+    const auto interval = std::chrono::duration<double>(1.0 / rate);
+    uint64_t sent = 0, recorded = 0;
+    for (uint64_t i = 0; i < total; ++i) {
+        const auto intended = start + std::chrono::duration_cast<Clock::duration>(interval * (double)i);
+        std::this_thread::sleep_until(intended);
+        const bool record = (double)i / rate >= warmup;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(Arrival{intended, pick(rng), record});
+            backlog_max = std::max(backlog_max, queue.size());
+        }
+        cv.notify_one();
+        ++sent;
+        recorded += record;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    cv.notify_all();
+    for (auto &t : workers) t.join();
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Merge per-worker results
+    HdrHistogram all, all_service;
+    std::vector<HdrHistogram> per_mix(mix.size()), per_mix_service(mix.size());
+    std::map<int, uint64_t> status;
+    uint64_t bytes_in = 0, completed = 0;
+    for (const auto &st : stats) {
+        for (size_t m = 0; m < mix.size(); ++m) {
+            per_mix[m].merge(st.latency[m]);
+            per_mix_service[m].merge(st.service[m]);
+            all.merge(st.latency[m]);
+            all_service.merge(st.service[m]);
+        }
+        for (const auto &s : st.status) status[s.first] += s.second;
+        bytes_in += st.bytes_in;
+        completed += st.completed;
+    }
+
+    Json::Value report(Json::objectValue);
+    Json::Value cfg(Json::objectValue);
+    cfg["url"] = url;
+    cfg["rate"] = rate;
+    cfg["duration_s"] = duration;
+    cfg["warmup_s"] = warmup;
+    cfg["connections"] = (Json::UInt64)connections;
+    cfg["mix"] = mix_path.empty() ? "default" : mix_path;
+    cfg["seed"] = (Json::UInt64)seed;
+    report["config"] = cfg;
+
+    Json::Value res(Json::objectValue);
+    res["sent"] = (Json::UInt64)sent;
+    res["recorded"] = (Json::UInt64)recorded;
+    res["completed"] = (Json::UInt64)completed;
+    res["elapsed_s"] = elapsed;
+    res["throughput_rps"] = duration > 0.0 ? (double)completed / duration : 0.0;
+    res["bytes_in"] = (Json::UInt64)bytes_in;
+    res["backlog_max"] = (Json::UInt64)backlog_max;
+    Json::Value codes(Json::objectValue);
+    for (const auto &s : status) codes[std::to_string(s.first)] = (Json::UInt64)s.second;
+    res["status"] = codes;
+    res["latency_us"] = report::latencyJson(all);
+    res["service_us"] = report::latencyJson(all_service);
+    Json::Value pm(Json::objectValue);
+    for (size_t m = 0; m < mix.size(); ++m) {
+        Json::Value e(Json::objectValue);
+        e["latency_us"] = report::latencyJson(per_mix[m]);
+        e["service_us"] = report::latencyJson(per_mix_service[m]);
+        pm[mix[m].name] = e;
+    }
+    res["per_mix"] = pm;
+    report["results"] = res;
+
+    std::printf("robot_arm_loadgen: %s  rate=%g/s  duration=%gs (+%gs warm-up)  connections=%zu\n",
+                url.c_str(), rate, duration, warmup, connections);
+    std::printf("  sent=%llu completed=%llu throughput=%.1f/s backlog_max=%zu\n",
+                (unsigned long long)sent, (unsigned long long)completed,
+                res["throughput_rps"].asDouble(), backlog_max);
+    for (const auto &s : status) std::printf("  status %d: %llu\n", s.first, (unsigned long long)s.second);
+    report::printLatency("latency (intended)", all);
+    report::printLatency("service (sent)", all_service);
+    if (mix.size() > 1) {
+        for (size_t m = 0; m < mix.size(); ++m) report::printLatency(mix[m].name.c_str(), per_mix[m]);
+    }
+
+    if (!baseline_path.empty()) report::compare(baseline_path, report, "intended send");
+    return out_path.empty() || report::write(out_path, report) ? 0 : 1;
+}
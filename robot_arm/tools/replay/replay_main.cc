@@ -0,0 +1,437 @@
+// robot_arm_replay: drives a server with plan requests recorded by custom_config.request_log
+//
+//   robot_arm_replay --log=requests.ralog [--url=http://127.0.0.1:8848] [--speed=1]
+//                    [--connections=64] [--limit=N] [--out=report.json] [--baseline=old.json]
+//
+// --speed=N replays the recorded arrival times N times faster (open loop: requests
+// are sent at their scheduled time whether or not earlier ones completed, latency is
+// measured from that time); --speed=max sends every request as soon as a connection
+// is free (closed loop, latency from the actual send).
+//
+// Recorded /arm/jog sessions are replayed too: each recorded connection opens a
+// WebSocket with its handshake query and sends its text messages at their (scaled)
+// times on one event loop thread; the report counts sessions, frames and setpoint
+// messages received.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <json/json.h>
+
+#include "cli.hpp"             // tools/common
+#include "event_loop.hpp"
+#include "hdr_histogram.hpp"
+#include "http_client.hpp"
+#include "latency_report.hpp"
+#include "sim_connection.hpp"
+#include "plan_codec.hpp"      // PlanChannel
+#include "request_log.hpp"     // reqlog::readAll
+
+using Clock = std::chrono::steady_clock;
+
+// ------------------------------------------------------------
+// Recorded request -> HTTP request (same fields the handlers decoded)
+// ------------------------------------------------------------
+struct Prepared {
+    uint64_t t_ns;                       // recorded arrival
+    const char *route;                   // report key
+    std::string path;
+    std::string body;
+    std::string headers;
+    size_t kind;                         // 0 plan, 1 batch
+};
+
+static Json::Value vec6(const double *v)
+{
+    Json::Value a(Json::arrayValue);
+    for (int i = 0; i < 6; ++i) a.append(v[i]);
+    return a;
+}
+
+static Prepared prepare(const reqlog::Request &r)
+{
+    static const char *channel_names[] = {"q", "dq", "ddq", "u", "J_acc"};
+    static const uint32_t channel_bits[] = {kChanQ, kChanDq, kChanDdq, kChanU, kChanJacc};
+
+    Json::Value body(Json::objectValue);
+    body["format"] = r.format == (uint8_t)PlanFormat::Binary ? "bin" : "json";
+    if (r.channels != kChanQ) {
+        Json::Value ch(Json::arrayValue);
+        for (size_t i = 0; i < 5; ++i) {
+            if (r.channels & channel_bits[i]) ch.append(channel_names[i]);
+        }
+        body["channels"] = ch;
+    }
+
+    Prepared p;
+    p.t_ns = r.t_ns;
+    if (r.kind == reqlog::Kind::Plan) {
+        p.route = "/arm/plan_pmp_q";
+        p.kind = 0;
+        body["q_target"] = vec6(r.q_target);
+        body["T"] = r.T;
+        body["dt"] = r.dt;
+    } else {
+        p.route = "/arm/plan_batch";
+        p.kind = 1;
+        Json::Value items(Json::arrayValue);
+        for (const auto &it : r.items) {
+            Json::Value item(Json::objectValue);
+            if (!(it.flags & reqlog::kItemInvalid)) {
+                if (it.flags & reqlog::kItemQ0) item["q0"] = vec6(it.q0);
+                item["q_target"] = vec6(it.q1);
+                item["T"] = it.T;
+                item["dt"] = it.dt;
+            }
+            items.append(item);
+        }
+        body["items"] = items;
+    }
+    p.path = p.route;
+    if (r.flags & reqlog::kStore) p.path += "?store=1";
+    if (r.flags & reqlog::kDeadline) {
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), "X-Deadline-Ms: %.17g\r\n", r.deadline_ms);
+        p.headers += buf;
+    }
+    if (r.flags & reqlog::kSession) p.headers += "X-Session-Id: " + r.session + "\r\n";
+
+    Json::StreamWriterBuilder w;
+    w["indentation"] = "";
+    p.body = Json::writeString(w, body);
+    return p;
+}
+
+// ------------------------------------------------------------
+// Per-worker results (merged at the end)
+// ------------------------------------------------------------
+struct Stats {
+    HdrHistogram latency[2];             // per kind, from the scheduled send time (us)
+    HdrHistogram service[2];             // per kind, from the actual send time (us)
+    std::map<int, uint64_t> status;
+    uint64_t bytes_in = 0;
+    uint64_t completed = 0;
+};
+
+struct Arrival {
+    Clock::time_point intended;
+    size_t index;
+};
+
+// ------------------------------------------------------------
+// Jog sessions: recorded /arm/jog connections on one event loop thread
+// ------------------------------------------------------------
+class JogReplay {
+public:
+    struct Stats {
+        uint64_t sessions = 0;           // handshakes sent
+        uint64_t frames = 0;             // client messages sent
+        uint64_t messages = 0;           // setpoint messages received
+        uint64_t bytes_in = 0;
+        uint64_t errors = 0;             // refused, or lost before the recorded close
+        uint64_t orphans = 0;            // frames of a connection opened before the log started
+    };
+
+    JogReplay(const sockaddr_storage &addr, socklen_t len, std::string host)
+        : addr_(addr), len_(len), host_(std::move(host))
+    {
+    }
+
+    // Before run(): r must outlive it
+    void schedule(const reqlog::Request &r, Clock::time_point when)
+    {
+        loop_.at(when, [this, &r]() { apply(r); });
+    }
+
+    // Replays everything scheduled, then closes the connections still open at `until`
+    void run(Clock::time_point until)
+    {
+        loop_.runUntil(until);
+        sessions_.clear();
+    }
+
+    const Stats &stats() const { return stats_; }
+
+private:
+    struct Session {
+        std::unique_ptr<SimConnection> conn;
+        std::vector<std::string> pending;    // frames due before the handshake completed
+        bool open = false;
+    };
+
+    void apply(const reqlog::Request &r)
+    {
+        if (r.kind == reqlog::Kind::JogOpen) {
+            auto &slot = sessions_[r.conn];
+            slot = std::make_unique<Session>();
+            Session *s = slot.get();
+            s->conn = std::make_unique<SimConnection>(loop_, addr_, len_, host_);
+            s->conn->onOpen = [this, s]() {
+                s->open = true;
+                for (const auto &f : s->pending) s->conn->sendText(f);
+                s->pending.clear();
+            };
+            s->conn->onMessage = [this](std::string &&payload) {
+                ++stats_.messages;
+                stats_.bytes_in += payload.size();
+            };
+            s->conn->onClose = [this](const char *) { ++stats_.errors; };
+            ++stats_.sessions;
+            if (!s->conn->open()) ++stats_.errors;
+            else s->conn->upgrade("/arm/jog?" + r.text);
+            return;
+        }
+        auto it = sessions_.find(r.conn);
+        if (it == sessions_.end()) {
+            stats_.orphans += r.kind == reqlog::Kind::JogFrame;
+            return;
+        }
+        Session &s = *it->second;
+        if (r.kind == reqlog::Kind::JogClose) {
+            s.conn->close(nullptr);      // ours: not counted as an error
+            sessions_.erase(it);
+            return;
+        }
+        ++stats_.frames;
+        if (s.open) s.conn->sendText(r.text);
+        else s.pending.push_back(r.text);
+    }
+
+    EventLoop loop_;
+    sockaddr_storage addr_;
+    socklen_t len_;
+    std::string host_;
+    std::map<uint64_t, std::unique_ptr<Session>> sessions_;
+    Stats stats_;
+};
+
+// Setpoints still streaming after the last jog record are consumed this long
+constexpr double kJogDrainS = 1.0;
+
+int main(int argc, char *argv[])
+{
+    std::string url = "http://127.0.0.1:8848", log_path, out_path, baseline_path, v;
+    double speed = 1.0, timeout = 30.0;     // speed 0: as fast as possible
+    size_t connections = 64, limit = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (cli::argValue(argv[i], "--log", v)) log_path = v;
+        else if (cli::argValue(argv[i], "--url", v)) url = v;
+        else if (cli::argValue(argv[i], "--speed", v)) {
+            speed = v == "max" ? 0.0 : std::atof(v.c_str());
+            if (v != "max" && !(speed > 0.0 && std::isfinite(speed))) {
+                std::cerr << "--speed must be a factor > 0 or max\n";
+                return 2;
+            }
+        }
+        else if (cli::argValue(argv[i], "--connections", v)) connections = std::max(1, std::atoi(v.c_str()));
+        else if (cli::argValue(argv[i], "--limit", v)) limit = std::strtoull(v.c_str(), nullptr, 10);
+        else if (cli::argValue(argv[i], "--timeout", v)) timeout = std::atof(v.c_str());
+        else if (cli::argValue(argv[i], "--out", v)) out_path = v;
+        else if (cli::argValue(argv[i], "--baseline", v)) baseline_path = v;
+        else {
+            std::cerr << "unknown argument: " << argv[i] << "\n"
+                      << "usage: robot_arm_replay --log=FILE [--url=http://host:port] [--speed=N|max]\n"
+                         "         [--connections=N] [--limit=N] [--timeout=S] [--out=FILE] [--baseline=FILE]\n";
+            return 2;
+        }
+    }
+    if (log_path.empty()) {
+        std::cerr << "--log is required\n";
+        return 2;
+    }
+
+    std::string host, port;
+    cli::splitUrl(url, host, port);
+
+    // Bodies are built up front: the dispatcher only schedules
+    reqlog::Log log;
+    try {
+        log = reqlog::readAll(log_path);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 2;
+    }
+    if (limit && log.requests.size() > limit) log.requests.resize(limit);
+    if (log.requests.empty()) {
+        std::cerr << log_path << ": no requests\n";
+        return 2;
+    }
+    std::vector<Prepared> prepared;
+    std::vector<const reqlog::Request *> jog;
+    prepared.reserve(log.requests.size());
+    for (const auto &r : log.requests) {
+        if (reqlog::isJog(r.kind)) jog.push_back(&r);
+        else prepared.push_back(prepare(r));
+    }
+    const uint64_t t0 = log.requests.front().t_ns;
+    const double recorded_s = (double)(log.requests.back().t_ns - t0) * 1e-9;
+    // Recorded gaps divided by speed, or everything at once
+    auto scheduled = [&](Clock::time_point start, uint64_t t_ns) {
+        if (!(speed > 0.0)) return start;
+        return start + std::chrono::duration_cast<Clock::duration>(
+                           std::chrono::duration<double>((double)(t_ns - t0) * 1e-9 / speed));
+    };
+
+    sockaddr_storage addr{};
+    socklen_t addr_len = 0;
+    if (!jog.empty() && !resolveAddress(host, port, addr, addr_len)) {
+        std::cerr << "cannot resolve " << host << "\n";
+        return 2;
+    }
+    JogReplay jog_replay(addr, addr_len, host);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Arrival> queue;
+    bool done = false;
+    size_t backlog_max = 0;
+
+    std::vector<Stats> stats(connections);
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < connections; ++w) {
+        workers.emplace_back([&, w]() {
+            HttpConnection conn(host, port, timeout);
+            Stats &st = stats[w];
+            for (;;) {
+                Arrival a;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&] { return done || !queue.empty(); });
+                    if (queue.empty()) return;
+                    a = queue.front();
+                    queue.pop_front();
+                }
+                const Prepared &p = prepared[a.index];
+                const auto sent = Clock::now();
+                const auto r = conn.request("POST", p.path, p.body, "application/json", p.headers);
+                const auto end = Clock::now();
+                const auto from = speed > 0.0 ? a.intended : sent;
+                st.latency[p.kind].record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(end - from).count());
+                st.service[p.kind].record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(end - sent).count());
+                ++st.status[r.status];
+                st.bytes_in += r.body_bytes;
+                ++st.completed;
+            }
+        });
+    }
+
+    // Jog sessions run on their own loop; the dispatcher below only schedules HTTP requests
+    const auto start = Clock::now();
+    std::thread jog_thread;
+    if (!jog.empty()) {
+        for (const reqlog::Request *r : jog) jog_replay.schedule(*r, scheduled(start, r->t_ns));
+        const auto until = scheduled(start, jog.back()->t_ns) +
+                           std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(kJogDrainS));
+        jog_thread = std::thread([&jog_replay, until]() { jog_replay.run(until); });
+    }
+
+    // Dispatcher
+    for (size_t i = 0; i < prepared.size(); ++i) {
+        const auto intended = scheduled(start, prepared[i].t_ns);
+        if (speed > 0.0) std::this_thread::sleep_until(intended);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(Arrival{intended, i});
+            backlog_max = std::max(backlog_max, queue.size());
+        }
+        cv.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    cv.notify_all();
+    for (auto &t : workers) t.join();
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    if (jog_thread.joinable()) jog_thread.join();
+    const JogReplay::Stats &js = jog_replay.stats();
+
+    HdrHistogram all, all_service, per_kind[2], per_kind_service[2];
+    std::map<int, uint64_t> status;
+    uint64_t bytes_in = 0, completed = 0;
+    for (const auto &st : stats) {
+        for (size_t k = 0; k < 2; ++k) {
+            per_kind[k].merge(st.latency[k]);
+            per_kind_service[k].merge(st.service[k]);
+            all.merge(st.latency[k]);
+            all_service.merge(st.service[k]);
+        }
+        for (const auto &s : st.status) status[s.first] += s.second;
+        bytes_in += st.bytes_in;
+        completed += st.completed;
+    }
+
+    Json::Value report(Json::objectValue);
+    Json::Value cfg(Json::objectValue);
+    cfg["url"] = url;
+    cfg["log"] = log_path;
+    cfg["speed"] = speed > 0.0 ? Json::Value(speed) : Json::Value("max");
+    cfg["connections"] = (Json::UInt64)connections;
+    cfg["recorded_s"] = recorded_s;
+    report["config"] = cfg;
+
+    Json::Value res(Json::objectValue);
+    res["sent"] = (Json::UInt64)prepared.size();
+    res["completed"] = (Json::UInt64)completed;
+    res["elapsed_s"] = elapsed;
+    res["throughput_rps"] = elapsed > 0.0 ? (double)completed / elapsed : 0.0;
+    res["bytes_in"] = (Json::UInt64)bytes_in;
+    res["backlog_max"] = (Json::UInt64)backlog_max;
+    Json::Value codes(Json::objectValue);
+    for (const auto &s : status) codes[std::to_string(s.first)] = (Json::UInt64)s.second;
+    res["status"] = codes;
+    res["latency_us"] = report::latencyJson(all);
+    res["service_us"] = report::latencyJson(all_service);
+    Json::Value routes(Json::objectValue);
+    const char *route_names[2] = {"/arm/plan_pmp_q", "/arm/plan_batch"};
+    for (size_t k = 0; k < 2; ++k) {
+        if (!per_kind[k].count()) continue;
+        Json::Value e(Json::objectValue);
+        e["latency_us"] = report::latencyJson(per_kind[k]);
+        e["service_us"] = report::latencyJson(per_kind_service[k]);
+        routes[route_names[k]] = e;
+    }
+    res["per_route"] = routes;
+    if (js.sessions || js.orphans) {
+        Json::Value j(Json::objectValue);
+        j["sessions"] = (Json::UInt64)js.sessions;
+        j["frames"] = (Json::UInt64)js.frames;
+        j["messages_in"] = (Json::UInt64)js.messages;
+        j["bytes_in"] = (Json::UInt64)js.bytes_in;
+        j["errors"] = (Json::UInt64)js.errors;
+        j["orphan_frames"] = (Json::UInt64)js.orphans;
+        res["jog"] = j;
+    }
+    report["results"] = res;
+
+    char speed_s[32] = "max";
+    if (speed > 0.0) std::snprintf(speed_s, sizeof(speed_s), "%gx", speed);
+    std::printf("robot_arm_replay: %s -> %s  requests=%zu  recorded=%.1fs  speed=%s  connections=%zu\n",
+                log_path.c_str(), url.c_str(), prepared.size(), recorded_s, speed_s, connections);
+    std::printf("  completed=%llu elapsed=%.1fs throughput=%.1f/s backlog_max=%zu\n",
+                (unsigned long long)completed, elapsed, res["throughput_rps"].asDouble(), backlog_max);
+    for (const auto &s : status) std::printf("  status %d: %llu\n", s.first, (unsigned long long)s.second);
+    report::printLatency(speed > 0.0 ? "latency (scheduled)" : "latency", all);
+    report::printLatency("service (sent)", all_service);
+    for (size_t k = 0; k < 2; ++k) {
+        if (per_kind[k].count()) report::printLatency(route_names[k], per_kind[k]);
+    }
+    if (js.sessions || js.orphans) {
+        std::printf("  /arm/jog: sessions=%llu frames=%llu setpoint messages=%llu errors=%llu orphan frames=%llu\n",
+                    (unsigned long long)js.sessions, (unsigned long long)js.frames,
+                    (unsigned long long)js.messages, (unsigned long long)js.errors,
+                    (unsigned long long)js.orphans);
+    }
+
+    if (!baseline_path.empty()) report::compare(baseline_path, report, "scheduled send");
+    return out_path.empty() || report::write(out_path, report) ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+// robot_arm_trajlib: compiles canonical moves into a trajectory library (include/trajectory_library.hpp)
+//
+//   robot_arm_trajlib --moves=moves.json --out=library.ratl [--version=N] [--formats=json,bin]
+//                     [--q-quantum=1e-6] [--t-quantum=1e-6]
+//   robot_arm_trajlib --inspect=library.ratl
+//
+// moves.json: {"moves": [...]} or a bare array, one move per element in the /arm/plan_pmp_q
+// layout: {"q0": [6] (default: zero pose), "q_target": [6], "T", "dt", "format"?, "channels"?}.
+// The warm-up snapshot of the server (custom_config.warmup.snapshot) has the same layout.
+// Moves without "format" are compiled once per --formats entry. The library replaces --out
+// atomically (temp file + rename): a running server picks it up at its next check.
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <json/json.h>
+
+#include "cli.hpp"                  // tools/common
+#include "plan_codec.hpp"           // serialize_plan, parse_plan_format
+#include "trajectory.hpp"           // plan_pmp_minimum_jerk, make_quintic_trajectory
+#include "trajectory_library.hpp"   // trajlib::Builder
+
+static bool readVec6(const Json::Value &arr, std::vector<double> &out)
+{
+    if (!arr.isArray() || arr.size() < 6) return false;
+    out.resize(6);
+    for (Json::ArrayIndex i = 0; i < 6; ++i) {
+        if (!arr[i].isNumeric()) return false;
+        out[i] = arr[i].asDouble();
+        if (!std::isfinite(out[i])) return false;
+    }
+    return true;
+}
+
+static int inspect(const std::string &path)
+{
+    std::shared_ptr<const trajlib::Library> lib;
+    try {
+        lib = trajlib::Library::open(path);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    std::printf("%s: version %llu, %zu entries, %zu bytes\n", path.c_str(),
+                (unsigned long long)lib->version(), lib->entries(), lib->bytes());
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string moves_path, out_path, inspect_path, formats = "json,bin", v;
+    uint64_t version = (uint64_t)std::time(nullptr);
+    double q_quantum = 1e-6, t_quantum = 1e-6;
+    for (int i = 1; i < argc; ++i) {
+        if (cli::argValue(argv[i], "--moves", v)) moves_path = v;
+        else if (cli::argValue(argv[i], "--out", v)) out_path = v;
+        else if (cli::argValue(argv[i], "--version", v)) version = std::strtoull(v.c_str(), nullptr, 10);
+        else if (cli::argValue(argv[i], "--formats", v)) formats = v;
+        else if (cli::argValue(argv[i], "--q-quantum", v)) q_quantum = std::atof(v.c_str());
+        else if (cli::argValue(argv[i], "--t-quantum", v)) t_quantum = std::atof(v.c_str());
+        else if (cli::argValue(argv[i], "--inspect", v)) inspect_path = v;
+        else {
+            std::cerr << "unknown argument: " << argv[i] << "\n"
+                      << "usage: robot_arm_trajlib --moves=FILE --out=FILE [--version=N] [--formats=json,bin]\n"
+                         "         [--q-quantum=RAD] [--t-quantum=S]\n"
+                         "       robot_arm_trajlib --inspect=FILE\n";
+            return 2;
+        }
+    }
+    if (!inspect_path.empty()) return inspect(inspect_path);
+    if (moves_path.empty() || out_path.empty() || !(q_quantum > 0.0) || !(t_quantum > 0.0) ||
+        !std::isfinite(q_quantum) || !std::isfinite(t_quantum)) {
+        std::cerr << "--moves and --out are required, quanta must be finite and > 0\n";
+        return 2;
+    }
+
+    std::vector<PlanFormat> default_formats;
+    for (size_t pos = 0; pos <= formats.size();) {
+        size_t end = formats.find(',', pos);
+        if (end == std::string::npos) end = formats.size();
+        PlanFormat f;
+        if (!parse_plan_format(formats.substr(pos, end - pos), f)) {
+            std::cerr << "--formats: \"json\" and/or \"bin\"\n";
+            return 2;
+        }
+        default_formats.push_back(f);
+        pos = end + 1;
+    }
+
+    Json::Value root;
+    {
+        std::ifstream in(moves_path, std::ios::binary);
+        std::string errs;
+        Json::CharReaderBuilder b;
+        if (!in || !Json::parseFromStream(b, in, &root, &errs)) {
+            std::cerr << moves_path << ": cannot read: " << errs << "\n";
+            return 2;
+        }
+    }
+    const Json::Value &moves = root.isArray() ? root : root["moves"];
+    if (!moves.isArray()) {
+        std::cerr << moves_path << ": expected {\"moves\": [...]} or an array\n";
+        return 2;
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    trajlib::Builder lib(q_quantum, t_quantum);
+    size_t failed = 0, duplicates = 0, samples = 0;
+    for (Json::ArrayIndex i = 0; i < moves.size(); ++i) {
+        const Json::Value &m = moves[i];
+        std::vector<double> q0(6, 0.0), q1;
+        PlanOptions opt;
+        const double T = m.get("T", 1.0).asDouble();
+        const double dt = m.get("dt", 0.02).asDouble();
+        if (!m.isObject() || !readVec6(m["q_target"], q1) || (m.isMember("q0") && !readVec6(m["q0"], q0)) ||
+            (m.isMember("channels") && !parse_plan_channels(m["channels"], opt.channels))) {
+            std::cerr << "move " << i << ": malformed, skipped\n";
+            ++failed;
+            continue;
+        }
+        std::vector<PlanFormat> move_formats = default_formats;
+        if (m.isMember("format")) {
+            if (!parse_plan_format(m["format"].asString(), opt.format)) {
+                std::cerr << "move " << i << ": format must be \"json\" or \"bin\", skipped\n";
+                ++failed;
+                continue;
+            }
+            move_formats = {opt.format};
+        }
+        try {
+            // Same planner and serializer as /arm/plan_pmp_q: the bodies are byte-identical
+            const QuinticTrajectory coeffs = make_quintic_trajectory(q0, q1, T);
+            const auto traj = plan_pmp_minimum_jerk(q0, q1, T, dt);
+            for (PlanFormat f : move_formats) {
+                opt.format = f;
+                const PlanKey key = make_plan_key(q0, q1, T, dt, opt, q_quantum, t_quantum);
+                if (!lib.add(key, coeffs, dt, f, serialize_plan(traj, dt, opt))) ++duplicates;
+                else samples += traj.size();
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "move " << i << ": " << e.what() << ", skipped\n";
+            ++failed;
+        }
+    }
+    if (lib.size() == 0) {
+        std::cerr << "no moves compiled\n";
+        return 1;
+    }
+
+    try {
+        lib.write(out_path, version);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("%s: version %llu, %zu entries (%zu samples) from %u moves in %.2f s; %zu skipped, %zu duplicates\n",
+                out_path.c_str(), (unsigned long long)version, lib.size(), samples, moves.size(), s, failed,
+                duplicates);
+    return inspect(out_path) == 0 && failed == 0 ? 0 : 1;
+}